@@ -0,0 +1,911 @@
+/********************************************************************
+ *
+ * Module Name : AccCodec.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Lossless fixed predictor and Rice block codec.
+ *
+ * Restrictions/Limitations :
+ *   SSE2 is part of x86-64, other machines get the scalar loops.
+ *   Lane sums are 32 bits, safe for kMaxFrames of 16 bit samples
+ *   whose third difference is under 2^18.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+// Local Includes.
+#include "AccCodec.hh"
+#include "debug.h"
+
+const char* const AccCodec::kName = "rice";
+
+/* "ACB" and the format version, as a little endian word. */
+static const uint32_t kSync = 0x01424341;
+
+/* Header word that has to agree with the rest of the header. */
+static inline uint32_t Guard(const AccCodec::Block &b)
+{
+    return kSync ^ b.bytes ^ (uint32_t) b.first ^ (uint32_t) (b.first >> 32) ^
+        (b.frames | (b.channels << 16)) ^ b.check ^ 0x5A5A5A5A;
+}
+
+/**
+ ******************************************************************
+ *
+ * Function Name : AccCodec constructor
+ *
+ * Description : Size the scratch space for the largest block.
+ *
+ * Inputs : NChan       - channels per frame
+ *          BlockFrames - frames per encoded block
+ *
+ * Returns : none
+ *
+ * Error Conditions : none, BlockFrames is clipped to kMaxFrames
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+AccCodec::AccCodec(uint32_t NChan, uint32_t BlockFrames)
+{
+    SET_DEBUG_STACK;
+    fNChannels   = (NChan > 0) ? NChan : 1;
+    fBlockFrames = (BlockFrames > kMaxFrames) ? kMaxFrames :
+        ((BlockFrames > 0) ? BlockFrames : 1);
+    for (uint32_t p=0; p<4; p++) fD[p].resize(kMaxFrames + 4);
+    fU.resize(kMaxFrames + 4);
+    fOut   = NULL;
+    fAcc   = 0;
+    fNBits = 0;
+    fIn    = NULL;
+    fEnd   = NULL;
+    fPos   = 0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AccCodec destructor
+ *
+ * Description : Nothing to do, the vectors look after themselves.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+AccCodec::~AccCodec(void)
+{
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Encode
+ *
+ * Description : One block, the channels one after the other in the
+ *               bit stream, padded to a whole byte, the header in
+ *               front.
+ *
+ * Inputs : in      - interleaved frames
+ *          nFrames - frames, at most BlockFrames
+ *          First   - frame in the file of in[0]
+ *          out     - MaxBytes() for the block
+ *
+ * Returns : bytes in the block
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+size_t AccCodec::Encode(const int16_t *in, uint32_t nFrames, uint64_t First,
+                        uint8_t *out)
+{
+    SET_DEBUG_STACK;
+    Block    b;
+    uint32_t guard;
+
+    if (nFrames > fBlockFrames) nFrames = fBlockFrames;
+    fOut   = out + kHeaderBytes;
+    fAcc   = 0;
+    fNBits = 0;
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        EncodeChannel(in + c, nFrames);
+    }
+    PutFlush();
+
+    b.bytes    = fOut - out;
+    b.first    = First;
+    b.frames   = nFrames;
+    b.channels = fNChannels;
+    b.check    = Check(in, (size_t) nFrames * fNChannels);
+    guard      = Guard(b);
+    uint16_t frames   = b.frames;
+    uint16_t channels = b.channels;
+    memcpy(out,      &kSync,    4);
+    memcpy(out + 4,  &b.bytes,  4);
+    memcpy(out + 8,  &b.first,  8);
+    memcpy(out + 16, &frames,   2);
+    memcpy(out + 18, &channels, 2);
+    memcpy(out + 20, &b.check,  4);
+    memcpy(out + 24, &guard,    4);
+    SET_DEBUG_STACK;
+    return b.bytes;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : EncodeChannel
+ *
+ * Description : Take the differences to third order and keep the
+ *               order with the smallest absolute residual. Each
+ *               partition gets the Rice parameter that codes it in
+ *               the fewest bits, tried either side of log2 of the
+ *               mean. Verbatim if nothing beats 16 bits a sample.
+ *
+ * Inputs : in - first sample of the channel, fNChannels apart
+ *          n  - samples
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccCodec::EncodeChannel(const int16_t *in, uint32_t n)
+{
+    const uint32_t nPart = (n + kPartition - 1) / kPartition;
+    int32_t       *x     = fD[0].data();
+    uint32_t      *u     = fU.data();
+    uint8_t        k[kMaxFrames / kPartition];
+    uint64_t       best, sum, bits, total, trial;
+    uint32_t       p, i, j, lo, hi, m, q, kk;
+
+    for (i=0; i<n; i++) x[i] = in[(size_t) i * fNChannels];
+    for (p=1; p<4; p++) Diff(fD[p-1].data(), fD[p].data(), n);
+
+    // Same samples for every order, so the sums compare.
+    p    = 0;
+    best = ~0ULL;
+    if (n > 3)
+    {
+        for (j=0; j<4; j++)
+        {
+            sum = AbsSum(fD[j].data() + 3, n - 3);
+            if (sum < best)
+            {
+                best = sum;
+                p    = j;
+            }
+        }
+    }
+    ZigZag(fD[p].data(), u, n);
+
+    total = 3 + 16 * p;
+    for (j=0; j<nPart; j++)
+    {
+        lo = (j == 0) ? p : j * kPartition;
+        hi = (j + 1) * kPartition;
+        if (hi > n) hi = n;
+        m  = (hi > lo) ? hi - lo : 0;
+        k[j] = 0;
+        bits = 0;
+        if (m > 0)
+        {
+            sum  = Sum(u + lo, m) / m;
+            kk   = (sum > 0) ? 63 - __builtin_clzll(sum) : 0;
+            if (kk > kMaxK) kk = kMaxK;
+            bits = Bits(u + lo, m, kk);
+            k[j] = kk;
+            if ((kk > 0) && ((trial = Bits(u + lo, m, kk - 1)) < bits))
+            {
+                bits = trial;
+                k[j] = kk - 1;
+            }
+            else if ((kk < kMaxK) && ((trial = Bits(u + lo, m, kk + 1)) < bits))
+            {
+                bits = trial;
+                k[j] = kk + 1;
+            }
+        }
+        total += 5 + bits;
+    }
+
+    if (total >= 3 + 16 * (uint64_t) n)
+    {
+        Put(kVerbatim, 3);
+        for (i=0; i<n; i++) Put((uint16_t) x[i], 16);
+        return;
+    }
+    Put(p, 3);
+    for (i=0; i<p; i++) Put((uint16_t) x[i], 16);
+    for (j=0; j<nPart; j++)
+    {
+        lo = (j == 0) ? p : j * kPartition;
+        hi = (j + 1) * kPartition;
+        if (hi > n) hi = n;
+        kk = k[j];
+        Put(kk, 5);
+        for (i=lo; i<hi; i++)
+        {
+            q = u[i] >> kk;
+            if (q >= kEscape)
+            {
+                Put((1u << kEscape) - 1, kEscape);
+                Put(u[i], kRaw);
+            }
+            else if (q + 1 + kk <= 32)
+            {
+                // q ones, a zero and the low bits in one go.
+                Put((uint32_t) (((((uint64_t) 1 << q) - 1) << (kk + 1)) |
+                                (u[i] & ((1u << kk) - 1))), q + 1 + kk);
+            }
+            else
+            {
+                Put(((1u << q) - 1) << 1, q + 1);
+                Put(u[i] & ((1u << kk) - 1), kk);
+            }
+        }
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Decode
+ *
+ * Description : Check the header, run the bit stream back out
+ *               into interleaved samples and compare the check.
+ *
+ * Inputs : in  - block header
+ *          n   - bytes available from in
+ *          out - frames x channels samples
+ *
+ * Returns : true if the whole block decoded and checks
+ *
+ * Error Conditions : false on a bad header, a short block, a
+ *                    channel count that is not ours or a bad check
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool AccCodec::Decode(const uint8_t *in, size_t n, int16_t *out)
+{
+    SET_DEBUG_STACK;
+    Block b;
+
+    if (!Peek(in, n, b) || (b.bytes > n) || (b.channels != fNChannels))
+    {
+        return false;
+    }
+    fIn  = in + kHeaderBytes;
+    fEnd = in + b.bytes;
+    fPos = 0;
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        if (!DecodeChannel(out + c, b.frames, fNChannels)) return false;
+    }
+    SET_DEBUG_STACK;
+    return (fPos <= 8 * (uint64_t) (fEnd - fIn)) &&
+        (Check(out, (size_t) b.frames * fNChannels) == b.check);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : DecodeChannel
+ *
+ * Description : Residuals back through the Rice codes, one peek a
+ *               code, then the predictor undone as order prefix
+ *               sums, each started from the differences of the
+ *               warm up samples.
+ *
+ * Inputs : out    - first sample of the channel
+ *          n      - samples
+ *          stride - samples between frames
+ *
+ * Returns : false if the stream is not valid
+ *
+ * Error Conditions : bad order or Rice parameter, or reading past
+ *                    the end of the block
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool AccCodec::DecodeChannel(int16_t *out, uint32_t n, uint32_t stride)
+{
+    const uint32_t nPart = (n + kPartition - 1) / kPartition;
+    int32_t       *x     = fD[0].data();
+    int32_t        carry[4], t[4];
+    uint64_t       w;
+    uint32_t       p, i, j, lo, hi, k, q, u;
+
+    p = Get(3);
+    if (p == kVerbatim)
+    {
+        for (i=0; i<n; i++) out[(size_t) i * stride] = (int16_t) Get(16);
+        return (fPos <= 8 * (uint64_t) (fEnd - fIn));
+    }
+    if ((p > 3) || (p > n)) return false;
+    for (i=0; i<p; i++) x[i] = (int16_t) Get(16);
+
+    for (j=0; j<nPart; j++)
+    {
+        lo = (j == 0) ? p : j * kPartition;
+        hi = (j + 1) * kPartition;
+        if (hi > n) hi = n;
+        k  = Get(5);
+        if (k > kMaxK) return false;
+        for (i=lo; i<hi; i++)
+        {
+            // At least 57 good bits, more than the longest code.
+            w = Peek64();
+            if ((~w >> (64 - kEscape)) == 0)
+            {
+                fPos += kEscape;
+                u     = Get(kRaw);
+            }
+            else
+            {
+                q     = __builtin_clzll(~w);
+                u     = (k > 0) ? (q << k) | (uint32_t) ((w << (q + 1)) >> (64 - k)) : q;
+                fPos += q + 1 + k;
+            }
+            x[i] = (int32_t) (u >> 1) ^ -(int32_t) (u & 1);
+        }
+        if (fPos > 8 * (uint64_t) (fEnd - fIn)) return false;
+    }
+
+    // carry[j] is the j-th difference at the last warm up sample.
+    for (j=0; j<p; j++) t[j] = x[j];
+    if (p > 0) carry[0] = t[p-1];
+    for (j=1; j<p; j++)
+    {
+        for (i=p-1; i>=j; i--) t[i] -= t[i-1];
+        carry[j] = t[p-1];
+    }
+    for (j=p; j-- > 0; )
+    {
+        Integrate(x + p, n - p, carry[j]);
+    }
+    for (i=0; i<n; i++) out[(size_t) i * stride] = (int16_t) x[i];
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Peek
+ *
+ * Description : Is there a believable header at in? The sync word,
+ *               the guard word and sizes that could be a block.
+ *               The block need not all be in the n bytes.
+ *
+ * Inputs : in - candidate header
+ *          n  - bytes available
+ *          b  - filled in
+ *
+ * Returns : true if it is a header
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool AccCodec::Peek(const uint8_t *in, size_t n, Block &b)
+{
+    uint32_t sync, guard;
+    uint16_t frames, channels;
+
+    if (n < kHeaderBytes) return false;
+    memcpy(&sync, in, 4);
+    if (sync != kSync) return false;
+    memcpy(&b.bytes,   in + 4,  4);
+    memcpy(&b.first,   in + 8,  8);
+    memcpy(&frames,    in + 16, 2);
+    memcpy(&channels,  in + 18, 2);
+    memcpy(&b.check,   in + 20, 4);
+    memcpy(&guard,     in + 24, 4);
+    b.frames   = frames;
+    b.channels = channels;
+    return (guard == Guard(b)) && (b.frames > 0) && (b.frames <= kMaxFrames) &&
+        (b.channels > 0) && (b.bytes > kHeaderBytes) &&
+        (b.bytes <= kHeaderBytes + b.channels * (2 * b.frames + 1) + 8);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Sync
+ *
+ * Description : Scan for the first byte of the sync word and try
+ *               a header there.
+ *
+ * Inputs : in - bytes to search
+ *          n  - how many
+ *
+ * Returns : offset of the header, n if there is none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+size_t AccCodec::Sync(const uint8_t *in, size_t n)
+{
+    const uint8_t *p   = in;
+    const uint8_t *end = in + n;
+    Block          b;
+
+    while ((p = (const uint8_t *) memchr(p, kSync & 0xFF, end - p)) != NULL)
+    {
+        if (Peek(p, end - p, b)) return p - in;
+        p++;
+    }
+    return n;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Put
+ *
+ * Description : Append the low nbits of v. Whole 32 bit words go
+ *               out as soon as they are complete.
+ *
+ * Inputs : v     - bits, below 2^nbits
+ *          nbits - at most 32
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+inline void AccCodec::Put(uint32_t v, uint32_t nbits)
+{
+    fAcc    = (fAcc << nbits) | v;
+    fNBits += nbits;
+    if (fNBits >= 32)
+    {
+        fNBits -= 32;
+        uint32_t word = __builtin_bswap32((uint32_t) (fAcc >> fNBits));
+        memcpy(fOut, &word, 4);
+        fOut += 4;
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : PutFlush
+ *
+ * Description : Zero pad to a byte and write what is left.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccCodec::PutFlush(void)
+{
+    if (fNBits % 8) Put(0, 8 - fNBits % 8);
+    while (fNBits >= 8)
+    {
+        fNBits -= 8;
+        *fOut++ = (uint8_t) (fAcc >> fNBits);
+    }
+    fAcc = 0;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Peek64
+ *
+ * Description : The next 64 bits of the stream from fPos, the
+ *               first of them in the top bit. Only the top 57 are
+ *               all stream bits. Zeros past the end of the block.
+ *
+ * Inputs : none
+ *
+ * Returns : bits
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+inline uint64_t AccCodec::Peek64(void) const
+{
+    const uint8_t *p = fIn + (fPos >> 3);
+    uint64_t       w = 0;
+
+    if (p + 8 <= fEnd)
+    {
+        memcpy(&w, p, 8);
+        w = __builtin_bswap64(w);
+    }
+    else
+    {
+        for (uint32_t i=0; i<8; i++)
+        {
+            w = (w << 8) | ((p + i < fEnd) ? p[i] : 0);
+        }
+    }
+    return w << (fPos & 7);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Get
+ *
+ * Description : Next nbits of the stream.
+ *
+ * Inputs : nbits - 1 to 32
+ *
+ * Returns : bits
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+inline uint32_t AccCodec::Get(uint32_t nbits)
+{
+    uint32_t v = (uint32_t) (Peek64() >> (64 - nbits));
+    fPos += nbits;
+    return v;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Diff
+ *
+ * Description : First difference, d[0] = a[0].
+ *
+ * Inputs : a - samples
+ *          d - differences, not a
+ *          n - length
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccCodec::Diff(const int32_t *a, int32_t *d, uint32_t n)
+{
+    uint32_t i = 1;
+    if (n == 0) return;
+    d[0] = a[0];
+#if defined(__SSE2__)
+    for (; i+4<=n; i+=4)
+    {
+        _mm_storeu_si128((__m128i *) &d[i],
+                         _mm_sub_epi32(_mm_loadu_si128((const __m128i *) &a[i]),
+                                       _mm_loadu_si128((const __m128i *) &a[i-1])));
+    }
+#endif
+    for (; i<n; i++) d[i] = a[i] - a[i-1];
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AbsSum
+ *
+ * Description : Sum of |a[i]|, abs as (x ^ s) - s with s the sign.
+ *
+ * Inputs : a - values
+ *          n - length
+ *
+ * Returns : sum
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint64_t AccCodec::AbsSum(const int32_t *a, uint32_t n)
+{
+    uint64_t sum = 0;
+    uint32_t i   = 0;
+#if defined(__SSE2__)
+    __m128i  acc = _mm_setzero_si128();
+    __m128i  v, s;
+    uint32_t t[4];
+
+    for (; i+4<=n; i+=4)
+    {
+        v   = _mm_loadu_si128((const __m128i *) &a[i]);
+        s   = _mm_srai_epi32(v, 31);
+        acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_xor_si128(v, s), s));
+    }
+    _mm_storeu_si128((__m128i *) t, acc);
+    sum = (uint64_t) t[0] + t[1] + t[2] + t[3];
+#endif
+    for (; i<n; i++) sum += (a[i] < 0) ? -(int64_t) a[i] : a[i];
+    return sum;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ZigZag
+ *
+ * Description : Signed to unsigned, 0, -1, 1, -2 ... to 0, 1, 2,
+ *               3 ..., as (x << 1) ^ (x >> 31).
+ *
+ * Inputs : a - residuals
+ *          u - mapped
+ *          n - length
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccCodec::ZigZag(const int32_t *a, uint32_t *u, uint32_t n)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    __m128i  v;
+    for (; i+4<=n; i+=4)
+    {
+        v = _mm_loadu_si128((const __m128i *) &a[i]);
+        _mm_storeu_si128((__m128i *) &u[i],
+                         _mm_xor_si128(_mm_slli_epi32(v, 1), _mm_srai_epi32(v, 31)));
+    }
+#endif
+    for (; i<n; i++) u[i] = ((uint32_t) a[i] << 1) ^ (uint32_t) (a[i] >> 31);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Sum
+ *
+ * Description : Sum of zig zag residuals.
+ *
+ * Inputs : a - values
+ *          n - length
+ *
+ * Returns : sum
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint64_t AccCodec::Sum(const uint32_t *a, uint32_t n)
+{
+    uint64_t sum = 0;
+    uint32_t i   = 0;
+#if defined(__SSE2__)
+    __m128i  acc = _mm_setzero_si128();
+    uint32_t t[4];
+
+    for (; i+4<=n; i+=4)
+    {
+        acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i *) &a[i]));
+    }
+    _mm_storeu_si128((__m128i *) t, acc);
+    sum = (uint64_t) t[0] + t[1] + t[2] + t[3];
+#endif
+    for (; i<n; i++) sum += a[i];
+    return sum;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Bits
+ *
+ * Description : Exact length of the Rice codes, escapes included.
+ *
+ * Inputs : u - zig zag residuals
+ *          n - length
+ *          k - Rice parameter
+ *
+ * Returns : bits
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint64_t AccCodec::Bits(const uint32_t *u, uint32_t n, uint32_t k)
+{
+    uint64_t bits = 0;
+    uint32_t i    = 0, q;
+#if defined(__SSE2__)
+    const __m128i shift  = _mm_cvtsi32_si128(k);
+    const __m128i escape = _mm_set1_epi32(kEscape);
+    const __m128i extra  = _mm_set1_epi32(k + 1);
+    const __m128i raw    = _mm_set1_epi32(kEscape + kRaw);
+    __m128i  acc = _mm_setzero_si128();
+    __m128i  v, m;
+    uint32_t t[4];
+
+    for (; i+4<=n; i+=4)
+    {
+        v   = _mm_srl_epi32(_mm_loadu_si128((const __m128i *) &u[i]), shift);
+        m   = _mm_cmplt_epi32(v, escape);
+        v   = _mm_or_si128(_mm_and_si128(m, _mm_add_epi32(v, extra)),
+                           _mm_andnot_si128(m, raw));
+        acc = _mm_add_epi32(acc, v);
+    }
+    _mm_storeu_si128((__m128i *) t, acc);
+    bits = (uint64_t) t[0] + t[1] + t[2] + t[3];
+#endif
+    for (; i<n; i++)
+    {
+        q     = u[i] >> k;
+        bits += (q < kEscape) ? q + 1 + k : kEscape + kRaw;
+    }
+    return bits;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Integrate
+ *
+ * Description : Running sum in place, four at a time as a shift
+ *               and add scan within the register plus the carry
+ *               from the last four.
+ *
+ * Inputs : a     - differences, replaced by their sums
+ *          n     - length
+ *          Carry - the sum before a[0]
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccCodec::Integrate(int32_t *a, uint32_t n, int32_t Carry)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    __m128i  c = _mm_set1_epi32(Carry);
+    __m128i  v;
+
+    for (; i+4<=n; i+=4)
+    {
+        v = _mm_loadu_si128((const __m128i *) &a[i]);
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, c);
+        _mm_storeu_si128((__m128i *) &a[i], v);
+        c = _mm_shuffle_epi32(v, 0xFF);
+    }
+    Carry = _mm_cvtsi128_si32(c);
+#endif
+    for (; i<n; i++) Carry = a[i] = a[i] + Carry;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Check
+ *
+ * Description : Fletcher style running sums of the samples as
+ *               unsigned 16 bit words, so order matters.
+ *
+ * Inputs : s - interleaved samples
+ *          n - how many
+ *
+ * Returns : check word
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t AccCodec::Check(const int16_t *s, size_t n)
+{
+    uint32_t a = 0, b = 0;
+    for (size_t i=0; i<n; i++)
+    {
+        a += (uint16_t) s[i];
+        b += a;
+    }
+    return (b << 16) ^ a;
+}
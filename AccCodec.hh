@@ -0,0 +1,160 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : AccCodec.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Lossless block codec for .acc samples, after FLAC.
+ *               Each block of up to BlockFrames interleaved frames
+ *               stands alone: a header with a sync word, its length,
+ *               the file frame it starts at and a check of the
+ *               decoded samples, then per channel
+ *
+ *                 order   3 bits, 0-3 fixed predictor, 7 verbatim
+ *                 warm up order samples, 16 bits each
+ *                 residual in kPartition sample partitions, each a
+ *                         5 bit Rice parameter k and the codes
+ *
+ *               The fixed predictor of order p leaves the p-th
+ *               difference of the signal, the order with the least
+ *               absolute residual is kept. A residual e is zig zag
+ *               mapped to u = 2e or -2e-1 and sent as u >> k in
+ *               unary, ones ended by a zero, then the low k bits. A
+ *               unary run of kEscape ones is followed by u in kRaw
+ *               bits instead, so a spike costs 44 bits, not
+ *               thousands. Bits are packed most significant first.
+ *
+ *               A reader that lands in the middle of a file, or on a
+ *               torn block, scans for the next header that checks
+ *               out, so any block can be found and decoded alone.
+ *
+ *               Differences, sums, zig zag and the prefix sums that
+ *               undo the predictor are done four samples at a time
+ *               with SSE2, the Rice codes a word at a time.
+ *
+ * Restrictions/Limitations :
+ *   Little endian, as the raw .acc format. One thread per codec, the
+ *   scratch space is in the object.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   J. Coalson, FLAC format specification, xiph.org.
+ *   T. Robinson, "SHORTEN: Simple lossless and near-lossless
+ *   waveform compression", Cambridge University, 1994.
+ *
+ *******************************************************************
+ */
+#ifndef __ACCCODEC_hh_
+#define __ACCCODEC_hh_
+#  include <cstdint>
+#  include <cstddef>
+#  include <vector>
+
+class AccCodec
+{
+public:
+    /*!
+     * What a block header says.
+     */
+    typedef struct
+    {
+        uint32_t bytes;        /*! Whole block, header included */
+        uint64_t first;        /*! Frame in the file */
+        uint32_t frames;
+        uint32_t channels;
+        uint32_t check;        /*! Of the decoded samples */
+    } Block;
+
+    /*!
+     * NChan       - interleaved channels
+     * BlockFrames - frames per block when encoding, at most kMaxFrames
+     */
+    AccCodec(uint32_t NChan, uint32_t BlockFrames=4096);
+    ~AccCodec(void);
+
+    /*!
+     * Encode nFrames, at most BlockFrames, as one block starting at
+     * file frame First. out needs MaxBytes(). Returns the bytes
+     * used.
+     */
+    size_t   Encode(const int16_t *in, uint32_t nFrames, uint64_t First,
+                    uint8_t *out);
+    /*!
+     * Decode the block at in, n bytes available, into out, which
+     * needs frames x channels samples. Returns false if it is not
+     * a whole, good block.
+     */
+    bool     Decode(const uint8_t *in, size_t n, int16_t *out);
+
+    /*! Fill in b if there is a good header at in. */
+    static bool   Peek(const uint8_t *in, size_t n, Block &b);
+    /*! Offset of the next good header in n bytes, n if none. */
+    static size_t Sync(const uint8_t *in, size_t n);
+
+    inline uint32_t NChannels(void)   const {return fNChannels;};
+    inline uint32_t BlockFrames(void) const {return fBlockFrames;};
+    /*! Worst case block, verbatim plus the header. */
+    inline size_t   MaxBytes(void)    const
+        {return kHeaderBytes + fNChannels * (2*fBlockFrames + 1) + 8;};
+
+    /*! Bytes of block header. */
+    static const uint32_t kHeaderBytes = 28;
+    static const uint32_t kMaxFrames   = 16384;
+    static const uint32_t kPartition   = 256;
+    /*! Header line value in the .acc file. */
+    static const char* const kName;
+
+private:
+    /*! Unary runs this long are escapes. */
+    static const uint32_t kEscape  = 24;
+    /*! Bits of an escaped zig zag residual, order 3 needs 19. */
+    static const uint32_t kRaw     = 20;
+    static const uint32_t kMaxK    = 19;
+    static const uint32_t kVerbatim = 7;
+
+    /*! One channel into the bit stream. */
+    void     EncodeChannel(const int16_t *in, uint32_t n);
+    /*! One channel out of the bit stream, false if it runs out. */
+    bool     DecodeChannel(int16_t *out, uint32_t n, uint32_t stride);
+
+    /* Bit writer, most significant first. */
+    void     Put(uint32_t v, uint32_t nbits);
+    void     PutFlush(void);
+    /* Bit reader over [fIn, fEnd). */
+    uint64_t Peek64(void) const;
+    uint32_t Get(uint32_t nbits);
+
+    /*! d[i] = a[i] - a[i-1], d[0] = a[0]. */
+    static void     Diff(const int32_t *a, int32_t *d, uint32_t n);
+    /*! Sum of |a[i]|. */
+    static uint64_t AbsSum(const int32_t *a, uint32_t n);
+    /*! 0, -1, 1, -2 ... to 0, 1, 2, 3 ... */
+    static void     ZigZag(const int32_t *a, uint32_t *u, uint32_t n);
+    /*! Sum of a[0..n). */
+    static uint64_t Sum(const uint32_t *a, uint32_t n);
+    /*! Rice bits for u[0..n) with parameter k. */
+    static uint64_t Bits(const uint32_t *u, uint32_t n, uint32_t k);
+    /*! a[i] += a[i-1] for i in [0, n), a[-1] taken as Carry. */
+    static void     Integrate(int32_t *a, uint32_t n, int32_t Carry);
+    /*! Fletcher style check of interleaved samples. */
+    static uint32_t Check(const int16_t *s, size_t n);
+
+    uint32_t fNChannels;
+    uint32_t fBlockFrames;
+
+    /*! Differences of one channel, order 0 to 3, and zig zag. */
+    std::vector<int32_t>  fD[4];
+    std::vector<uint32_t> fU;
+
+    uint8_t       *fOut;       /*! Writer position */
+    uint64_t       fAcc;       /*! Pending bits, low fNBits of them */
+    uint32_t       fNBits;
+    const uint8_t *fIn;        /*! Reader block payload */
+    const uint8_t *fEnd;
+    uint64_t       fPos;       /*! Bits read */
+};
+#endif
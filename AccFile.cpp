@@ -0,0 +1,438 @@
+/********************************************************************
+ *
+ * Module Name : AccFile.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Memory mapped .acc reader.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Compressed files through AccCodec.
+ * 17-Oct-26 CBL A compressed file with no good block fails, EDECODE.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Local Includes.
+#include "AccFile.hh"
+#include "AccCodec.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : AccFile constructor
+ *
+ * Description : Nothing mapped, open Name if there is one.
+ *
+ * Inputs : Name - .acc file or NULL
+ *
+ * Returns : none
+ *
+ * Error Conditions : as Open
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+AccFile::AccFile(const char *Name) : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("AccFile");
+    SetError(); // No error.
+
+    fMap         = NULL;
+    fMapSize     = 0;
+    fSamples     = NULL;
+    fFrames      = 0;
+    fNChannels   = 0;
+    fSampleRate  = 0.0;
+    fFirstSample = 0;
+    fFirstTime   = 0.0;
+    fCompressed  = false;
+    fBadBlocks   = 0;
+    if (Name) Open(Name);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AccFile destructor
+ *
+ * Description : Unmap.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+AccFile::~AccFile(void)
+{
+    SET_DEBUG_STACK;
+    Close();
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Map the whole file read only and parse the header.
+ *               The descriptor is not needed once mapped. The
+ *               kernel is told access will be sequential so it
+ *               reads well ahead.
+ *
+ * Inputs : Name - .acc file
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_FILE, EMAP, EHEADER if NChannels or
+ *                    SampleRate is missing or the compression is
+ *                    not one we know, EDECODE if a compressed file
+ *                    has no block that decodes
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool AccFile::Open(const char *Name)
+{
+    SET_DEBUG_STACK;
+    struct stat st;
+    int         fd;
+    void       *map;
+
+    Close();
+    fName = Name ? Name : "";
+    fd    = open(fName.c_str(), O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size < (off_t) kHeaderSize))
+    {
+        if (fd >= 0) close(fd);
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        SetError(EMAP, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    fMap     = (char *) map;
+    fMapSize = st.st_size;
+    madvise(fMap, fMapSize, MADV_SEQUENTIAL);
+
+    // Header is zero padded, stop at the first zero.
+    fHeader.assign(fMap, strnlen(fMap, kHeaderSize));
+    fNChannels   = strtoul(Value("NChannels").c_str(), NULL, 10);
+    fSampleRate  = strtod(Value("SampleRate").c_str(), NULL);
+    fFirstSample = strtoull(Value("FirstSample").c_str(), NULL, 10);
+    fFirstTime   = strtod(Value("FirstTime").c_str(), NULL);
+    string codec = Value("Compression");
+    fCompressed  = (codec == AccCodec::kName);
+    if ((fNChannels == 0) || (fSampleRate <= 0.0) ||
+        !(codec.empty() || (codec == "none") || fCompressed))
+    {
+        Close();
+        SetError(EHEADER, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    if (fCompressed)
+    {
+        if (!Decode())
+        {
+            Close();
+            SetError(EDECODE, __LINE__);
+            SET_DEBUG_STACK;
+            return false;
+        }
+        SET_DEBUG_STACK;
+        return true;
+    }
+    fSamples = (const int16_t *) (fMap + kHeaderSize);
+    fFrames  = (fMapSize - kHeaderSize) / (fNChannels * sizeof(int16_t));
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Unmap. Views handed out are no longer valid.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccFile::Close(void)
+{
+    SET_DEBUG_STACK;
+    if (fMap) munmap(fMap, fMapSize);
+    fMap       = NULL;
+    fMapSize   = 0;
+    fSamples   = NULL;
+    fFrames    = 0;
+    fNChannels = 0;
+    fCompressed = false;
+    fBadBlocks  = 0;
+    fHeader.clear();
+    fDecoded.clear();
+    fDecoded.shrink_to_fit();
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Value
+ *
+ * Description : The rest of the "Key: " line.
+ *
+ * Inputs : Key - field name without the colon
+ *
+ * Returns : value, "" if there is no such line
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+string AccFile::Value(const char *Key) const
+{
+    string key = string(Key) + ": ";
+    size_t pos = 0;
+
+    // Only at the start of a line, so Note text can not match.
+    while ((pos = fHeader.find(key, pos)) != string::npos)
+    {
+        if ((pos == 0) || (fHeader[pos-1] == '\n'))
+        {
+            pos += key.size();
+            return fHeader.substr(pos, fHeader.find('\n', pos) - pos);
+        }
+        pos += key.size();
+    }
+    return string();
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Range
+ *
+ * Description : Bytes holding Count frames from First, widened to
+ *               whole pages as madvise wants.
+ *
+ * Inputs : First, Count - frames
+ *          Start, Length - filled in
+ *
+ * Returns : false if there is nothing to advise
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool AccFile::Range(uint64_t First, uint64_t Count, char **Start,
+                    size_t *Length)
+{
+    const size_t page  = sysconf(_SC_PAGESIZE);
+    SampleView   v     = Samples(First, Count);
+    // Decoded samples are not in the mapping.
+    if (fMap == NULL || fCompressed || v.Empty()) return false;
+
+    size_t begin = (const char *) v.Data() - fMap;
+    size_t end   = begin + v.Frames() * fNChannels * sizeof(int16_t);
+    begin -= begin % page;
+    *Start  = fMap + begin;
+    *Length = end - begin;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WillNeed
+ *
+ * Description : MADV_WILLNEED, start reading before we get there.
+ *
+ * Inputs : First, Count - frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none, advice only
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccFile::WillNeed(uint64_t First, uint64_t Count)
+{
+    char  *start;
+    size_t length;
+    if (Range(First, Count, &start, &length))
+    {
+        madvise(start, length, MADV_WILLNEED);
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : DontNeed
+ *
+ * Description : MADV_DONTNEED on frames already used, so a pass
+ *               over a file bigger than memory does not push
+ *               everything else out. The pages come back from the
+ *               file if they are touched again. Only whole pages
+ *               before the end of the range are released, the last
+ *               one may still hold frames that are wanted.
+ *
+ * Inputs : First, Count - frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none, advice only
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void AccFile::DontNeed(uint64_t First, uint64_t Count)
+{
+    const size_t page = sysconf(_SC_PAGESIZE);
+    char  *start;
+    size_t length;
+    if (Range(First, Count, &start, &length))
+    {
+        length -= length % page;
+        if (length > 0) madvise(start, length, MADV_DONTNEED);
+    }
+}
+
+/**
+ ******************************************************************
+ *
+ * Function Name : Decode
+ *
+ * Description : Two passes over the blocks. The first walks the
+ *               headers, block length to block length, to find how
+ *               many frames there are, the second decodes each block
+ *               to the frame it says it starts at. Anywhere a header
+ *               does not check out the walk scans on for the next
+ *               one. The coded pages are dropped once used.
+ *
+ * Inputs : none
+ *
+ * Returns : true if at least one block decoded
+ *
+ * Error Conditions : blocks that fail are counted in fBadBlocks
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool AccFile::Decode(void)
+{
+    SET_DEBUG_STACK;
+    const uint8_t *data = (const uint8_t *) fMap + kHeaderSize;
+    const size_t   n    = fMapSize - kHeaderSize;
+    AccCodec       codec(fNChannels);
+    AccCodec::Block b;
+    uint64_t       frames = 0;
+    uint32_t       good   = 0;
+    size_t         off;
+
+    for (int pass=0; pass<2; pass++)
+    {
+        off = 0;
+        while (off < n)
+        {
+            // No block codes to less than a bit a sample.
+            if (AccCodec::Peek(data + off, n - off, b) && (b.bytes <= n - off) &&
+                (b.channels == fNChannels) && (b.first < 8 * (uint64_t) n))
+            {
+                if (pass == 0)
+                {
+                    if (b.first + b.frames > frames) frames = b.first + b.frames;
+                }
+                else if (codec.Decode(data + off, n - off,
+                                      &fDecoded[b.first * fNChannels]))
+                {
+                    good++;
+                }
+                else
+                {
+                    memset(&fDecoded[b.first * fNChannels], 0,
+                           (size_t) b.frames * fNChannels * sizeof(int16_t));
+                    fBadBlocks++;
+                }
+                off += b.bytes;
+                continue;
+            }
+            // Not a block, look for the next one.
+            off += 1 + AccCodec::Sync(data + off + 1, n - off - 1);
+        }
+        if (pass == 0) fDecoded.assign(frames * fNChannels, 0);
+    }
+    madvise(fMap, fMapSize, MADV_DONTNEED);
+    fSamples = fDecoded.data();
+    fFrames  = frames;
+    SET_DEBUG_STACK;
+    return (good > 0);
+}
@@ -0,0 +1,162 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : AccFile.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Read only, memory mapped .acc recording. The 256
+ *               byte "Key: value" header written by FormatLogHeader
+ *               is parsed on Open and the samples that follow are
+ *               handed out as StridedView's straight into the page
+ *               cache, no copies. The mapping is advised sequential
+ *               and pages already used can be dropped, so files
+ *               bigger than memory stream through at disk or memory
+ *               bandwidth.
+ *
+ *               A file whose header says "Compression: rice" is
+ *               AccCodec blocks after the header. Those are decoded
+ *               on Open into memory, each block at the frame its
+ *               header gives, and the views are into that instead.
+ *               A block that does not decode is left as zeros and
+ *               counted, the scan picks up again at the next good
+ *               header.
+ *
+ * Restrictions/Limitations :
+ *   64 bit builds for multi GB files. A trailing partial frame is
+ *   not part of the view. A compressed file has to fit in memory
+ *   decoded.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Compressed files, decoded on Open.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __ACCFILE_hh_
+#define __ACCFILE_hh_
+#  include <cstdint>
+#  include <cstddef>
+#  include <string>
+#  include <vector>
+#  include "CObject.hh"
+
+/*!
+ * Frames of interleaved samples in memory someone else owns.
+ * Sample c of frame i is Data()[i*Stride() + c], c < NChannels().
+ * Stride is the interleave of the underlying buffer, so a single
+ * channel of a two channel file has NChannels 1 and Stride 2.
+ */
+template <class T> class StridedView
+{
+public:
+    StridedView(void) : fData(NULL), fFrames(0), fStride(1), fNChannels(1) {};
+    StridedView(const T *Data, uint64_t Frames, uint32_t Stride,
+                uint32_t NChannels)
+        : fData(Data), fFrames(Frames), fStride(Stride), fNChannels(NChannels) {};
+
+    inline const T* Data(void)      const {return fData;};
+    inline uint64_t Frames(void)    const {return fFrames;};
+    inline uint32_t Stride(void)    const {return fStride;};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    /*! Frames are whole interleaved frames, nothing skipped. */
+    inline bool     Dense(void)     const {return fStride == fNChannels;};
+    inline bool     Empty(void)     const {return (fData == NULL) || (fFrames == 0);};
+
+    inline T operator()(uint64_t Frame, uint32_t Chan) const
+        {return fData[Frame*fStride + Chan];};
+
+    /*! Count frames from First, clipped to the view. */
+    inline StridedView Slice(uint64_t First, uint64_t Count) const
+    {
+        if (First > fFrames) First = fFrames;
+        if (Count > fFrames - First) Count = fFrames - First;
+        return StridedView(fData + First*fStride, Count, fStride, fNChannels);
+    };
+    /*! Just channel Chan. */
+    inline StridedView Channel(uint32_t Chan) const
+        {return StridedView(fData + Chan, fFrames, fStride, 1);};
+
+private:
+    const T  *fData;
+    uint64_t  fFrames;
+    uint32_t  fStride;
+    uint32_t  fNChannels;
+};
+typedef StridedView<int16_t> SampleView;
+
+class AccFile : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_FILE=1, EHEADER, EMAP, EDECODE};
+
+    /*! Opens Name if given. */
+    AccFile(const char *Name=NULL);
+    ~AccFile(void);
+
+    /*! Map Name and parse its header, closing any open file. */
+    bool Open(const char *Name);
+    void Close(void);
+    inline bool IsOpen(void) const {return (fMap != NULL);};
+
+    /* From the header. */
+    inline uint32_t NChannels(void)   const {return fNChannels;};
+    inline double   SampleRate(void)  const {return fSampleRate;};
+    inline uint64_t FirstSample(void) const {return fFirstSample;};
+    inline double   FirstTime(void)   const {return fFirstTime;};
+    /*! Stored as AccCodec blocks. */
+    inline bool     Compressed(void)  const {return fCompressed;};
+    /*! Compressed blocks that did not decode. */
+    inline uint32_t BadBlocks(void)   const {return fBadBlocks;};
+    /*! Any header field as a string, "" if missing. */
+    std::string     Value(const char *Key) const;
+    inline const std::string& Header(void) const {return fHeader;};
+    inline const std::string& Name(void)   const {return fName;};
+
+    /*! Whole frames in the file. */
+    inline uint64_t Frames(void)      const {return fFrames;};
+    inline uint64_t Bytes(void)       const {return fFrames * fNChannels * sizeof(int16_t);};
+    inline double   Seconds(void)     const
+        {return (fSampleRate > 0.0) ? fFrames / fSampleRate : 0.0;};
+
+    /*! Every sample, or Count frames from First. */
+    inline SampleView Samples(void) const
+        {return SampleView(fSamples, fFrames, fNChannels, fNChannels);};
+    inline SampleView Samples(uint64_t First, uint64_t Count) const
+        {return Samples().Slice(First, Count);};
+
+    /*! Ask for frames to be read ahead. */
+    void WillNeed(uint64_t First, uint64_t Count);
+    /*! Finished with these frames, let their pages go. */
+    void DontNeed(uint64_t First, uint64_t Count);
+
+    /*! Size of the ASCII header, MainModule::kHeaderSize. */
+    static const uint32_t kHeaderSize = 256;
+
+private:
+    /*! Page aligned byte range for frames, for madvise. */
+    bool Range(uint64_t First, uint64_t Count, char **Start, size_t *Length);
+    /*! Decode the AccCodec blocks after the header into fDecoded. */
+    bool Decode(void);
+
+    std::string    fName;
+    std::string    fHeader;
+    char          *fMap;
+    size_t         fMapSize;
+    const int16_t *fSamples;
+    uint64_t       fFrames;
+    uint32_t       fNChannels;
+    double         fSampleRate;
+    uint64_t       fFirstSample;
+    double         fFirstTime;
+    bool           fCompressed;
+    uint32_t       fBadBlocks;
+    std::vector<int16_t> fDecoded;
+};
+#endif
@@ -9,6 +9,13 @@
  * Restrictions/Limitations :
  *
  * Change Descriptions :
+ * 17-Oct-26 CBL Plans come from the persistent wisdom store.
+ * 17-Oct-26 CBL All channels in one batched plan over planar data.
+ * 17-Oct-26 CBL ScaleData uses the vectorised ScaleFrames kernel.
+ * 17-Oct-26 CBL Single precision (fftwf) path.
+ * 17-Oct-26 CBL Multi threaded plans.
+ * 17-Oct-26 CBL Results go to a SpectrumFile.
+ * 17-Oct-26 CBL ScaleData from a SampleView.
  *
  * Classification : Unclassified
  *
@@ -31,6 +38,10 @@ using namespace std;
 #include "Analysis.hh"
 #include "debug.h"
 #include "fftw3.h"
+#include "Wisdom.hh"
+#include "AccFile.hh"
+#include "ScaleKernel.hh"
+#include "SpectrumFile.hh"
 
 /**
  ******************************************************************
@@ -52,7 +63,8 @@ using namespace std;
  *
  *******************************************************************
  */
-Analysis::Analysis (int32_t Array_size, uint32_t NChannel)
+Analysis::Analysis (int32_t Array_size, uint32_t NChannel, bool Single,
+                    int Threads)
 {
     SET_DEBUG_STACK;
     /*
@@ -66,12 +78,33 @@ Analysis::Analysis (int32_t Array_size, uint32_t NChannel)
     fArraySize = Array_size;
     fNChannels = NChannel;
     fWindow    = NULL;
+    fWindowf   = NULL;
+    fSingle    = Single;
+    fThreads   = Wisdom::ThreadCount(Threads);
+    fFFT       = NULL;
+    fIN        = NULL;
+    fOUT       = NULL;
+    fFFTf      = NULL;
+    fINf       = NULL;
+    fOUTf      = NULL;
     
     // If we got this far, might as well make an fftw plan.
-    // Allocate the arrays for the computation.
-    fIN  = (double *) fftw_malloc(Array_size * sizeof(double));
-    fOUT = (fftw_complex *) fftw_malloc(Array_size * sizeof(fftw_complex));
-    fFFT = fftw_plan_dft_r2c_1d(Array_size, fIN, fOUT, FFTW_ESTIMATE);
+    // Allocate the arrays for the computation, one row per channel.
+    if (fSingle)
+    {
+        fINf  = (float *) fftwf_malloc(fNChannels * Array_size * sizeof(float));
+        fOUTf = (fftwf_complex *) fftwf_malloc(fNChannels * NBins() *
+                                               sizeof(fftwf_complex));
+        fFFTf = Wisdom::PlanR2C(Array_size, fNChannels, fINf, fOUTf,
+                                fThreads);
+    }
+    else
+    {
+        fIN  = (double *) fftw_malloc(fNChannels * Array_size * sizeof(double));
+        fOUT = (fftw_complex *) fftw_malloc(fNChannels * NBins() *
+                                            sizeof(fftw_complex));
+        fFFT = Wisdom::PlanR2C(Array_size, fNChannels, fIN, fOUT, fThreads);
+    }
     //Hamming(Array_size);
     SET_DEBUG_STACK;
 }
@@ -100,12 +133,16 @@ Analysis::~Analysis (void)
 {
     SET_DEBUG_STACK;
     // Free the FFTW plan
-    fftw_destroy_plan(fFFT);
+    Wisdom::Destroy(fFFT);
+    Wisdom::Destroy(fFFTf);
 
     // Free the working arrays
     fftw_free(fIN);
     fftw_free(fOUT);
-    delete fWindow;
+    fftwf_free(fINf);
+    fftwf_free(fOUTf);
+    delete[] fWindow;
+    delete[] fWindowf;
     SET_DEBUG_STACK;
 }
 /**
@@ -159,6 +196,11 @@ void Analysis::Hamming(uint32_t N)
       theta = 2.0 * M_PI/FN * (double) i;
       fWindow[i] = 0.54 - 0.46 * cos(theta);
   }
+  if (fSingle)
+  {
+      fWindowf = new float[N];
+      for (uint32_t i=0;i<N;i++) fWindowf[i] = (float) fWindow[i];
+  }
   SET_DEBUG_STACK;
 }
 /**
@@ -185,22 +227,113 @@ void Analysis::ScaleData(const int16_t *samples)
 {
     SET_DEBUG_STACK;
     /*
-     * While the data may be stereo, assume we are inputting only
-     * a single accelerometer on the TIP channel. (0)
-     *
-     * calculate the stride for this. 
+     * De-interleave every channel into its own row, TIP is row 0,
+     * RING row 1. Convert, scale and window in the same pass. Every
+     * element is written so there is no need to clear fIN first.
      */
-    memset(fIN, 0, fArraySize * sizeof(double));
-    
-    for (int32_t i=0; i<fArraySize; i++)
+    if (fSingle)
+    {
+        ScaleFramesF(samples, fNChannels, fArraySize, (float) fScale,
+                     fWindowf, fINf, fArraySize);
+    }
+    else
     {
-	fIN[i] = fScale * (double) samples[i*fNChannels];
-	if (fWindow)
-	{
-	    fIN[i] *= fWindow[i];
+        ScaleFrames(samples, fNChannels, fArraySize, fScale, fWindow,
+                    fIN, fArraySize);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ScaleData
+ *
+ * Description : ScaleData reading through a view. Whole interleaved
+ *               frames, the usual case for an AccFile, go through
+ *               the ScaleFrames kernel exactly as a buffer would.
+ *               A view that skips channels is done per channel.
+ *
+ * Inputs : view - samples, need not be aligned or dense
+ *
+ * Returns : frames used
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t Analysis::ScaleData(const SampleView &view)
+{
+    SET_DEBUG_STACK;
+    const uint32_t n    = (view.Frames() < (uint64_t) fArraySize) ?
+        (uint32_t) view.Frames() : (uint32_t) fArraySize;
+    const uint32_t nCh  = (view.NChannels() < fNChannels) ?
+        view.NChannels() : fNChannels;
+    const uint32_t stride = view.Stride();
+    const int16_t *src  = view.Data();
+
+    if (view.Empty())
+    {
+        if (fSingle) memset(fINf, 0, fNChannels*fArraySize*sizeof(float));
+        else         memset(fIN,  0, fNChannels*fArraySize*sizeof(double));
+        SET_DEBUG_STACK;
+        return 0;
+    }
+
+    if (fSingle)
+    {
+        if (view.Dense() && (nCh == fNChannels))
+        {
+            ScaleFramesF(src, fNChannels, n, (float) fScale, fWindowf,
+                         fINf, fArraySize);
+        }
+        else
+        {
+            for (uint32_t c=0; c<nCh; c++)
+            {
+                float *dst = &fINf[c*fArraySize];
+                for (uint32_t i=0; i<n; i++)
+                    dst[i] = (float) fScale * src[i*stride + c] *
+                        (fWindowf ? fWindowf[i] : 1.0f);
+            }
+        }
+        for (uint32_t c=0; c<fNChannels; c++)
+        {
+            uint32_t from = (c < nCh) ? n : 0;
+            memset(&fINf[c*fArraySize + from], 0,
+                   (fArraySize - from)*sizeof(float));
+        }
+    }
+    else
+    {
+        if (view.Dense() && (nCh == fNChannels))
+        {
+            ScaleFrames(src, fNChannels, n, fScale, fWindow,
+                        fIN, fArraySize);
+        }
+        else
+        {
+            for (uint32_t c=0; c<nCh; c++)
+            {
+                double *dst = &fIN[c*fArraySize];
+                for (uint32_t i=0; i<n; i++)
+                    dst[i] = fScale * src[i*stride + c] *
+                        (fWindow ? fWindow[i] : 1.0);
+            }
+        }
+        for (uint32_t c=0; c<fNChannels; c++)
+        {
+            uint32_t from = (c < nCh) ? n : 0;
+            memset(&fIN[c*fArraySize + from], 0,
+                   (fArraySize - from)*sizeof(double));
         }
     }
     SET_DEBUG_STACK;
+    return n;
 }
 /**
  ******************************************************************
@@ -225,23 +358,29 @@ void Analysis::ScaleData(const int16_t *samples)
 void Analysis::ComputeFFT(void)
 {
     SET_DEBUG_STACK;
-    memset (fOUT, 0, fArraySize * sizeof(fftw_complex));
-    fftw_execute(fFFT);
+    // r2c writes every output bin, no need to clear fOUT.
+    if (fSingle)
+        fftwf_execute(fFFTf);
+    else
+        fftw_execute(fFFT);
     //DumpResults();
     SET_DEBUG_STACK;
 }
 /**
  ******************************************************************
  *
- * Function Name : 
+ * Function Name : DumpResults
  *
- * Description :
+ * Description : Append the power spectrum of the last transform
+ *               to a spectral products file.
  *
- * Inputs :
+ * Inputs : out   - file with matching NChannels and NBins
+ *          Time  - UTC of the first sample transformed
+ *          Frame - stream index of that sample
  *
- * Returns :
+ * Returns : false if the file does not match or is not open
  *
- * Error Conditions :
+ * Error Conditions : none
  * 
  * Unit Tested on: 
  *
@@ -250,15 +389,59 @@ void Analysis::ComputeFFT(void)
  *
  *******************************************************************
  */
-void Analysis::DumpResults(void)
+bool Analysis::DumpResults(SpectrumFile *out, double Time, uint64_t Frame)
 {
     SET_DEBUG_STACK;
-    cout << "DUMP RESULTS" << endl;
-    ofstream dat("results.dat", ios_base::out);
+    float   *dst;
+    uint32_t k;
+    if ((out == NULL) || (out->NChannels() != fNChannels) ||
+        (out->NBins() != (uint32_t) NBins()))
+    {
+        return false;
+    }
+    dst = out->Reserve(Time, Frame);
+    if (dst == NULL) return false;
     /*
-     * output format is pretty raw.
-     * array of doubles orgainzied (Real, complex)  * array size
+     * Power in float32, channel major, the record layout is in
+     * the SpectrumFile header.
      */
-    dat.write( (char *)fOUT, fArraySize * sizeof(fftw_complex));
-    dat.close();
+    for (k=0; k<fNChannels*NBins(); k++)
+    {
+        if (fSingle)
+            dst[k] = fOUTf[k][0]*fOUTf[k][0] + fOUTf[k][1]*fOUTf[k][1];
+        else
+            dst[k] = (float) (fOUT[k][0]*fOUT[k][0] + fOUT[k][1]*fOUT[k][1]);
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Power
+ *
+ * Description : Power in one bin of the last transform, whichever precision is in use.
+ *
+ * Inputs : chan - channel
+ *          bin  - 0 to NBins()-1
+ *
+ * Returns : |X|^2
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double Analysis::Power(uint32_t chan, int32_t bin) const
+{
+    uint32_t k = chan*NBins() + bin;
+    if (fSingle)
+    {
+        return (double) fOUTf[k][0]*fOUTf[k][0] + (double) fOUTf[k][1]*fOUTf[k][1];
+    }
+    return fOUT[k][0]*fOUT[k][0] + fOUT[k][1]*fOUT[k][1];
 }
@@ -10,6 +10,17 @@
  * Restrictions/Limitations :
  *
  * Change Descriptions :
+ * 17-Oct-26 CBL ArraySize is frames per channel. Every channel is
+ *               transformed in one batched plan over planar data.
+ * 17-Oct-26 CBL Optional single precision path. The ADC is 16 bits,
+ *               float holds it exactly and the transform gets twice
+ *               the SIMD lanes. Only the arrays for the chosen
+ *               precision are allocated.
+ * 17-Oct-26 CBL Threads for long records.
+ * 17-Oct-26 CBL DumpResults appends power to a SpectrumFile rather
+ *               than overwriting results.dat.
+ * 17-Oct-26 CBL ScaleData takes a SampleView, e.g. straight out of a
+ *               mapped AccFile, short views are zero padded.
  *
  * Classification : Unclassified
  *
@@ -21,12 +32,19 @@
 #define __ANALYSIS_hh_
 #  include "fftw3.h"
 
+class SpectrumFile;
+template <class T> class StridedView;
+typedef StridedView<int16_t> SampleView;
+
 /// Analysis documentation here. 
 class Analysis
 {
 public:
-    /// Default Constructor
-    Analysis(int32_t ArraySize, uint32_t NChan=1);
+    /// Constructor, ArraySize is the number of frames per channel.
+    /// Single selects fftwf and float buffers, Threads is the FFTW
+    /// thread count (see Wisdom::ThreadCount).
+    Analysis(int32_t ArraySize, uint32_t NChan=1, bool Single=false,
+             int Threads=1);
     /// Default destructor
     ~Analysis();
     /// Analysis function
@@ -43,9 +61,34 @@ public:
      *
      */
     void ScaleData(const int16_t *samples);
+    /*!
+     * The same from a view of any stride, no copy is made. Up to
+     * ArraySize frames are used, fewer are zero padded. Channels
+     * past the view's are zeroed. Returns the frames used.
+     */
+    uint32_t ScaleData(const SampleView &view);
 
     void ComputeFFT(void);
-    void DumpResults(void);
+    /*!
+     * Append |X|^2 of every channel, NBins float32 each, to out
+     * as one record stamped with Time (UTC) and Frame.
+     */
+    bool DumpResults(SpectrumFile *out, double Time, uint64_t Frame);
+
+    /*! Spectrum of channel, NBins() complex values, NULL if Single. */
+    inline const fftw_complex* Spectrum(uint32_t chan) const
+	{return fOUT ? &fOUT[chan*NBins()] : NULL;};
+    /*! Same for the single precision path, NULL if not Single. */
+    inline const fftwf_complex* SpectrumF(uint32_t chan) const
+	{return fOUTf ? &fOUTf[chan*NBins()] : NULL;};
+    /*! |X|^2 of one bin, either precision. */
+    double Power(uint32_t chan, int32_t bin) const;
+    inline bool     Single(void)    const {return fSingle;};
+    inline int      Threads(void)   const {return fThreads;};
+    /*! Real to complex output length per channel. */
+    inline int32_t  NBins(void)     const {return fArraySize/2 + 1;};
+    inline int32_t  ArraySize(void) const {return fArraySize;};
+    inline uint32_t NChannels(void) const {return fNChannels;};
 
 
    inline void SetScale(double v) {fScale = v;};
@@ -58,10 +101,17 @@ private:
 
     // Private Data
     fftw_plan fFFT;        /*! FFTW plan access. */
-    // fft vectors used
-    double *fIN;
-    fftw_complex *fOUT;
-    int32_t  fArraySize;   /*! FFT array sizes */
+    // fft vectors used, planar, one row per channel.
+    double *fIN;           /*! NChannels x fArraySize */
+    fftw_complex *fOUT;    /*! NChannels x NBins */
+    // Single precision equivalents, used instead of the above.
+    fftwf_plan     fFFTf;
+    float         *fINf;
+    fftwf_complex *fOUTf;
+    float         *fWindowf;
+    bool           fSingle;
+    int            fThreads;      /*! FFTW threads per execute */
+    int32_t  fArraySize;   /*! FFT array sizes, per channel */
     uint32_t fNChannels;   /*! Number of channels in input data. */
     double   fScale;
     double  *fWindow; 
@@ -0,0 +1,86 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : AudioSource.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Where MainModule gets its samples from. The contract
+ *               is the PortAudio one: the source calls a
+ *               PaStreamCallback with interleaved paInt16 frames, a
+ *               PaStreamCallbackTimeInfo and status flags until the
+ *               callback returns something other than paContinue or
+ *               the source is stopped. recordCallback and ringCallback
+ *               do not know whether a sound card or a file is behind
+ *               them.
+ *
+ *               PortAudioSource is the live device, ReplaySource
+ *               plays a .acc, WAV or synthetic signal through the same
+ *               callbacks at any speed.
+ *
+ * Restrictions/Limitations :
+ *   One open stream per source. The last callback of a finite
+ *   source may be short.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __AUDIOSOURCE_hh_
+#define __AUDIOSOURCE_hh_
+#  include <cstdint>
+#  include "CObject.hh"
+#  include "portaudio.h"
+
+class AudioSource : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_DEVICE=1, ENO_FILE, EFORMAT, ENO_STREAM, ENO_START};
+
+    /*!
+     * Asked before each callback by sources that are not paced by a
+     * clock, true when the consumer has room for Frames more.
+     */
+    typedef bool (*ReadyFunc)(void *Arg, unsigned long Frames);
+
+    AudioSource(void) : CObject() {fNChannels = 0; fSampleRate = 0.0;};
+    virtual ~AudioSource(void) {};
+
+    /*!
+     * Set up a stream of FramesPerBuffer frame callbacks at
+     * SampleRate, NChannels() channels, each to Callback(UserData).
+     */
+    virtual bool Open(double SampleRate, uint32_t FramesPerBuffer,
+                      PaStreamCallback *Callback, void *UserData) = 0;
+    /*! Begin calling back. */
+    virtual bool Start(void) = 0;
+    /*! Let the callback in progress finish and stop. */
+    virtual bool Stop(void)  = 0;
+    /*! Stop if need be and release the stream. */
+    virtual bool Close(void) = 0;
+    /*! 1 running, 0 finished or stopped, negative on error. */
+    virtual int  IsActive(void) = 0;
+    /*! True if a hardware clock sets the pace. */
+    virtual bool Live(void) const = 0;
+    /*! For the log. */
+    virtual const char* Name(void) const = 0;
+    /*! See ReadyFunc. Live sources can not wait, so ignore it. */
+    virtual void SetReady(ReadyFunc Ready, void *Arg) {(void) Ready; (void) Arg;};
+
+    /*! Channels per frame the source delivers. */
+    inline uint32_t NChannels(void)  const {return fNChannels;};
+    /*! Native rate of the source, 0 if it has none. */
+    inline double   SampleRate(void) const {return fSampleRate;};
+
+protected:
+    uint32_t fNChannels;
+    double   fSampleRate;
+};
+#endif
@@ -0,0 +1,481 @@
+/********************************************************************
+ *
+ * Module Name : BatchAnalysis.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Thread pool over a list of .acc files.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Files are read through a mapped AccFile.
+ * 17-Oct-26 CBL Summary from StreamStats, adds min, max, crest and
+ *               clips.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <glob.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Local Includes.
+#include "BatchAnalysis.hh"
+#include "AccFile.hh"
+#include "StreamStats.hh"
+#include "SpectrumFile.hh"
+#include "Welch.hh"
+#include "CLogger.hh"
+#include "debug.h"
+
+/* Frames handed to Welch per pass, pages behind are released. */
+static const uint32_t kReadFrames = 65536;
+
+/* UTC now in seconds. */
+static double WallTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double) ts.tv_sec + 1.0e-9 * (double) ts.tv_nsec;
+}
+
+/**
+ ******************************************************************
+ *
+ * Function Name : BatchAnalysis constructor
+ *
+ * Description : Keep the settings, no work yet.
+ *
+ * Inputs : Segment - Welch segment, samples
+ *          Overlap - Welch overlap, samples
+ *          Window  - Welch window enum
+ *          Threads - workers, 0 or less for one per core
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+BatchAnalysis::BatchAnalysis(uint32_t Segment, uint32_t Overlap, int Window,
+                             int Threads) : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("BatchAnalysis");
+    SetError(); // No error.
+
+    fSegment = Segment;
+    fOverlap = Overlap;
+    fWindow  = Window;
+    fThreads = Threads;
+    if (fThreads <= 0)
+    {
+        fThreads = std::thread::hardware_concurrency();
+        if (fThreads <= 0) fThreads = 1;
+    }
+    fNext.store(0);
+    fFailed  = 0;
+    fBytes   = 0;
+    fSeconds = 0.0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : BatchAnalysis destructor
+ *
+ * Description : Nothing held between runs.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+BatchAnalysis::~BatchAnalysis(void)
+{
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Expand
+ *
+ * Description : Turn the -f argument into a sorted list of files.
+ *
+ * Inputs : Pattern - directory or glob
+ *
+ * Returns : file names, empty if nothing matched
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+vector<string> BatchAnalysis::Expand(const char *Pattern)
+{
+    SET_DEBUG_STACK;
+    vector<string> rc;
+    struct stat    st;
+
+    if (Pattern == NULL) return rc;
+    if ((stat(Pattern, &st) == 0) && S_ISDIR(st.st_mode))
+    {
+        DIR           *dir = opendir(Pattern);
+        struct dirent *ent;
+        string         base(Pattern);
+        if (base.size() > 0 && base[base.size()-1] != '/') base += "/";
+        while (dir && (ent = readdir(dir)) != NULL)
+        {
+            size_t n = strlen(ent->d_name);
+            if ((n > 4) && (strcmp(&ent->d_name[n-4], ".acc") == 0))
+            {
+                rc.push_back(base + ent->d_name);
+            }
+        }
+        if (dir) closedir(dir);
+    }
+    else
+    {
+        glob_t g;
+        if (glob(Pattern, 0, NULL, &g) == 0)
+        {
+            for (size_t i=0; i<g.gl_pathc; i++) rc.push_back(g.gl_pathv[i]);
+        }
+        globfree(&g);
+    }
+    sort(rc.begin(), rc.end());
+    SET_DEBUG_STACK;
+    return rc;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Run
+ *
+ * Description : Expand the pattern, start the workers, wait for
+ *               them and write the summary.
+ *
+ * Inputs : Pattern - directory or glob
+ *
+ * Returns : true if any file was analysed
+ *
+ * Error Conditions : ENO_FILES, EOUTPUT for the summary
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool BatchAnalysis::Run(const char *Pattern)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    vector<std::thread*> workers;
+
+    fFiles = Expand(Pattern);
+    if (fFiles.empty())
+    {
+        pLogger->Log("# Batch: nothing matches %s\n", Pattern ? Pattern : "");
+        SetError(ENO_FILES, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    fResults.assign(fFiles.size(), Result());
+    fNext.store(0);
+    fFailed = 0;
+    fBytes  = 0;
+
+    int n = min((size_t) fThreads, fFiles.size());
+    pLogger->Log("# Batch: %lu files, %d threads, Welch %u/%u %s\n",
+                 (unsigned long) fFiles.size(), n, fSegment, fOverlap,
+                 Welch::WindowName(fWindow));
+
+    double start = WallTime();
+    for (int i=0; i<n; i++)
+    {
+        workers.push_back(new std::thread(&BatchAnalysis::Worker, this));
+    }
+    for (size_t i=0; i<workers.size(); i++)
+    {
+        workers[i]->join();
+        delete workers[i];
+    }
+    fSeconds = WallTime() - start;
+
+    for (size_t i=0; i<fResults.size(); i++)
+    {
+        if (fResults[i].ok)
+            fBytes += fResults[i].bytes;
+        else
+            fFailed++;
+    }
+    WriteSummary();
+
+    double secs = (fSeconds > 0.0) ? fSeconds : 1.0e-9;
+    pLogger->Log("# Batch: %lu files (%u failed), %.1f MB in %.3f s, %.2f files/s, %.1f MB/s\n",
+                 (unsigned long) fFiles.size(), fFailed, fBytes/1.0e6,
+                 fSeconds, fFiles.size()/secs, fBytes/1.0e6/secs);
+    SET_DEBUG_STACK;
+    return (fFailed < fFiles.size());
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Worker
+ *
+ * Description : One pool thread. Files are handed out one at a
+ *               time so long and short files balance out.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void BatchAnalysis::Worker(void)
+{
+    SET_DEBUG_STACK;
+    size_t i;
+    while ((i = fNext.fetch_add(1)) < fFiles.size())
+    {
+        fResults[i].ok = AnalyseFile(fFiles[i], fResults[i]);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AnalyseFile
+ *
+ * Description : Map the file, then stream the samples through
+ *               a Welch estimator that averages the whole file and
+ *               the running sums for the summary. The PSD goes to
+ *               the .psd product stamped with the file's first
+ *               sample.
+ *
+ * Inputs : Name - .acc file
+ *          r    - filled in
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : logged, the file is skipped
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool BatchAnalysis::AnalyseFile(const string &Name, Result &r)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    AccFile  acc;
+
+    r.ok     = false;
+    r.frames = 0;
+    r.bytes  = 0;
+    r.segments = 0;
+    if (!acc.Open(Name.c_str()))
+    {
+        if (acc.Error() == AccFile::EHEADER)
+            pLogger->Log("# Batch: %s has no NChannels/SampleRate\n", Name.c_str());
+        else if (acc.Error() == AccFile::EDECODE)
+            pLogger->Log("# Batch: %s has no good compressed block\n", Name.c_str());
+        else
+            pLogger->Log("# Batch: can not read %s\n", Name.c_str());
+        return false;
+    }
+    r.nChannels  = acc.NChannels();
+    r.sampleRate = acc.SampleRate();
+
+    // The whole file is one average.
+    Welch    welch(fSegment, fOverlap, r.nChannels, fWindow, 0xFFFFFFFF,
+                   r.sampleRate);
+    StreamStats stats("batch", r.nChannels);
+
+    for (uint64_t first=0; first<acc.Frames(); first+=kReadFrames)
+    {
+        SampleView     v   = acc.Samples(first, kReadFrames);
+        const int16_t *buf = v.Data();
+        uint32_t       n   = v.Frames();
+        acc.WillNeed(first + kReadFrames, kReadFrames);
+        stats.Add(buf, n);
+        welch.AddBlock(buf, n);
+        // Welch keeps its own overlap history, the pages can go.
+        acc.DontNeed(first, n);
+        r.frames += n;
+    }
+    r.bytes = acc.Bytes();
+
+    r.mean.resize(r.nChannels);
+    r.rms.resize(r.nChannels);
+    r.peak.resize(r.nChannels);
+    r.min.resize(r.nChannels);
+    r.max.resize(r.nChannels);
+    r.crest.resize(r.nChannels);
+    r.clips.resize(r.nChannels);
+    for (uint32_t c=0; c<r.nChannels; c++)
+    {
+        r.mean[c]  = stats.DC(StreamStats::kFile, c);
+        r.rms[c]   = stats.RMS(StreamStats::kFile, c);
+        r.peak[c]  = stats.Peak(StreamStats::kFile, c);
+        r.min[c]   = stats.Min(StreamStats::kFile, c);
+        r.max[c]   = stats.Max(StreamStats::kFile, c);
+        r.crest[c] = stats.Crest(StreamStats::kFile, c);
+        r.clips[c] = stats.Clips(StreamStats::kFile, c);
+    }
+
+    // Shorter than a segment leaves no PSD, the summary still counts.
+    if (welch.Emit())
+    {
+        SpectrumFile psd(r.nChannels, welch.NBins(), 1);
+        string       out = Product(Name, ".psd");
+        r.segments = welch.Segments();
+        psd.SetKind(SpectrumFile::kPSD);
+        psd.SetSampleRate(r.sampleRate);
+        psd.SetFFTLength(fSegment);
+        psd.SetAverages(r.segments);
+        psd.SetOverlap(fOverlap);
+        psd.SetWindow(Welch::WindowName(fWindow));
+        psd.SetNote(Name.c_str());
+        if (!psd.Open(out.c_str()))
+        {
+            pLogger->Log("# Batch: can not create %s\n", out.c_str());
+            return false;
+        }
+        psd.Append(acc.FirstTime(), acc.FirstSample(), welch.PSD(0));
+        psd.Close();
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Product
+ *
+ * Description : Output file for an input, in the output directory
+ *               if there is one.
+ *
+ * Inputs : Name - input file
+ *          ext  - new extension, with the dot
+ *
+ * Returns : file name
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+string BatchAnalysis::Product(const string &Name, const char *ext) const
+{
+    string rc(Name);
+    size_t slash = rc.rfind('/');
+    size_t dot   = rc.rfind('.');
+    if ((dot != string::npos) && ((slash == string::npos) || (dot > slash)))
+    {
+        rc.erase(dot);
+    }
+    if (!fOutput.empty())
+    {
+        slash = rc.rfind('/');
+        rc = fOutput + "/" + ((slash == string::npos) ? rc : rc.substr(slash+1));
+    }
+    return rc + ext;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WriteSummary
+ *
+ * Description : batch.csv in the output directory, or the current
+ *               one, a line per channel per file, in file order.
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : EOUTPUT
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool BatchAnalysis::WriteSummary(void)
+{
+    SET_DEBUG_STACK;
+    string name = fOutput.empty() ? string("batch.csv") : fOutput + "/batch.csv";
+    FILE  *fp   = fopen(name.c_str(), "w");
+
+    if (fp == NULL)
+    {
+        SetError(EOUTPUT, __LINE__);
+        return false;
+    }
+    fprintf(fp, "file,channel,sample_rate,frames,seconds,segments,mean,rms,peak,min,max,crest,clips\n");
+    for (size_t i=0; i<fFiles.size(); i++)
+    {
+        const Result &r = fResults[i];
+        if (!r.ok) continue;
+        for (uint32_t c=0; c<r.nChannels; c++)
+        {
+            fprintf(fp, "%s,%u,%g,%lu,%.3f,%u,%.4f,%.4f,%d,%d,%d,%.3f,%lu\n",
+                    fFiles[i].c_str(), c, r.sampleRate,
+                    (unsigned long) r.frames, r.frames / r.sampleRate,
+                    r.segments, r.mean[c], r.rms[c], r.peak[c],
+                    r.min[c], r.max[c], r.crest[c], (unsigned long) r.clips[c]);
+        }
+    }
+    fclose(fp);
+    SET_DEBUG_STACK;
+    return true;
+}
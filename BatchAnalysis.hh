@@ -0,0 +1,112 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : BatchAnalysis.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Offline analysis of a set of .acc files, what the
+ *               notebooks did one file at a time. The files are
+ *               shared out to a pool of worker threads, each with
+ *               its own Welch estimator and buffers. For every file
+ *               the whole file Welch PSD is written to a .psd
+ *               SpectrumFile and per channel StreamStats go to a
+ *               summary CSV. Files/s and MB/s go to the log.
+ *
+ * Restrictions/Limitations :
+ *   Files are independent, nothing is carried from one to the next.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Summary adds min, max, crest and clips.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __BATCHANALYSIS_hh_
+#define __BATCHANALYSIS_hh_
+#  include <cstdint>
+#  include <atomic>
+#  include <string>
+#  include <vector>
+#  include "CObject.hh"
+
+class BatchAnalysis : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_FILES=1, EOUTPUT};
+
+    /*!
+     * Segment, Overlap, Window - Welch settings, as for the live PSD
+     * Threads                  - workers, 0 for one per core
+     */
+    BatchAnalysis(uint32_t Segment, uint32_t Overlap, int Window,
+                  int Threads=0);
+    ~BatchAnalysis(void);
+
+    /*! Where the products go, "" for next to each input. */
+    inline void SetOutput(const char *Dir) {fOutput = Dir ? Dir : "";};
+
+    /*!
+     * A directory means every .acc file in it, anything else is a
+     * glob(3) pattern. Sorted.
+     */
+    static std::vector<std::string> Expand(const char *Pattern);
+
+    /*! Analyse everything Pattern names. False if nothing was done. */
+    bool Run(const char *Pattern);
+
+    inline uint32_t Files(void)   const {return fFiles.size();};
+    inline uint32_t Failed(void)  const {return fFailed;};
+    inline uint64_t Bytes(void)   const {return fBytes;};
+    inline double   Seconds(void) const {return fSeconds;};
+    inline int      Threads(void) const {return fThreads;};
+
+private:
+    /*! What one worker found in one file. */
+    typedef struct
+    {
+        bool                ok;
+        uint32_t            nChannels;
+        double              sampleRate;
+        uint64_t            frames;
+        uint64_t            bytes;
+        uint32_t            segments;
+        std::vector<double> mean;
+        std::vector<double> rms;
+        std::vector<int32_t> peak;   /*! |sample|, 32768 fits */
+        std::vector<int32_t> min;
+        std::vector<int32_t> max;
+        std::vector<double>  crest;
+        std::vector<uint64_t> clips;
+    }
+    Result;
+
+    /*! Take files off the list until there are none left. */
+    void Worker(void);
+    /*! Everything done to one file. */
+    bool AnalyseFile(const std::string &Name, Result &r);
+    /*! Product name for an input, with a new extension. */
+    std::string Product(const std::string &Name, const char *ext) const;
+    /*! One CSV line per channel per file. */
+    bool WriteSummary(void);
+
+    uint32_t                  fSegment;
+    uint32_t                  fOverlap;
+    int                       fWindow;
+    int                       fThreads;
+    std::string               fOutput;
+
+    std::vector<std::string>  fFiles;
+    std::vector<Result>       fResults;
+    std::atomic<size_t>       fNext;      /*! Next file to hand out */
+    uint32_t                  fFailed;
+    uint64_t                  fBytes;
+    double                    fSeconds;
+};
+#endif
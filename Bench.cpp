@@ -0,0 +1,707 @@
+/********************************************************************
+ *
+ * Module Name : Bench.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Microbenchmarks for the analysis hot paths.
+ *               Built and run with make bench.
+ *
+ * Restrictions/Limitations :
+ *   Allocation counts replace malloc through glibc's __libc_malloc,
+ *   so Linux only, which is all we build on anyway.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Sweep of Analysis::ScaleData and ComputeFFT over FFT
+ *               size, channels, precision and threads, plus the
+ *               Stats and callback copy loops. Results also go out as
+ *               JSON with ns/sample, GFLOP/s and allocations per call
+ *               so a change can be compared against a baseline run.
+ * 17-Oct-26 CBL StreamStats against the old Stats loop.
+ * 17-Oct-26 CBL Spectrogram and its file at 48 kHz.
+ * 17-Oct-26 CBL ToneBank, per sample cost against tones tracked.
+ * 17-Oct-26 CBL BiquadFilter at 48 kHz against order.
+ * 17-Oct-26 CBL OctaveBank, octaves and thirds at 48 kHz.
+ * 17-Oct-26 CBL Decimator, one stage against a cascade.
+ * 17-Oct-26 CBL AccCodec encode and decode, quiet and noisy.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+#include <iostream>
+using namespace std;
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstdarg>
+#include <cerrno>
+#include <cmath>
+#include <chrono>
+#include <new>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+
+// Local Includes.
+#include "ScaleKernel.hh"
+#include "Analysis.hh"
+#include "Wisdom.hh"
+#include "RingBuffer.hh"
+#include "StreamStats.hh"
+#include "Spectrogram.hh"
+#include "SpectrogramFile.hh"
+#include "ToneBank.hh"
+#include "BiquadFilter.hh"
+#include "OctaveBank.hh"
+#include "Decimator.hh"
+#include "AccCodec.hh"
+
+/*
+ * Every allocation in the process, C and C++, is counted so a
+ * benchmark can report how many its hot path makes. The hot paths
+ * should make none.
+ */
+static std::atomic<uint64_t> gAllocs(0);
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void *__libc_memalign(size_t, size_t);
+
+extern "C" void *malloc(size_t n)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(n);
+}
+extern "C" void *calloc(size_t n, size_t m)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, m);
+}
+extern "C" void *realloc(void *p, size_t n)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, n);
+}
+extern "C" int posix_memalign(void **p, size_t a, size_t n)
+{
+    gAllocs.fetch_add(1, std::memory_order_relaxed);
+    *p = __libc_memalign(a, n);
+    return (*p == NULL) ? ENOMEM : 0;
+}
+// operator new ends up in malloc above, no need to count it twice.
+
+/* One JSON object per measurement, written out at the end. */
+static vector<string> gResults;
+
+/* Results go here so the compiler can not drop the work. */
+static volatile double gSink;
+
+/* Quick sweep, small sizes only. */
+static bool gQuick = false;
+
+/*
+ * What Analysis::ScaleData did before ScaleFrames, kept here as the
+ * baseline. Channel 0 only, memset then a branch per sample.
+ */
+static void ScaleReference(const int16_t *samples, uint32_t nChan,
+                           int32_t n, double scale, const double *window,
+                           double *in)
+{
+    memset(in, 0, n * sizeof(double));
+    for (int32_t i=0; i<n; i++)
+    {
+        in[i] = scale * (double) samples[i*nChan];
+        if (window)
+        {
+            in[i] *= window[i];
+        }
+    }
+}
+
+/*
+ * The loop the old MainModule::Stats ran, peak and mean absolute
+ * value, kept as the reference for StreamStats.
+ */
+static void StatsReference(const int16_t *samples, uint32_t n,
+                           int16_t &max, double &average)
+{
+    int16_t val;
+    max     = 0;
+    average = 0.0;
+    for (uint32_t i=0; i<n; i++)
+    {
+        val = samples[i];
+        if (val < 0) val = -val;
+        if (val > max) max = val;
+        average += val;
+    }
+    average = average / (double) n;
+}
+
+/*
+ * The copy in recordCallback, a frame at a time, one or two channels.
+ */
+static void RecordCopy(const int16_t *rptr, int16_t *wptr, uint32_t nChan,
+                       uint32_t framesToCalc)
+{
+    for (uint32_t i=0; i<framesToCalc; i++)
+    {
+        *wptr++ = *rptr++;  /* left */
+        if (nChan == 2) *wptr++ = *rptr++;  /* right */
+    }
+}
+
+/*
+ * Timing of one benchmark: best of the runs, and allocations per run.
+ */
+typedef struct
+{
+    double   best;     /* seconds */
+    double   allocs;   /* per run */
+    int      runs;
+}
+Timing;
+
+/*
+ * Run f at least MinRuns times and for at least MinSeconds, keep
+ * the best.
+ */
+template <class F> static Timing Time(F f, int MinRuns=5,
+                                      double MinSeconds=0.2)
+{
+    Timing   rc;
+    double   total = 0.0;
+    uint64_t a0;
+
+    rc.best = 1.0e30;
+    rc.runs = 0;
+    f();    // Warm the caches and page in the buffers.
+    a0 = gAllocs.load();
+    while ((rc.runs < MinRuns) || (total < MinSeconds))
+    {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        f();
+        std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+        if (dt.count() < rc.best) rc.best = dt.count();
+        total += dt.count();
+        rc.runs++;
+    }
+    rc.allocs = (double) (gAllocs.load() - a0) / (double) rc.runs;
+    return rc;
+}
+
+/*
+ * Print a line and keep the JSON. Params is the comma separated
+ * "key": value list that identifies the case.
+ */
+static void Report(const char *Bench, const string &Params, const Timing &t,
+                   double Samples, double Flops)
+{
+    char   line[512];
+    double ns     = 1.0e9 * t.best / Samples;
+    double gflops = (Flops > 0.0) ? 1.0e-9 * Flops / t.best : 0.0;
+
+    printf("%-10s %-60s %9.3f ns/sample %8.3f GFLOP/s %6.1f allocs\n",
+           Bench, Params.c_str(), ns, gflops, t.allocs);
+    snprintf(line, sizeof(line),
+             "{\"bench\": \"%s\", %s, \"ns_per_sample\": %.4f, \"gflops\": %.4f, \"allocs_per_call\": %.2f, \"runs\": %d, \"best_s\": %.6e}",
+             Bench, Params.c_str(), ns, gflops, t.allocs, t.runs, t.best);
+    gResults.push_back(line);
+}
+
+static string Params(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static string Params(const char *fmt, ...)
+{
+    char    buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return string(buf);
+}
+
+static void Fill(int16_t *samples, size_t n)
+{
+    for (size_t i=0; i<n; i++)
+    {
+        samples[i] = (int16_t) (rand() & 0xFFFF);
+    }
+}
+
+/*
+ * ScaleData, reference loop against each kernel. The reference only
+ * does one channel per call, so it is run once per channel to
+ * compare like with like.
+ */
+static void BenchScaleKernels(uint32_t nChan, uint32_t nFrames, bool windowed)
+{
+    int16_t *samples = new int16_t[nChan * nFrames];
+    double  *window  = new double[nFrames];
+    double  *out     = new double[nChan * nFrames];
+    double   n       = (double) nChan * nFrames;
+    Timing   t;
+
+    Fill(samples, nChan * nFrames);
+    for (uint32_t i=0; i<nFrames; i++)
+    {
+        window[i] = 0.54 - 0.46 * cos(2.0 * M_PI * i / nFrames);
+    }
+    const double *w = windowed ? window : NULL;
+
+    t = Time([&]{
+        for (uint32_t c=0; c<nChan; c++)
+            ScaleReference(&samples[c], nChan, nFrames, 1.0, w, &out[c*nFrames]);
+    });
+    Report("scale", Params("\"frames\": %u, \"channels\": %u, \"window\": %s, \"kernel\": \"reference\"",
+                           nFrames, nChan, windowed ? "true" : "false"),
+           t, n, (windowed ? 2.0 : 1.0) * n);
+
+    for (int isa=kScaleScalar; isa<=kScaleAVX2; isa++)
+    {
+        if (SetScaleKernel(isa) != isa) continue;
+        t = Time([&]{
+            ScaleFrames(samples, nChan, nFrames, 1.0, w, out, nFrames);
+        });
+        Report("scale", Params("\"frames\": %u, \"channels\": %u, \"window\": %s, \"kernel\": \"%s\"",
+                               nFrames, nChan, windowed ? "true" : "false",
+                               ScaleKernelName()),
+               t, n, (windowed ? 2.0 : 1.0) * n);
+    }
+    SetScaleKernel(kScaleAuto);
+
+    delete[] samples;
+    delete[] window;
+    delete[] out;
+}
+
+/*
+ * Analysis::ScaleData and ComputeFFT for one shape. FFT flops are
+ * the usual 2.5 N log2 N per real transform.
+ */
+static void BenchAnalysis(uint32_t nFrames, uint32_t nChan, bool single,
+                          int threads)
+{
+    int16_t *samples = new int16_t[nChan * nFrames];
+    double   n       = (double) nChan * nFrames;
+    Timing   t;
+
+    Fill(samples, nChan * nFrames);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    Analysis *a = new Analysis(nFrames, nChan, single, threads);
+    std::chrono::duration<double> plan = std::chrono::steady_clock::now() - t0;
+    string p = Params("\"frames\": %u, \"channels\": %u, \"precision\": \"%s\", \"threads\": %d",
+                      nFrames, nChan, single ? "float" : "double",
+                      a->Threads());
+
+    t = Time([&]{ a->ScaleData(samples); });
+    Report("scaledata", p, t, n, 2.0 * n);
+
+    t = Time([&]{ a->ComputeFFT(); });
+    Report("fft", p + Params(", \"plan_s\": %.3f", plan.count()), t, n,
+           2.5 * n * log2((double) nFrames));
+
+    delete a;
+    delete[] samples;
+}
+
+/*
+ * Statistics over a record, the old Stats loop then StreamStats with
+ * each MomentFrames kernel.
+ */
+static void BenchStats(uint32_t nChan, uint32_t nFrames)
+{
+    int16_t    *samples = new int16_t[nChan * nFrames];
+    int16_t     max;
+    double      average;
+    double      n = (double) nChan * nFrames;
+    StreamStats stats("bench", nChan);
+
+    Fill(samples, nChan * nFrames);
+    Timing t = Time([&]{
+        StatsReference(samples, nChan * nFrames, max, average);
+        gSink = average + max;
+    });
+    Report("stats", Params("\"frames\": %u, \"channels\": %u, \"kernel\": \"reference\"",
+                           nFrames, nChan),
+           t, n, 3.0 * n);
+
+    for (int isa=kScaleScalar; isa<=kScaleAVX2; isa++)
+    {
+        if (SetScaleKernel(isa) != isa) continue;
+        t = Time([&]{
+            stats.Add(samples, nFrames);
+            gSink = stats.RMS(StreamStats::kInterval, 0);
+        });
+        Report("stats", Params("\"frames\": %u, \"channels\": %u, \"kernel\": \"%s\"",
+                               nFrames, nChan, ScaleKernelName()),
+               t, n, 6.0 * n);
+    }
+    SetScaleKernel(kScaleAuto);
+    delete[] samples;
+}
+
+/*
+ * The processing thread's STFT work for 10 s of 48 kHz capture, in
+ * 512 frame blocks, through to the tiled file (on /dev/null so the
+ * disk is not what is timed). Real time is 1/ns per sample/rate.
+ */
+static void BenchSpectrogram(uint32_t nChan, uint32_t segment, uint32_t hop,
+                             int format, bool decibels)
+{
+    const double     rate    = 48000.0;
+    const uint32_t   block   = 512;
+    const uint32_t   nFrames = 48000 * 10;
+    int16_t         *samples = new int16_t[nChan * nFrames];
+    double           n       = (double) nChan * nFrames;
+    Spectrogram      stft(segment, hop, nChan, Welch::kHann, rate);
+    SpectrogramFile  file(nChan, stft.NBins(), 64, format);
+    Timing           t;
+
+    Fill(samples, nChan * nFrames);
+    stft.SetDecibels(decibels);
+    file.SetRange(-40.0, 100.0);
+    file.Open("/dev/null");
+    t = Time([&]{
+        for (uint32_t b=0; b+block<=nFrames; b+=block)
+        {
+            uint32_t m = stft.AddBlock(&samples[b*nChan], block);
+            for (uint32_t i=0; i<m; i++)
+                file.Append((double) stft.ColumnFrame(i) / rate,
+                            stft.ColumnFrame(i), stft.Column(i));
+        }
+        gSink = stft.Count();
+    });
+    Report("stft", Params("\"segment\": %u, \"hop\": %u, \"channels\": %u, \"rate\": %.0f, \"units\": \"%s\", \"format\": \"%s\", \"realtime\": %.0f",
+                          segment, hop, nChan, rate,
+                          decibels ? "dB" : "magnitude",
+                          SpectrogramFile::FormatName(format),
+                          (double) nFrames / rate / t.best),
+           t, n, 2.5 * n * log2((double) segment) * segment / hop);
+    delete[] samples;
+}
+
+/*
+ * Goertzel tone trackers over a minute at 16 kHz, the cost should
+ * go up linearly with the tones and not at all with the window.
+ */
+static void BenchTones(uint32_t nChan, uint32_t nTones)
+{
+    const uint32_t nFrames = 16000 * 60;
+    int16_t       *samples = new int16_t[nChan * nFrames];
+    double         n       = (double) nChan * nFrames;
+    ToneBank       bank(nChan, 16000.0, 1.0);
+    Timing         t;
+
+    Fill(samples, nChan * nFrames);
+    for (uint32_t k=0; k<nTones; k++) bank.AddTone(50.0 * (k + 1));
+    t = Time([&]{
+        for (uint32_t b=0; b<nFrames; b+=512)
+            bank.Add(&samples[b*nChan], (nFrames - b < 512) ? nFrames - b : 512);
+        gSink = bank.Amplitude(0, 0);
+    });
+    Report("tones", Params("\"frames\": %u, \"channels\": %u, \"tones\": %u",
+                           nFrames, nChan, nTones),
+           t, n, 3.0 * 3.0 * n * nTones);
+    delete[] samples;
+}
+
+/*
+ * Band pass cascade over a minute at 48 kHz, in place in the blocks
+ * the processing thread sees. The budget is well under 1% of a core,
+ * so realtime should be in the hundreds at least.
+ */
+static void BenchFilter(uint32_t nChan, uint32_t order)
+{
+    const double   rate    = 48000.0;
+    const uint32_t nFrames = 48000 * 60;
+    int16_t       *samples = new int16_t[nChan * nFrames];
+    double         n       = (double) nChan * nFrames;
+    BiquadFilter   filter(nChan, rate);
+    Timing         t;
+
+    Fill(samples, nChan * nFrames);
+    filter.Design(BiquadFilter::kBandPass, order, 0.5, 2000.0);
+    t = Time([&]{
+        for (uint32_t b=0; b<nFrames; b+=1024)
+            filter.Process(&samples[b*nChan],
+                           (nFrames - b < 1024) ? nFrames - b : 1024);
+        gSink = samples[0];
+    });
+    Report("biquad", Params("\"order\": %u, \"sections\": %u, \"channels\": %u, \"rate\": %.0f, \"realtime\": %.0f",
+                            order, filter.Sections(), nChan, rate,
+                            (double) nFrames / rate / t.best),
+           t, n, 9.0 * n * filter.Sections());
+    delete[] samples;
+}
+
+/*
+ * Band levels from 1 Hz up over a minute at 48 kHz. Most of the cost
+ * should be the top octave, the rest about as much again.
+ */
+static void BenchOctave(uint32_t nChan, uint32_t fraction)
+{
+    const double   rate    = 48000.0;
+    const uint32_t nFrames = 48000 * 60;
+    int16_t       *samples = new int16_t[nChan * nFrames];
+    double         n       = (double) nChan * nFrames;
+    OctaveBank     bank(nChan, rate, fraction, 1.0, 20000.0, 3, 1.0);
+    Timing         t;
+
+    Fill(samples, nChan * nFrames);
+    t = Time([&]{
+        for (uint32_t b=0; b<nFrames; b+=1024)
+            bank.Add(&samples[b*nChan], (nFrames - b < 1024) ? nFrames - b : 1024);
+        gSink = bank.Leq(0, 0);
+    });
+    Report("octave", Params("\"fraction\": %u, \"bands\": %u, \"levels\": %u, \"channels\": %u, \"rate\": %.0f, \"realtime\": %.0f",
+                            fraction, bank.NBands(), bank.NLevels(), nChan,
+                            rate, (double) nFrames / rate / t.best),
+           t, n, 0.0);
+    delete[] samples;
+}
+
+/*
+ * Decimation of a minute at 48 kHz, in place in the blocks the
+ * processing thread pops. The same total factor as one stage and as
+ * a cascade of twos.
+ */
+static void BenchDecimate(uint32_t nChan, const vector<uint32_t> &factors)
+{
+    const double   rate    = 48000.0;
+    const uint32_t nFrames = 48000 * 60;
+    const uint32_t block   = 2048;
+    int16_t       *samples = new int16_t[nChan * nFrames];
+    double         n       = (double) nChan * nFrames;
+    Decimator      dec(nChan, rate);
+    Timing         t;
+    string         list;
+
+    Fill(samples, nChan * nFrames);
+    dec.Design(factors);
+    for (uint32_t f : factors) list += (list.empty() ? "" : ",") + to_string(f);
+    t = Time([&]{
+        for (uint32_t b=0; b<nFrames; b+=block)
+            dec.Process(&samples[b*nChan], (nFrames - b < block) ? nFrames - b : block,
+                        &samples[b*nChan]);
+        gSink = samples[0];
+    });
+    Report("decimate", Params("\"factors\": [%s], \"taps_per_sample\": %.1f, \"channels\": %u, \"rate\": %.0f, \"realtime\": %.0f",
+                              list.c_str(), dec.Cost(), nChan, rate,
+                              (double) nFrames / rate / t.best),
+           t, n, 2.0 * n * dec.Cost());
+    delete[] samples;
+}
+
+/*
+ * Lossless coding of a minute at 16 kHz in the writer's blocks. Full
+ * scale noise does not compress, so the signal is a hum plus noise
+ * of a given peak, about what an accelerometer on a bench gives.
+ */
+static void BenchCodec(uint32_t nChan, int noise)
+{
+    const double   rate    = 16000.0;
+    const uint32_t nFrames = 16000 * 60;
+    const uint32_t block   = 4096;
+    int16_t       *samples = new int16_t[nChan * nFrames];
+    int16_t       *decoded = new int16_t[nChan * nFrames];
+    double         n       = (double) nChan * nFrames;
+    AccCodec       codec(nChan, block);
+    vector<uint8_t> coded((size_t) (nFrames / block + 1) * codec.MaxBytes());
+    size_t         bytes   = 0;
+    Timing         t;
+
+    for (uint32_t i=0; i<nFrames; i++)
+        for (uint32_t c=0; c<nChan; c++)
+            samples[i*nChan + c] = (int16_t) lrint(2000.0 * sin(2.0*M_PI*50.0*i/rate) +
+                                                   ((rand() % (2*noise + 1)) - noise));
+    t = Time([&]{
+        bytes = 0;
+        for (uint32_t b=0; b<nFrames; b+=block)
+            bytes += codec.Encode(&samples[b*nChan], (nFrames - b < block) ? nFrames - b : block,
+                                  b, &coded[bytes]);
+        gSink = bytes;
+    });
+    Report("encode", Params("\"noise\": %d, \"channels\": %u, \"ratio\": %.2f, \"realtime\": %.0f",
+                            noise, nChan, 2.0 * n / bytes,
+                            (double) nFrames / rate / t.best),
+           t, n, 0.0);
+    t = Time([&]{
+        AccCodec::Block b;
+        for (size_t off=0; off<bytes; off+=b.bytes)
+        {
+            AccCodec::Peek(&coded[off], bytes - off, b);
+            codec.Decode(&coded[off], bytes - off, &decoded[b.first*nChan]);
+        }
+        gSink = decoded[0];
+    });
+    Report("decode", Params("\"noise\": %d, \"channels\": %u, \"lossless\": %s, \"realtime\": %.0f",
+                            noise, nChan,
+                            memcmp(samples, decoded, 2*(size_t) n) ? "false" : "true",
+                            (double) nFrames / rate / t.best),
+           t, n, 0.0);
+    delete[] samples;
+    delete[] decoded;
+}
+
+/*
+ * What each callback does to its buffer: the one shot frame by frame
+ * copy, and the continuous mode ring push plus the processing thread
+ * pop, both timed over a whole record of FramesPerBuffer callbacks.
+ */
+static void BenchCallback(uint32_t nChan, uint32_t framesPerBuffer)
+{
+    const uint32_t   nFrames  = 16000 * 10;
+    const uint32_t   nBuffers = nFrames / framesPerBuffer;
+    int16_t         *in       = new int16_t[nChan * framesPerBuffer];
+    int16_t         *record   = new int16_t[nChan * nFrames];
+    SPSCRing<int16_t> ring(4 * nChan * nFrames);
+    double           n        = (double) nChan * nBuffers * framesPerBuffer;
+    string           p        = Params("\"frames_per_buffer\": %u, \"channels\": %u",
+                                       framesPerBuffer, nChan);
+    Timing           t;
+
+    Fill(in, nChan * framesPerBuffer);
+    t = Time([&]{
+        for (uint32_t b=0; b<nBuffers; b++)
+            RecordCopy(in, &record[b * framesPerBuffer * nChan], nChan,
+                       framesPerBuffer);
+        gSink = record[nChan * nFrames - 1];
+    });
+    Report("record_cb", p, t, n, 0.0);
+
+    t = Time([&]{
+        for (uint32_t b=0; b<nBuffers; b++)
+            ring.Push(in, framesPerBuffer * nChan);
+        while (ring.Pop(record, nChan * nFrames) > 0) ;
+    });
+    Report("ring_cb", p, t, n, 0.0);
+
+    delete[] in;
+    delete[] record;
+}
+
+static void Help(void)
+{
+    cout << "Bench [-q] [-o file.json] [-e effort] [-d wisdom dir]" << endl
+         << "  -q  quick, small sizes only" << endl
+         << "  -o  write the results as JSON" << endl
+         << "  -e  FFTW planner effort, default measure" << endl
+         << "  -d  wisdom directory, default wisdom" << endl;
+}
+
+int main(int argc, char **argv)
+{
+    const char *json   = NULL;
+    const char *effort = "measure";
+    const char *dir    = "wisdom";
+    int         option;
+
+    while ((option = getopt(argc, argv, "qo:e:d:h")) != -1)
+    {
+        switch (option)
+        {
+        case 'q':
+            gQuick = true;
+            break;
+        case 'o':
+            json = optarg;
+            break;
+        case 'e':
+            effort = optarg;
+            break;
+        case 'd':
+            dir = optarg;
+            break;
+        default:
+            Help();
+            return 1;
+        }
+    }
+    Wisdom::SetEffort(effort);
+    Wisdom::SetDirectory(dir);
+
+    /*
+     * Powers of two and the 16000*k record lengths we actually run
+     * (1 s, 4 s, 16 s and a minute at 16 kHz).
+     */
+    vector<uint32_t> sizes;
+    for (uint32_t p=10; p<=(gQuick ? 14u : 20u); p+=2) sizes.push_back(1u << p);
+    sizes.push_back(16000);
+    if (!gQuick)
+    {
+        sizes.push_back(16000*4);
+        sizes.push_back(16000*16);
+        sizes.push_back(16000*60);
+    }
+    // 1, 2, 4 and every core, without repeats.
+    vector<int> threads;
+    int         cores = Wisdom::ThreadCount(0);
+    for (int t=1; t<cores; t*=2) threads.push_back(t);
+    threads.push_back(cores);
+
+    for (uint32_t nChan=1; nChan<=2; nChan++)
+    {
+        BenchScaleKernels(nChan, 16000,      true);
+        BenchScaleKernels(nChan, 16000*60,   false);
+        BenchScaleKernels(nChan, 16000*60,   true);
+    }
+    for (uint32_t nChan=1; nChan<=2; nChan++)
+    {
+        for (uint32_t size : sizes)
+        {
+            for (int single=0; single<=1; single++)
+            {
+                for (int t : threads)
+                {
+                    // Threads do not pay below about a second.
+                    if ((t > 1) && (size < 16000)) continue;
+                    BenchAnalysis(size, nChan, single, t);
+                }
+            }
+        }
+        BenchStats(nChan, 16000*60);
+        for (uint32_t nTones=1; nTones<=8; nTones*=2) BenchTones(nChan, nTones);
+        BenchCallback(nChan, 512);
+    }
+    for (int format=SpectrogramFile::kFloat32; format<=SpectrogramFile::kUInt8;
+         format++)
+    {
+        BenchSpectrogram(2, 1024, 256, format, true);
+    }
+    BenchSpectrogram(2, 1024, 256, SpectrogramFile::kFloat16, false);
+    if (!gQuick) BenchSpectrogram(2, 4096, 512, SpectrogramFile::kFloat16, true);
+    for (uint32_t order=2; order<=8; order*=2) BenchFilter(2, order);
+    BenchOctave(2, 1);
+    BenchOctave(2, 3);
+    BenchDecimate(2, {8});
+    BenchDecimate(2, {2, 2, 2});
+    BenchCodec(2, 8);
+    BenchCodec(2, 256);
+
+    if (json)
+    {
+        FILE *fp = fopen(json, "w");
+        if (fp == NULL)
+        {
+            perror(json);
+            return 1;
+        }
+        fprintf(fp, "{\n \"kernel\": \"%s\",\n \"effort\": \"%s\",\n \"cores\": %d,\n \"results\": [\n",
+                ScaleKernelName(), Wisdom::Effort(), cores);
+        for (size_t i=0; i<gResults.size(); i++)
+        {
+            fprintf(fp, "  %s%s\n", gResults[i].c_str(),
+                    (i+1 < gResults.size()) ? "," : "");
+        }
+        fprintf(fp, " ]\n}\n");
+        fclose(fp);
+    }
+    return 0;
+}
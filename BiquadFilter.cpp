@@ -0,0 +1,549 @@
+/********************************************************************
+ *
+ * Module Name : BiquadFilter.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Butterworth biquad cascade, in place on int16 blocks.
+ *
+ * Restrictions/Limitations :
+ *   SSE2 is part of x86-64 so the vector loop needs no target
+ *   attribute or CPU check, other machines get the scalar loop.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstdint>
+#include <complex>
+#include <strings.h>
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+// Local Includes.
+#include "BiquadFilter.hh"
+#include "debug.h"
+
+static const char *FilterNames[] = {"none", "highpass", "lowpass",
+                                    "bandpass"};
+
+/**
+ ******************************************************************
+ *
+ * Function Name : BiquadFilter constructor
+ *
+ * Description : No sections, which passes everything through.
+ *
+ * Inputs : NChan      - channels per frame
+ *          SampleRate - Hz
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+BiquadFilter::BiquadFilter(uint32_t NChan, double SampleRate)
+{
+    SET_DEBUG_STACK;
+    fNChannels  = (NChan > 0) ? NChan : 1;
+    fPairs      = (fNChannels + 1) / 2;
+    fSampleRate = SampleRate;
+    fType       = kNone;
+    fPrimed     = false;
+    fClipped    = 0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : BiquadFilter destructor
+ *
+ * Description : Nothing to do, the vectors look after themselves.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+BiquadFilter::~BiquadFilter(void)
+{
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FilterType
+ *
+ * Description : Config string to design enum.
+ *
+ * Inputs : Name - none, highpass, lowpass or bandpass
+ *
+ * Returns : design enum, kNone if not recognised
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int BiquadFilter::FilterType(const char *Name)
+{
+    for (int i=kNone; i<=kBandPass; i++)
+    {
+        if (Name && (strcasecmp(Name, FilterNames[i]) == 0))
+        {
+            return i;
+        }
+    }
+    return kNone;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FilterName
+ *
+ * Description : Design enum to config string.
+ *
+ * Inputs : Type - enum
+ *
+ * Returns : name
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+const char* BiquadFilter::FilterName(int Type)
+{
+    if ((Type < kNone) || (Type > kBandPass))
+    {
+        Type = kNone;
+    }
+    return FilterNames[Type];
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AddSection
+ *
+ * Description : Append a section and make room for its state.
+ *
+ * Inputs : b0, b1, b2 - numerator
+ *          a1, a2     - denominator, a0 = 1
+ *
+ * Returns : false if the cascade is already kMaxSections long
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool BiquadFilter::AddSection(double b0, double b1, double b2, double a1,
+                              double a2)
+{
+    SET_DEBUG_STACK;
+    if (fB0.size() >= kMaxSections) return false;
+    fB0.push_back(b0);
+    fB1.push_back(b1);
+    fB2.push_back(b2);
+    fA1.push_back(a1);
+    fA2.push_back(a2);
+    fZ1.assign(fPairs * fB0.size() * 2, 0.0);
+    fZ2.assign(fPairs * fB0.size() * 2, 0.0);
+    fPrimed = false;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Butterworth
+ *
+ * Description : One section per conjugate pole pair, Q from the
+ *               pole angle, and a first order section for the real
+ *               pole of an odd order.
+ *
+ * Inputs : High   - high pass rather than low pass
+ *          Order  - poles
+ *          Corner - -3 dB frequency, Hz
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void BiquadFilter::Butterworth(bool High, uint32_t Order, double Corner)
+{
+    SET_DEBUG_STACK;
+    double w0    = 2.0 * M_PI * Corner / fSampleRate;
+    double cosw  = cos(w0);
+    double sinw  = sin(w0);
+    double k     = tan(0.5 * w0);
+    double theta, q, alpha, a0;
+
+    for (uint32_t i=0; i<Order/2; i++)
+    {
+        // Angle of the pole pair from the negative real axis.
+        if (Order % 2)
+        {
+            theta = M_PI * (double) (i + 1) / (double) Order;
+        }
+        else
+        {
+            theta = M_PI * (double) (2*i + 1) / (double) (2*Order);
+        }
+        q     = 1.0 / (2.0 * cos(theta));
+        alpha = sinw / (2.0 * q);
+        a0    = 1.0 + alpha;
+        if (High)
+        {
+            AddSection(0.5*(1.0 + cosw)/a0, -(1.0 + cosw)/a0,
+                       0.5*(1.0 + cosw)/a0, -2.0*cosw/a0, (1.0 - alpha)/a0);
+        }
+        else
+        {
+            AddSection(0.5*(1.0 - cosw)/a0, (1.0 - cosw)/a0,
+                       0.5*(1.0 - cosw)/a0, -2.0*cosw/a0, (1.0 - alpha)/a0);
+        }
+    }
+    if (Order % 2)
+    {
+        if (High)
+        {
+            AddSection(1.0/(1.0 + k), -1.0/(1.0 + k), 0.0,
+                       (k - 1.0)/(k + 1.0), 0.0);
+        }
+        else
+        {
+            AddSection(k/(1.0 + k), k/(1.0 + k), 0.0,
+                       (k - 1.0)/(k + 1.0), 0.0);
+        }
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Design
+ *
+ * Description : Throw away any sections and build the design asked
+ *               for.
+ *
+ * Inputs : Type  - kNone, kHighPass, kLowPass or kBandPass
+ *          Order - 1 to 16, per edge for band pass
+ *          Low   - high pass corner, Hz
+ *          High  - low pass corner, Hz
+ *
+ * Returns : false if the corners are not between 0 and Nyquist, in
+ *           order, or there would be too many sections
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool BiquadFilter::Design(int Type, uint32_t Order, double Low, double High)
+{
+    SET_DEBUG_STACK;
+    double   nyquist = 0.5 * fSampleRate;
+    uint32_t n       = (Order + 1) / 2;
+    bool     hp      = (Type == kHighPass) || (Type == kBandPass);
+    bool     lp      = (Type == kLowPass)  || (Type == kBandPass);
+
+    fB0.clear();
+    fB1.clear();
+    fB2.clear();
+    fA1.clear();
+    fA2.clear();
+    fZ1.clear();
+    fZ2.clear();
+    fType   = kNone;
+    fPrimed = false;
+
+    if ((Type == kNone) || (Order < 1))
+    {
+        SET_DEBUG_STACK;
+        return (Type == kNone);
+    }
+    if ((hp && ((Low <= 0.0) || (Low >= nyquist))) ||
+        (lp && ((High <= 0.0) || (High >= nyquist))) ||
+        ((Type == kBandPass) && (Low >= High)) ||
+        ((hp && lp) ? 2*n : n) > kMaxSections)
+    {
+        SET_DEBUG_STACK;
+        return false;
+    }
+    if (hp) Butterworth(true,  Order, Low);
+    if (lp) Butterworth(false, Order, High);
+    fType = Type;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Reset
+ *
+ * Description : Zero the state and prime on the next block.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void BiquadFilter::Reset(void)
+{
+    SET_DEBUG_STACK;
+    fZ1.assign(fZ1.size(), 0.0);
+    fZ2.assign(fZ2.size(), 0.0);
+    fPrimed = false;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Prime
+ *
+ * Description : For a constant input u every section settles at
+ *               y = u H(1), z1 = y - b0 u, z2 = b2 u - a2 y. Start
+ *               there with u the first frame.
+ *
+ * Inputs : frames - first frame of the stream
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void BiquadFilter::Prime(const int16_t *frames)
+{
+    SET_DEBUG_STACK;
+    uint32_t ns = fB0.size();
+    double   u, y, g;
+    size_t   z;
+
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        u = (double) frames[c];
+        for (uint32_t s=0; s<ns; s++)
+        {
+            g  = (fB0[s] + fB1[s] + fB2[s]) / (1.0 + fA1[s] + fA2[s]);
+            y  = g * u;
+            z  = ((c/2) * ns + s) * 2 + (c % 2);
+            fZ1[z] = y - fB0[s] * u;
+            fZ2[z] = fB2[s] * u - fA2[s] * y;
+            u  = y;
+        }
+    }
+    fPrimed = true;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Process
+ *
+ * Description : Run the block through the cascade a pair of
+ *               channels at a time, the state in registers for the
+ *               whole block. Output is rounded to nearest and
+ *               saturated. State that has decayed to nothing is
+ *               zeroed at the end so silence does not go denormal.
+ *
+ * Inputs : frames  - interleaved samples, overwritten
+ *          nFrames - frames in the block
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void BiquadFilter::Process(int16_t *frames, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    const uint32_t ns = fB0.size();
+    const uint32_t nc = fNChannels;
+
+    if ((ns == 0) || (nFrames == 0)) return;
+    if (!fPrimed) Prime(frames);
+
+    for (uint32_t p=0; p<fPairs; p++)
+    {
+        const uint32_t c0   = 2*p;
+        const bool     two  = (c0 + 1 < nc);
+        double        *z1   = &fZ1[p * ns * 2];
+        double        *z2   = &fZ2[p * ns * 2];
+        int16_t       *io   = &frames[c0];
+#if defined(__SSE2__)
+        __m128d b0[kMaxSections], b1[kMaxSections], b2[kMaxSections];
+        __m128d a1[kMaxSections], a2[kMaxSections];
+        __m128d s1[kMaxSections], s2[kMaxSections];
+        const __m128d lo = _mm_set1_pd(-32768.0);
+        const __m128d hi = _mm_set1_pd(32767.0);
+        __m128d x, y;
+        __m128i v;
+        uint32_t s, clips = 0;
+
+        for (s=0; s<ns; s++)
+        {
+            b0[s] = _mm_set1_pd(fB0[s]);
+            b1[s] = _mm_set1_pd(fB1[s]);
+            b2[s] = _mm_set1_pd(fB2[s]);
+            a1[s] = _mm_set1_pd(fA1[s]);
+            a2[s] = _mm_set1_pd(fA2[s]);
+            s1[s] = _mm_loadu_pd(&z1[2*s]);
+            s2[s] = _mm_loadu_pd(&z2[2*s]);
+        }
+        for (uint32_t i=0; i<nFrames; i++, io+=nc)
+        {
+            x = _mm_set_pd(two ? (double) io[1] : 0.0, (double) io[0]);
+            for (s=0; s<ns; s++)
+            {
+                y     = _mm_add_pd(_mm_mul_pd(b0[s], x), s1[s]);
+                s1[s] = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1[s], x),
+                                              _mm_mul_pd(a1[s], y)), s2[s]);
+                s2[s] = _mm_sub_pd(_mm_mul_pd(b2[s], x),
+                                   _mm_mul_pd(a2[s], y));
+                x     = y;
+            }
+            clips += __builtin_popcount(_mm_movemask_pd(
+                         _mm_or_pd(_mm_cmplt_pd(x, lo), _mm_cmpgt_pd(x, hi))) &
+                                        (two ? 3 : 1));
+            v     = _mm_cvtpd_epi32(_mm_min_pd(_mm_max_pd(x, lo), hi));
+            io[0] = (int16_t) _mm_cvtsi128_si32(v);
+            if (two) io[1] = (int16_t) _mm_extract_epi16(v, 2);
+        }
+        for (s=0; s<ns; s++)
+        {
+            _mm_storeu_pd(&z1[2*s], s1[s]);
+            _mm_storeu_pd(&z2[2*s], s2[s]);
+        }
+        fClipped += clips;
+#else
+        for (uint32_t l=0; l<(two ? 2u : 1u); l++)
+        {
+            int16_t *q = &io[l];
+            double   x, y;
+            for (uint32_t i=0; i<nFrames; i++, q+=nc)
+            {
+                x = (double) *q;
+                for (uint32_t s=0; s<ns; s++)
+                {
+                    y           = fB0[s] * x + z1[2*s+l];
+                    z1[2*s+l]   = fB1[s] * x - fA1[s] * y + z2[2*s+l];
+                    z2[2*s+l]   = fB2[s] * x - fA2[s] * y;
+                    x           = y;
+                }
+                if ((x < -32768.0) || (x > 32767.0))
+                {
+                    fClipped++;
+                    x = (x < 0.0) ? -32768.0 : 32767.0;
+                }
+                *q = (int16_t) lrint(x);
+            }
+        }
+#endif
+    }
+    for (size_t k=0; k<fZ1.size(); k++)
+    {
+        if (fabs(fZ1[k]) < 1.0e-30) fZ1[k] = 0.0;
+        if (fabs(fZ2[k]) < 1.0e-30) fZ2[k] = 0.0;
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Response
+ *
+ * Description : Magnitude of the whole cascade at one frequency.
+ *
+ * Inputs : Frequency - Hz
+ *
+ * Returns : |H(e^jw)|, 1 with no sections
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double BiquadFilter::Response(double Frequency) const
+{
+    complex<double> z1 = polar(1.0, -2.0 * M_PI * Frequency / fSampleRate);
+    complex<double> z2 = z1 * z1;
+    double          h  = 1.0;
+
+    for (size_t s=0; s<fB0.size(); s++)
+    {
+        h *= abs((fB0[s] + fB1[s]*z1 + fB2[s]*z2) /
+                 (1.0 + fA1[s]*z1 + fA2[s]*z2));
+    }
+    return h;
+}
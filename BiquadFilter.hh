@@ -0,0 +1,106 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : BiquadFilter.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Cascade of second order IIR sections applied in place
+ *               to interleaved int16 blocks, with each channel's state
+ *               carried from block to block. Butterworth high, low and
+ *               band pass designs come from the order and corners, one
+ *               section per pole pair plus a first order section for
+ *               odd orders, via the bilinear transform prewarped at the
+ *               corner. Band pass is the high pass at Low followed by
+ *               the low pass at High.
+ *
+ *               Each section is transposed direct form II in double,
+ *               which holds up with poles this close to z=1 (a 0.5 Hz
+ *               high pass at 48 kHz):
+ *
+ *                 y  = b0 x + z1
+ *                 z1 = b1 x - a1 y + z2
+ *                 z2 = b2 x - a2 y
+ *
+ *               Channels are taken two at a time, one per SSE2 lane,
+ *               so stereo costs the same as mono. Output is rounded and
+ *               saturated back to int16, clips are counted.
+ *
+ *               On the first block the state is set as though the
+ *               first frame had always been there, so the offset of the
+ *               accelerometer does not ring through a high pass.
+ *
+ * Restrictions/Limitations :
+ *   One thread. Sections are fixed once the first block is through.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   R. Bristow-Johnson, "Cookbook formulae for audio EQ biquad
+ *   filter coefficients".
+ *
+ *******************************************************************
+ */
+#ifndef __BIQUADFILTER_hh_
+#define __BIQUADFILTER_hh_
+#  include <cstdint>
+#  include <vector>
+
+class BiquadFilter
+{
+public:
+    /*! Designs. */
+    enum {kNone=0, kHighPass, kLowPass, kBandPass};
+
+    BiquadFilter(uint32_t NChan, double SampleRate);
+    ~BiquadFilter(void);
+
+    /*!
+     * Replace the sections with a Butterworth design. Low is the
+     * high pass corner, High the low pass corner, Hz. Returns false,
+     * leaving no sections, if the corners do not make sense.
+     */
+    bool Design(int Type, uint32_t Order, double Low, double High);
+    /*! Add a section, a0 normalised to 1. False if there are
+     *  already kMaxSections. */
+    bool AddSection(double b0, double b1, double b2, double a1, double a2);
+
+    /*! Filter nFrames interleaved frames in place. */
+    void Process(int16_t *frames, uint32_t nFrames);
+    /*! Forget the state, the next block primes it again. */
+    void Reset(void);
+
+    /*! |H| at Frequency, Hz. */
+    double   Response(double Frequency) const;
+    inline uint32_t Sections(void)  const {return fB0.size();};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    inline int      Type(void)      const {return fType;};
+    /*! Output samples saturated to int16 since construction. */
+    inline uint64_t Clipped(void)   const {return fClipped;};
+
+    /*! Longest cascade, a 16th order band pass. */
+    static const uint32_t kMaxSections = 16;
+
+    /*! Config string to design enum and back. */
+    static int         FilterType(const char *Name);
+    static const char* FilterName(int Type);
+
+private:
+    /*! Butterworth low or high pass sections. */
+    void Butterworth(bool High, uint32_t Order, double Corner);
+    /*! Steady state for a constant input of the first frame. */
+    void Prime(const int16_t *frames);
+
+    uint32_t fNChannels;
+    uint32_t fPairs;            /*! Channels rounded up to even, / 2 */
+    double   fSampleRate;
+    int      fType;
+    bool     fPrimed;
+    uint64_t fClipped;
+
+    std::vector<double> fB0, fB1, fB2, fA1, fA2;  /*! Per section */
+    std::vector<double> fZ1, fZ2;  /*! Pairs x Sections x 2 lanes */
+};
+#endif
@@ -0,0 +1,173 @@
+/********************************************************************
+ *
+ * Module Name : CallbackStats.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Reader side of the callback timing statistics.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdio>
+#include <string>
+
+// Local Includes.
+#include "CallbackStats.hh"
+#include "CLogger.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : CallbackStats constructor
+ *
+ * Description : Zero everything.
+ *
+ * Inputs : Name   - label for the log
+ *          Period - seconds between callbacks, the deadline
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+CallbackStats::CallbackStats(const char *Name, double Period)
+{
+    SET_DEBUG_STACK;
+    fName   = Name;
+    fPeriod = (uint64_t) (Period * 1.0e9);
+    fLastStart.store(0);
+    fCount.store(0);
+    fMisses.store(0);
+    fExecMax.store(0);
+    fJitterMax.store(0);
+    fInputUnderflow.store(0);
+    fInputOverflow.store(0);
+    fOutputUnderflow.store(0);
+    fOutputOverflow.store(0);
+    for (uint32_t i=0; i<kBuckets; i++)
+    {
+        fExec[i].store(0);
+        fJitter[i].store(0);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Percentile
+ *
+ * Description : Upper edge of the bucket holding quantile q.
+ *
+ * Inputs : h - kBuckets counts
+ *          q - 0 to 1
+ *
+ * Returns : ns, 0 if the histogram is empty
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint64_t CallbackStats::Percentile(const uint64_t *h, double q)
+{
+    uint64_t total = 0;
+    uint64_t sum   = 0;
+    for (uint32_t i=0; i<kBuckets; i++) total += h[i];
+    if (total == 0) return 0;
+    for (uint32_t i=0; i<kBuckets; i++)
+    {
+        sum += h[i];
+        if ((double) sum >= q * (double) total)
+        {
+            return (i == 0) ? 0 : (1ULL << i);
+        }
+    }
+    return 1ULL << (kBuckets-1);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Publish
+ *
+ * Description : Snapshot the counters and put two lines in the
+ *               log, the summary and the execution time histogram.
+ *               Percentiles are bucket edges, so good to a factor
+ *               of 2, plenty to compare against the period.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void CallbackStats::Publish(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    uint64_t exec[kBuckets];
+    uint64_t jitter[kBuckets];
+    char     item[48];
+    string   hist;
+
+    for (uint32_t i=0; i<kBuckets; i++)
+    {
+        exec[i]   = fExec[i].load(std::memory_order_relaxed);
+        jitter[i] = fJitter[i].load(std::memory_order_relaxed);
+        if (exec[i] > 0)
+        {
+            snprintf(item, sizeof(item), " <%.3gus:%lu",
+                     (double) (1ULL << i) / 1000.0, (unsigned long) exec[i]);
+            hist += item;
+        }
+    }
+    // Maxima are since the last publish.
+    uint64_t emax = fExecMax.exchange(0, std::memory_order_relaxed);
+    uint64_t jmax = fJitterMax.exchange(0, std::memory_order_relaxed);
+
+    pLogger->Log("# Callback %s: n %lu, budget %lu us, exec p50 %lu p99 %lu p99.9 %lu max %lu us, misses %lu, jitter p99 %lu max %lu us, xruns in %lu/%lu out %lu/%lu (under/over)\n",
+                 fName, (unsigned long) Count(),
+                 (unsigned long) (fPeriod/1000),
+                 (unsigned long) (Percentile(exec, 0.5)/1000),
+                 (unsigned long) (Percentile(exec, 0.99)/1000),
+                 (unsigned long) (Percentile(exec, 0.999)/1000),
+                 (unsigned long) (emax/1000),
+                 (unsigned long) Misses(),
+                 (unsigned long) (Percentile(jitter, 0.99)/1000),
+                 (unsigned long) (jmax/1000),
+                 (unsigned long) fInputUnderflow.load(std::memory_order_relaxed),
+                 (unsigned long) fInputOverflow.load(std::memory_order_relaxed),
+                 (unsigned long) fOutputUnderflow.load(std::memory_order_relaxed),
+                 (unsigned long) fOutputOverflow.load(std::memory_order_relaxed));
+    pLogger->Log("# Callback %s exec histogram:%s\n", fName, hist.c_str());
+    SET_DEBUG_STACK;
+}
@@ -0,0 +1,140 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : CallbackStats.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Timing of the PortAudio callbacks. The callback
+ *               takes a time stamp on the way in and the way out and
+ *               drops the execution time and the start to start
+ *               jitter into log2 histograms, along with counts of the
+ *               stream status flags. Everything is a relaxed atomic
+ *               written by the callback only, so there are no locks or
+ *               fences in the real time path. Another thread calls
+ *               Publish to put a summary in the log.
+ *
+ * Restrictions/Limitations :
+ *   One callback thread per instance. Readers see counts that may
+ *   be a callback apart from each other, which is fine for stats.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __CALLBACKSTATS_hh_
+#define __CALLBACKSTATS_hh_
+#  include <atomic>
+#  include <cstdint>
+#  include <ctime>
+#  include "portaudio.h"
+
+class CallbackStats
+{
+public:
+    /*! Bucket k counts values in [2^(k-1), 2^k) ns, bucket 0 is 0. */
+    enum {kBuckets = 40};
+
+    /*!
+     * Name    - used in the log
+     * Period  - seconds per callback, FramesPerBuffer/SampleRate
+     */
+    CallbackStats(const char *Name, double Period);
+
+    /*! Monotonic ns, cheap enough for the callback (vDSO). */
+    static inline uint64_t Now(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    };
+
+    /*!
+     * Callback: account for one invocation that started at Start
+     * (from Now) and is about to return.
+     */
+    inline void Record(uint64_t Start, PaStreamCallbackFlags Flags)
+    {
+        uint64_t end  = Now();
+        uint64_t exec = end - Start;
+        uint64_t last = fLastStart.load(std::memory_order_relaxed);
+
+        Bump(fExec[Bucket(exec)]);
+        Max(fExecMax, exec);
+        if (exec > fPeriod) Bump(fMisses);
+        if (last > 0)
+        {
+            uint64_t dt  = Start - last;
+            uint64_t jit = (dt > fPeriod) ? dt - fPeriod : fPeriod - dt;
+            Bump(fJitter[Bucket(jit)]);
+            Max(fJitterMax, jit);
+        }
+        fLastStart.store(Start, std::memory_order_relaxed);
+        if (Flags & paInputUnderflow)  Bump(fInputUnderflow);
+        if (Flags & paInputOverflow)   Bump(fInputOverflow);
+        if (Flags & paOutputUnderflow) Bump(fOutputUnderflow);
+        if (Flags & paOutputOverflow)  Bump(fOutputOverflow);
+        Bump(fCount);
+    };
+
+    /*!
+     * New stream, forget the last start so the gap between streams
+     * is not counted as jitter. Only while no callback is running.
+     */
+    inline void Restart(void) {fLastStart.store(0, std::memory_order_relaxed);};
+
+    /*!
+     * Reader: log counts, percentiles and the non empty histogram
+     * buckets through CLogger. The maxima restart after each call.
+     */
+    void Publish(void);
+
+    inline uint64_t Count(void)  const {return fCount.load(std::memory_order_relaxed);};
+    inline uint64_t Misses(void) const {return fMisses.load(std::memory_order_relaxed);};
+    inline uint64_t Xruns(void)  const
+    {
+        return fInputUnderflow.load(std::memory_order_relaxed) +
+            fInputOverflow.load(std::memory_order_relaxed) +
+            fOutputUnderflow.load(std::memory_order_relaxed) +
+            fOutputOverflow.load(std::memory_order_relaxed);
+    };
+
+private:
+    /* Single writer, so no read-modify-write is needed. */
+    static inline void Bump(std::atomic<uint64_t> &v)
+    {
+        v.store(v.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    };
+    static inline void Max(std::atomic<uint64_t> &v, uint64_t x)
+    {
+        if (x > v.load(std::memory_order_relaxed))
+            v.store(x, std::memory_order_relaxed);
+    };
+    static inline uint32_t Bucket(uint64_t ns)
+    {
+        uint32_t b = (ns == 0) ? 0 : 64 - __builtin_clzll(ns);
+        return (b < kBuckets) ? b : kBuckets - 1;
+    };
+    /*! ns below which fraction q of the histogram lies. */
+    static uint64_t Percentile(const uint64_t *h, double q);
+
+    const char            *fName;
+    uint64_t               fPeriod;         /*! Deadline, ns */
+    std::atomic<uint64_t>  fLastStart;
+    std::atomic<uint64_t>  fCount;
+    std::atomic<uint64_t>  fMisses;         /*! Ran longer than Period */
+    std::atomic<uint64_t>  fExecMax;
+    std::atomic<uint64_t>  fJitterMax;
+    std::atomic<uint64_t>  fInputUnderflow;
+    std::atomic<uint64_t>  fInputOverflow;
+    std::atomic<uint64_t>  fOutputUnderflow;
+    std::atomic<uint64_t>  fOutputOverflow;
+    std::atomic<uint64_t>  fExec[kBuckets];
+    std::atomic<uint64_t>  fJitter[kBuckets];
+};
+#endif
@@ -0,0 +1,1088 @@
+/********************************************************************
+ *
+ * Module Name : DataWriter.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Asynchronous N buffered data log writer.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Gapless rotation through a preallocated spare file.
+ * 17-Oct-26 CBL AccCodec compression on the writer thread. The
+ *               header is written by Open so buffers only ever hold
+ *               samples.
+ * 17-Oct-26 CBL Give back the preallocation past the data when a
+ *               file is closed, coded files are a fraction of it.
+ * 17-Oct-26 CBL Raw files: the buffer after a header is short by the
+ *               header, so every later write starts on kAlignment.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Local Includes.
+#include "DataWriter.hh"
+#include "AccCodec.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : DataWriter constructor
+ *
+ * Description : Allocate the aligned buffers and start the writer
+ *               thread.
+ *
+ * Inputs : NBuffers    - number of buffers, at least 2
+ *          BufferBytes - size of each buffer
+ *
+ * Returns : none
+ *
+ * Error Conditions : ENO_MEM if the buffers can not be allocated
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+DataWriter::DataWriter(uint32_t NBuffers, size_t BufferBytes) : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("DataWriter");
+    SetError(); // No error.
+
+    fFD           = -1;
+    fSpareFD      = -1;
+    fPreallocate  = 0;
+    fFill         = NULL;
+    fFillLimit    = 0;
+    fFileOffset   = 0;
+    fBusy         = false;
+    fQuit         = false;
+    fThread       = NULL;
+    fMaxDepth     = 0;
+    fStallTime    = 0.0;
+    fStalls       = 0;
+    fBytesWritten = 0;
+    fWriteErrors  = 0;
+    fRotateErrors = 0;
+    fRotations    = 0;
+    fSampleBytes  = 0;
+    fCodedBytes   = 0;
+    fCodec        = NULL;
+    fPendingUsed  = 0;
+    fFileFrames   = 0;
+
+    if (NBuffers < 2) NBuffers = 2;
+    fBufferBytes = ((BufferBytes + kAlignment - 1)/kAlignment) * kAlignment;
+    if (fBufferBytes == 0) fBufferBytes = kAlignment;
+
+    fBuffers.resize(NBuffers);
+    for (uint32_t i=0; i<NBuffers; i++)
+    {
+        fBuffers[i].used = 0;
+        if (posix_memalign((void **)&fBuffers[i].data, kAlignment,
+                           fBufferBytes))
+        {
+            fBuffers[i].data = NULL;
+            SetError(ENO_MEM, __LINE__);
+            SET_DEBUG_STACK;
+            return;
+        }
+        fFree.push_back(&fBuffers[i]);
+    }
+    fFill = fFree.front();
+    fFree.pop_front();
+    fFillLimit = fBufferBytes;
+
+    fThread = new std::thread(&DataWriter::WriterThread, this);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : DataWriter destructor
+ *
+ * Description : Flush, close, stop the thread and free the buffers.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+DataWriter::~DataWriter(void)
+{
+    SET_DEBUG_STACK;
+    if (fThread)
+    {
+        Close();
+        DiscardSpare();
+        {
+            std::lock_guard<std::mutex> lock(fLock);
+            fQuit = true;
+        }
+        fWorkReady.notify_one();
+        fThread->join();
+        delete fThread;
+    }
+    for (size_t i=0; i<fBuffers.size(); i++)
+    {
+        free(fBuffers[i].data);
+    }
+    delete fCodec;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetSpare
+ *
+ * Description : Name of the spare file and how much space to
+ *               reserve in each new data file.
+ *
+ * Inputs : SpareName   - spare file, same directory as the data
+ *          Preallocate - bytes to fallocate, 0 for none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::SetSpare(const char *SpareName, uint64_t Preallocate)
+{
+    SET_DEBUG_STACK;
+    Drain();
+    fSpareName   = SpareName ? SpareName : "";
+    fPreallocate = Preallocate;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetCodec
+ *
+ * Description : Switch AccCodec compression on or off for the
+ *               files opened from now on.
+ *
+ * Inputs : NChan       - channels per frame, 0 for raw samples
+ *          BlockFrames - frames per coded block
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::SetCodec(uint32_t NChan, uint32_t BlockFrames)
+{
+    SET_DEBUG_STACK;
+    Drain();
+    delete fCodec;
+    fCodec = NULL;
+    fPending.clear();
+    fCoded.clear();
+    if (NChan > 0)
+    {
+        fCodec = new AccCodec(NChan, BlockFrames);
+        fPending.resize((size_t) fCodec->BlockFrames() * NChan * sizeof(int16_t));
+        fCoded.resize(fCodec->MaxBytes());
+    }
+    fPendingUsed = 0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Close anything that is open, start a new file
+ *               and write its header. The writer thread is idle
+ *               with nothing open, so the header goes straight out
+ *               and the buffers only ever carry samples. The spare
+ *               for the next rotation is prepared in the background.
+ *
+ * Inputs : Name        - file to create
+ *          Header      - header bytes
+ *          HeaderBytes - length of header
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_FILE
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool DataWriter::Open(const char *Name, const void *Header, size_t HeaderBytes)
+{
+    SET_DEBUG_STACK;
+    ClearError(__LINE__);
+    Close();
+
+    int fd = open( Name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    if (fPreallocate > 0)
+    {
+        // Best effort, not every file system supports it.
+        (void) fallocate( fd, FALLOC_FL_KEEP_SIZE, 0, fPreallocate);
+    }
+    if (!WriteAll(fd, (const char *) Header, HeaderBytes))
+    {
+        close(fd);
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    fBytesWritten += HeaderBytes;
+    fPendingUsed   = 0;
+    fFileFrames    = 0;
+    fFileOffset    = HeaderBytes;
+    SetFillLimit();
+    fFD = fd;
+    fLastHeader.assign((const char *) Header, HeaderBytes);
+    Queue(kPrepare);
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Rotate
+ *
+ * Description : Queue a swap to a new file. Data already
+ *               written goes to the old file, anything written after
+ *               this call goes to the new one. The producer never
+ *               waits on open/fallocate, the spare is already there.
+ *
+ * Inputs : Name        - final name of the new file
+ *          Header      - header with the exact first sample
+ *          HeaderBytes - length of header, same for every file
+ *
+ * Returns : true if queued
+ *
+ * Error Conditions : ENO_FILE if nothing is open
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool DataWriter::Rotate(const char *Name, const void *Header, size_t HeaderBytes)
+{
+    SET_DEBUG_STACK;
+    if (fFD.load() < 0)
+    {
+        SetError(ENO_FILE, __LINE__);
+        return false;
+    }
+    Flush();
+    Queue(kRotate, Name, Header, HeaderBytes);
+    // The spare has its header at 0, samples carry on after it.
+    fFileOffset = HeaderBytes;
+    SetFillLimit();
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Restamp
+ *
+ * Description : Queue a rewrite of the current file header,
+ *               used once the real start time is known.
+ *
+ * Inputs : Header      - new header, same length as the old
+ *          HeaderBytes - length of header
+ *
+ * Returns : true if queued
+ *
+ * Error Conditions : ENO_FILE if nothing is open
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool DataWriter::Restamp(const void *Header, size_t HeaderBytes)
+{
+    SET_DEBUG_STACK;
+    if (fFD.load() < 0)
+    {
+        SetError(ENO_FILE, __LINE__);
+        return false;
+    }
+    Queue(kHeader, NULL, Header, HeaderBytes);
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Push out the partial buffer and any partial coded
+ *               block, wait for the writer to finish everything and
+ *               close the file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Close(void)
+{
+    SET_DEBUG_STACK;
+    if (fFD.load() < 0) return;
+    Flush();
+    if (fCodec) Queue(kFinish);
+    Drain();
+    std::lock_guard<std::mutex> lock(fLock);
+    Release(fFD);
+    close(fFD);
+    fFD = -1;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Write
+ *
+ * Description : Copy data into the fill buffer, handing off full
+ *               buffers to the writer thread as we go. Only blocks
+ *               if every buffer is queued.
+ *
+ * Inputs : data - bytes to write
+ *          n    - number of bytes
+ *
+ * Returns : true if everything was queued
+ *
+ * Error Conditions : ENO_FILE if no file is open
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool DataWriter::Write(const void *data, size_t n)
+{
+    SET_DEBUG_STACK;
+    const char *p = (const char *) data;
+    size_t      m;
+
+    if ((fFD.load() < 0) || (fFill == NULL))
+    {
+        SetError(ENO_FILE, __LINE__);
+        return false;
+    }
+    while (n > 0)
+    {
+        m = fFillLimit - fFill->used;
+        if (m > n) m = n;
+        memcpy( fFill->data + fFill->used, p, m);
+        fFill->used += m;
+        p += m;
+        n -= m;
+        if (fFill->used == fFillLimit)
+        {
+            if (!Submit()) return false;
+        }
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Flush
+ *
+ * Description : Queue the fill buffer even if it is not full.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Flush(void)
+{
+    SET_DEBUG_STACK;
+    if (fFill && (fFill->used > 0))
+    {
+        Submit();
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : QueueDepth
+ *
+ * Description : Number of jobs waiting on the writer.
+ *
+ * Inputs : none
+ *
+ * Returns : queue depth
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t DataWriter::QueueDepth(void)
+{
+    std::lock_guard<std::mutex> lock(fLock);
+    return fQueue.size() + (fBusy ? 1 : 0);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Submit
+ *
+ * Description : Queue fFill and take the next free buffer, waiting
+ *               for the writer if there are none. Time spent waiting
+ *               is accumulated as stall time.
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool DataWriter::Submit(void)
+{
+    SET_DEBUG_STACK;
+    std::unique_lock<std::mutex> lock(fLock);
+    uint32_t depth;
+
+    Job job;
+    job.op  = kWrite;
+    job.buf = fFill;
+    fQueue.push_back(job);
+    fFileOffset += fFill->used;
+    fFill = NULL;
+    depth = fQueue.size() + (fBusy ? 1 : 0);
+    if (depth > fMaxDepth) fMaxDepth = depth;
+    fWorkReady.notify_one();
+
+    if (fFree.empty())
+    {
+        std::chrono::steady_clock::time_point t0 =
+            std::chrono::steady_clock::now();
+        fFreeReady.wait(lock, [this]{return !fFree.empty();});
+        std::chrono::duration<double> dt =
+            std::chrono::steady_clock::now() - t0;
+        fStallTime += dt.count();
+        fStalls++;
+    }
+    fFill = fFree.front();
+    fFree.pop_front();
+    fFill->used = 0;
+    SetFillLimit();
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetFillLimit
+ *
+ * Description : How much of fFill to use. Raw samples go to the
+ *               file as they are, so a buffer that starts off a
+ *               kAlignment boundary, after a header or a partial
+ *               flush, stops at the next one. Coded blocks have
+ *               sizes of their own, whole buffers for them.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::SetFillLimit(void)
+{
+    fFillLimit = fBufferBytes;
+    if (fCodec == NULL)
+    {
+        fFillLimit -= fFileOffset % kAlignment;
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Queue
+ *
+ * Description : Put a rotate or prepare job on the writer
+ *               queue behind any data already there.
+ *
+ * Inputs : op          - kRotate, kPrepare, kHeader or kFinish
+ *          Name        - new file name for kRotate
+ *          Header      - header for kRotate/kHeader
+ *          HeaderBytes - length of header
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Queue(int op, const char *Name, const void *Header,
+                       size_t HeaderBytes)
+{
+    SET_DEBUG_STACK;
+    Job job;
+    job.op  = op;
+    job.buf = NULL;
+    if (Name)   job.name = Name;
+    if (Header) job.header.assign((const char *) Header, HeaderBytes);
+    {
+        std::lock_guard<std::mutex> lock(fLock);
+        fQueue.push_back(job);
+    }
+    fWorkReady.notify_one();
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Drain
+ *
+ * Description : Block until the writer thread has emptied the queue.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Drain(void)
+{
+    SET_DEBUG_STACK;
+    std::unique_lock<std::mutex> lock(fLock);
+    fFreeReady.wait(lock, [this]{return fQueue.empty() && !fBusy;});
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WriterThread
+ *
+ * Description : Pull jobs off the queue in order, writing buffers
+ *               and swapping files. The lock is not held during
+ *               I/O so the producer can keep filling.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : write errors are counted in fWriteErrors
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::WriterThread(void)
+{
+    SET_DEBUG_STACK;
+    Job     job;
+    std::unique_lock<std::mutex> lock(fLock);
+
+    while (true)
+    {
+        fWorkReady.wait(lock, [this]{return fQuit || !fQueue.empty();});
+        if (fQueue.empty() && fQuit) break;
+
+        job = fQueue.front();
+        fQueue.pop_front();
+        fBusy = true;
+        lock.unlock();
+
+        switch (job.op)
+        {
+        case kWrite:
+            if (fCodec)
+            {
+                Encode(job.buf->data, job.buf->used);
+            }
+            else if ((fFD.load() >= 0) &&
+                WriteAll(fFD.load(), job.buf->data, job.buf->used))
+            {
+                fBytesWritten += job.buf->used;
+            }
+            else
+            {
+                fWriteErrors++;
+            }
+            job.buf->used = 0;
+            break;
+        case kRotate:
+            // The short last block belongs to the old file.
+            if (fCodec) Finish();
+            SwapFiles(job.name, job.header);
+            fFileFrames = 0;
+            PrepareSpare();
+            break;
+        case kFinish:
+            Finish();
+            break;
+        case kPrepare:
+            PrepareSpare();
+            break;
+        case kHeader:
+            if ((job.header.size() != fLastHeader.size()) ||
+                (pwrite( fFD.load(), job.header.data(), job.header.size(), 0)
+                 != (ssize_t) job.header.size()))
+            {
+                fWriteErrors++;
+            }
+            break;
+        }
+
+        lock.lock();
+        fBusy = false;
+        if (job.buf)
+        {
+            fFree.push_back(job.buf);
+        }
+        fFreeReady.notify_all();
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WriteAll
+ *
+ * Description : write(2) until everything is out.
+ *
+ * Inputs : fd - file descriptor
+ *          p  - data
+ *          n - bytes
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : any write(2) failure other than EINTR
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool DataWriter::WriteAll(int fd, const char *p, size_t n)
+{
+    ssize_t rc;
+    while (n > 0)
+    {
+        rc = write( fd, p, n);
+        if (rc < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += rc;
+        n -= rc;
+    }
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : PrepareSpare
+ *
+ * Description : Writer thread. Create the spare file,
+ *               reserve a full file worth of space and put a
+ *               placeholder header in so that a rotation only has to
+ *               rename it and rewrite the header in place.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : spare is left closed on failure, SwapFiles falls back
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::PrepareSpare(void)
+{
+    SET_DEBUG_STACK;
+    if ((fSpareFD >= 0) || fSpareName.empty()) return;
+
+    fSpareFD = open( fSpareName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fSpareFD < 0) return;
+
+    if (fPreallocate > 0)
+    {
+        /*
+         * KEEP_SIZE so the blocks are reserved without changing the
+         * file length. Whatever is left past the data is given back
+         * by Release when the file is done with.
+         */
+        (void) fallocate( fSpareFD, FALLOC_FL_KEEP_SIZE, 0, fPreallocate);
+    }
+    if (!WriteAll( fSpareFD, fLastHeader.data(), fLastHeader.size()))
+    {
+        DiscardSpare();
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SwapFiles
+ *
+ * Description : Writer thread. Close the current file, rename
+ *               the spare to its final name, patch the header with
+ *               the real first sample and carry on writing to it.
+ *               If there is no spare the file is opened here, which
+ *               costs time but still loses nothing.
+ *
+ * Inputs : Name   - final file name
+ *          Header - header for the new file
+ *
+ * Returns : none
+ *
+ * Error Conditions : counted in fRotateErrors
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::SwapFiles(const std::string &Name, const std::string &Header)
+{
+    SET_DEBUG_STACK;
+    int fd = -1;
+
+    if (fSpareFD >= 0)
+    {
+        if ((rename( fSpareName.c_str(), Name.c_str()) == 0) &&
+            (Header.size() == fLastHeader.size()) &&
+            (pwrite( fSpareFD, Header.data(), Header.size(), 0) ==
+             (ssize_t) Header.size()))
+        {
+            fd = fSpareFD;
+        }
+        else
+        {
+            close(fSpareFD);
+        }
+        fSpareFD = -1;
+    }
+    if (fd < 0)
+    {
+        // Slow path, no spare available.
+        fRotateErrors++;
+        fd = open( Name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if ((fd >= 0) && !WriteAll( fd, Header.data(), Header.size()))
+        {
+            fWriteErrors++;
+        }
+    }
+    if (fFD.load() >= 0)
+    {
+        Release(fFD);
+        close(fFD);
+    }
+    fFD = fd;
+    fLastHeader = Header;
+    fRotations++;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Release
+ *
+ * Description : Free the blocks reserved past the end of the data.
+ *               KEEP_SIZE blocks stay allocated after close, so
+ *               without this a short or compressed file would hold
+ *               on to the whole preallocation.
+ *
+ * Inputs : fd - file about to be closed
+ *
+ * Returns : none
+ *
+ * Error Conditions : none, best effort as the preallocation
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Release(int fd)
+{
+    SET_DEBUG_STACK;
+    struct stat st;
+
+    if ((fPreallocate == 0) || (fstat( fd, &st) != 0) ||
+        ((uint64_t) st.st_size >= fPreallocate))
+    {
+        return;
+    }
+    // Same length, but the blocks past EOF go. A hole punched past
+    // EOF is ignored by ext4, so truncate it is.
+    (void) ftruncate( fd, st.st_size);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : DiscardSpare
+ *
+ * Description : Close the spare and remove it from disk.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::DiscardSpare(void)
+{
+    SET_DEBUG_STACK;
+    if (fSpareFD >= 0)
+    {
+        close(fSpareFD);
+        unlink(fSpareName.c_str());
+        fSpareFD = -1;
+    }
+    SET_DEBUG_STACK;
+}
+
+/**
+ ******************************************************************
+ *
+ * Function Name : Encode
+ *
+ * Description : Writer thread. Copy samples into the block being
+ *               filled and code each one as it fills. A buffer need
+ *               not end on a block or even a frame.
+ *
+ * Inputs : p - samples
+ *          n - bytes
+ *
+ * Returns : none
+ *
+ * Error Conditions : write failures are counted in fWriteErrors
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Encode(const char *p, size_t n)
+{
+    SET_DEBUG_STACK;
+    const size_t block = fPending.size();
+    size_t       m;
+
+    while (n > 0)
+    {
+        m = block - fPendingUsed;
+        if (m > n) m = n;
+        memcpy( fPending.data() + fPendingUsed, p, m);
+        fPendingUsed += m;
+        p += m;
+        n -= m;
+        if (fPendingUsed == block)
+        {
+            EncodeBlock(fCodec->BlockFrames());
+        }
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : EncodeBlock
+ *
+ * Description : Writer thread. Code Frames whole frames from the
+ *               front of fPending, write the block and keep any bytes
+ *               after them for the next block.
+ *
+ * Inputs : Frames - frames to code, at most BlockFrames
+ *
+ * Returns : none
+ *
+ * Error Conditions : write failures are counted in fWriteErrors
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::EncodeBlock(uint32_t Frames)
+{
+    SET_DEBUG_STACK;
+    const size_t bytes = (size_t) Frames * fCodec->NChannels() * sizeof(int16_t);
+    size_t       n;
+
+    if (Frames == 0) return;
+    n = fCodec->Encode((const int16_t *) fPending.data(), Frames, fFileFrames,
+                       fCoded.data());
+    if ((fFD.load() >= 0) && WriteAll(fFD.load(), (const char *) fCoded.data(), n))
+    {
+        fBytesWritten += n;
+    }
+    else
+    {
+        fWriteErrors++;
+    }
+    fFileFrames  += Frames;
+    fSampleBytes += bytes;
+    fCodedBytes  += n;
+    fPendingUsed -= bytes;
+    memmove( fPending.data(), fPending.data() + bytes, fPendingUsed);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Finish
+ *
+ * Description : Writer thread. Code the whole frames still pending
+ *               as a short block, at a rotation or close.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void DataWriter::Finish(void)
+{
+    SET_DEBUG_STACK;
+    if (fCodec)
+    {
+        EncodeBlock(fPendingUsed / (fCodec->NChannels() * sizeof(int16_t)));
+    }
+    SET_DEBUG_STACK;
+}
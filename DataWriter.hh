@@ -0,0 +1,226 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : DataWriter.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Asynchronous, N buffered writer for the .acc data
+ *               log. The caller copies samples into a fill buffer,
+ *               full buffers are queued to a writer thread that owns
+ *               the file descriptor. Disk latency only ever stalls
+ *               the writer thread, never the acquisition path, until
+ *               every buffer is in flight.
+ *
+ * Restrictions/Limitations :
+ *   One producer thread. Open/Rotate/Write/Flush/Close must all be
+ *   called from that thread.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Gapless rotation. The writer thread keeps a spare
+ *               file open, preallocated and with a header in place,
+ *               and swaps to it on a buffer boundary.
+ * 17-Oct-26 CBL Optional lossless AccCodec blocks, encoded on the
+ *               writer thread so compression never costs the
+ *               producer anything.
+ * 17-Oct-26 CBL Raw writes after the header start on kAlignment.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __DATAWRITER_hh_
+#define __DATAWRITER_hh_
+#  include <cstdint>
+#  include <atomic>
+#  include <thread>
+#  include <mutex>
+#  include <condition_variable>
+#  include <deque>
+#  include <vector>
+#  include <string>
+#  include "CObject.hh"
+
+class AccCodec;
+
+class DataWriter : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_FILE=1, ENO_MEM, EWRITE, EROTATE};
+
+    /*!
+     * NBuffers of BufferBytes each. BufferBytes is rounded up to
+     * a multiple of kAlignment.
+     */
+    DataWriter(uint32_t NBuffers=4, size_t BufferBytes=1048576);
+    /*! Flush, close and stop the writer thread. */
+    ~DataWriter(void);
+
+    /*!
+     * Where to keep the spare file and how much to preallocate
+     * for each new file. Must be on the same file system as the
+     * data files so the swap is a rename.
+     */
+    void SetSpare(const char *SpareName, uint64_t Preallocate);
+
+    /*!
+     * Compress the samples after the header into AccCodec blocks of
+     * BlockFrames frames of NChan channels, 0 channels for raw. Every
+     * file starts a new block sequence and ends with a short block.
+     * Set before Open.
+     */
+    void SetCodec(uint32_t NChan, uint32_t BlockFrames);
+    inline bool Compressed(void) const {return (fCodec != NULL);};
+
+    /*!
+     * Open a new output file synchronously and queue the header,
+     * any previous file is flushed and closed first.
+     */
+    bool Open(const char *Name, const void *Header, size_t HeaderBytes);
+    /*!
+     * Everything written so far goes to the current file, everything
+     * after goes to Name, which gets Header at offset 0. Does not
+     * wait on the disk, the writer thread does the swap.
+     */
+    bool Rotate(const char *Name, const void *Header, size_t HeaderBytes);
+    /*!
+     * Rewrite the header of the current file in place, behind
+     * anything already queued.
+     */
+    bool Restamp(const void *Header, size_t HeaderBytes);
+    /*! Flush everything queued and close the file. */
+    void Close(void);
+    /*! Is there a file to write to? */
+    inline bool IsOpen(void) const {return (fFD.load() >= 0);};
+
+    /*!
+     * Copy n bytes into the fill buffer. Returns false if the data
+     * could not be queued.
+     */
+    bool Write(const void *data, size_t n);
+    /*! Queue the partially filled buffer. */
+    void Flush(void);
+
+    /*! Number of jobs waiting on the writer thread. */
+    uint32_t QueueDepth(void);
+    /*! Deepest the queue has been. */
+    inline uint32_t MaxQueueDepth(void) const {return fMaxDepth;};
+    /*! Time the producer spent waiting for a free buffer. */
+    inline double   StallTime(void) const {return fStallTime;};
+    /*! Number of times the producer had to wait. */
+    inline uint64_t Stalls(void) const {return fStalls;};
+    /*! Bytes that have reached the file. */
+    inline uint64_t BytesWritten(void) const {return fBytesWritten.load();};
+    /*! Failed write(2) calls on the writer thread. */
+    inline uint64_t WriteErrors(void) const {return fWriteErrors.load();};
+    /*! Rotations that could not use the spare file. */
+    inline uint64_t RotateErrors(void) const {return fRotateErrors.load();};
+    /*! Completed file swaps */
+    inline uint64_t Rotations(void) const {return fRotations.load();};
+    /*! Bytes per buffer */
+    inline size_t   BufferBytes(void) const {return fBufferBytes;};
+    /*! Sample bytes the codec has taken and the blocks it made of them. */
+    inline uint64_t SampleBytes(void) const {return fSampleBytes.load();};
+    inline uint64_t CodedBytes(void)  const {return fCodedBytes.load();};
+
+    /*! Chunk alignment, matches the page size. */
+    static const size_t kAlignment = 4096;
+
+private:
+    /*!
+     * A chunk of output.
+     */
+    struct Buffer
+    {
+        char   *data;
+        size_t  used;
+    };
+
+    /*!
+     * Work for the writer thread, either a buffer to write or a
+     * file swap. Queued in order so a swap lands exactly between
+     * the buffers either side of it.
+     */
+    enum {kWrite, kRotate, kPrepare, kHeader, kFinish};
+    struct Job
+    {
+        int          op;
+        Buffer      *buf;
+        std::string  name;
+        std::string  header;
+    };
+
+    /*! Hand fFill to the writer thread and get a free buffer. */
+    bool  Submit(void);
+    /*! Size fFill so raw writes end on a kAlignment boundary. */
+    void  SetFillLimit(void);
+    /*! Queue a job that is not a data buffer. */
+    void  Queue(int op, const char *Name=NULL, const void *Header=NULL,
+                size_t HeaderBytes=0);
+    /*! Wait until the writer has nothing queued. */
+    void  Drain(void);
+    /*! Writer thread. */
+    void  WriterThread(void);
+    /*! write(2) with retries on short writes. */
+    bool  WriteAll(int fd, const char *p, size_t n);
+    /*! Writer thread: create, preallocate and header the spare. */
+    void  PrepareSpare(void);
+    /*! Writer thread: close the current file and make the spare current. */
+    void  SwapFiles(const std::string &Name, const std::string &Header);
+    /*! Give back the preallocation past the end of fd. */
+    void  Release(int fd);
+    /*! Close and remove the spare. */
+    void  DiscardSpare(void);
+    /*! Writer thread: add samples to the block being filled. */
+    void  Encode(const char *p, size_t n);
+    /*! Writer thread: code and write Frames from the front of fPending. */
+    void  EncodeBlock(uint32_t Frames);
+    /*! Writer thread: short block with whatever is pending. */
+    void  Finish(void);
+
+    std::atomic<int>    fFD;           /*! Output file */
+    size_t              fBufferBytes;
+    std::vector<Buffer> fBuffers;      /*! All of them, for cleanup */
+    Buffer             *fFill;         /*! Producer owns this */
+    size_t              fFillLimit;    /*! Bytes of fFill to use */
+    uint64_t            fFileOffset;   /*! Where fFill starts in the file */
+    std::deque<Buffer*> fFree;         /*! Available to the producer */
+    std::deque<Job>     fQueue;        /*! Waiting on the writer */
+    bool                fBusy;         /*! Writer has a job in hand */
+    bool                fQuit;
+
+    /* Spare file, only touched by the writer thread once running. */
+    std::string         fSpareName;
+    int                 fSpareFD;
+    uint64_t            fPreallocate;  /*! Bytes to reserve per file */
+    std::string         fLastHeader;   /*! Placeholder for the spare */
+
+    /* Codec, only touched by the writer thread once a file is open. */
+    AccCodec           *fCodec;
+    std::vector<char>   fPending;      /*! Samples for the next block */
+    size_t              fPendingUsed;
+    std::vector<uint8_t> fCoded;       /*! One coded block */
+    uint64_t            fFileFrames;   /*! Frames coded into this file */
+
+    std::mutex              fLock;
+    std::condition_variable fWorkReady; /*! fFull not empty or quit */
+    std::condition_variable fFreeReady; /*! fFree not empty or idle */
+    std::thread            *fThread;
+
+    /* Statistics. */
+    uint32_t              fMaxDepth;
+    double                fStallTime;
+    uint64_t              fStalls;
+    std::atomic<uint64_t> fBytesWritten;
+    std::atomic<uint64_t> fWriteErrors;
+    std::atomic<uint64_t> fRotateErrors;
+    std::atomic<uint64_t> fRotations;
+    std::atomic<uint64_t> fSampleBytes;
+    std::atomic<uint64_t> fCodedBytes;
+};
+#endif
@@ -0,0 +1,484 @@
+/********************************************************************
+ *
+ * Module Name : Decimator.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Cascaded polyphase FIR decimation of int16 blocks.
+ *
+ * Restrictions/Limitations :
+ *   SSE is part of x86-64 so the dot product needs no target
+ *   attribute or CPU check, other machines get the scalar loop.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+// Local Includes.
+#include "Decimator.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : Decimator constructor
+ *
+ * Description : No stages, which passes everything through.
+ *
+ * Inputs : NChan      - channels per frame
+ *          SampleRate - input rate, Hz
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+Decimator::Decimator(uint32_t NChan, double SampleRate)
+{
+    SET_DEBUG_STACK;
+    fNChannels  = (NChan > 0) ? NChan : 1;
+    fSampleRate = SampleRate;
+    fFactor     = 1;
+    fPrimed     = false;
+    fClipped    = 0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Decimator destructor
+ *
+ * Description : Nothing to do, the vectors look after themselves.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+Decimator::~Decimator(void)
+{
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Kaiser
+ *
+ * Description : Windowed sinc low pass, scaled to unit DC gain.
+ *
+ * Inputs : N      - taps
+ *          Cutoff - cycles per sample
+ *          Beta   - Kaiser window shape
+ *          h      - taps, replaced
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void Decimator::Kaiser(uint32_t N, double Cutoff, double Beta,
+                       vector<float> &h)
+{
+    SET_DEBUG_STACK;
+    // Zeroth order modified Bessel function by its series.
+    auto I0 = [](double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k=1; k<50; k++)
+        {
+            term *= (0.5 * x / k) * (0.5 * x / k);
+            sum  += term;
+            if (term < 1.0e-12 * sum) break;
+        }
+        return sum;
+    };
+    vector<double> w(N);
+    double mid = 0.5 * (double) (N - 1);
+    double sum = 0.0, t, r;
+
+    for (uint32_t k=0; k<N; k++)
+    {
+        t    = (double) k - mid;
+        r    = t / mid;
+        w[k] = 2.0 * Cutoff * I0(Beta * sqrt(fmax(0.0, 1.0 - r*r))) / I0(Beta);
+        if (t != 0.0) w[k] *= sin(2.0 * M_PI * Cutoff * t) / (2.0 * M_PI * Cutoff * t);
+        sum += w[k];
+    }
+    h.resize(N);
+    for (uint32_t k=0; k<N; k++) h[k] = (float) (w[k] / sum);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Design
+ *
+ * Description : One stage per factor. The transition band of each
+ *               sets its length by Kaiser's estimate, rounded up to
+ *               a multiple of 8 for the dot product.
+ *
+ * Inputs : Factors     - decimation of each stage, in order
+ *          Passband    - flat to this fraction of the output rate
+ *          Attenuation - stopband, dB
+ *
+ * Returns : false if a factor is below 2 or Passband is not between
+ *           0 and 0.5
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool Decimator::Design(const vector<uint32_t> &Factors, double Passband,
+                       double Attenuation)
+{
+    SET_DEBUG_STACK;
+    double   rate = fSampleRate;
+    double   out, fp, stop, beta, df;
+    uint32_t total = 1, in = kChunk, n;
+    Stage    s;
+
+    fStages.clear();
+    fFactor = 1;
+    fPrimed = false;
+    for (uint32_t f : Factors)
+    {
+        if (f < 2) return false;
+        total *= f;
+    }
+    if ((Passband <= 0.0) || (Passband >= 0.5)) return false;
+    if (Attenuation < 21.0) Attenuation = 21.0;
+    if (Attenuation > 50.0)
+    {
+        beta = 0.1102 * (Attenuation - 8.7);
+    }
+    else
+    {
+        beta = 0.5842 * pow(Attenuation - 21.0, 0.4) +
+               0.07886 * (Attenuation - 21.0);
+    }
+    fp = Passband * fSampleRate / (double) total;
+
+    for (size_t i=0; i<Factors.size(); i++)
+    {
+        out  = rate / (double) Factors[i];
+        // The last stage keeps the whole output band clean.
+        stop = (i + 1 == Factors.size()) ? 0.5 * out : out - fp;
+        df   = (stop - fp) / rate;
+        n    = (uint32_t) ceil((Attenuation - 7.95) / (14.36 * df)) + 1;
+        n    = (n + 7) & ~7u;
+
+        s.factor = Factors[i];
+        s.taps   = n;
+        s.phase  = 0;
+        Kaiser(n, 0.5 * (fp + stop) / rate, beta, s.h);
+        s.stride = (n - 1) + in + 1;
+        s.buf.assign(fNChannels * s.stride, 0.0f);
+        fStages.push_back(s);
+
+        in   = in / Factors[i] + 1;
+        rate = out;
+    }
+    fFactor = total;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Delay
+ *
+ * Description : Half the length of each stage at its input rate.
+ *
+ * Inputs : none
+ *
+ * Returns : seconds
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double Decimator::Delay(void) const
+{
+    double rate = fSampleRate, d = 0.0;
+    for (const Stage &s : fStages)
+    {
+        d    += 0.5 * (double) (s.taps - 1) / rate;
+        rate /= (double) s.factor;
+    }
+    return d;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Cost
+ *
+ * Description : Each stage's taps once per output it keeps.
+ *
+ * Inputs : none
+ *
+ * Returns : multiplies per input frame and channel
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double Decimator::Cost(void) const
+{
+    double f = 1.0, c = 0.0;
+    for (const Stage &s : fStages)
+    {
+        f *= (double) s.factor;
+        c += (double) s.taps / f;
+    }
+    return c;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Reset
+ *
+ * Description : Start again as though nothing had been seen.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void Decimator::Reset(void)
+{
+    SET_DEBUG_STACK;
+    for (Stage &s : fStages) s.phase = 0;
+    fPrimed = false;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Prime
+ *
+ * Description : Every stage has unit DC gain, so a history of the
+ *               first frame throughout is the steady state for it.
+ *
+ * Inputs : frame - first frame of the stream
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void Decimator::Prime(const int16_t *frame)
+{
+    SET_DEBUG_STACK;
+    for (Stage &s : fStages)
+    {
+        for (uint32_t c=0; c<fNChannels; c++)
+        {
+            float *b = &s.buf[c * s.stride];
+            for (uint32_t k=0; k+1<s.taps; k++) b[k] = (float) frame[c];
+        }
+    }
+    fPrimed = true;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Dot
+ *
+ * Description : Two SSE accumulators, so consecutive adds do not
+ *               wait on each other.
+ *
+ * Inputs : h - taps
+ *          x - window, oldest first
+ *          n - length, a multiple of 8
+ *
+ * Returns : sum h[k] x[k]
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+float Decimator::Dot(const float *h, const float *x, uint32_t n)
+{
+#if defined(__SSE2__)
+    __m128 a0 = _mm_setzero_ps();
+    __m128 a1 = _mm_setzero_ps();
+    float  t[4];
+
+    for (uint32_t k=0; k<n; k+=8)
+    {
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_loadu_ps(&h[k]),   _mm_loadu_ps(&x[k])));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_loadu_ps(&h[k+4]), _mm_loadu_ps(&x[k+4])));
+    }
+    _mm_storeu_ps(t, _mm_add_ps(a0, a1));
+    return (t[0] + t[1]) + (t[2] + t[3]);
+#else
+    float a[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (uint32_t k=0; k<n; k+=4)
+    {
+        a[0] += h[k]   * x[k];
+        a[1] += h[k+1] * x[k+1];
+        a[2] += h[k+2] * x[k+2];
+        a[3] += h[k+3] * x[k+3];
+    }
+    return (a[0] + a[1]) + (a[2] + a[3]);
+#endif
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Process
+ *
+ * Description : Each chunk is split into channels behind the first
+ *               stage's history. A stage takes the taps over the
+ *               window ending at each input it keeps, one in factor,
+ *               straight into the next stage's input or, at the end,
+ *               rounded into out. Then the tail of the input becomes
+ *               the history. A chunk is read before any of its output
+ *               is written, and output never runs ahead of input, so
+ *               out may be in.
+ *
+ * Inputs : in      - interleaved frames
+ *          nFrames - frames in
+ *          out     - interleaved frames, nFrames / Factor + 1 room
+ *
+ * Returns : frames written to out
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t Decimator::Process(const int16_t *in, uint32_t nFrames, int16_t *out)
+{
+    SET_DEBUG_STACK;
+    const uint32_t nc = fNChannels;
+    const uint32_t ns = fStages.size();
+    uint32_t done = 0, m, n, q = 0, cnt, c, j;
+    float    y;
+
+    if (ns == 0)
+    {
+        if (out != in) memmove(out, in, nFrames * nc * sizeof(int16_t));
+        return nFrames;
+    }
+    if ((nFrames > 0) && !fPrimed) Prime(in);
+
+    for (uint32_t i=0; i<nFrames; i+=m)
+    {
+        m = nFrames - i;
+        if (m > kChunk) m = kChunk;
+
+        Stage &first = fStages[0];
+        for (c=0; c<nc; c++)
+        {
+            float *b = &first.buf[c * first.stride + first.taps - 1];
+            for (j=0; j<m; j++) b[j] = (float) in[(i + j)*nc + c];
+        }
+        n = m;
+        for (uint32_t k=0; k<ns; k++)
+        {
+            Stage &s    = fStages[k];
+            Stage *next = (k + 1 < ns) ? &fStages[k+1] : NULL;
+            cnt = 0;
+            for (c=0; c<nc; c++)
+            {
+                float *b = &s.buf[c * s.stride];
+                for (q=s.phase, cnt=0; q<n; q+=s.factor, cnt++)
+                {
+                    y = Dot(s.h.data(), &b[q], s.taps);
+                    if (next)
+                    {
+                        next->buf[c * next->stride + next->taps - 1 + cnt] = y;
+                    }
+                    else
+                    {
+                        if ((y > 32767.0f) || (y < -32768.0f))
+                        {
+                            fClipped++;
+                            y = (y > 0.0f) ? 32767.0f : -32768.0f;
+                        }
+                        out[(done + cnt)*nc + c] = (int16_t) lrintf(y);
+                    }
+                }
+                memmove(b, &b[n], (s.taps - 1) * sizeof(float));
+            }
+            s.phase = q - n;
+            n = cnt;
+        }
+        done += n;
+    }
+    SET_DEBUG_STACK;
+    return done;
+}
@@ -0,0 +1,123 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : Decimator.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Integer rate reduction of interleaved int16 blocks by
+ *               a cascade of FIR low pass and keep one in M stages.
+ *               Each stage only works out the outputs it keeps, the
+ *               polyphase form, so it costs Taps/M multiplies per
+ *               input sample. Channel state carries from block to
+ *               block and output frame j is input frame j x Factor.
+ *
+ *               Taps are a Kaiser windowed sinc. With the final
+ *               output at rate R and the passband edge fp = Passband
+ *               x R, the last stage stops from R/2, so nothing aliases
+ *               anywhere in the output band. An earlier stage at
+ *               output rate r only has to keep out what would land
+ *               below fp, so it stops from r - fp and is short. That
+ *               is where a cascade such as 2, 2, 2 beats a single 8.
+ *
+ *               Stages run in float, one channel's taps over a
+ *               contiguous window as an SSE dot product. Only the
+ *               final output is rounded and saturated to int16, and
+ *               clips are counted. The history is primed with the
+ *               first frame, so the accelerometer offset does not
+ *               step in.
+ *
+ * Restrictions/Limitations :
+ *   One thread. Stages are fixed by Design. The delay through the
+ *   linear phase taps, Delay(), is not taken out.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   J.F. Kaiser, "Nonrecursive digital filter design using the
+ *   I0-sinh window function", Proc. IEEE ISCAS, 1974.
+ *   R.E. Crochiere and L.R. Rabiner, "Multirate Digital Signal
+ *   Processing", 1983.
+ *
+ *******************************************************************
+ */
+#ifndef __DECIMATOR_hh_
+#define __DECIMATOR_hh_
+#  include <cstdint>
+#  include <vector>
+
+class Decimator
+{
+public:
+    /*!
+     * NChan      - interleaved channels
+     * SampleRate - input rate, Hz
+     */
+    Decimator(uint32_t NChan, double SampleRate);
+    ~Decimator(void);
+
+    /*!
+     * Replace the stages with one per factor, applied in order.
+     * Passband is the edge kept flat as a fraction of the output
+     * rate, below 0.5. Attenuation is the stopband in dB. Returns
+     * false, leaving no stages, if a factor is below 2 or the
+     * passband does not make sense.
+     */
+    bool Design(const std::vector<uint32_t> &Factors, double Passband=0.4,
+                double Attenuation=90.0);
+
+    /*!
+     * Decimate nFrames interleaved frames from in into out, which
+     * may be in. Returns the frames written, all of them with no
+     * stages.
+     */
+    uint32_t Process(const int16_t *in, uint32_t nFrames, int16_t *out);
+    /*! Forget the history, the next block primes it again. */
+    void Reset(void);
+
+    inline uint32_t Stages(void)    const {return fStages.size();};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    /*! Product of the stage factors. */
+    inline uint32_t Factor(void)    const {return fFactor;};
+    inline uint32_t StageFactor(uint32_t s) const {return fStages[s].factor;};
+    inline uint32_t Taps(uint32_t s) const {return fStages[s].taps;};
+    inline double   OutputRate(void) const {return fSampleRate/(double) fFactor;};
+    /*! Group delay, seconds. */
+    double   Delay(void) const;
+    /*! Multiplies per input frame and channel. */
+    double   Cost(void) const;
+    /*! Output samples saturated to int16 since construction. */
+    inline uint64_t Clipped(void)   const {return fClipped;};
+
+private:
+    /*! Input frames taken at a time. */
+    static const uint32_t kChunk = 1024;
+
+    typedef struct
+    {
+        uint32_t factor;
+        uint32_t taps;            /*! Multiple of 8 */
+        uint32_t phase;           /*! Next output, into the new input */
+        std::vector<float> h;     /*! Symmetric, DC gain 1 */
+        std::vector<float> buf;   /*! Channel x (taps-1 history + input) */
+        uint32_t stride;          /*! Floats per channel in buf */
+    } Stage;
+
+    /*! Kaiser windowed sinc, cutoff in cycles per sample. */
+    static void Kaiser(uint32_t N, double Cutoff, double Beta,
+                       std::vector<float> &h);
+    /*! Dot product of n floats, n a multiple of 8. */
+    static float Dot(const float *h, const float *x, uint32_t n);
+    /*! Fill every stage's history with the first frame. */
+    void Prime(const int16_t *frame);
+
+    uint32_t fNChannels;
+    double   fSampleRate;
+    uint32_t fFactor;
+    bool     fPrimed;
+    uint64_t fClipped;
+    std::vector<Stage> fStages;
+};
+#endif
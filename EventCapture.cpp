@@ -0,0 +1,504 @@
+/********************************************************************
+ *
+ * Module Name : EventCapture.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : STA/LTA triggered event files.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL An event cut at MaxSeconds with the detector still on
+ *               carries on in a new file, Part counts them.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// Local Includes.
+#include "EventCapture.hh"
+#include "StaLta.hh"
+#include "DataWriter.hh"
+#include "CLogger.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : EventCapture constructor
+ *
+ * Description : Size the history, make the directory and set up a
+ *               detector with the default settings.
+ *
+ * Inputs : NChan, SampleRate - stream shape
+ *          Pre, Post, Max    - seconds
+ *          Directory         - for the event files
+ *
+ * Returns : none
+ *
+ * Error Conditions : ENO_DIRECTORY if Directory can not be made
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+EventCapture::EventCapture(uint32_t NChan, double SampleRate, double Pre,
+                           double Post, double Max, const char *Directory)
+    : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("EventCapture");
+    SetError(); // No error.
+
+    fNChannels   = (NChan > 0) ? NChan : 1;
+    fSampleRate  = SampleRate;
+    fPreFrames   = (Pre  > 0.0) ? (uint32_t) (Pre  * SampleRate) : 0;
+    fPostFrames  = (Post > 0.0) ? (uint64_t) (Post * SampleRate) : 0;
+    fMaxFrames   = (Max  > 0.0) ? (uint64_t) (Max  * SampleRate) : UINT64_MAX;
+    if (fMaxFrames == 0) fMaxFrames = 1;
+    fDirectory   = (Directory && *Directory) ? Directory : ".";
+    fDetector    = NULL;
+    fWriter      = new DataWriter();
+    fHistorySize = (fPreFrames > 0) ? fPreFrames : 1;
+    fHistory     = new int16_t[fHistorySize * fNChannels];
+    fHistoryHead = 0;
+    fHistoryFill = 0;
+    fRecording   = false;
+    fStartTime   = 0.0;
+    fFirst       = 0;
+    fTrigger     = 0;
+    fChannel     = 0;
+    fWritten     = 0;
+    fLastActive  = 0;
+    fPart        = 0;
+    fEvents      = 0;
+    fEventFrames = 0;
+    SetTrigger(0.5, 30.0, 4.0, 1.5);
+
+    if ((mkdir(fDirectory.c_str(), 0755) != 0) && (errno != EEXIST))
+    {
+        CLogger::GetThis()->LogError(__FILE__, __LINE__, 'W',
+                                     "Can not make the event directory.");
+        SetError(ENO_DIRECTORY, __LINE__);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : EventCapture destructor
+ *
+ * Description : Close any open event.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+EventCapture::~EventCapture(void)
+{
+    SET_DEBUG_STACK;
+    Finish();
+    delete fWriter;
+    delete fDetector;
+    delete[] fHistory;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetTrigger
+ *
+ * Description : New detector with these settings.
+ *
+ * Inputs : Sta, Lta - window lengths, seconds
+ *          On, Off  - trigger and reset ratios
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::SetTrigger(double Sta, double Lta, double On, double Off)
+{
+    SET_DEBUG_STACK;
+    fSta = Sta;
+    fLta = Lta;
+    fOn  = On;
+    fOff = Off;
+    delete fDetector;
+    fDetector = new StaLta(fNChannels, fSampleRate, Sta, Lta, On, Off);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Remember
+ *
+ * Description : Copy a block into the history ring, only the tail
+ *               if it is longer than the ring.
+ *
+ * Inputs : frames  - interleaved samples
+ *          nFrames - frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::Remember(const int16_t *frames, uint32_t nFrames)
+{
+    if (nFrames > fHistorySize)
+    {
+        frames  += (nFrames - fHistorySize) * fNChannels;
+        nFrames  = fHistorySize;
+    }
+    uint32_t n = fHistorySize - fHistoryHead;
+    if (n > nFrames) n = nFrames;
+    memcpy(&fHistory[fHistoryHead * fNChannels], frames,
+           n * fNChannels * sizeof(int16_t));
+    memcpy(fHistory, &frames[n * fNChannels],
+           (nFrames - n) * fNChannels * sizeof(int16_t));
+    fHistoryHead = (fHistoryHead + nFrames) % fHistorySize;
+    fHistoryFill = (fHistoryFill + nFrames > fHistorySize) ? fHistorySize :
+        fHistoryFill + nFrames;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WriteHistory
+ *
+ * Description : Queue the last n frames of history, oldest first,
+ *               in at most two pieces.
+ *
+ * Inputs : n - frames, no more than fHistoryFill
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::WriteHistory(uint32_t n)
+{
+    uint32_t from = (fHistoryHead + fHistorySize - n) % fHistorySize;
+    uint32_t m    = fHistorySize - from;
+    if (m > n) m = n;
+    fWriter->Write(&fHistory[from * fNChannels], m * fNChannels * sizeof(int16_t));
+    fWriter->Write(fHistory, (n - m) * fNChannels * sizeof(int16_t));
+    fWritten += n;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Add
+ *
+ * Description : Detect, write and remember one block. A trigger
+ *               while idle starts an event at the trigger frame less
+ *               the pre-trigger time, as much of it as the history
+ *               and this block have. While recording, the event ends
+ *               once the detector has been quiet for PostSeconds. One
+ *               that reaches MaxSeconds with the detector still on is
+ *               continued in a new file from the next frame, so a long
+ *               disturbance is kept whole, in parts.
+ *
+ * Inputs : frames    - interleaved samples
+ *          nFrames   - frames
+ *          First     - stream frame of frames[0]
+ *          StartTime - UTC of stream frame 0
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::Add(const int16_t *frames, uint32_t nFrames, uint64_t First,
+                       double StartTime)
+{
+    SET_DEBUG_STACK;
+    int64_t  onset = fDetector->Process(frames, nFrames);
+    uint32_t done  = nFrames;   // Block frames already in a file
+
+    fStartTime = StartTime;
+    if (fRecording)
+    {
+        uint64_t n = nFrames;
+        if (n > fMaxFrames - fWritten) n = fMaxFrames - fWritten;
+        fWriter->Write(frames, n * fNChannels * sizeof(int16_t));
+        fWritten += n;
+        done      = n;
+    }
+    else if (onset >= 0)
+    {
+        fPart = 0;
+        done  = Start(frames, nFrames, (uint32_t) onset, First);
+    }
+
+    if (fRecording && fDetector->Active()) fLastActive = First + nFrames;
+    while (fRecording)
+    {
+        if (First + nFrames - fLastActive >= fPostFrames)
+        {
+            End();
+        }
+        else if (fWritten >= fMaxFrames)
+        {
+            End();
+            if (!fDetector->Active()) break;
+            // Still on, the rest of the block starts the next part.
+            fPart++;
+            done = Start(frames, nFrames, done, First);
+        }
+        else
+        {
+            break;
+        }
+    }
+    Remember(frames, nFrames);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Start
+ *
+ * Description : Open the event file, header first, then the
+ *               pre-trigger frames and the rest of this block, up to
+ *               MaxSeconds. A continuation, fPart above 0, has no
+ *               pre-trigger frames and keeps the original trigger.
+ *
+ * Inputs : frames  - this block
+ *          nFrames - frames in it
+ *          Onset   - trigger frame within it, or where to continue
+ *          First   - stream frame of frames[0]
+ *
+ * Returns : frames of the block now written, from its start
+ *
+ * Error Conditions : ENO_FILE, logged, the event is dropped
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t EventCapture::Start(const int16_t *frames, uint32_t nFrames,
+                             uint32_t Onset, uint64_t First)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    uint32_t pre       = (fPart == 0) ? fPreFrames : 0;
+    uint32_t fromBlock = (Onset < pre) ? Onset : pre;
+    uint32_t fromHist  = pre - fromBlock;
+    uint64_t left;
+    char     header[kHeaderSize];
+    char     stamp[32];
+    char     name[64];
+    double   t = fStartTime + (double) (First + Onset) / fSampleRate;
+    time_t   sec = (time_t) t;
+    struct tm tm;
+
+    if (fromHist > fHistoryFill) fromHist = fHistoryFill;
+    if (fPart == 0)
+    {
+        fTrigger    = First + Onset;
+        fChannel    = fDetector->Channel();
+        fLastActive = fTrigger;
+    }
+    fFirst      = First + Onset - fromBlock - fromHist;
+    fWritten    = 0;
+    fDetector->ResetPeak();
+
+    gmtime_r(&sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &tm);
+    snprintf(name, sizeof(name), "/event_%s_%03d.acc", stamp,
+             (int) ((t - (double) sec) * 1000.0));
+    fName = fDirectory + name;
+
+    FormatHeader(header);
+    if (!fWriter->Open(fName.c_str(), header, kHeaderSize))
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'W', "Can not open event file.");
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return nFrames;
+    }
+    fRecording = true;
+    WriteHistory(fromHist);
+    // Pre-trigger part of the block and everything after, as far
+    // as MaxSeconds allows.
+    nFrames -= Onset - fromBlock;
+    left     = (fWritten < fMaxFrames) ? fMaxFrames - fWritten : 0;
+    if (nFrames > left) nFrames = left;
+    fWriter->Write(&frames[(Onset - fromBlock) * fNChannels],
+                   nFrames * fNChannels * sizeof(int16_t));
+    fWritten += nFrames;
+    if (fPart == 0)
+    {
+        pLogger->Log("# Event %s: trigger at sample %lu channel %u\n",
+                     fName.c_str(), (unsigned long) fTrigger, fChannel);
+    }
+    else
+    {
+        pLogger->Log("# Event %s: part %u of the trigger at sample %lu\n",
+                     fName.c_str(), fPart, (unsigned long) fTrigger);
+    }
+    SET_DEBUG_STACK;
+    return Onset - fromBlock + nFrames;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : End
+ *
+ * Description : Rewrite the header now the length and peak ratio
+ *               are known, and close the file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::End(void)
+{
+    SET_DEBUG_STACK;
+    char header[kHeaderSize];
+
+    FormatHeader(header);
+    fWriter->Restamp(header, kHeaderSize);
+    fWriter->Close();
+    fRecording = false;
+    fEvents++;
+    fEventFrames += fWritten;
+    CLogger::GetThis()->Log("# Event %s: %.2f s, peak ratio %.2f\n",
+                            fName.c_str(), (double) fWritten / fSampleRate,
+                            fDetector->Peak());
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Finish
+ *
+ * Description : End the current event, if any.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::Finish(void)
+{
+    if (fRecording) End();
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FormatHeader
+ *
+ * Description : .acc style header for the event file. FirstSample
+ *               and FirstTime place it in the stream as for the
+ *               continuous files.
+ *
+ * Inputs : header - kHeaderSize bytes to fill
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void EventCapture::FormatHeader(char *header)
+{
+    char   created[32];
+    time_t now;
+
+    time(&now);
+    strftime(created, sizeof(created), "%F %T", gmtime(&now));
+    memset(header, 0, kHeaderSize);
+    snprintf(header, kHeaderSize,
+             "Created: %s\n"
+             "SampleRate: %g\n"
+             "NChannels: %u\n"
+             "FirstSample: %lu\n"
+             "FirstTime: %.6f\n"
+             "TriggerSample: %lu\n"
+             "TriggerChannel: %u\n"
+             "PeakRatio: %.2f\n"
+             "Frames: %lu\n"
+             "Part: %u\n"
+             "StaLta: %g %g %g %g\n",
+             created, fSampleRate, fNChannels, (unsigned long) fFirst,
+             fStartTime + (double) fFirst / fSampleRate,
+             (unsigned long) fTrigger, fChannel, fDetector->Peak(),
+             (unsigned long) fWritten, fPart, fSta, fLta, fOn, fOff);
+}
@@ -0,0 +1,122 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : EventCapture.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Triggered recording. Every block goes through a
+ *               StaLta detector and into a history ring holding the
+ *               last PreSeconds of frames. On a trigger a new event
+ *               file is started with that history, then frames are
+ *               written until the detector has been quiet for
+ *               PostSeconds, or the event reaches MaxSeconds. Past
+ *               MaxSeconds with the detector still on the event goes
+ *               on in a new file, the header's Part counts from 0.
+ *
+ *               An event file is an ordinary .acc file, the 256 byte
+ *               header then interleaved int16 frames, so AccFile, the
+ *               replay source and -f read it. The header also carries
+ *               where the trigger was, which channel, the largest
+ *               ratio and the detector settings. Writes go through a
+ *               DataWriter so the disk never stalls the caller.
+ *
+ * Restrictions/Limitations :
+ *   One thread, the processing thread.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Continuation parts past MaxSeconds.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __EVENTCAPTURE_hh_
+#define __EVENTCAPTURE_hh_
+#  include <cstdint>
+#  include <string>
+#  include "CObject.hh"
+
+class StaLta;
+class DataWriter;
+
+class EventCapture : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_DIRECTORY=1, ENO_FILE};
+
+    /*!
+     * NChan, SampleRate - stream shape
+     * Pre, Post, Max    - seconds before the trigger, after the
+     *                     detector goes quiet, longest event
+     * Directory         - where event files go, made if need be
+     */
+    EventCapture(uint32_t NChan, double SampleRate, double Pre, double Post,
+                 double Max, const char *Directory);
+    ~EventCapture(void);
+
+    /*! Detector settings, see StaLta. Call before the first block. */
+    void SetTrigger(double Sta, double Lta, double On, double Off);
+
+    /*!
+     * Next block of the stream.
+     * First     - stream frame number of frames[0]
+     * StartTime - UTC of stream frame 0
+     */
+    void Add(const int16_t *frames, uint32_t nFrames, uint64_t First,
+             double StartTime);
+    /*! Finish any event in progress. */
+    void Finish(void);
+
+    inline bool     Recording(void) const {return fRecording;};
+    inline uint32_t Events(void)    const {return fEvents;};
+    inline uint64_t EventFrames(void) const {return fEventFrames;};
+
+    /*! Size of the ASCII header, MainModule::kHeaderSize. */
+    static const uint32_t kHeaderSize = 256;
+
+private:
+    /*! Keep the last fHistorySize frames. */
+    void Remember(const int16_t *frames, uint32_t nFrames);
+    /*! Write the last n remembered frames. */
+    void WriteHistory(uint32_t n);
+    /*! Open an event or its next part, returns block frames written. */
+    uint32_t Start(const int16_t *frames, uint32_t nFrames, uint32_t Onset,
+                   uint64_t First);
+    void End(void);
+    void FormatHeader(char *header);
+
+    uint32_t     fNChannels;
+    double       fSampleRate;
+    uint32_t     fPreFrames;
+    uint64_t     fPostFrames;
+    uint64_t     fMaxFrames;
+    std::string  fDirectory;
+    double       fSta, fLta, fOn, fOff;
+
+    StaLta      *fDetector;
+    DataWriter  *fWriter;
+
+    int16_t     *fHistory;       /*! fHistorySize frames, circular */
+    uint32_t     fHistorySize;
+    uint32_t     fHistoryHead;   /*! Next frame to overwrite */
+    uint32_t     fHistoryFill;
+
+    bool         fRecording;
+    std::string  fName;          /*! Current event file */
+    double       fStartTime;     /*! UTC of stream frame 0 */
+    uint64_t     fFirst;         /*! Stream frame of the file's first frame */
+    uint64_t     fTrigger;       /*! Stream frame of the trigger */
+    uint32_t     fChannel;
+    uint64_t     fWritten;       /*! Frames in the current file */
+    uint64_t     fLastActive;    /*! Stream frame detector was last on */
+    uint32_t     fPart;          /*! 0, or continuation number */
+    uint32_t     fEvents;
+    uint64_t     fEventFrames;
+};
+#endif
@@ -0,0 +1,392 @@
+/********************************************************************
+ *
+ * Module Name : H5Writer.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Chunked, compressed HDF5 sample log.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include "H5Cpp.h"
+using namespace H5;
+
+// Local Includes.
+#include "H5Writer.hh"
+#include "debug.h"
+
+const char *H5Writer::kDataset = "Samples";
+
+/**
+ ******************************************************************
+ *
+ * Function Name : H5Writer constructor
+ *
+ * Description : Allocate the chunk buffer. No file yet.
+ *
+ * Inputs : NChan       - channels per frame
+ *          ChunkFrames - frames per chunk
+ *          Deflate     - gzip level, 0 for none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+H5Writer::H5Writer(uint32_t NChan, uint32_t ChunkFrames, int Deflate)
+    : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("H5Writer");
+    SetError(); // No error.
+
+    fNChannels   = (NChan > 0) ? NChan : 1;
+    fChunkFrames = (ChunkFrames > 0) ? ChunkFrames : 16000;
+    fDeflate     = (Deflate < 0) ? 0 : ((Deflate > 9) ? 9 : Deflate);
+    fChunk       = new int16_t[fChunkFrames * fNChannels];
+    fFill        = 0;
+    fFrames      = 0;
+    fFile        = NULL;
+    fData        = NULL;
+
+    // We report our own errors, HDF5 would print a stack trace.
+    Exception::dontPrint();
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : H5Writer destructor
+ *
+ * Description : Close out the file and free the chunk buffer.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+H5Writer::~H5Writer(void)
+{
+    SET_DEBUG_STACK;
+    Close();
+    delete[] fChunk;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Create the file and an empty, unlimited
+ *               /Samples dataset chunked ChunkFrames x NChannels
+ *               with shuffle then deflate.
+ *
+ * Inputs : Name - file to create, truncated if it exists
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_FILE
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool H5Writer::Open(const char *Name)
+{
+    SET_DEBUG_STACK;
+    hsize_t dims[2]    = {0, fNChannels};
+    hsize_t maxdims[2] = {H5S_UNLIMITED, fNChannels};
+    hsize_t chunk[2]   = {fChunkFrames, fNChannels};
+
+    Close();
+    try
+    {
+        DataSpace         space(2, dims, maxdims);
+        DSetCreatPropList plist;
+        plist.setChunk(2, chunk);
+        // Shuffle puts the high bytes together, deflate does the rest.
+        plist.setShuffle();
+        if (fDeflate > 0) plist.setDeflate(fDeflate);
+
+        fFile = new H5File(Name, H5F_ACC_TRUNC);
+        fData = new DataSet(fFile->createDataSet(kDataset,
+                                                 PredType::NATIVE_INT16,
+                                                 space, plist));
+    }
+    catch (const Exception &e)
+    {
+        delete fData;
+        delete fFile;
+        fData = NULL;
+        fFile = NULL;
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    fFill   = 0;
+    fFrames = 0;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Write the partial chunk and close the file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void H5Writer::Close(void)
+{
+    SET_DEBUG_STACK;
+    if (fFile == NULL) return;
+    if (fFill > 0) WriteChunk();
+    try
+    {
+        fData->close();
+        fFile->close();
+    }
+    catch (const Exception &e)
+    {
+        SetError(EWRITE, __LINE__);
+    }
+    delete fData;
+    delete fFile;
+    fData = NULL;
+    fFile = NULL;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Append
+ *
+ * Description : Copy frames into the chunk buffer, writing each
+ *               chunk as it fills.
+ *
+ * Inputs : samples - interleaved frames
+ *          nFrames - number of frames
+ *
+ * Returns : false if a chunk could not be written
+ *
+ * Error Conditions : EWRITE
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool H5Writer::Append(const int16_t *samples, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    bool     rc = true;
+    uint32_t n;
+
+    if (fFile == NULL) return false;
+    while (nFrames > 0)
+    {
+        n = fChunkFrames - fFill;
+        if (n > nFrames) n = nFrames;
+        memcpy(&fChunk[fFill*fNChannels], samples,
+               n * fNChannels * sizeof(int16_t));
+        fFill   += n;
+        samples += n * fNChannels;
+        nFrames -= n;
+        if ((fFill == fChunkFrames) && !WriteChunk()) rc = false;
+    }
+    SET_DEBUG_STACK;
+    return rc;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WriteChunk
+ *
+ * Description : Grow /Samples by fFill frames and write them at
+ *               the end. Chunk aligned except for the last one.
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : EWRITE, the frames are dropped
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool H5Writer::WriteChunk(void)
+{
+    SET_DEBUG_STACK;
+    hsize_t size[2]   = {fFrames + fFill, fNChannels};
+    hsize_t offset[2] = {fFrames, 0};
+    hsize_t count[2]  = {fFill, fNChannels};
+    bool    rc        = true;
+
+    try
+    {
+        fData->extend(size);
+        DataSpace file = fData->getSpace();
+        file.selectHyperslab(H5S_SELECT_SET, count, offset);
+        DataSpace mem(2, count);
+        fData->write(fChunk, PredType::NATIVE_INT16, mem, file);
+        fFrames += fFill;
+        // Keep what is on disk readable if we die.
+        fFile->flush(H5F_SCOPE_LOCAL);
+    }
+    catch (const Exception &e)
+    {
+        SetError(EWRITE, __LINE__);
+        rc = false;
+    }
+    fFill = 0;
+    SET_DEBUG_STACK;
+    return rc;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetAttribute
+ *
+ * Description : String attribute on /Samples, replacing any
+ *               attribute already there with the same name.
+ *
+ * Inputs : Name  - attribute name
+ *          Value - value
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : EATTRIBUTE
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool H5Writer::SetAttribute(const char *Name, const std::string &Value)
+{
+    SET_DEBUG_STACK;
+    if (fData == NULL) return false;
+    try
+    {
+        StrType   type(PredType::C_S1, Value.size() > 0 ? Value.size() : 1);
+        DataSpace scalar(H5S_SCALAR);
+        if (fData->attrExists(Name)) fData->removeAttr(Name);
+        Attribute attr = fData->createAttribute(Name, type, scalar);
+        attr.write(type, Value);
+    }
+    catch (const Exception &e)
+    {
+        SetError(EATTRIBUTE, __LINE__);
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetAttribute
+ *
+ * Description : Numeric attributes, same rules as above.
+ *
+ * Inputs : Name  - attribute name
+ *          Value - value
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : EATTRIBUTE
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+template <class T> static bool WriteScalar(DataSet *data, const char *Name,
+                                           const PredType &type, T Value)
+{
+    try
+    {
+        DataSpace scalar(H5S_SCALAR);
+        if (data->attrExists(Name)) data->removeAttr(Name);
+        Attribute attr = data->createAttribute(Name, type, scalar);
+        attr.write(type, &Value);
+    }
+    catch (const Exception &e)
+    {
+        return false;
+    }
+    return true;
+}
+bool H5Writer::SetAttribute(const char *Name, int32_t Value)
+{
+    if (fData == NULL) return false;
+    if (WriteScalar(fData, Name, PredType::NATIVE_INT32, Value)) return true;
+    SetError(EATTRIBUTE, __LINE__);
+    return false;
+}
+bool H5Writer::SetAttribute(const char *Name, uint64_t Value)
+{
+    if (fData == NULL) return false;
+    if (WriteScalar(fData, Name, PredType::NATIVE_UINT64, Value)) return true;
+    SetError(EATTRIBUTE, __LINE__);
+    return false;
+}
+bool H5Writer::SetAttribute(const char *Name, double Value)
+{
+    if (fData == NULL) return false;
+    if (WriteScalar(fData, Name, PredType::NATIVE_DOUBLE, Value)) return true;
+    SetError(EATTRIBUTE, __LINE__);
+    return false;
+}
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : H5Writer.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : HDF5 recording backend. Samples go into a single
+ *               chunked, extendible int16 dataset /Samples of
+ *               frames x channels with the shuffle and deflate
+ *               filters. The .acc header fields are kept as typed
+ *               attributes on the dataset. Frames are gathered into
+ *               whole chunks so every chunk is compressed once.
+ *
+ * Restrictions/Limitations :
+ *   The serial HDF5 library is not thread safe, all calls for one
+ *   file must come from one thread. Up to a chunk of frames is held
+ *   in memory until the chunk fills or the file is closed.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   https://support.hdfgroup.org/HDF5/doc/cpplus_RM/
+ *
+ *******************************************************************
+ */
+#ifndef __H5WRITER_hh_
+#define __H5WRITER_hh_
+#  include <cstdint>
+#  include <string>
+#  include "CObject.hh"
+
+namespace H5 { class H5File; class DataSet; }
+
+class H5Writer : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_FILE=1, EWRITE, EATTRIBUTE};
+
+    /*!
+     * NChan       - channels per frame
+     * ChunkFrames - frames per HDF5 chunk
+     * Deflate     - gzip level 0-9, 0 is shuffle only
+     */
+    H5Writer(uint32_t NChan, uint32_t ChunkFrames=16000, int Deflate=4);
+    /*! Flush and close */
+    ~H5Writer(void);
+
+    /*! Create Name, closing any file already open. */
+    bool Open(const char *Name);
+    /*! Write out the partial chunk and close. */
+    void Close(void);
+    inline bool IsOpen(void) const {return (fFile != NULL);};
+
+    /*! Append nFrames interleaved frames. */
+    bool Append(const int16_t *samples, uint32_t nFrames);
+
+    /*!
+     * Typed attributes on /Samples, created or overwritten.
+     */
+    bool SetAttribute(const char *Name, const std::string &Value);
+    bool SetAttribute(const char *Name, int32_t  Value);
+    bool SetAttribute(const char *Name, uint64_t Value);
+    bool SetAttribute(const char *Name, double   Value);
+
+    /*! Frames written to the current file, including the partial chunk. */
+    inline uint64_t Frames(void)      const {return fFrames + fFill;};
+    inline uint32_t ChunkFrames(void) const {return fChunkFrames;};
+    inline uint32_t NChannels(void)   const {return fNChannels;};
+
+    /*! Name of the sample dataset. */
+    static const char *kDataset;
+
+private:
+    /*! Extend the dataset and write fFill frames from fChunk. */
+    bool WriteChunk(void);
+
+    uint32_t      fNChannels;
+    uint32_t      fChunkFrames;
+    int           fDeflate;
+    int16_t      *fChunk;       /*! ChunkFrames x NChannels */
+    uint32_t      fFill;        /*! Frames in fChunk */
+    uint64_t      fFrames;      /*! Frames in the dataset */
+    H5::H5File   *fFile;
+    H5::DataSet  *fData;
+};
+#endif
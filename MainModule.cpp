@@ -10,6 +10,33 @@
  * Restrictions/Limitations : none
  *
  * Change Descriptions : 
+ * 17-Oct-26 CBL Continuous mode, the callback feeds a lock free ring
+ *               that is drained by a processing thread.
+ *               The data log is now a DataWriter with its own thread.
+ *               Rotation is queued between blocks, the header records
+ *               the first sample and its time.
+ *               Streaming Welch PSD on the processing thread.
+ *               FFT plans use wisdom kept next to the config file.
+ *               Optional chunked, compressed HDF5 copy of the data.
+ *               Spectral products to memmap readable files.
+ *               Per callback ADC time, frame and status side stream.
+ *               Callback execution time and jitter histograms.
+ *               Capture through an AudioSource, PortAudio or replay.
+ *               Batch analysis of .acc files, -f.
+ *               Streaming amplitude statistics, per interval and per
+ *               file, in place of the Stats pass.
+ *               STA/LTA triggered event files, RawLog false keeps
+ *               only those.
+ *               Rolling STFT spectrogram to a tiled .stft file.
+ *               Goertzel trackers for the reference and hum tones.
+ *               Biquad high, low or band pass ahead of the analysis,
+ *               the logs stay raw.
+ *               Octave band Leq series to a .oct file.
+ *               Decimation between the capture and everything else,
+ *               fCaptureRate is the device, fSampleRate the data.
+ *               The amplitude statistics stay at the capture rate.
+ *               .acc samples optionally compressed, losslessly.
+ *               -w runs offline and plans the whole record itself.
  *
  * Classification : Unclassified
  *
@@ -51,14 +78,33 @@ using namespace std;
 #include <unistd.h>
 #include <errno.h>
 #include <cstdlib>
+#include <strings.h>
 #include <libconfig.h++>
 #include <ostream>
 #include <sstream>
+#include <chrono>
 using namespace libconfig;
 
 /// Local Includes.
 #include "MainModule.hh"
 #include "Analysis.hh"
+#include "PortAudioSource.hh"
+#include "ReplaySource.hh"
+#include "BatchAnalysis.hh"
+#include "DataWriter.hh"
+#include "H5Writer.hh"
+#include "SpectrumFile.hh"
+#include "Welch.hh"
+#include "Spectrogram.hh"
+#include "SpectrogramFile.hh"
+#include "ToneBank.hh"
+#include "BiquadFilter.hh"
+#include "OctaveBank.hh"
+#include "Decimator.hh"
+#include "AccCodec.hh"
+#include "Wisdom.hh"
+#include "StreamStats.hh"
+#include "EventCapture.hh"
 #include "CLogger.hh"
 #include "tools.h"
 #include "debug.h"
@@ -66,6 +112,27 @@ using namespace libconfig;
 
 MainModule* MainModule::fMainModule;
 
+/* UTC now in seconds, with the resolution of the real time clock. */
+static double WallTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double) ts.tv_sec + 1.0e-9 * (double) ts.tv_nsec;
+}
+
+/* Name with its extension replaced, data.acc -> data.h5 */
+static string Extension(const char *name, const char *ext)
+{
+    string rc(name);
+    size_t dot   = rc.rfind('.');
+    size_t slash = rc.rfind('/');
+    if ((dot != string::npos) && ((slash == string::npos) || (dot > slash)))
+    {
+        rc.erase(dot);
+    }
+    return rc + ext;
+}
+
 /* This routine will be called by the PortAudio engine when audio is needed.
 ** It may be called at interrupt level on some machines so don't do anything
 ** that could mess up the system like calling malloc() or free().
@@ -76,6 +143,7 @@ static int recordCallback( const void *inputBuffer, void *outputBuffer,
                            PaStreamCallbackFlags statusFlags,
                            void *userData )
 {
+    uint64_t start = CallbackStats::Now();
     paTestData *data = (paTestData*)userData;
     const SAMPLE *rptr = (const SAMPLE*)inputBuffer;
     SAMPLE *wptr = &data->recordedSamples[data->frameIndex * data->nChannels];
@@ -85,8 +153,6 @@ static int recordCallback( const void *inputBuffer, void *outputBuffer,
     unsigned long framesLeft = data->maxFrameIndex - data->frameIndex;
 
     (void) outputBuffer; /* Prevent unused variable warnings. */
-    (void) timeInfo;
-    (void) statusFlags;
     (void) userData;
 
     if( framesLeft < framesPerBuffer )
@@ -116,10 +182,62 @@ static int recordCallback( const void *inputBuffer, void *outputBuffer,
             if( data->nChannels == 2 ) *wptr++ = *rptr++;  /* right */
         }
     }
+    if (data->blocks && (data->nBlocks < data->maxBlocks))
+    {
+        BlockInfo *b = &data->blocks[data->nBlocks++];
+        b->adcTime  = timeInfo ? timeInfo->inputBufferAdcTime : 0.0;
+        b->wallTime = WallTime();
+        b->frame    = data->frameIndex;
+        b->nFrames  = framesToCalc;
+        b->flags    = statusFlags | ((inputBuffer == NULL) ? BLOCK_NO_INPUT : 0);
+    }
     data->frameIndex += framesToCalc;
+    if (data->stats) data->stats->Record(start, statusFlags);
     return finished;
 }
 
+/* Continuous version of recordCallback. Every frame is pushed into
+** the ring, nothing here can block or allocate. If the consumer falls
+** behind the ring counts the dropped samples.
+*/
+static int ringCallback( const void *inputBuffer, void *outputBuffer,
+                         unsigned long framesPerBuffer,
+                         const PaStreamCallbackTimeInfo* timeInfo,
+                         PaStreamCallbackFlags statusFlags,
+                         void *userData )
+{
+    uint64_t start = CallbackStats::Now();
+    paStreamData *data = (paStreamData*)userData;
+    size_t nSamples = framesPerBuffer * data->nChannels;
+    size_t pushed;
+    BlockInfo info;
+
+    (void) outputBuffer; /* Prevent unused variable warnings. */
+
+    if( inputBuffer == NULL )
+    {
+        pushed = data->ring->PushZeros(nSamples);
+    }
+    else
+    {
+        pushed = data->ring->Push((const SAMPLE*)inputBuffer, nSamples);
+    }
+    if (data->blocks)
+    {
+        info.adcTime  = timeInfo ? timeInfo->inputBufferAdcTime : 0.0;
+        info.wallTime = WallTime();
+        info.frame    = data->frames;
+        info.nFrames  = framesPerBuffer;
+        info.flags    = statusFlags;
+        if (inputBuffer == NULL) info.flags |= BLOCK_NO_INPUT;
+        if (pushed == 0)         info.flags |= BLOCK_DROPPED;
+        data->blocks->Push(&info, 1);
+    }
+    data->frames += framesPerBuffer;
+    if (data->stats) data->stats->Record(start, statusFlags);
+    return data->run->load(std::memory_order_relaxed) ? paContinue : paComplete;
+}
+
 /* This routine will be called by the PortAudio engine when audio is needed.
 ** It may be called at interrupt level on some machines so don't do anything
 ** that could mess up the system like calling malloc() or free().
@@ -130,6 +248,7 @@ static int playCallback( const void *inputBuffer, void *outputBuffer,
                          PaStreamCallbackFlags statusFlags,
                          void *userData )
 {
+    uint64_t start = CallbackStats::Now();
     paTestData *data = (paTestData*)userData;
     SAMPLE *rptr = &data->recordedSamples[data->frameIndex * data->nChannels];
     SAMPLE *wptr = (SAMPLE*)outputBuffer;
@@ -139,7 +258,6 @@ static int playCallback( const void *inputBuffer, void *outputBuffer,
 
     (void) inputBuffer; /* Prevent unused variable warnings. */
     (void) timeInfo;
-    (void) statusFlags;
     (void) userData;
 
     if( framesLeft < framesPerBuffer )
@@ -168,6 +286,7 @@ static int playCallback( const void *inputBuffer, void *outputBuffer,
         data->frameIndex += framesPerBuffer;
         finished = paContinue;
     }
+    if (data->stats) data->stats->Record(start, statusFlags);
     return finished;
 }
 
@@ -191,7 +310,8 @@ static int playCallback( const void *inputBuffer, void *outputBuffer,
  *
  *******************************************************************
  */
-MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
+MainModule::MainModule(const char* ConfigFile, const char *Note,
+                       bool Offline) : CObject()
 {
     CLogger *pLogger = CLogger::GetThis();
     PaError err = paNoError;
@@ -208,6 +328,8 @@ MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
 
     fLogging         = true;
     fSampleRate      = 44000;
+    fConfigRate      = fSampleRate;
+    fCaptureRate     = fSampleRate;
     fFramesPerBuffer =   512;
     fNSeconds        =     5; // Seconds
     fInput           =     0; // Pa_GetDefaultInputDevice
@@ -215,7 +337,117 @@ MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
     fDefault         = false;
     fVolume          =    50;
     fDataLog         = NULL;
+    fn               = NULL;
+    fWriteBuffers    =     4;
+    fWriteBufferKB   =  1024;
+    fCompress        = false;
+    fCompressFrames  = 4096;
+    fH5Log           = NULL;
+    fH5Enable        = false;
+    fH5Deflate       =     4;
+    fH5ChunkFrames   = 16000;
+    fPSDLog          = NULL;
+    fBlockRing       = NULL;
+    fBlockLog        = NULL;
+    fBlockLogEnable  = true;
+    fLastAdcTime     =   0.0;
+    fOverflows       =     0;
+    fDroppedFrames   =     0;
+    fGaps            =     0;
+    fGapTime         =   0.0;
+    fData.blocks     = NULL;
+    fData.nBlocks    =     0;
+    fData.maxBlocks  =     0;
+    fData.stats      = NULL;
+    fRecordStats     = NULL;
+    fPlayStats       = NULL;
+    fCallbackStats   = true;
+    fCallbackStatsSeconds = 60;
+    fStreamStats     = NULL;
+    fStatsEnable     = true;
+    fStatsSeconds    =    60;
+    fClipLevel       = 32767;
+    fStatsFile       = "run";
+    fSpecLog         = NULL;
+    fSpectrumLog     = false;
+    fSpectrumBatch   =     8;
     fNote            = NULL;
+    fContinuous      = false;
+    fRingSeconds     =     4;
+    fRing            = NULL;
+    fBlock           = NULL;
+    fBlockFrames     =     0;
+    fFrameCount      =     0;
+    fStartTime       = WallTime();
+    fFirstSample     =     0;
+    fWelch           = NULL;
+    fWelchEnable     = true;
+    fWelchSegment    = 16000;
+    fWelchOverlap    =  8000;
+    fWelchWindow     = "hann";
+    fWelchSeconds    =  60.0;
+    fSTFT            = NULL;
+    fSTFTLog         = NULL;
+    fSTFTEnable      = false;
+    fSTFTSegment     =  1024;
+    fSTFTHop         =   256;
+    fSTFTWindow      = "hann";
+    fSTFTDecibels    = true;
+    fSTFTFormat      = "f2";
+    fSTFTMin         = -40.0;
+    fSTFTMax         = 100.0;
+    fSTFTTile        =    64;
+    fToneBank        = NULL;
+    fToneEnable      = false;
+    fTones.push_back(100.0);
+    fToneSeconds     =   1.0;
+    fToneReportSeconds = 60;
+    fToneReported    =     0;
+    fDecimator       = NULL;
+    fDecimationPassband    = 0.4;
+    fDecimationAttenuation = 90.0;
+    fOctave          = NULL;
+    fOctaveLog       = NULL;
+    fOctaveEnable    = false;
+    fOctaveFraction  =     3;
+    fOctaveLow       =   1.0;
+    fOctaveHigh      = 8000.0;
+    fOctaveOrder     =     3;
+    fOctaveSeconds   =   1.0;
+    fFilter          = NULL;
+    fFilterType      = "none";
+    fFilterOrder     =     2;
+    fFilterLow       =   0.5;
+    fFilterHigh      = 2000.0;
+    fEvents          = NULL;
+    fTriggerEnable   = false;
+    fTriggerSTA      =   0.5;
+    fTriggerLTA      =  30.0;
+    fTriggerOn       =   4.0;
+    fTriggerOff      =   1.5;
+    fEventPre        =  10.0;
+    fEventPost       =  20.0;
+    fEventMax        = 300.0;
+    fEventDirectory  = "events";
+    fRawLog          = true;
+    fFFTPlanner      = "measure";
+    fSinglePrecision = false;
+    fFFTThreads      = 1;
+    fProcess         = NULL;
+    fSource          = NULL;
+    fSourceName      = "portaudio";
+    fReplaySpeed     =   1.0;
+    fReplayLoop      = false;
+    fReplaySeconds   =     0;
+    fSyntheticChannels =   1;
+    fSyntheticTone   = 1000.0;
+    fSyntheticLevel  =  0.25;
+    fSyntheticNoise  =  0.01;
+    fData.recordedSamples = NULL;
+    fData.nChannels  =     0;
+    fNChannels       =     0;
+    fAnalysis        = NULL;
+    fBatchThreads    =     0;
     
     if(!ConfigFile)
     {
@@ -226,7 +458,7 @@ MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
     fConfigFileName = strdup(ConfigFile);
 
     // Initalize PortAudio!
-    err = Pa_Initialize();
+    err = Offline ? paNoError : Pa_Initialize();
     if( err != paNoError )
     {
         pLogger->LogError(__FILE__, __LINE__, 'F',
@@ -243,14 +475,92 @@ MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
     }
 
     /* USER POST CONFIGURATION STUFF. */
+    fConfigRate  = fSampleRate;
+    fCaptureRate = fSampleRate;
+
+    /*
+     * Wisdom lives in a directory next to the configuration file.
+     */
+    string dir(fConfigFileName);
+    size_t slash = dir.rfind('/');
+    dir = (slash == string::npos) ? string("wisdom") : dir.substr(0, slash+1) + "wisdom";
+    if (!Wisdom::SetEffort(fFFTPlanner.c_str()))
+    {
+        pLogger->Log("# Unknown FFTPlanner %s, using %s\n",
+                     fFFTPlanner.c_str(), Wisdom::Effort());
+    }
+    if (!Wisdom::SetDirectory(dir.c_str()))
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'W',
+                          "Can not use FFTW wisdom directory.");
+    }
+
+    if (Offline)
+    {
+        pLogger->Log("# MainModule constructed, offline.\n");
+        SET_DEBUG_STACK;
+        return;
+    }
+
+    fSource     = CreateSource();
+    if (fSource == NULL)
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F',
+                          "No usable audio source.");
+        SetError(ENO_DEVICE, __LINE__);
+        SET_DEBUG_STACK;
+        return;
+    }
+    // A recording plays back at the rate it was made.
+    if (!fSource->Live() && (fSource->SampleRate() > 0.0))
+    {
+        fSampleRate = (int32_t) fSource->SampleRate();
+    }
+    pLogger->Log("# Source %s, %u channel(s) at %d Hz\n", fSource->Name(),
+                 fSource->NChannels(), fSampleRate);
+    fCaptureRate = fSampleRate;
+    fNChannels   = fSource->NChannels();
+    if (!fDecimation.empty())
+    {
+        vector<uint32_t> factors;
+        uint32_t         total = 1;
+        for (int32_t f : fDecimation)
+        {
+            factors.push_back((f > 0) ? f : 0);
+            total *= (f > 0) ? f : 0;
+        }
+        fDecimator = new Decimator(fNChannels, fCaptureRate);
+        if ((total > 1) && ((fCaptureRate % total) == 0) &&
+            fDecimator->Design(factors, fDecimationPassband,
+                               fDecimationAttenuation))
+        {
+            fSampleRate = fCaptureRate / total;
+            pLogger->Log("# Decimate by %u in %u stage(s) to %d Hz, flat to %g Hz, %g dB, %.1f multiplies a sample, %.2f ms delay\n",
+                         total, fDecimator->Stages(), fSampleRate,
+                         fDecimationPassband * fSampleRate,
+                         fDecimationAttenuation, fDecimator->Cost(),
+                         1.0e3 * fDecimator->Delay());
+        }
+        else
+        {
+            pLogger->Log("# Decimation by %u does not fit %d Hz, not decimating\n",
+                         total, fCaptureRate);
+            delete fDecimator;
+            fDecimator = NULL;
+        }
+    }
+
     // Setup data array
-    // Setup frame size. 
-    fData.maxFrameIndex = fTotalFrames = fNSeconds * fSampleRate; 
+    // Setup frame size. The record is captured at fCaptureRate and
+    // decimated in place to fTotalFrames.
+    fData.maxFrameIndex = fNSeconds * fCaptureRate;
+    fTotalFrames = fNSeconds * fSampleRate; 
     fData.frameIndex = 0;
-    fNSamples = fTotalFrames * Pa_GetDeviceInfo( fInput )->maxInputChannels;
+    fData.nChannels = fNChannels;
+    fNSamples = fTotalFrames * fNChannels;
     
     /* From now on, recordedSamples is initialised. */
-    fData.recordedSamples = new SAMPLE[fNSamples];
+    fData.recordedSamples = new SAMPLE[fData.maxFrameIndex * fNChannels];
     
     if( fData.recordedSamples == NULL )
     {
@@ -260,8 +570,160 @@ MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
 	SET_DEBUG_STACK;
         return;
     }
-    memset( fData.recordedSamples, 0, sizeof(SAMPLE)*fNSamples);
+    memset( fData.recordedSamples, 0,
+            sizeof(SAMPLE) * fData.maxFrameIndex * fNChannels);
+    if (fCallbackStats)
+    {
+        // The deadline is one buffer.
+        fRecordStats = new CallbackStats("record",
+                                 (double) fFramesPerBuffer / (double) fCaptureRate);
+        fPlayStats   = new CallbackStats("play",
+                                 (double) fFramesPerBuffer / (double) fCaptureRate);
+    }
+    if (fStatsEnable)
+    {
+        fStreamStats = new StreamStats("input", fNChannels, fClipLevel);
+    }
+    if (fBlockLogEnable && !fContinuous)
+    {
+        // Callbacks may come short, allow for twice as many.
+        fData.maxBlocks = 2 * (fData.maxFrameIndex / fFramesPerBuffer + 1);
+        fData.blocks    = new BlockInfo[fData.maxBlocks];
+    }
+
+    if (fContinuous)
+    {
+        /*
+         * The ring is the only thing that grows with time, and it
+         * does not. It holds fRingSeconds of data so the processing
+         * thread can stall that long without losing anything.
+         */
+        fRing = new SPSCRing<SAMPLE>(fRingSeconds * fCaptureRate * fNChannels);
+        fBlockFrames = 4 * fFramesPerBuffer;
+        fBlock = new SAMPLE[fBlockFrames * fNChannels];
+        if (!fRing->Valid())
+        {
+            pLogger->LogError(__FILE__, __LINE__, 'F',
+                              "Could not allocate capture ring.");
+            SetError(ENO_MEM, __LINE__);
+            SET_DEBUG_STACK;
+            return;
+        }
+        fStream.nChannels = fNChannels;
+        fStream.ring      = fRing;
+        fStream.run       = &fRun;
+        fStream.frames    = 0;
+        fStream.blocks    = NULL;
+        fStream.stats     = fRecordStats;
+        if (fBlockLogEnable)
+        {
+            // As deep as the sample ring, in callbacks.
+            fBlockRing = new SPSCRing<BlockInfo>(
+                2 * (fRingSeconds * fCaptureRate / fFramesPerBuffer + 1));
+            if (fBlockRing->Valid()) fStream.blocks = fBlockRing;
+        }
+    }
+
+    // Whole record, per channel, all channels in one plan.
+    fAnalysis = new Analysis(fTotalFrames, fNChannels, fSinglePrecision,
+                             fFFTThreads);
+    pLogger->Log("# Whole record FFT %d x %u, %s, %d thread(s)\n",
+                 fTotalFrames, fNChannels,
+                 fSinglePrecision ? "float" : "double", fAnalysis->Threads());
+    if (fWelchEnable)
+    {
+        // Number of segments to average for one PSD every fWelchSeconds
+        double   hop = fWelchSegment - fWelchOverlap;
+        uint32_t nav = (hop > 0) ? (uint32_t) ceil(fWelchSeconds*fSampleRate/hop) : 1;
+        fWelch = new Welch(fWelchSegment, fWelchOverlap, fNChannels,
+                           Welch::WindowType(fWelchWindow.c_str()), nav,
+                           fSampleRate);
+    }
+    if (fContinuous && fSTFTEnable)
+    {
+        fSTFT = new Spectrogram(fSTFTSegment, fSTFTHop, fNChannels,
+                                Welch::WindowType(fSTFTWindow.c_str()),
+                                fSampleRate);
+        fSTFT->SetDecibels(fSTFTDecibels);
+        pLogger->Log("# Spectrogram %u point %s, hop %u, %s as %s\n",
+                     fSTFT->Segment(), Welch::WindowName(fSTFT->Window()),
+                     fSTFT->Hop(), fSTFTDecibels ? "dB" : "magnitude",
+                     SpectrogramFile::FormatName(
+                         SpectrogramFile::FormatType(fSTFTFormat.c_str())));
+    }
+    if (fToneEnable && !fTones.empty())
+    {
+        fToneBank = new ToneBank(fNChannels, fSampleRate, fToneSeconds);
+        for (size_t i=0; i<fTones.size(); i++)
+        {
+            if (fToneBank->AddTone(fTones[i]) < 0)
+            {
+                pLogger->Log("# Tone %g Hz is out of range, skipped\n",
+                             fTones[i]);
+            }
+        }
+        pLogger->Log("# Tracking %u tone(s), %g s per estimate\n",
+                     fToneBank->NTones(), fToneSeconds);
+    }
+    if (BiquadFilter::FilterType(fFilterType.c_str()) != BiquadFilter::kNone)
+    {
+        fFilter = new BiquadFilter(fNChannels, fSampleRate);
+        if (fFilter->Design(BiquadFilter::FilterType(fFilterType.c_str()),
+                            (fFilterOrder > 0) ? fFilterOrder : 0,
+                            fFilterLow, fFilterHigh))
+        {
+            pLogger->Log("# Filter %s order %d, %g to %g Hz, %u section(s), %.2f dB and %.2f dB at the corners\n",
+                         BiquadFilter::FilterName(fFilter->Type()),
+                         fFilterOrder, fFilterLow, fFilterHigh,
+                         fFilter->Sections(),
+                         20.0*log10(fFilter->Response(fFilterLow)),
+                         20.0*log10(fFilter->Response(fFilterHigh)));
+        }
+        else
+        {
+            pLogger->Log("# Filter %s order %d, %g to %g Hz can not be designed at %d Hz, not filtering\n",
+                         fFilterType.c_str(), fFilterOrder, fFilterLow,
+                         fFilterHigh, fSampleRate);
+            delete fFilter;
+            fFilter = NULL;
+        }
+    }
+    if (fOctaveEnable)
+    {
+        fOctaveFraction = (fOctaveFraction >= 3) ? 3 : 1;
+        fOctave = new OctaveBank(fNChannels, fSampleRate, fOctaveFraction,
+                                 fOctaveLow, fOctaveHigh,
+                                 (fOctaveOrder > 0) ? fOctaveOrder : 3,
+                                 fOctaveSeconds);
+        if (fOctave->NBands() > 0)
+        {
+            pLogger->Log("# Octave bands 1/%u, %u from %g to %g Hz over %u rates, Leq every %g s\n",
+                         fOctave->Fraction(), fOctave->NBands(),
+                         fOctave->Centre(0),
+                         fOctave->Centre(fOctave->NBands()-1),
+                         fOctave->NLevels(), fOctaveSeconds);
+        }
+        else
+        {
+            pLogger->Log("# No octave bands between %g and %g Hz at %d Hz\n",
+                         fOctaveLow, fOctaveHigh, fSampleRate);
+            delete fOctave;
+            fOctave = NULL;
+        }
+    }
+    // Only the continuous stream is watched.
+    if (fContinuous && fTriggerEnable)
+    {
+        fEvents = new EventCapture(fNChannels, fSampleRate, fEventPre,
+                                   fEventPost, fEventMax,
+                                   fEventDirectory.c_str());
+        fEvents->SetTrigger(fTriggerSTA, fTriggerLTA, fTriggerOn, fTriggerOff);
+        pLogger->Log("# Events: STA/LTA %g/%g s, on %g off %g, %g s before, %g s after, to %s\n",
+                     fTriggerSTA, fTriggerLTA, fTriggerOn, fTriggerOff,
+                     fEventPre, fEventPost, fEventDirectory.c_str());
+    }
 
+    // After the analysis so the spectral files know their shape.
     fn       = NULL;
     if (fLogging)
     {
@@ -269,7 +731,6 @@ MainModule::MainModule(const char* ConfigFile, const char *Note) : CObject()
 	fn = new FileName("Accelerometer", "acc", One_Day);
 	OpenLogFile();
     }
-    fAnalysis = new Analysis(fNSamples);
     
     pLogger->Log("# MainModule constructed.\n");
     oss << *this;
@@ -302,11 +763,23 @@ MainModule::~MainModule(void)
     CLogger *Logger = CLogger::GetThis();
 
     // Close port audio. 
+    delete fSource;
     Pa_Terminate();
 
     // Free up the data sample space. 
     if( fData.recordedSamples )       /* Sure it is NULL or valid. */
         delete[] fData.recordedSamples;
+    delete fRing;
+    delete[] fBlock;
+    delete fBlockRing;
+    delete[] fData.blocks;
+    delete fRecordStats;
+    delete fPlayStats;
+    if (fStreamStats)
+    {
+        fStreamStats->Publish(StreamStats::kFile, fStatsFile.c_str());
+        delete fStreamStats;
+    }
     
     // Write the configuration - maybe it changed.
     // in the instance that one did not exist, it will create
@@ -320,11 +793,31 @@ MainModule::~MainModule(void)
     free(fConfigFileName);
     free(fNote);
     delete fAnalysis;
+    delete fWelch;
+    delete fSTFT;
+    delete fToneBank;
+    delete fFilter;
+    delete fDecimator;
+    delete fEvents;
 
-    // Close and delete logger.
-    fDataLog->close();
-    // This will close and flush the existing logfile.
-    delete fDataLog;
+    // This will flush and close the existing logfile.
+    if (fDataLog)
+    {
+        LogWriterStats();
+        delete fDataLog;
+    }
+    if (fBlockLog)
+    {
+        LogCaptureStats();
+        delete fBlockLog;
+    }
+    // Writes the last partial chunk.
+    delete fH5Log;
+    delete fPSDLog;
+    delete fSpecLog;
+    delete fSTFTLog;
+    delete fOctaveLog;
+    delete fOctave;
     
     // Free the file naming tool. 
     if (fn)
@@ -359,33 +852,18 @@ bool MainModule::Record(void)
 {
     SET_DEBUG_STACK;
 
-    PaStreamParameters  inputParameters;
-    PaStream*           stream;
-    PaError             err = paNoError;
     CLogger *pLogger = CLogger::GetThis();
+    int      err;
     ClearError(__LINE__);
 
     pLogger->LogComment("Recording!\n");
-    const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo( fInput );
-
-    inputParameters.device = fInput;
-    inputParameters.channelCount = deviceInfo->maxInputChannels;
-    fData.nChannels = inputParameters.channelCount;
-    inputParameters.sampleFormat = PA_SAMPLE_TYPE;
-    inputParameters.suggestedLatency = deviceInfo->defaultLowInputLatency;
-    inputParameters.hostApiSpecificStreamInfo = NULL;
+    fData.nChannels = fNChannels;
+    fData.nBlocks = 0;
+    fData.stats   = fRecordStats;
+    if (fRecordStats) fRecordStats->Restart();
 
     /* Record some audio. -------------------------------------------- */
-    err = Pa_OpenStream(
-              &stream,
-              &inputParameters,
-              NULL,                  /* &outputParameters, */
-              fSampleRate,
-              fFramesPerBuffer,
-              paClipOff,      /* we won't output out of range samples so don't bother clipping them */
-              recordCallback,
-              &fData );
-    if( err != paNoError )
+    if (!fSource->Open(fCaptureRate, fFramesPerBuffer, recordCallback, &fData))
     {
         pLogger->LogError(__FILE__, __LINE__, 'F', "Could not open stream.");
         SetError(ENO_STREAM, __LINE__);
@@ -393,20 +871,29 @@ bool MainModule::Record(void)
         return false;
     }
 
-    err = Pa_StartStream( stream );
-    if( err != paNoError )
+    double start = WallTime();
+    if (!fSource->Start())
     {
         pLogger->LogError(__FILE__, __LINE__, 'F', "Could not record.");
         SetError(ENO_RECORD, __LINE__);
         SET_DEBUG_STACK;
         return false;
     }
+    if (fFrameCount == 0)
+    {
+        StampStart();
+    }
     printf("\n=== Now recording!! Please speak into the microphone. ===\n"); fflush(stdout);
 
-    while( (( err = Pa_IsStreamActive( stream ) ) == 1 ) && fRun)
+    // Poll often enough that a replay does not wait on us.
+    uint32_t ticks = 0;
+    while( (( err = fSource->IsActive() ) == 1 ) && fRun)
     {
-        Pa_Sleep(1000);
-        printf("index = %d\n", fData.frameIndex ); fflush(stdout);
+        Pa_Sleep(100);
+        if ((++ticks % 10) == 0)
+        {
+            printf("index = %d\n", fData.frameIndex ); fflush(stdout);
+        }
     }
     if( err < 0 )
     {
@@ -416,18 +903,227 @@ bool MainModule::Record(void)
         return false;
     }
 
-    err = Pa_CloseStream( stream );
-    if( err != paNoError )
+    if (!fSource->Close())
     {
-        pLogger->LogError(__FILE__, __LINE__, 'F', Pa_GetErrorText(err));
+        pLogger->LogError(__FILE__, __LINE__, 'F', "Could not close stream.");
         SetError(ENO_STREAM, __LINE__);
         SET_DEBUG_STACK;
         return false;
     }
+    if (fRecordStats) fRecordStats->Publish();
+    if (!fSource->Live()) LogThroughput(fData.frameIndex, WallTime() - start);
     
     SET_DEBUG_STACK;
     return true;
 }
+/**
+ ******************************************************************
+ *
+ * Function Name : Acquire
+ *
+ * Description : Continuous version of Record. The stream runs
+ *               until Stop() is called, the callback fills fRing and
+ *               ProcessThread empties it. Unlike Record the stream is
+ *               never restarted so there are no gaps between blocks.
+ *
+ * Inputs : none
+ *
+ * Returns : true on a clean shutdown
+ *
+ * Error Conditions : ENO_STREAM, ENO_RECORD
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool MainModule::Acquire(void)
+{
+    SET_DEBUG_STACK;
+
+    CLogger *pLogger = CLogger::GetThis();
+    int      err = 0;
+    bool     rc = true;
+    ClearError(__LINE__);
+
+    pLogger->LogComment("Continuous acquisition!\n");
+
+    if (!fSource->Open(fCaptureRate, fFramesPerBuffer, ringCallback, &fStream))
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', "Could not open stream.");
+        SetError(ENO_STREAM, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    // Only a replay can wait, a live device ignores this.
+    fSource->SetReady(RingReady, this);
+
+    // Consumer first so it is ready when the first callback lands.
+    fFrameCount = 0;
+    StampStart();
+    fProcess = new std::thread(&MainModule::ProcessThread, this);
+
+    double start = WallTime();
+    if (!fSource->Start())
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', "Could not record.");
+        SetError(ENO_RECORD, __LINE__);
+        rc = false;
+        fRun = false;
+    }
+
+    // Poll often enough that a replay does not wait on us.
+    uint32_t ticks = 0;
+    while( rc && (( err = fSource->IsActive() ) == 1 ) && fRun)
+    {
+        Pa_Sleep(100);
+        if ((++ticks % 10) != 0) continue;
+
+        uint32_t seconds = ticks / 10;
+        if (fRecordStats && (fCallbackStatsSeconds > 0) &&
+            (seconds % fCallbackStatsSeconds == 0))
+        {
+            fRecordStats->Publish();
+        }
+        if ((seconds % 10) == 0)
+        {
+            printf("frames = %lu, ring = %lu, dropped = %lu, write queue = %u, overflows = %lu, gaps = %lu\n",
+                   (unsigned long) fFrameCount,
+                   (unsigned long) fRing->Available(),
+                   (unsigned long) fRing->Dropped(),
+                   fDataLog ? fDataLog->QueueDepth() : 0,
+                   (unsigned long) fOverflows,
+                   (unsigned long) fGaps);
+            fflush(stdout);
+        }
+    }
+    if( err < 0 )
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', "Error with input stream.");
+        SetError(ENO_RECORD, __LINE__);
+        rc = false;
+    }
+
+    /*
+     * The callback sees fRun go false and completes, then the
+     * processing thread empties what is left in the ring.
+     */
+    fRun = false;
+    fSource->Stop();
+    if (!fSource->Close())
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', "Could not close stream.");
+        SetError(ENO_STREAM, __LINE__);
+        rc = false;
+    }
+    fProcess->join();
+    delete fProcess;
+    fProcess = NULL;
+    if (fRecordStats) fRecordStats->Publish();
+    if (fEvents)
+    {
+        fEvents->Finish();
+        pLogger->Log("# Events: %u, %.1f s of %.1f s kept\n", fEvents->Events(),
+                     (double) fEvents->EventFrames() / fSampleRate,
+                     (double) fFrameCount / fSampleRate);
+    }
+    if (fStreamStats)
+    {
+        fStreamStats->Publish(StreamStats::kInterval, "interval");
+        fStreamStats->Publish(StreamStats::kFile, fStatsFile.c_str());
+    }
+    if (fToneBank) ReportTones();
+    if (fDecimator && (fDecimator->Clipped() > 0))
+    {
+        pLogger->Log("# Decimator output clipped %lu samples.\n",
+                     (unsigned long) fDecimator->Clipped());
+    }
+    if (fFilter && (fFilter->Clipped() > 0))
+    {
+        pLogger->Log("# Filter output clipped %lu samples.\n",
+                     (unsigned long) fFilter->Clipped());
+    }
+    if (!fSource->Live())
+    {
+        LogThroughput(fFrameCount * (fCaptureRate / fSampleRate),
+                      WallTime() - start);
+    }
+
+    if (fRing->Dropped() > 0)
+    {
+        pLogger->Log("# Capture ring dropped %lu samples.\n",
+                     (unsigned long) fRing->Dropped());
+    }
+    SET_DEBUG_STACK;
+    return rc;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : RingReady
+ *
+ * Description : ReplaySource asks this before each callback when
+ *               running flat out. True when the sample ring and the
+ *               block ring both have room, so the replay goes exactly
+ *               as fast as the processing thread.
+ *
+ * Inputs : Arg    - the MainModule
+ *          Frames - frames in the next callback
+ *
+ * Returns : true if the callback can go now
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool MainModule::RingReady(void *Arg, unsigned long Frames)
+{
+    MainModule *mm = (MainModule *) Arg;
+    if (mm->fRing->Space() < Frames * mm->fNChannels) return false;
+    return ((mm->fBlockRing == NULL) || (mm->fBlockRing->Space() > 0));
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : LogThroughput
+ *
+ * Description : How fast a replay went through the pipeline, as
+ *               frames and bytes per second and a multiple of real
+ *               time.
+ *
+ * Inputs : Frames  - frames processed
+ *          Seconds - wall time they took
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::LogThroughput(uint64_t Frames, double Seconds)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    if (Seconds <= 0.0) return;
+    double rate = (double) Frames / Seconds;
+    pLogger->Log("# Throughput: %lu frames in %.3f s, %.0f frames/s, %.2f MB/s, %.1f x real time\n",
+                 (unsigned long) Frames, Seconds, rate,
+                 rate * fNChannels * sizeof(SAMPLE) / 1.0e6,
+                 rate / (double) fCaptureRate);
+    SET_DEBUG_STACK;
+}
 /**
  ******************************************************************
  *
@@ -460,6 +1156,8 @@ bool MainModule::Play(void)
 
     /* Playback recorded data.  -------------------------------------------- */
     fData.frameIndex = 0;
+    fData.stats      = fPlayStats;
+    if (fPlayStats) fPlayStats->Restart();
 
     outputParameters.device = fOutput;
     outputParameters.channelCount = deviceInfo->maxOutputChannels;
@@ -472,7 +1170,7 @@ bool MainModule::Play(void)
               &stream,
               NULL, /* no input */
               &outputParameters,
-              fSampleRate,
+              fCaptureRate,
               fFramesPerBuffer,
               paClipOff,      /* we won't output out of range samples so don't bother clipping them */
               playCallback,
@@ -511,6 +1209,7 @@ bool MainModule::Play(void)
 	}
         
         pLogger->LogComment("Playback Done.\n");
+        if (fPlayStats) fPlayStats->Publish();
     }
 
     SET_DEBUG_STACK;
@@ -519,7 +1218,7 @@ bool MainModule::Play(void)
 /**
  ******************************************************************
  *
- * Function Name : 
+ * Function Name : Do
  *
  * Description :
  *
@@ -536,46 +1235,122 @@ bool MainModule::Play(void)
  *
  *******************************************************************
  */
-void MainModule::Stats(void)
+void MainModule::Do(void)
 {
     SET_DEBUG_STACK;
-    SAMPLE  max, val;
-    double  average;
+    CLogger *pLogger = CLogger::GetThis();
 
-     /* Measure maximum peak amplitude. */
-    max     = 0;
-    average = 0.0;
-    for( uint32_t i=0; i<fNSamples; i++ )
+    fRun = true;
+ 
+    ClearError(__LINE__);
+    pLogger->LogComment("DO!\n");
+    
+    // Only a device has rates to check.
+    if(fSource->Live() && !ScanRateSupported())
     {
-        val = fData.recordedSamples[i];
-        if( val < 0 ) val = -val; /* ABS */
-        if( val > max )
-        {
-            max = val;
-        }
-        average += val;
+        return;
     }
 
-    average = average / (double)fNSamples;
-
-    printf("sample max amplitude = %d\n", max );
-    printf("sample average = %lf\n", average );
-
-    SET_DEBUG_STACK;
-}
-
-/**
- ******************************************************************
- *
- * Function Name : Do
- *
- * Description :
- *
- * Inputs :
+    if (fContinuous)
+    {
+        Acquire();
+    }
+    else if(Record() && fRun)
+    {
+        CheckFileChange();
+        // Played back and counted as captured, everything else is
+        // decimated.
+        if (fSource->Live()) Play();
+        if (fStreamStats)
+        {
+            fStreamStats->Add(fData.recordedSamples, fData.maxFrameIndex);
+            fStreamStats->Publish(StreamStats::kInterval, "record");
+        }
+        if (fDecimator)
+        {
+            fDecimator->Reset();
+            fDecimator->Process(fData.recordedSamples, fData.maxFrameIndex,
+                                fData.recordedSamples);
+        }
+	if (fDataLog)
+	{
+	    fDataLog->Write(fData.recordedSamples, fNSamples*sizeof(SAMPLE));
+	}
+        if (fH5Log)
+        {
+            fH5Log->Append(fData.recordedSamples, fTotalFrames);
+        }
+        for (uint32_t i=0; i<fData.nBlocks; i++)
+        {
+            // Record relative to stream relative, capture frames.
+            fData.blocks[i].frame += fFrameCount * (fCaptureRate / fSampleRate);
+            RecordBlock(fData.blocks[i]);
+        }
+        if (fFilter)
+        {
+            // Each record settles on its own first frame.
+            fFilter->Reset();
+            fFilter->Process(fData.recordedSamples, fTotalFrames);
+        }
+	fAnalysis->ScaleData(fData.recordedSamples);
+	fAnalysis->ComputeFFT();
+        if (fSpecLog)
+        {
+            fAnalysis->DumpResults(fSpecLog, fStartTime +
+                                   (double) fFrameCount / (double) fSampleRate,
+                                   fFrameCount);
+        }
+        fFrameCount += fTotalFrames;
+        if (fWelch)
+        {
+            /*
+             * A record can hold several averages and AddBlock keeps
+             * only the last, so feed it a hop at a time, at most one
+             * PSD each, then publish what is left of the record.
+             */
+            uint32_t hop = fWelch->Segment() - fWelch->Overlap();
+            uint32_t m;
+            for (int32_t i=0; i<fTotalFrames; i+=m)
+            {
+                m = ((uint32_t) (fTotalFrames - i) < hop) ?
+                    fTotalFrames - i : hop;
+                if (fWelch->AddBlock(&fData.recordedSamples[i*fNChannels],
+                                     m) > 0)
+                {
+                    ReportPSD();
+                }
+            }
+            if (fWelch->Emit()) ReportPSD();
+        }
+        if (fToneBank && (fToneBank->Add(fData.recordedSamples,
+                                         fTotalFrames) > 0))
+        {
+            ReportTones();
+        }
+        if (fOctave && (fOctave->Add(fData.recordedSamples,
+                                     fTotalFrames) > 0))
+        {
+            ReportBands();
+        }
+    }
+    SET_DEBUG_STACK;
+}
+
+/**
+ ******************************************************************
  *
- * Returns :
+ * Function Name : ProcessThread
  *
- * Error Conditions :
+ * Description : Consumer side of fRing. Pull whole frames out
+ *               in blocks of fBlockFrames, decimate them in place
+ *               and hand them on. Keeps
+ *               going after fRun drops until the ring is empty.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
  * 
  * Unit Tested on: 
  *
@@ -584,60 +1359,483 @@ void MainModule::Stats(void)
  *
  *******************************************************************
  */
-void MainModule::Do(void)
+void MainModule::ProcessThread(void)
 {
     SET_DEBUG_STACK;
-    CLogger *pLogger = CLogger::GetThis();
-    const char *pSample;
+    size_t   n;
+    uint32_t m;
+    BlockInfo info;
+    // Sleep about a quarter of a callback period when idle.
+    const std::chrono::microseconds idle(250000 * fFramesPerBuffer / fCaptureRate);
 
-    fRun = true;
- 
-    ClearError(__LINE__);
-    pLogger->LogComment("DO!\n");
-    
-    if(!ScanRateSupported())
+    do
     {
-        return;
+        while (fBlockRing && (fBlockRing->Pop(&info, 1) == 1))
+        {
+            RecordBlock(info);
+        }
+        n = fRing->Pop(fBlock, fBlockFrames * fNChannels);
+        if (n > 0)
+        {
+            m = n / fNChannels;
+            CaptureStats(fBlock, m);
+            if (fDecimator) m = fDecimator->Process(fBlock, m, fBlock);
+            if (m > 0) ProcessBlock(fBlock, m);
+        }
+        else
+        {
+            std::this_thread::sleep_for(idle);
+        }
+    } while (fRun || (n > 0) || (fRing->Available() > 0) ||
+             (fBlockRing && (fBlockRing->Available() > 0)));
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : CaptureStats
+ *
+ * Description : Amplitude statistics of a block as it came from the
+ *               source, ahead of any decimation, so clips, extremes
+ *               and crest factor describe the ADC and not the
+ *               filtered data. Intervals are counted at fCaptureRate.
+ *
+ * Inputs : samples - interleaved frames at the capture rate
+ *          nFrames - number of frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::CaptureStats(const SAMPLE *samples, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    if (fStreamStats == NULL) return;
+    fStreamStats->Add(samples, nFrames);
+    if ((fStatsSeconds > 0) && (fStreamStats->Frames(StreamStats::kInterval) >=
+                                (uint64_t) fStatsSeconds * fCaptureRate))
+    {
+        fStreamStats->Publish(StreamStats::kInterval, "interval");
     }
-
-    if(Record() && fRun)
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ProcessBlock
+ *
+ * Description : Everything done to a block of frames after
+ *               it leaves the ring. Runs on the processing thread.
+ *               The logs take the block raw, the filter then
+ *               works on it in place for everything after.
+ *
+ * Inputs : samples - interleaved frames, filtered in place
+ *          nFrames - number of frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::ProcessBlock(SAMPLE *samples, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    // Rotate first so the new file starts with this block.
+    CheckFileChange();
+    if (fDataLog)
     {
-        Stats();
-        Play();
-	if (fDataLog)
-	{
-	    pSample = (char *)fData.recordedSamples;
-	    fDataLog->write(pSample, fNSamples*sizeof(SAMPLE));
-	}
-	fAnalysis->ScaleData(fData.recordedSamples);
-	fAnalysis->ComputeFFT();
+        fDataLog->Write(samples, nFrames * fNChannels * sizeof(SAMPLE));
+    }
+    if (fH5Log)
+    {
+        fH5Log->Append(samples, nFrames);
+    }
+    if (fFilter)
+    {
+        fFilter->Process(samples, nFrames);
+    }
+    if (fWelch && (fWelch->AddBlock(samples, nFrames) > 0))
+    {
+        ReportPSD();
+    }
+    if (fSTFT)
+    {
+        uint32_t n = fSTFT->AddBlock(samples, nFrames);
+        for (uint32_t i=0; fSTFTLog && (i<n); i++)
+        {
+            fSTFTLog->Append(fStartTime + (double) fSTFT->ColumnFrame(i) /
+                             (double) fSampleRate, fSTFT->ColumnFrame(i),
+                             fSTFT->Column(i));
+        }
+    }
+    if (fToneBank && (fToneBank->Add(samples, nFrames) > 0) &&
+        (fFrameCount + nFrames >= fToneReported +
+         (uint64_t) fToneReportSeconds * fSampleRate))
+    {
+        ReportTones();
+        fToneReported = fFrameCount + nFrames;
+    }
+    if (fOctave && (fOctave->Add(samples, nFrames) > 0))
+    {
+        ReportBands();
+    }
+    if (fEvents)
+    {
+        fEvents->Add(samples, nFrames, fFrameCount, fStartTime);
     }
+    fFrameCount += nFrames;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : CheckFileChange
+ *
+ * Description : If the file name tool says it is time, switch
+ *               the data log to a new file starting at fFrameCount.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::CheckFileChange(void)
+{
+    SET_DEBUG_STACK;
     if (fLogging)
     {
         if (fn->ChangeNames())
         {
             /*
-             * flush and close existing file
              * get a new unique filename
              * reset the timer
-             * and go!
+             * queue the swap, the writer thread closes the old file
+             * and the next block lands in the new one.
              *
              * Check to see that logging is enabled.
              */
             if(fDataLog)
             {
-	        fDataLog->close();
-                // This will close and flush the existing logfile.
-	        delete fDataLog;
-                fDataLog = NULL;
-                // Now reopen
                 OpenLogFile();
             }
         }
-     }
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : LogWriterStats
+ *
+ * Description : Put the data writer statistics in the log
+ *               so FramesPerBuffer/WriteBuffers can be sized.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::LogWriterStats(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    pLogger->Log("# DataWriter: %lu bytes, max queue %u of %d, stalls %lu, stall time %f s, write errors %lu\n",
+                 (unsigned long) fDataLog->BytesWritten(),
+                 fDataLog->MaxQueueDepth(), fWriteBuffers,
+                 (unsigned long) fDataLog->Stalls(),
+                 fDataLog->StallTime(),
+                 (unsigned long) fDataLog->WriteErrors());
+    if (fDataLog->Compressed() && (fDataLog->CodedBytes() > 0))
+    {
+        pLogger->Log("# DataWriter: %lu sample bytes coded to %lu, %.2f:1\n",
+                     (unsigned long) fDataLog->SampleBytes(),
+                     (unsigned long) fDataLog->CodedBytes(),
+                     (double) fDataLog->SampleBytes() /
+                     (double) fDataLog->CodedBytes());
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : RecordBlock
+ *
+ * Description : Count overflows, drops and ADC clock gaps for one
+ *               callback and queue its record to the .blk file. A gap
+ *               is the ADC time of a block landing more than half a
+ *               buffer after the end of the previous one.
+ *
+ * Inputs : info - block to account for
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::RecordBlock(const BlockInfo &info)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    double   dt;
+    double   period = (double) info.nFrames / (double) fCaptureRate;
+
+    if (info.flags & paInputOverflow) fOverflows++;
+    if (info.flags & BLOCK_DROPPED)   fDroppedFrames += info.nFrames;
+    if ((fLastAdcTime > 0.0) && (info.adcTime > 0.0))
+    {
+        dt = info.adcTime - fLastAdcTime;
+        if (dt > 0.5 * (double) fFramesPerBuffer / (double) fCaptureRate)
+        {
+            fGaps++;
+            fGapTime += dt;
+            pLogger->Log("# ADC gap of %f s before frame %lu\n", dt,
+                         (unsigned long) info.frame);
+        }
+    }
+    fLastAdcTime = (info.adcTime > 0.0) ? info.adcTime + period : 0.0;
+
+    if (fBlockLog)
+    {
+        fBlockLog->Write(&info, sizeof(BlockInfo));
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : LogCaptureStats
+ *
+ * Description : Put the block stream totals in the log.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::LogCaptureStats(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    pLogger->Log("# Capture: %lu overflows, %lu frames dropped, %lu gaps totalling %f s\n",
+                 (unsigned long) fOverflows, (unsigned long) fDroppedFrames,
+                 (unsigned long) fGaps, fGapTime);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReportPSD
+ *
+ * Description : Summarise the PSD that fWelch just published,
+ *               peak frequency and band limited RMS per channel.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::ReportPSD(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    const double *psd;
+    uint32_t peak;
+    double   power;
+
+    for (uint32_t c=0; c<fWelch->NChannels(); c++)
+    {
+        psd   = fWelch->PSD(c);
+        peak  = 1;
+        power = 0.0;
+        // Skip DC, the mean was removed anyway.
+        for (uint32_t k=1; k<fWelch->NBins(); k++)
+        {
+            if (psd[k] > psd[peak]) peak = k;
+            power += psd[k];
+        }
+        if (fWelch->GetScaling() == Welch::kDensity)
+        {
+            power *= fWelch->BinWidth();
+        }
+        pLogger->Log("# Welch %lu chan %u, %u segments, peak %f Hz, rms %g\n",
+                     (unsigned long) fWelch->Count(), c, fWelch->Segments(),
+                     peak * fWelch->BinWidth(), sqrt(power));
+    }
+    if (fPSDLog)
+    {
+        // Channels are contiguous in the published PSD.
+        fPSDLog->Append(fStartTime + (double) fWelch->FirstFrame() /
+                        (double) fSampleRate, fWelch->FirstFrame(),
+                        fWelch->PSD(0));
+    }
     SET_DEBUG_STACK;
 }
+/**
+ ******************************************************************
+ *
+ * Function Name : ReportTones
+ *
+ * Description : Latest amplitude and phase of every tone on every
+ *               channel. Phase is radians at stream frame 0, so a
+ *               steady tone logs the same phase each time.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::ReportTones(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
 
+    for (uint32_t k=0; k<fToneBank->NTones(); k++)
+    {
+        if (fToneBank->Count(k) == 0) continue;
+        for (uint32_t c=0; c<fToneBank->NChannels(); c++)
+        {
+            pLogger->Log("# Tone %.3f Hz chan %u, frame %lu, amplitude %g, phase %.4f\n",
+                         fToneBank->Frequency(k), c,
+                         (unsigned long) fToneBank->FirstFrame(k),
+                         fToneBank->Amplitude(k, c), fToneBank->Phase(k, c));
+        }
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReportBands
+ *
+ * Description : fOctave has the Leq of the interval it just
+ *               finished, one record in the .oct file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::ReportBands(void)
+{
+    SET_DEBUG_STACK;
+    if (fOctaveLog)
+    {
+        fOctaveLog->Append(fStartTime + (double) fOctave->FirstFrame() /
+                           (double) fSampleRate, fOctave->FirstFrame(),
+                           fOctave->Leq());
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : StampStart
+ *
+ * Description : Frame 0 is about to be taken. Record the
+ *               time and fix up the header of the open file, which
+ *               was written before the start time was known.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::StampStart(void)
+{
+    SET_DEBUG_STACK;
+    char header[kHeaderSize];
+    fStartTime = WallTime();
+    if (fDataLog && fDataLog->IsOpen() && (fFirstSample == 0))
+    {
+        FormatLogHeader(header);
+        fDataLog->Restamp(header, kHeaderSize);
+    }
+    if (fH5Log && fH5Log->IsOpen() && (fFirstSample == 0))
+    {
+        StampH5();
+    }
+    if (fBlockLog && fBlockLog->IsOpen() && (fFirstSample == 0))
+    {
+        FormatBlockHeader(header);
+        fBlockLog->Restamp(header, kHeaderSize);
+    }
+    SET_DEBUG_STACK;
+}
 /**
  ******************************************************************
  *
@@ -676,18 +1874,106 @@ bool MainModule::OpenLogFile(void)
     SET_DEBUG_STACK;
     time(&now);
     strftime (msg, sizeof(msg), "%m-%d-%y %H:%M:%S", gmtime(&now));
-    pLogger->Log("# changed file name %s at %s\n", name, msg);
+    pLogger->Log("# changed file name %s at %s, first sample %lu\n", name, msg,
+                 (unsigned long) fFrameCount);
     
-    fChangeFile = false;
-    fDataLog = new ofstream(name, ios::binary);
+    fChangeFile  = false;
+    fFirstSample = fFrameCount;
+    // The file set covers exactly what went to the last file.
+    if (fStreamStats)
+    {
+        fStreamStats->Publish(StreamStats::kFile, fStatsFile.c_str());
+    }
+    fStatsFile = name;
+    char header[kHeaderSize];
+    FormatLogHeader(header);
+
+    if (fH5Enable)
+    {
+        // Same name, .h5 rather than .acc, same first sample.
+        string h5 = Extension(name, ".h5");
+        if (!fH5Log)
+        {
+            fH5Log = new H5Writer(fNChannels, fH5ChunkFrames, fH5Deflate);
+        }
+        if (fH5Log->Open(h5.c_str()))
+        {
+            StampH5();
+        }
+        else
+        {
+            pLogger->LogError(__FILE__,__LINE__, 'W',
+                              "Error opening HDF5 data file");
+        }
+    }
+
+    if (fSpectrumLog || fSTFT || fOctave)
+    {
+        OpenSpectrumFiles(name);
+    }
+
+    if (fBlockLogEnable)
+    {
+        string blk = Extension(name, ".blk");
+        char   bheader[kHeaderSize];
+        FormatBlockHeader(bheader);
+        if (fBlockLog && fBlockLog->IsOpen())
+        {
+            fBlockLog->Rotate(blk.c_str(), bheader, kHeaderSize);
+        }
+        else
+        {
+            // Small, 32 bytes a callback.
+            if (!fBlockLog) fBlockLog = new DataWriter(2, 65536);
+            if (!fBlockLog->Open(blk.c_str(), bheader, kHeaderSize))
+            {
+                pLogger->LogError(__FILE__,__LINE__, 'W',
+                                  "Error opening block file");
+            }
+        }
+    }
+
+    // Events only, the other products still rotate.
+    if (!fRawLog)
+    {
+        SET_DEBUG_STACK;
+        return true;
+    }
+    if (fDataLog && fDataLog->IsOpen())
+    {
+        // Gapless, the writer thread swaps on the next buffer.
+        fDataLog->Rotate(name, header, kHeaderSize);
+        SET_DEBUG_STACK;
+        return true;
+    }
     if (!fDataLog)
+    {
+        fDataLog = new DataWriter(fWriteBuffers, fWriteBufferKB*1024);
+        /*
+         * The spare lives next to the data so the swap is a rename,
+         * and is big enough for a whole raw day. The writer gives
+         * back whatever a file did not use when it is closed.
+         */
+        string spare(name);
+        size_t slash = spare.rfind('/');
+        spare = (slash == string::npos) ? string("") : spare.substr(0, slash+1);
+        spare += ".Accelerometer.spare";
+        fDataLog->SetSpare(spare.c_str(), (uint64_t) 86400 * fSampleRate *
+                           fNChannels * sizeof(SAMPLE) + kHeaderSize);
+        if (fCompress)
+        {
+            // Coded on the writer thread, a block at a time.
+            fDataLog->SetCodec(fNChannels, (fCompressFrames > 0) ?
+                               fCompressFrames : 4096);
+        }
+    }
+    if (fDataLog->Error() || !fDataLog->Open(name, header, kHeaderSize))
     {
         pLogger->LogError(__FILE__,__LINE__, 'W',
 			"Error opening data output stream");
-        SetError(__LINE__, ENO_LOGFILE);
+        SetError(ENO_LOGFILE, __LINE__);
 	return false;
     }
-    WriteLogHeader();
     SET_DEBUG_STACK;
     return true;
 }
@@ -761,6 +2047,94 @@ bool MainModule::ReadConfiguration(void)
 	MM.lookupValue("OutputDevice",    fOutput);
 	MM.lookupValue("DefaultIO",       fDefault);
 	MM.lookupValue("Volume",          fVolume);
+	MM.lookupValue("Continuous",      fContinuous);
+	MM.lookupValue("RingSeconds",     fRingSeconds);
+	MM.lookupValue("WriteBuffers",    fWriteBuffers);
+	MM.lookupValue("WriteBufferKB",   fWriteBufferKB);
+	MM.lookupValue("Compress",        fCompress);
+	MM.lookupValue("CompressFrames",  fCompressFrames);
+	MM.lookupValue("H5Log",           fH5Enable);
+	MM.lookupValue("H5Deflate",       fH5Deflate);
+	MM.lookupValue("H5ChunkFrames",   fH5ChunkFrames);
+	MM.lookupValue("SpectrumLog",     fSpectrumLog);
+	MM.lookupValue("SpectrumBatch",   fSpectrumBatch);
+	MM.lookupValue("BlockLog",        fBlockLogEnable);
+	MM.lookupValue("CallbackStats",   fCallbackStats);
+	MM.lookupValue("CallbackStatsSeconds", fCallbackStatsSeconds);
+	MM.lookupValue("Stats",           fStatsEnable);
+	MM.lookupValue("StatsSeconds",    fStatsSeconds);
+	MM.lookupValue("ClipLevel",       fClipLevel);
+	MM.lookupValue("Welch",           fWelchEnable);
+	MM.lookupValue("WelchSegment",    fWelchSegment);
+	MM.lookupValue("WelchOverlap",    fWelchOverlap);
+	MM.lookupValue("WelchWindow",     fWelchWindow);
+	MM.lookupValue("WelchSeconds",    fWelchSeconds);
+	MM.lookupValue("Spectrogram",     fSTFTEnable);
+	MM.lookupValue("SpectrogramSegment", fSTFTSegment);
+	MM.lookupValue("SpectrogramHop",  fSTFTHop);
+	MM.lookupValue("SpectrogramWindow", fSTFTWindow);
+	MM.lookupValue("SpectrogramDB",   fSTFTDecibels);
+	MM.lookupValue("SpectrogramFormat", fSTFTFormat);
+	MM.lookupValue("SpectrogramMin",  fSTFTMin);
+	MM.lookupValue("SpectrogramMax",  fSTFTMax);
+	MM.lookupValue("SpectrogramTile", fSTFTTile);
+	MM.lookupValue("ToneTrack",       fToneEnable);
+	if (MM.exists("Tones"))
+	{
+	    const Setting &tones = MM["Tones"];
+	    fTones.clear();
+	    for (int i=0; i<tones.getLength(); i++)
+	    {
+		fTones.push_back((double) tones[i]);
+	    }
+	}
+	MM.lookupValue("ToneSeconds",     fToneSeconds);
+	MM.lookupValue("ToneReportSeconds", fToneReportSeconds);
+	if (MM.exists("Decimation"))
+	{
+	    const Setting &factors = MM["Decimation"];
+	    fDecimation.clear();
+	    for (int i=0; i<factors.getLength(); i++)
+	    {
+		fDecimation.push_back((int) factors[i]);
+	    }
+	}
+	MM.lookupValue("DecimationPassband", fDecimationPassband);
+	MM.lookupValue("DecimationAttenuation", fDecimationAttenuation);
+	MM.lookupValue("Octave",          fOctaveEnable);
+	MM.lookupValue("OctaveFraction",  fOctaveFraction);
+	MM.lookupValue("OctaveLow",       fOctaveLow);
+	MM.lookupValue("OctaveHigh",      fOctaveHigh);
+	MM.lookupValue("OctaveOrder",     fOctaveOrder);
+	MM.lookupValue("OctaveSeconds",   fOctaveSeconds);
+	MM.lookupValue("Filter",          fFilterType);
+	MM.lookupValue("FilterOrder",     fFilterOrder);
+	MM.lookupValue("FilterLow",       fFilterLow);
+	MM.lookupValue("FilterHigh",      fFilterHigh);
+	MM.lookupValue("Trigger",         fTriggerEnable);
+	MM.lookupValue("TriggerSTA",      fTriggerSTA);
+	MM.lookupValue("TriggerLTA",      fTriggerLTA);
+	MM.lookupValue("TriggerOn",       fTriggerOn);
+	MM.lookupValue("TriggerOff",      fTriggerOff);
+	MM.lookupValue("EventPreSeconds", fEventPre);
+	MM.lookupValue("EventPostSeconds", fEventPost);
+	MM.lookupValue("EventMaxSeconds", fEventMax);
+	MM.lookupValue("EventDirectory",  fEventDirectory);
+	MM.lookupValue("RawLog",          fRawLog);
+	MM.lookupValue("FFTPlanner",      fFFTPlanner);
+	MM.lookupValue("SinglePrecision", fSinglePrecision);
+	MM.lookupValue("FFTThreads",      fFFTThreads);
+	MM.lookupValue("Source",          fSourceName);
+	MM.lookupValue("ReplayFile",      fReplayFile);
+	MM.lookupValue("ReplaySpeed",     fReplaySpeed);
+	MM.lookupValue("ReplayLoop",      fReplayLoop);
+	MM.lookupValue("ReplaySeconds",   fReplaySeconds);
+	MM.lookupValue("SyntheticChannels", fSyntheticChannels);
+	MM.lookupValue("SyntheticTone",   fSyntheticTone);
+	MM.lookupValue("SyntheticLevel",  fSyntheticLevel);
+	MM.lookupValue("SyntheticNoise",  fSyntheticNoise);
+	MM.lookupValue("BatchThreads",    fBatchThreads);
+	MM.lookupValue("BatchOutput",     fBatchOutput);
     }
     catch(const SettingNotFoundException &nfex)
     {
@@ -822,13 +2196,94 @@ bool MainModule::WriteConfiguration(void)
     Setting &MM = root.add("MainModule", Setting::TypeGroup);
     MM.add("Debug",           Setting::TypeInt)     = 0;
     MM.add("Logging",         Setting::TypeBoolean) = true;
-    MM.add("SampleRate",      Setting::TypeInt)     = fSampleRate;
+    // Not a replayed file's rate.
+    MM.add("SampleRate",      Setting::TypeInt)     = fConfigRate;
     MM.add("FramesPerBuffer", Setting::TypeInt)     = fFramesPerBuffer;
     MM.add("NSeconds",        Setting::TypeInt)     = fNSeconds;
     MM.add("InputDevice",     Setting::TypeInt)     = fInput;
     MM.add("OutputDevice",    Setting::TypeInt)     = fOutput;
     MM.add("DefaultIO",       Setting::TypeBoolean) = fDefault;
     MM.add("Volume",          Setting::TypeInt)     = fVolume;
+    MM.add("Continuous",      Setting::TypeBoolean) = fContinuous;
+    MM.add("RingSeconds",     Setting::TypeInt)     = fRingSeconds;
+    MM.add("WriteBuffers",    Setting::TypeInt)     = fWriteBuffers;
+    MM.add("WriteBufferKB",   Setting::TypeInt)     = fWriteBufferKB;
+    MM.add("Compress",        Setting::TypeBoolean) = fCompress;
+    MM.add("CompressFrames",  Setting::TypeInt)     = fCompressFrames;
+    MM.add("H5Log",           Setting::TypeBoolean) = fH5Enable;
+    MM.add("H5Deflate",       Setting::TypeInt)     = fH5Deflate;
+    MM.add("H5ChunkFrames",   Setting::TypeInt)     = fH5ChunkFrames;
+    MM.add("SpectrumLog",     Setting::TypeBoolean) = fSpectrumLog;
+    MM.add("SpectrumBatch",   Setting::TypeInt)     = fSpectrumBatch;
+    MM.add("BlockLog",        Setting::TypeBoolean) = fBlockLogEnable;
+    MM.add("CallbackStats",   Setting::TypeBoolean) = fCallbackStats;
+    MM.add("CallbackStatsSeconds", Setting::TypeInt) = fCallbackStatsSeconds;
+    MM.add("Stats",           Setting::TypeBoolean) = fStatsEnable;
+    MM.add("StatsSeconds",    Setting::TypeInt)     = fStatsSeconds;
+    MM.add("ClipLevel",       Setting::TypeInt)     = fClipLevel;
+    MM.add("Welch",           Setting::TypeBoolean) = fWelchEnable;
+    MM.add("WelchSegment",    Setting::TypeInt)     = fWelchSegment;
+    MM.add("WelchOverlap",    Setting::TypeInt)     = fWelchOverlap;
+    MM.add("WelchWindow",     Setting::TypeString)  = fWelchWindow;
+    MM.add("WelchSeconds",    Setting::TypeFloat)   = fWelchSeconds;
+    MM.add("Spectrogram",     Setting::TypeBoolean) = fSTFTEnable;
+    MM.add("SpectrogramSegment", Setting::TypeInt)  = fSTFTSegment;
+    MM.add("SpectrogramHop",  Setting::TypeInt)     = fSTFTHop;
+    MM.add("SpectrogramWindow", Setting::TypeString) = fSTFTWindow;
+    MM.add("SpectrogramDB",   Setting::TypeBoolean) = fSTFTDecibels;
+    MM.add("SpectrogramFormat", Setting::TypeString) = fSTFTFormat;
+    MM.add("SpectrogramMin",  Setting::TypeFloat)   = fSTFTMin;
+    MM.add("SpectrogramMax",  Setting::TypeFloat)   = fSTFTMax;
+    MM.add("SpectrogramTile", Setting::TypeInt)     = fSTFTTile;
+    MM.add("ToneTrack",       Setting::TypeBoolean) = fToneEnable;
+    Setting &tones = MM.add("Tones", Setting::TypeArray);
+    for (size_t i=0; i<fTones.size(); i++)
+    {
+        tones.add(Setting::TypeFloat) = fTones[i];
+    }
+    MM.add("ToneSeconds",     Setting::TypeFloat)   = fToneSeconds;
+    MM.add("ToneReportSeconds", Setting::TypeInt)   = fToneReportSeconds;
+    Setting &factors = MM.add("Decimation", Setting::TypeArray);
+    for (size_t i=0; i<fDecimation.size(); i++)
+    {
+        factors.add(Setting::TypeInt) = fDecimation[i];
+    }
+    MM.add("DecimationPassband", Setting::TypeFloat) = fDecimationPassband;
+    MM.add("DecimationAttenuation", Setting::TypeFloat) = fDecimationAttenuation;
+    MM.add("Octave",          Setting::TypeBoolean) = fOctaveEnable;
+    MM.add("OctaveFraction",  Setting::TypeInt)     = fOctaveFraction;
+    MM.add("OctaveLow",       Setting::TypeFloat)   = fOctaveLow;
+    MM.add("OctaveHigh",      Setting::TypeFloat)   = fOctaveHigh;
+    MM.add("OctaveOrder",     Setting::TypeInt)     = fOctaveOrder;
+    MM.add("OctaveSeconds",   Setting::TypeFloat)   = fOctaveSeconds;
+    MM.add("Filter",          Setting::TypeString)  = fFilterType;
+    MM.add("FilterOrder",     Setting::TypeInt)     = fFilterOrder;
+    MM.add("FilterLow",       Setting::TypeFloat)   = fFilterLow;
+    MM.add("FilterHigh",      Setting::TypeFloat)   = fFilterHigh;
+    MM.add("Trigger",         Setting::TypeBoolean) = fTriggerEnable;
+    MM.add("TriggerSTA",      Setting::TypeFloat)   = fTriggerSTA;
+    MM.add("TriggerLTA",      Setting::TypeFloat)   = fTriggerLTA;
+    MM.add("TriggerOn",       Setting::TypeFloat)   = fTriggerOn;
+    MM.add("TriggerOff",      Setting::TypeFloat)   = fTriggerOff;
+    MM.add("EventPreSeconds", Setting::TypeFloat)   = fEventPre;
+    MM.add("EventPostSeconds", Setting::TypeFloat)  = fEventPost;
+    MM.add("EventMaxSeconds", Setting::TypeFloat)   = fEventMax;
+    MM.add("EventDirectory",  Setting::TypeString)  = fEventDirectory;
+    MM.add("RawLog",          Setting::TypeBoolean) = fRawLog;
+    MM.add("FFTPlanner",      Setting::TypeString)  = fFFTPlanner;
+    MM.add("SinglePrecision", Setting::TypeBoolean) = fSinglePrecision;
+    MM.add("FFTThreads",      Setting::TypeInt)     = fFFTThreads;
+    MM.add("Source",          Setting::TypeString)  = fSourceName;
+    MM.add("ReplayFile",      Setting::TypeString)  = fReplayFile;
+    MM.add("ReplaySpeed",     Setting::TypeFloat)   = fReplaySpeed;
+    MM.add("ReplayLoop",      Setting::TypeBoolean) = fReplayLoop;
+    MM.add("ReplaySeconds",   Setting::TypeInt)     = fReplaySeconds;
+    MM.add("SyntheticChannels", Setting::TypeInt)   = fSyntheticChannels;
+    MM.add("SyntheticTone",   Setting::TypeFloat)   = fSyntheticTone;
+    MM.add("SyntheticLevel",  Setting::TypeFloat)   = fSyntheticLevel;
+    MM.add("SyntheticNoise",  Setting::TypeFloat)   = fSyntheticNoise;
+    MM.add("BatchThreads",    Setting::TypeInt)     = fBatchThreads;
+    MM.add("BatchOutput",     Setting::TypeString)  = fBatchOutput;
     // Write out the new configuration.
     try
     {
@@ -898,6 +2353,232 @@ void MainModule::EnumerateAvailable(void)
     
     SET_DEBUG_STACK;
 }
+/**
+ ******************************************************************
+ *
+ * Function Name : Batch
+ *
+ * Description : -f, analyse recorded .acc files offline with the
+ *               configured Welch settings, BatchThreads at a time.
+ *
+ * Inputs : Pattern - directory or glob
+ *
+ * Returns : true if any file was analysed
+ *
+ * Error Conditions : ENO_FILE if nothing could be done
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool MainModule::Batch(const char *Pattern)
+{
+    SET_DEBUG_STACK;
+    ClearError(__LINE__);
+    BatchAnalysis batch(fWelchSegment, fWelchOverlap,
+                        Welch::WindowType(fWelchWindow.c_str()),
+                        fBatchThreads);
+    batch.SetOutput(fBatchOutput.c_str());
+    if (!batch.Run(Pattern))
+    {
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    printf("%u files, %.2f files/s, %.1f MB/s\n", batch.Files(),
+           batch.Files() / batch.Seconds(),
+           batch.Bytes() / 1.0e6 / batch.Seconds());
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WarmWisdom
+ *
+ * Description : Plan every FFT size the configuration uses,
+ *               with the configured effort, and save the wisdom. Run
+ *               once after changing SampleRate, NSeconds or the Welch
+ *               segment so a normal start does not pay for planning.
+ *               Runs on an offline module, so nothing has planned
+ *               yet and no data files are made. The channels and
+ *               rate come from the configured source and decimation,
+ *               as the live constructor works them out.
+ *
+ * Inputs : none
+ *
+ * Returns : true if every size planned
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool MainModule::WarmWisdom(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    bool     rc = true;
+    double   dt, wall;
+    int32_t  sizes[3];
+    bool     single[3];
+    int      threads[3];
+    int32_t  n = 0;
+    int32_t  rate = fSampleRate;
+    uint32_t nchan, total = 1;
+    AudioSource *source;
+    std::chrono::steady_clock::time_point t0;
+
+    /*
+     * Offline, so work out the shape a live start would have. The
+     * source is only asked, never opened, PortAudio just to look at
+     * the device. The destructor balances the Pa_Initialize.
+     */
+    (void) Pa_Initialize();
+    source = CreateSource();
+    if (source == NULL)
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'W', "No usable audio source.");
+        SET_DEBUG_STACK;
+        return false;
+    }
+    if (!source->Live() && (source->SampleRate() > 0.0))
+    {
+        rate = (int32_t) source->SampleRate();
+    }
+    nchan = source->NChannels();
+    delete source;
+    if (!fDecimation.empty())
+    {
+        vector<uint32_t> factors;
+        for (int32_t f : fDecimation)
+        {
+            factors.push_back((f > 0) ? f : 0);
+            total *= (f > 0) ? f : 0;
+        }
+        Decimator dec(nchan, rate);
+        if ((total > 1) && ((rate % total) == 0) &&
+            dec.Design(factors, fDecimationPassband, fDecimationAttenuation))
+        {
+            rate /= total;
+        }
+    }
+
+    // Welch always accumulates in double, on one thread.
+    single[n]  = fSinglePrecision;
+    threads[n] = Wisdom::ThreadCount(fFFTThreads);
+    sizes[n++] = fNSeconds * rate;
+    if (fWelchEnable)
+    {
+        single[n]  = false;
+        threads[n] = 1;
+        sizes[n++] = fWelchSegment;
+    }
+    // The spectrogram is float, one thread, and only runs continuous.
+    if (fContinuous && fSTFTEnable)
+    {
+        single[n]  = true;
+        threads[n] = 1;
+        sizes[n++] = (fSTFTSegment < 2) ? 2 : fSTFTSegment;
+    }
+    pLogger->Log("# Warming FFTW wisdom in %s, effort %s\n",
+                 Wisdom::Directory(), Wisdom::Effort());
+    for (int32_t i=0; i<n; i++)
+    {
+        // Wall time too, a plan found in wisdom still costs the import.
+        t0   = std::chrono::steady_clock::now();
+        dt   = Wisdom::Warm(sizes[i], nchan, single[i], threads[i]);
+        wall = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+        if (dt < 0.0)
+        {
+            pLogger->LogError(__FILE__, __LINE__, 'W', "Planning failed.");
+            rc = false;
+        }
+        pLogger->Log("# Wisdom N = %d x %u, planning took %f s, %f s in all\n",
+                     sizes[i], nchan, dt, wall);
+        cout << "Wisdom N = " << sizes[i] << " x " << nchan
+             << " planned in " << dt << " s, " << wall << " s in all" << endl;
+    }
+    SET_DEBUG_STACK;
+    return rc;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : CreateSource
+ *
+ * Description : The AudioSource named by Source in the
+ *               configuration. Replays take their channels and rate
+ *               from the file header.
+ *
+ * Inputs : none
+ *
+ * Returns : the source, NULL if it could not be set up
+ *
+ * Error Conditions : the reason is logged
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+AudioSource* MainModule::CreateSource(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    AudioSource  *rc;
+    ReplaySource *replay;
+    int           kind = ReplaySource::Kind(fSourceName.c_str());
+
+    if (kind < 0)
+    {
+        if (strcasecmp(fSourceName.c_str(), "portaudio") != 0)
+        {
+            pLogger->Log("# Unknown Source %s, using portaudio\n",
+                         fSourceName.c_str());
+        }
+        rc = new PortAudioSource(fInput);
+    }
+    else
+    {
+        if (kind == ReplaySource::kSynthetic)
+        {
+            replay = new ReplaySource(fSyntheticChannels, fSampleRate,
+                                      fSyntheticTone, fSyntheticLevel,
+                                      fSyntheticNoise);
+        }
+        else
+        {
+            replay = new ReplaySource(kind, fReplayFile.c_str());
+        }
+        replay->SetSpeed(fReplaySpeed);
+        replay->SetLoop(fReplayLoop);
+        if (fReplaySeconds > 0)
+        {
+            double rate = (replay->SampleRate() > 0.0) ?
+                replay->SampleRate() : fSampleRate;
+            replay->SetMaxFrames((uint64_t) (fReplaySeconds * rate));
+        }
+        rc = replay;
+    }
+    if ((rc->Error() != 0) || (rc->NChannels() == 0))
+    {
+        delete rc;
+        rc = NULL;
+    }
+    SET_DEBUG_STACK;
+    return rc;
+}
 /**
  ******************************************************************
  *
@@ -947,7 +2628,7 @@ bool MainModule::ScanRateSupported(void)
     outputParameters.suggestedLatency = Pa_GetDeviceInfo( fOutput)->defaultLowOutputLatency;
 
     PaError err = Pa_IsFormatSupported( &inputParameters, &outputParameters,
-					 (double) fSampleRate);
+					 (double) fCaptureRate);
     if (err == paFormatIsSupported)
     {
         pLogger->Log("# Format supported!\n");
@@ -1001,13 +2682,223 @@ bool MainModule::SetVolume(void)
 /**
  ******************************************************************
  *
- * Function Name : 
+ * Function Name : OpenSpectrumFiles
  *
- * Description :
+ * Description : Start new spectral product files named after the
+ *               data file. Records already batched go to the old files
+ *               as they close. The spectrogram and the octave bands
+ *               have their own switches, the rest need SpectrumLog.
  *
- * Inputs :
+ * Inputs : name - data file name
  *
- * Returns :
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::OpenSpectrumFiles(const char *name)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    string   file;
+
+    if (fWelch && fSpectrumLog)
+    {
+        if (!fPSDLog)
+        {
+            fPSDLog = new SpectrumFile(fNChannels, fWelch->NBins(),
+                                       fSpectrumBatch);
+            fPSDLog->SetKind((fWelch->GetScaling() == Welch::kDensity) ?
+                             SpectrumFile::kPSD : SpectrumFile::kPower);
+            fPSDLog->SetSampleRate(fSampleRate);
+            fPSDLog->SetFFTLength(fWelch->Segment());
+            fPSDLog->SetAverages(fWelch->Averages());
+            fPSDLog->SetOverlap(fWelch->Overlap());
+            fPSDLog->SetWindow(Welch::WindowName(fWelch->Window()));
+            fPSDLog->SetNote(fNote);
+        }
+        file = Extension(name, ".psd");
+        if (!fPSDLog->Open(file.c_str()))
+        {
+            pLogger->LogError(__FILE__,__LINE__, 'W',
+                              "Error opening PSD file");
+        }
+    }
+    // Whole record spectra only exist in one shot mode.
+    if (!fContinuous && fAnalysis && fSpectrumLog)
+    {
+        if (!fSpecLog)
+        {
+            fSpecLog = new SpectrumFile(fNChannels, fAnalysis->NBins(),
+                                        fSpectrumBatch);
+            fSpecLog->SetKind(SpectrumFile::kPower);
+            fSpecLog->SetSampleRate(fSampleRate);
+            fSpecLog->SetFFTLength(fAnalysis->ArraySize());
+            fSpecLog->SetWindow("rectangular");
+            fSpecLog->SetNote(fNote);
+        }
+        file = Extension(name, ".spc");
+        if (!fSpecLog->Open(file.c_str()))
+        {
+            pLogger->LogError(__FILE__,__LINE__, 'W',
+                              "Error opening spectrum file");
+        }
+    }
+    if (fSTFT)
+    {
+        if (!fSTFTLog)
+        {
+            fSTFTLog = new SpectrogramFile(fNChannels, fSTFT->NBins(),
+                           fSTFTTile,
+                           SpectrogramFile::FormatType(fSTFTFormat.c_str()));
+            fSTFTLog->SetSampleRate(fSampleRate);
+            fSTFTLog->SetFFTLength(fSTFT->Segment());
+            fSTFTLog->SetHop(fSTFT->Hop());
+            fSTFTLog->SetWindow(Welch::WindowName(fSTFT->Window()));
+            fSTFTLog->SetDecibels(fSTFT->Decibels());
+            fSTFTLog->SetRange(fSTFTMin, fSTFTMax);
+            fSTFTLog->SetNote(fNote);
+        }
+        file = Extension(name, ".stft");
+        if (!fSTFTLog->Open(file.c_str()))
+        {
+            pLogger->LogError(__FILE__,__LINE__, 'W',
+                              "Error opening spectrogram file");
+        }
+    }
+    if (fOctave)
+    {
+        if (!fOctaveLog)
+        {
+            vector<double> centre;
+            for (uint32_t b=0; b<fOctave->NBands(); b++)
+            {
+                centre.push_back(fOctave->Centre(b));
+            }
+            fOctaveLog = new SpectrumFile(fNChannels, fOctave->NBands(),
+                                          fSpectrumBatch);
+            fOctaveLog->SetKind(SpectrumFile::kLeq);
+            fOctaveLog->SetSampleRate(fSampleRate);
+            fOctaveLog->SetFFTLength(0);
+            fOctaveLog->SetAverages(fOctave->Interval());
+            fOctaveLog->SetWindow(fOctave->Fraction() == 1 ? "octave" :
+                                  "third-octave");
+            fOctaveLog->SetFrequencies(centre);
+            fOctaveLog->SetNote(fNote);
+        }
+        file = Extension(name, ".oct");
+        if (!fOctaveLog->Open(file.c_str()))
+        {
+            pLogger->LogError(__FILE__,__LINE__, 'W',
+                              "Error opening octave band file");
+        }
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : StampH5
+ *
+ * Description : Put the header fields on the HDF5 dataset as typed
+ *               attributes, FirstSample and FirstTime locate the file
+ *               in the stream exactly as in the .acc header.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::StampH5(void)
+{
+    SET_DEBUG_STACK;
+    time_t now;
+    char   msg[64];
+
+    time(&now);
+    strftime (msg, sizeof(msg), "%F %T", gmtime(&now));
+    fH5Log->SetAttribute("Created",         string(msg));
+    fH5Log->SetAttribute("Input",           fInput);
+    fH5Log->SetAttribute("Output",          fOutput);
+    fH5Log->SetAttribute("FramesPerBuffer", fFramesPerBuffer);
+    fH5Log->SetAttribute("SampleRate",      fSampleRate);
+    fH5Log->SetAttribute("Decimation",      fCaptureRate / fSampleRate);
+    fH5Log->SetAttribute("NChannels",       (int32_t) fNChannels);
+    fH5Log->SetAttribute("Volume",          fVolume);
+    fH5Log->SetAttribute("FirstSample",     fFirstSample);
+    fH5Log->SetAttribute("FirstTime",
+                         fStartTime + (double) fFirstSample / (double) fSampleRate);
+    fH5Log->SetAttribute("Note",            string(fNote ? fNote : ""));
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FormatBlockHeader
+ *
+ * Description : ASCII header for the .blk file. Records follow at
+ *               kHeaderSize, 32 bytes each, in callback order.
+ *
+ * Inputs : header - kHeaderSize bytes to fill
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void MainModule::FormatBlockHeader(char *header)
+{
+    SET_DEBUG_STACK;
+    char first[32];
+    snprintf(first, sizeof(first), "%.6f",
+             fStartTime + (double) fFirstSample / (double) fSampleRate);
+    memset(header, 0, kHeaderSize);
+    snprintf(header, kHeaderSize,
+             "BlockFile: 1\n"
+             "SampleRate: %d\n"
+             "FramesPerBuffer: %d\n"
+             "FirstSample: %lu\n"
+             "FirstTime: %s\n"
+             "HeaderBytes: %u\n"
+             "RecordBytes: %lu\n"
+             "Record: <f8 AdcTime, <f8 WallTime, <u8 Frame, <u4 NFrames, <u4 Flags\n",
+             fCaptureRate, fFramesPerBuffer,
+             (unsigned long) fFirstSample * (fCaptureRate / fSampleRate),
+             first, kHeaderSize, (unsigned long) sizeof(BlockInfo));
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FormatLogHeader
+ *
+ * Description : Build the fixed size ASCII header, FirstSample and
+ *               FirstTime locate the file exactly in the stream so
+ *               consecutive files concatenate without gaps.
+ *
+ * Inputs : header - kHeaderSize bytes to fill
+ *
+ * Returns : none
  *
  * Error Conditions :
  * 
@@ -1018,26 +2909,19 @@ bool MainModule::SetVolume(void)
  *
  *******************************************************************
  */
-bool MainModule::WriteLogHeader(void)
+void MainModule::FormatLogHeader(char *header)
 {
     SET_DEBUG_STACK;
-    static const uint32_t HEADER_SIZE = 256;
-    ClearError(__LINE__);
-    char zeros[HEADER_SIZE];
     ostringstream oss;
-    bool rc = true;
-    ClearError(__LINE__);
 
     oss << *this;
     int32_t n = oss.tellp();
-    fDataLog->write(oss.str().data(), n);
-    
-    // Calculate the number of zeros to write.
-    n = HEADER_SIZE - n;
-    memset(zeros, 0, sizeof(zeros));
-    fDataLog->write( zeros, n);
+    if (n > (int32_t) kHeaderSize) n = kHeaderSize;
+
+    // Pad out with zeros.
+    memset(header, 0, kHeaderSize);
+    memcpy(header, oss.str().data(), n);
     SET_DEBUG_STACK;
-    return rc;
 }
 /**
  ******************************************************************
@@ -1065,21 +2949,29 @@ ostream& operator<<(ostream& os, const MainModule &mm)
     time_t now;
     char msg[64];
     char note[64];
+    char first[32];
     
     time(&now);
     strftime (msg, sizeof(msg), "%F %T", gmtime(&now));
+    // UTC seconds of the first frame in the file.
+    snprintf(first, sizeof(first), "%.6f",
+             mm.fStartTime + (double) mm.fFirstSample / (double) mm.fSampleRate);
     
     os << "Created: " << msg << endl
        << "Input: " << mm.fInput << endl
        << "Output: " << mm.fOutput << endl
        << "FramesPerBuffer: " << mm.fFramesPerBuffer << endl
        << "SampleRate: " << mm.fSampleRate << endl
+       << "Decimation: " << mm.fCaptureRate / mm.fSampleRate << endl
+       << "Compression: " << (mm.fCompress ? AccCodec::kName : "none") << endl
        << "NChannels: " << mm.fData.nChannels << endl
        << "Volume: " << mm.fVolume << endl
+       << "FirstSample: " << mm.fFirstSample << endl
+       << "FirstTime: " << first << endl
        << "Note: " ;
     if (mm.fNote)
     {
-        // Truncate note.
+        // Truncate note, whatever is left of the header.
         memset (note, 0, sizeof(note));
         strncpy( note, mm.fNote, sizeof(note));
         os << note;
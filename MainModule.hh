@@ -11,6 +11,21 @@
  *
  * Change Descriptions :
  * 26-Sep-25 CBL Added in include cstdint
+ * 17-Oct-26 CBL Continuous acquisition through an SPSC ring buffer.
+ *               Data log is written by an asynchronous DataWriter.
+ *               Sample accurate rotation, header carries first sample.
+ *               Streaming Welch PSD.
+ *               FFTW wisdom store and -w pre-warm.
+ *               Samples come from an AudioSource, live or replayed.
+ *               Offline batch analysis of .acc files.
+ *               StreamStats replaces the second pass in Stats.
+ *               STA/LTA triggered event files, raw log optional.
+ *               Rolling STFT spectrogram to a tiled file.
+ *               Goertzel tone trackers.
+ *               Biquad filter ahead of the analysis.
+ *               Fractional octave band Leq series.
+ *               Polyphase FIR decimation after capture.
+ *               Lossless compression of the .acc samples.
  *
  * Classification : Unclassified
  *
@@ -22,26 +37,81 @@
 #ifndef __MAINMODULE_hh_
 #define __MAINMODULE_hh_
 #  include <cstdint>
+#  include <atomic>
+#  include <thread>
+#  include <string>
+#  include <vector>
 #  include "CObject.hh" // Base class with all kinds of intermediate
 #  include "filename.hh"
 #  include "portaudio.h"
+#  include "RingBuffer.hh"
+#  include "CallbackStats.hh"
 
 class Analysis;
+class AudioSource;
+class DataWriter;
+class H5Writer;
+class SpectrumFile;
+class StreamStats;
+class EventCapture;
+class Spectrogram;
+class SpectrogramFile;
+class ToneBank;
+class BiquadFilter;
+class OctaveBank;
+class Decimator;
+class Welch;
 
 /* Select sample format. */
 #define PA_SAMPLE_TYPE  paInt16   // this is pretty important for buffer allocaiton. 
 typedef short SAMPLE;             // aka, here, this is a 16 bit wide
 #define SAMPLE_SILENCE  (0)       // defines no input. 
 
+/*
+ * One per callback, written to the .blk side stream. frame counts
+ * every frame the driver delivered, including any that had to be
+ * dropped, so adcTime against frame shows gaps and drift.
+ */
+typedef struct
+{
+    double      adcTime;     /* inputBufferAdcTime, PortAudio stream clock */
+    double      wallTime;    /* UTC when the callback ran */
+    uint64_t    frame;       /* First frame of the block in the stream */
+    uint32_t    nFrames;
+    uint32_t    flags;       /* PaStreamCallbackFlags and BLOCK_* below */
+}
+BlockInfo;
+#define BLOCK_NO_INPUT  0x100     // Driver gave us NULL, zeros logged.
+#define BLOCK_DROPPED   0x200     // Ring full, samples not logged.
+
 typedef struct
 {
     uint32_t    frameIndex;  /* Index into sample array. */
     uint32_t    maxFrameIndex;
     uint32_t    nChannels;
     SAMPLE      *recordedSamples;
+    BlockInfo   *blocks;     /* One per callback */
+    uint32_t    nBlocks;
+    uint32_t    maxBlocks;
+    CallbackStats *stats;    /* Timing, NULL for none */
 }
 paTestData;
 
+/*
+ * Continuous mode, the callback pushes every frame it gets into
+ * the ring and a processing thread drains it.
+ */
+typedef struct
+{
+    uint32_t          nChannels;
+    SPSCRing<SAMPLE> *ring;
+    std::atomic<bool> *run;     /* Callback completes when false. */
+    SPSCRing<BlockInfo> *blocks; /* Side stream, one per callback */
+    uint64_t          frames;   /* Frames delivered, callback only */
+    CallbackStats    *stats;    /* Timing, NULL for none */
+}
+paStreamData;
+
 
 class MainModule : public CObject
 {
@@ -54,8 +124,11 @@ public:
     /**
      * Constructor recording accelerometer data. 
      * All inputs are in configuration file. 
+     * Offline reads the configuration and nothing else, no audio
+     * device or log files, for Batch and WarmWisdom.
      */
-    MainModule(const char *ConfigFile, const char *Note=NULL);
+    MainModule(const char *ConfigFile, const char *Note=NULL,
+               bool Offline=false);
 
     /**
      * for main module
@@ -74,7 +147,7 @@ public:
     /**
      * Tell the program to stop. 
      */
-    void Stop(void) {fRun=false;};
+    void Stop(void) {fRun.store(false);};
 
     /**
      * Control bits - control verbosity of output
@@ -86,24 +159,56 @@ public:
     static const unsigned int kVerboseHexDump  = 0x0040;
     static const unsigned int kVerboseCharDump = 0x0080;
     static const unsigned int kVerboseMax      = 0x8000;
+
+    /*! Size of the ASCII header at the top of each .acc file. */
+    static const uint32_t kHeaderSize = 256;
   
     // Public Functions
     bool Record(void);
+    bool Acquire(void);
     bool Play(void);
-    void Stats(void);
     void EnumerateAvailable(void);
+    /*!
+     * Plan every configured FFT size so the wisdom is on disk.
+     */
+    bool WarmWisdom(void);
+    /*!
+     * Welch PSD and summary of every .acc file in a directory or
+     * matching a glob, spread over BatchThreads workers.
+     */
+    bool Batch(const char *Pattern);
 
     friend ostream& operator<<(ostream &os, const MainModule &mm);
   
 private:
     // Private Data
-    bool fRun;
+    std::atomic<bool> fRun;
     /*!
      * Tool to manage the file name. 
      */
     FileName*    fn;          /*! File nameing utilities. */
     bool         fChangeFile; /*! Tell the system to change the file name. */
-    ofstream    *fDataLog; 
+    DataWriter  *fDataLog;    /*! Asynchronous .acc writer. */
+    int32_t      fWriteBuffers;  /*! Number of writer buffers. */
+    int32_t      fWriteBufferKB; /*! Size of each in kB. */
+    bool         fCompress;      /*! .acc samples as AccCodec blocks. */
+    int32_t      fCompressFrames; /*! Frames per block. */
+    /*!
+     * Optional HDF5 copy of the samples, written from the
+     * processing thread alongside the .acc file.
+     */
+    H5Writer    *fH5Log;
+    bool         fH5Enable;
+    int32_t      fH5Deflate;     /*! gzip level, 0-9 */
+    int32_t      fH5ChunkFrames; /*! Frames per HDF5 chunk */
+    /*!
+     * Spectral products, named after the .acc file. Welch PSDs
+     * go to .psd, whole record power spectra to .spc.
+     */
+    SpectrumFile *fPSDLog;
+    SpectrumFile *fSpecLog;
+    bool          fSpectrumLog;
+    int32_t       fSpectrumBatch; /*! Records per write */
   
     /*! 
      * Configuration file name. 
@@ -119,27 +224,204 @@ private:
     paTestData fData;             /*! Data collected, read or playback. */
     uint32_t   fNSamples;         /*! Derived value. */
     int32_t    fTotalFrames;      /*! Derived value  */
-    int32_t    fSampleRate;       /*! Sample rate    */
+    int32_t    fSampleRate;       /*! Rate stored and analysed */
+    int32_t    fCaptureRate;      /*! Rate at the source, before decimation */
     int32_t    fFramesPerBuffer;
     int32_t    fNSeconds;         /*! Number of seconds of data to record. */
     int32_t    fInput;            /*! Input device   */
     int32_t    fOutput;           /*! Output device  */
     bool       fDefault;          /*! Use default IO if set to true */
     int32_t    fVolume;           /*! Set input volume level -- Calibrate */
+    uint32_t   fNChannels;        /*! Input channels on fInput */
+
+    /*!
+     * Where the samples come from. "portaudio" is fInput, "acc"
+     * and "wav" replay fReplayFile, "synthetic" makes tones.
+     */
+    AudioSource *fSource;
+    std::string  fSourceName;
+    std::string  fReplayFile;
+    double       fReplaySpeed;      /*! x real time, 0 as fast as possible */
+    bool         fReplayLoop;       /*! Start the file again at the end */
+    int32_t      fReplaySeconds;    /*! Stop after this much, 0 no limit */
+    int32_t      fSyntheticChannels;
+    double       fSyntheticTone;    /*! Hz, channel c at (c+1) times */
+    double       fSyntheticLevel;   /*! Fraction of full scale */
+    double       fSyntheticNoise;   /*! Fraction of full scale */
+    int32_t      fConfigRate;       /*! SampleRate as configured */
+
+    int32_t      fBatchThreads;     /*! -f workers, 0 per core */
+    std::string  fBatchOutput;      /*! -f products, "" next to input */
+
+    /*!
+     * Continuous acquisition.
+     */
+    bool              fContinuous;   /*! Run 24/7 rather than one shot */
+    int32_t           fRingSeconds;  /*! Depth of the capture ring */
+    SPSCRing<SAMPLE> *fRing;         /*! Callback -> processing thread */
+    paStreamData      fStream;       /*! Callback user data */
+    SAMPLE           *fBlock;        /*! Processing thread work block */
+    uint32_t          fBlockFrames;  /*! Frames per processing block */
+    uint64_t          fFrameCount;   /*! Frames processed since start */
+    double            fStartTime;    /*! UTC of frame 0, seconds */
+    uint64_t          fFirstSample;  /*! First frame in current file */
+    std::thread      *fProcess;      /*! Ring consumer */
+
+    /*!
+     * Per block timing and status, the .blk side stream.
+     */
+    SPSCRing<BlockInfo> *fBlockRing; /*! Callback -> processing thread */
+    DataWriter  *fBlockLog;
+    bool         fBlockLogEnable;
+    double       fLastAdcTime;       /*! End of the previous block */
+    uint64_t     fOverflows;         /*! Blocks flagged paInputOverflow */
+    uint64_t     fDroppedFrames;     /*! Frames lost to a full ring */
+    uint64_t     fGaps;              /*! ADC clock jumps */
+    double       fGapTime;           /*! Seconds missing in those jumps */
+
+    /*!
+     * Callback timing, published every fCallbackStatsSeconds.
+     */
+    CallbackStats *fRecordStats;
+    CallbackStats *fPlayStats;
+    bool           fCallbackStats;
+    int32_t        fCallbackStatsSeconds;
+
+    /*!
+     * Amplitude statistics of the input, kept per block, published
+     * every fStatsSeconds of data and for each data file.
+     */
+    StreamStats   *fStreamStats;
+    bool           fStatsEnable;
+    int32_t        fStatsSeconds;
+    int32_t        fClipLevel;
+    std::string    fStatsFile;       /*! What the kFile set covers */
 
     Analysis  *fAnalysis;         /*! tools to analyze data. */
+
+    /*!
+     * Streaming Welch PSD, runs on the processing thread.
+     */
+    Welch      *fWelch;
+    bool        fWelchEnable;
+    int32_t     fWelchSegment;    /*! Samples per segment */
+    int32_t     fWelchOverlap;    /*! Samples of overlap */
+    std::string fWelchWindow;     /*! hann, hamming, blackman, rectangular */
+    double      fWelchSeconds;    /*! Publish a PSD this often */
+
+    /*!
+     * Rolling STFT, on the processing thread, into a tiled .stft
+     * file named after the data file.
+     */
+    Spectrogram     *fSTFT;
+    SpectrogramFile *fSTFTLog;
+    bool        fSTFTEnable;
+    int32_t     fSTFTSegment;     /*! FFT length */
+    int32_t     fSTFTHop;         /*! Frames between columns */
+    std::string fSTFTWindow;      /*! As fWelchWindow */
+    bool        fSTFTDecibels;    /*! dB rather than magnitude */
+    std::string fSTFTFormat;      /*! f4, f2 or u1 */
+    double      fSTFTMin;         /*! u1 range */
+    double      fSTFTMax;
+    int32_t     fSTFTTile;        /*! Columns per tile */
+
+    /*!
+     * Amplitude and phase of a few known tones, both modes.
+     */
+    ToneBank   *fToneBank;
+    bool        fToneEnable;
+    std::vector<double> fTones;   /*! Hz */
+    double      fToneSeconds;     /*! Integration per estimate */
+    int32_t     fToneReportSeconds; /*! Log the latest this often */
+    uint64_t    fToneReported;    /*! Frame of the last report */
+
+    /*!
+     * Rate reduction between the capture and everything else, so
+     * the logs, files and analysis are all at fSampleRate =
+     * fCaptureRate / product of fDecimation.
+     */
+    Decimator  *fDecimator;
+    std::vector<int32_t> fDecimation;   /*! Factor per stage, in order */
+    double      fDecimationPassband;    /*! Flat to this x fSampleRate */
+    double      fDecimationAttenuation; /*! Stopband, dB */
+
+    /*!
+     * Octave or fractional octave band Leq, both modes, every
+     * fOctaveSeconds into a .oct file named after the data file.
+     */
+    OctaveBank   *fOctave;
+    SpectrumFile *fOctaveLog;
+    bool        fOctaveEnable;
+    int32_t     fOctaveFraction;  /*! 1 or 3 bands per octave */
+    double      fOctaveLow;       /*! Lowest midband, Hz */
+    double      fOctaveHigh;      /*! Highest midband, Hz */
+    int32_t     fOctaveOrder;     /*! Butterworth order per band */
+    double      fOctaveSeconds;   /*! Interval per Leq */
+
+    /*!
+     * Butterworth cascade applied in place before the analysis,
+     * both modes. The data and HDF5 logs keep the raw samples.
+     */
+    BiquadFilter *fFilter;
+    std::string fFilterType;      /*! none, highpass, lowpass, bandpass */
+    int32_t     fFilterOrder;     /*! Poles, per edge for band pass */
+    double      fFilterLow;       /*! High pass corner, Hz */
+    double      fFilterHigh;      /*! Low pass corner, Hz */
+
+    /*!
+     * STA/LTA triggered event files, on the processing thread.
+     * With fRawLog false only the events are kept.
+     */
+    EventCapture *fEvents;
+    bool        fTriggerEnable;
+    double      fTriggerSTA;      /*! Short window, s */
+    double      fTriggerLTA;      /*! Long window, s */
+    double      fTriggerOn;       /*! Ratio to start an event */
+    double      fTriggerOff;      /*! Ratio to count as quiet */
+    double      fEventPre;        /*! s kept before the trigger */
+    double      fEventPost;       /*! s of quiet before the end */
+    double      fEventMax;        /*! Longest event, s */
+    std::string fEventDirectory;
+    bool        fRawLog;          /*! Continuous .acc files */
+
+    std::string fFFTPlanner;      /*! estimate, measure, patient, exhaustive */
+    bool        fSinglePrecision; /*! float/fftwf whole record analysis */
+    int32_t     fFFTThreads;      /*! whole record FFT threads, 0 = per core */
     char      *fNote;
   
     /* Private functions. ==============================  */
 
     /*!
-     * Open the data logger. 
+     * Open the data logger, or rotate to a new file on the next
+     * frame if one is already open.
      */
     bool OpenLogFile(void);
     /*!
-     * Write header in log file.
+     * Fill in a kHeaderSize header for the file whose first
+     * frame is fFirstSample.
+     */
+    void FormatLogHeader(char *header);
+    /*!
+     * Same fields as the header, as typed attributes on the
+     * HDF5 sample dataset.
      */
-    bool WriteLogHeader(void);
+    void StampH5(void);
+    /*!
+     * Header for the .blk file, kHeaderSize bytes.
+     */
+    void FormatBlockHeader(char *header);
+    /*!
+     * Account for and log one callback's BlockInfo.
+     */
+    void RecordBlock(const BlockInfo &info);
+    /*!
+     * Open the spectral product files to go with the data file.
+     */
+    void OpenSpectrumFiles(const char *name);
+    /*!
+     * Note the time of frame 0.
+     */
+    void StampStart(void);
     /*!
      * Read the configuration file. 
      */
@@ -156,6 +438,57 @@ private:
 
     bool SetVolume(void);
 
+    /*!
+     * Build the configured AudioSource.
+     */
+    AudioSource* CreateSource(void);
+    /*!
+     * Replay at full speed waits on this so the ring never drops.
+     */
+    static bool RingReady(void *Arg, unsigned long Frames);
+    /*!
+     * Log frames per second through the pipeline.
+     */
+    void LogThroughput(uint64_t Frames, double Seconds);
+
+    /*!
+     * Drain the capture ring until told to stop.
+     */
+    void ProcessThread(void);
+    /*!
+     * Everything that happens to a block of frames once it is
+     * out of the ring.
+     */
+    void ProcessBlock(SAMPLE *samples, uint32_t nFrames);
+    /*!
+     * Amplitude statistics of a block before decimation.
+     */
+    void CaptureStats(const SAMPLE *samples, uint32_t nFrames);
+    /*!
+     * Roll over to a new data log file if it is time to. 
+     */
+    void CheckFileChange(void);
+    /*!
+     * Log the writer queue depth and stall time.
+     */
+    void LogWriterStats(void);
+    /*!
+     * Log overflow, drop and gap totals from the block stream.
+     */
+    void LogCaptureStats(void);
+    /*!
+     * A new averaged PSD is ready in fWelch.
+     */
+    void ReportPSD(void);
+    /*!
+     * Log the latest estimate of every tone in fToneBank.
+     */
+    void ReportTones(void);
+    /*!
+     * fOctave has finished an interval.
+     */
+    void ReportBands(void);
+
   
     /*! The static 'this' pointer. */
     static MainModule *fMainModule;
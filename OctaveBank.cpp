@@ -0,0 +1,524 @@
+/********************************************************************
+ *
+ * Module Name : OctaveBank.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Multirate fractional octave band levels.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstdint>
+#include <complex>
+
+// Local Includes.
+#include "OctaveBank.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : OctaveBank constructor
+ *
+ * Description : Pick the bands, give each the lowest rate it will
+ *               run at, design the band and decimation filters and
+ *               size the level buffers.
+ *
+ * Inputs : NChan      - channels per frame
+ *          SampleRate - Hz
+ *          Fraction   - bands per octave, odd
+ *          Low, High  - midband range, Hz
+ *          Order      - Butterworth order per band
+ *          Seconds    - interval per Leq
+ *
+ * Returns : none
+ *
+ * Error Conditions : none, no bands if the range is empty
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+OctaveBank::OctaveBank(uint32_t NChan, double SampleRate, uint32_t Fraction,
+                       double Low, double High, uint32_t Order,
+                       double Seconds)
+{
+    SET_DEBUG_STACK;
+    double   half, fm, rate;
+    int      x, level, levels = 1;
+    Band     b;
+    Stage    l;
+
+    fNChannels  = (NChan > 0) ? NChan : 1;
+    fSampleRate = SampleRate;
+    fFraction   = (Fraction > 0) ? (Fraction | 1) : 1;
+    fOrder      = (Order > 0) ? Order : 1;
+    fInterval   = (uint64_t) floor(Seconds * SampleRate + 0.5);
+    if (fInterval < 1) fInterval = 1;
+    fN          = 0;
+    fFirst      = 0;
+    fLast       = 0;
+    fCount      = 0;
+
+    // Bands by index from the lowest whose midband is in range.
+    half = pow(10.0, 0.3 / (2.0 * fFraction));
+    x    = (int) ceil(fFraction * log10(Low / 1000.0) / 0.3 - 1.0e-9);
+    for (; (fm = Midband(x, fFraction)) <= High * (1.0 + 1.0e-9); x++)
+    {
+        b.centre = fm;
+        b.lower  = fm / half;
+        b.upper  = fm * half;
+        if (b.upper >= kMaxEdge * fSampleRate) break;
+        level    = (int) floor(log2(kTop * fSampleRate / b.upper));
+        b.level  = (level > 0) ? level : 0;
+        if ((int) b.level + 1 > levels) levels = b.level + 1;
+        rate     = fSampleRate / (double) (1u << b.level);
+        BandPass(fOrder, b.lower, b.upper, rate, b.s);
+        b.z1.assign(fNChannels * b.s.size(), 0.0);
+        b.z2.assign(fNChannels * b.s.size(), 0.0);
+        b.sum.assign(fNChannels, 0.0);
+        b.n      = 0;
+        fBands.push_back(b);
+    }
+
+    // Each level low passes what it hands down at a third of the
+    // new Nyquist, well clear of the bands there.
+    for (int i=0; i<levels; i++)
+    {
+        rate = fSampleRate / (double) (1u << i);
+        l.s.clear();
+        if (i + 1 < levels) LowPass(6, 0.16 * rate, rate, l.s);
+        l.z1.assign(fNChannels * l.s.size(), 0.0);
+        l.z2.assign(fNChannels * l.s.size(), 0.0);
+        l.buf.assign(fNChannels * ((kChunk >> i) + 1), 0.0);
+        l.n     = 0;
+        l.phase = 0;
+        fLevels.push_back(l);
+    }
+    fLeq.assign(fNChannels * fBands.size(), kFloor);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : OctaveBank destructor
+ *
+ * Description : Nothing to do, the vectors look after themselves.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+OctaveBank::~OctaveBank(void)
+{
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Midband
+ *
+ * Description : Exact base ten midband frequency.
+ *
+ * Inputs : x        - band index, 0 is 1 kHz
+ *          Fraction - bands per octave
+ *
+ * Returns : Hz
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double OctaveBank::Midband(int x, uint32_t Fraction)
+{
+    return 1000.0 * pow(10.0, 0.3 * (double) x / (double) Fraction);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : BandPass
+ *
+ * Description : Analogue Butterworth prototype, low pass to band
+ *               pass with the edges prewarped, then the bilinear
+ *               transform. Each pole in the upper half plane is a
+ *               section, pairs of real poles near Nyquist share one.
+ *               Every section gets a zero at DC and one at Nyquist,
+ *               and is scaled to unit gain at the digital centre.
+ *
+ * Inputs : Order        - prototype order, sections out
+ *          Lower, Upper - -3 dB edges, Hz
+ *          Rate         - Hz
+ *          s            - sections, replaced
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void OctaveBank::BandPass(uint32_t Order, double Lower, double Upper,
+                          double Rate, vector<Section> &s)
+{
+    SET_DEBUG_STACK;
+    typedef complex<double> cplx;
+    double  t1 = tan(M_PI * Lower / Rate);
+    double  t2 = tan(M_PI * Upper / Rate);
+    double  w0 = 2.0 * Rate * sqrt(t1 * t2);
+    double  bw = 2.0 * Rate * (t2 - t1);
+    double  wc = 2.0 * atan(sqrt(t1 * t2));
+    cplx    p, d, z, e1 = polar(1.0, -wc), e2 = e1 * e1;
+    vector<double> real;
+    Section q;
+
+    s.clear();
+    for (uint32_t k=0; k<Order; k++)
+    {
+        p = polar(1.0, M_PI * (double) (2*k + 1 + Order) / (double) (2*Order));
+        d = sqrt(p * p * bw * bw - 4.0 * w0 * w0);
+        for (int sign=-1; sign<=1; sign+=2)
+        {
+            z = (2.0 * Rate + 0.5 * (p * bw + (double) sign * d)) /
+                (2.0 * Rate - 0.5 * (p * bw + (double) sign * d));
+            if (fabs(z.imag()) < 1.0e-12)
+            {
+                real.push_back(z.real());
+            }
+            else if (z.imag() > 0.0)
+            {
+                q.a1 = -2.0 * z.real();
+                q.a2 = norm(z);
+                s.push_back(q);
+            }
+        }
+    }
+    for (size_t i=0; i+1<real.size(); i+=2)
+    {
+        q.a1 = -(real[i] + real[i+1]);
+        q.a2 = real[i] * real[i+1];
+        s.push_back(q);
+    }
+    for (Section &v : s)
+    {
+        // (1 - z^-2) g / (1 + a1 z^-1 + a2 z^-2), |H(wc)| = 1
+        double g = abs((1.0 + v.a1*e1 + v.a2*e2) / (1.0 - e2));
+        v.b0 = g;
+        v.b1 = 0.0;
+        v.b2 = -g;
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : LowPass
+ *
+ * Description : Butterworth low pass, one section per pole pair,
+ *               Q from the pole angle.
+ *
+ * Inputs : Order  - even number of poles
+ *          Corner - -3 dB, Hz
+ *          Rate   - Hz
+ *          s      - sections, replaced
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void OctaveBank::LowPass(uint32_t Order, double Corner, double Rate,
+                         vector<Section> &s)
+{
+    SET_DEBUG_STACK;
+    double  w0   = 2.0 * M_PI * Corner / Rate;
+    double  cosw = cos(w0);
+    double  sinw = sin(w0);
+    double  alpha, a0;
+    Section q;
+
+    s.clear();
+    for (uint32_t i=0; i<Order/2; i++)
+    {
+        alpha = sinw * cos(M_PI * (double) (2*i + 1) / (double) (2*Order));
+        a0    = 1.0 + alpha;
+        q.b0  = 0.5 * (1.0 - cosw) / a0;
+        q.b1  = (1.0 - cosw) / a0;
+        q.b2  = q.b0;
+        q.a1  = -2.0 * cosw / a0;
+        q.a2  = (1.0 - alpha) / a0;
+        s.push_back(q);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Run
+ *
+ * Description : Transposed direct form II through every section,
+ *               in place on one channel.
+ *
+ * Inputs : s      - sections
+ *          z1, z2 - this channel's state, one per section
+ *          buf    - first sample of the channel
+ *          n      - frames
+ *          stride - samples between frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void OctaveBank::Run(vector<Section> &s, double *z1, double *z2,
+                     double *buf, uint32_t n, uint32_t stride)
+{
+    const uint32_t ns = s.size();
+    double x, y;
+
+    for (uint32_t i=0; i<n; i++, buf+=stride)
+    {
+        x = *buf;
+        for (uint32_t k=0; k<ns; k++)
+        {
+            y     = s[k].b0 * x + z1[k];
+            z1[k] = s[k].b1 * x - s[k].a1 * y + z2[k];
+            z2[k] = s[k].b2 * x - s[k].a2 * y;
+            x     = y;
+        }
+        *buf = x;
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Add
+ *
+ * Description : The block goes through in chunks that stop at
+ *               interval ends. Each chunk is converted once into the
+ *               top level, then level by level: the bands there sum
+ *               their squares, and the level is low passed and every
+ *               other frame handed down to the next.
+ *
+ * Inputs : frames  - interleaved samples
+ *          nFrames - frames in the block
+ *
+ * Returns : intervals completed
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t OctaveBank::Add(const int16_t *frames, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    const uint32_t nc   = fNChannels;
+    uint32_t       done = 0;
+    uint32_t       i = 0, m, c, j, k, ns;
+
+    if (fBands.empty()) return 0;
+    while (i < nFrames)
+    {
+        m = nFrames - i;
+        if (m > kChunk) m = kChunk;
+        if (m > fInterval - fN) m = fInterval - fN;
+
+        Stage &top = fLevels[0];
+        for (j=0; j<m*nc; j++) top.buf[j] = (double) frames[i*nc + j];
+        top.n = m;
+
+        for (size_t L=0; L<fLevels.size(); L++)
+        {
+            Stage &l = fLevels[L];
+            for (Band &b : fBands)
+            {
+                if (b.level != L) continue;
+                ns = b.s.size();
+                for (c=0; c<nc; c++)
+                {
+                    double *z1  = &b.z1[c*ns];
+                    double *z2  = &b.z2[c*ns];
+                    double *in  = &l.buf[c];
+                    double  sum = 0.0, x, y;
+                    for (j=0; j<l.n; j++)
+                    {
+                        x = in[j*nc];
+                        for (k=0; k<ns; k++)
+                        {
+                            y     = b.s[k].b0 * x + z1[k];
+                            z1[k] = b.s[k].b1 * x - b.s[k].a1 * y + z2[k];
+                            z2[k] = b.s[k].b2 * x - b.s[k].a2 * y;
+                            x     = y;
+                        }
+                        sum += x * x;
+                    }
+                    b.sum[c] += sum;
+                }
+                b.n += l.n;
+            }
+            if (L + 1 == fLevels.size()) break;
+
+            // Anti alias, then keep every other frame.
+            Stage &next = fLevels[L+1];
+            ns = l.s.size();
+            for (c=0; c<nc; c++)
+            {
+                Run(l.s, &l.z1[c*ns], &l.z2[c*ns], &l.buf[c], l.n, nc);
+            }
+            next.n = 0;
+            for (j=l.phase; j<l.n; j+=2, next.n++)
+            {
+                for (c=0; c<nc; c++)
+                {
+                    next.buf[next.n*nc + c] = l.buf[j*nc + c];
+                }
+            }
+            l.phase = (j - l.n);
+        }
+        Settle();
+        fN += m;
+        i  += m;
+        if (fN == fInterval)
+        {
+            Finish();
+            done++;
+        }
+    }
+    SET_DEBUG_STACK;
+    return done;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Finish
+ *
+ * Description : Mean square per band and channel to dB, then start
+ *               the next interval.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void OctaveBank::Finish(void)
+{
+    SET_DEBUG_STACK;
+    const uint32_t nb = fBands.size();
+    double ms;
+
+    for (uint32_t k=0; k<nb; k++)
+    {
+        Band &b = fBands[k];
+        for (uint32_t c=0; c<fNChannels; c++)
+        {
+            ms = (b.n > 0) ? b.sum[c] / (double) b.n : 0.0;
+            fLeq[c*nb + k] = (ms > 0.0) ? 10.0 * log10(ms) : kFloor;
+            if (fLeq[c*nb + k] < kFloor) fLeq[c*nb + k] = kFloor;
+            b.sum[c] = 0.0;
+        }
+        b.n = 0;
+    }
+    fLast   = fFirst;
+    fFirst += fInterval;
+    fN      = 0;
+    fCount++;
+    SET_DEBUG_STACK;
+}
+
+/**
+ ******************************************************************
+ *
+ * Function Name : Settle
+ *
+ * Description : State that has decayed to nothing is zeroed so a
+ *               silent input does not go denormal.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void OctaveBank::Settle(void)
+{
+    for (Band &b : fBands)
+    {
+        for (size_t j=0; j<b.z1.size(); j++)
+        {
+            if (fabs(b.z1[j]) < 1.0e-30) b.z1[j] = 0.0;
+            if (fabs(b.z2[j]) < 1.0e-30) b.z2[j] = 0.0;
+        }
+    }
+    for (Stage &l : fLevels)
+    {
+        for (size_t j=0; j<l.z1.size(); j++)
+        {
+            if (fabs(l.z1[j]) < 1.0e-30) l.z1[j] = 0.0;
+            if (fabs(l.z2[j]) < 1.0e-30) l.z2[j] = 0.0;
+        }
+    }
+}
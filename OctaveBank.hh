@@ -0,0 +1,161 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : OctaveBank.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Octave or fractional octave band levels, IEC 61260
+ *               style, as a running series of Leq per interval. Bands
+ *               are the base ten ones, midband
+ *
+ *                 fm = 1000 G^(x/b),  G = 10^(3/10)
+ *
+ *               for 1/b octave bands (b odd), edges fm G^(-+1/2b).
+ *               Each band is a Butterworth band pass of Order pole
+ *               pairs, -3 dB at its edges and 0 dB at its centre, as
+ *               Order biquads with their zeros at DC and Nyquist.
+ *
+ *               A band pass a fraction of an octave wide is hard work
+ *               at a rate hundreds of times its centre, so the bands
+ *               are run multirate. The stream is low passed and
+ *               halved once per octave down, and each band is run at
+ *               the lowest rate that keeps its upper edge below
+ *               kTop of that rate. Every level costs half the one
+ *               above, so the whole bank costs about twice its top
+ *               octave whatever the lowest band.
+ *
+ *               Squares are summed per band and channel over every
+ *               Seconds of input, then
+ *
+ *                 Leq = 10 log10(mean x^2)   dB re 1 count
+ *
+ * Restrictions/Limitations :
+ *   One thread. Bands are fixed at construction. Bands whose upper
+ *   edge is above kMaxEdge of the sample rate are left out.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   IEC 61260-1:2014, Electroacoustics - Octave-band and
+ *   fractional-octave-band filters.
+ *
+ *******************************************************************
+ */
+#ifndef __OCTAVEBANK_hh_
+#define __OCTAVEBANK_hh_
+#  include <cstdint>
+#  include <vector>
+
+class OctaveBank
+{
+public:
+    /*!
+     * NChan      - interleaved channels
+     * SampleRate - Hz
+     * Fraction   - 1 for octaves, 3 for thirds, any odd b
+     * Low, High  - midband frequencies to cover, Hz
+     * Order      - Butterworth order per band, 3 for class 1
+     * Seconds    - interval per Leq
+     */
+    OctaveBank(uint32_t NChan, double SampleRate, uint32_t Fraction=3,
+               double Low=1.0, double High=8000.0, uint32_t Order=3,
+               double Seconds=1.0);
+    ~OctaveBank(void);
+
+    /*!
+     * Run nFrames interleaved frames through the bank. Returns the
+     * number of intervals completed, the latest is held.
+     */
+    uint32_t Add(const int16_t *frames, uint32_t nFrames);
+
+    inline uint32_t NBands(void)    const {return fBands.size();};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    inline uint32_t NLevels(void)   const {return fLevels.size();};
+    inline uint32_t Fraction(void)  const {return fFraction;};
+    inline uint32_t Order(void)     const {return fOrder;};
+    inline double   Centre(uint32_t b) const {return fBands[b].centre;};
+    inline double   Lower(uint32_t b)  const {return fBands[b].lower;};
+    inline double   Upper(uint32_t b)  const {return fBands[b].upper;};
+    /*! Halvings of the sample rate the band runs at. */
+    inline uint32_t Level(uint32_t b)  const {return fBands[b].level;};
+    /*! Frames per interval. */
+    inline uint64_t Interval(void)  const {return fInterval;};
+    /*! Intervals completed. */
+    inline uint64_t Count(void)     const {return fCount;};
+    /*! Stream frame the latest interval began at. */
+    inline uint64_t FirstFrame(void) const {return fLast;};
+    /*! Latest Leq, dB, NChannels x NBands, channel major. */
+    inline const double* Leq(void)  const {return fLeq.data();};
+    inline double   Leq(uint32_t c, uint32_t b) const
+	{return fLeq[c*fBands.size() + b];};
+
+    /*! Exact midband frequency of band x, 0 is 1 kHz. */
+    static double   Midband(int x, uint32_t Fraction);
+
+    /*! Upper edges stay below this fraction of the level's rate. */
+    static constexpr double kTop     = 0.2;
+    /*! No band above this fraction of the sample rate. */
+    static constexpr double kMaxEdge = 0.45;
+    /*! Leq of an interval of zeros. */
+    static constexpr double kFloor   = -200.0;
+
+private:
+    /*! Frames converted and run through the levels at a time. */
+    static const uint32_t kChunk = 1024;
+
+    typedef struct
+    {
+        double b0, b1, b2, a1, a2;
+    } Section;
+
+    typedef struct
+    {
+        double   centre, lower, upper;
+        uint32_t level;
+        std::vector<Section> s;
+        std::vector<double>  z1, z2;   /*! Channel x Sections */
+        std::vector<double>  sum;      /*! Per channel, x^2 */
+        uint64_t n;                    /*! Samples in this interval */
+    } Band;
+
+    typedef struct
+    {
+        std::vector<Section> s;        /*! Anti alias low pass */
+        std::vector<double>  z1, z2;   /*! Channel x Sections */
+        std::vector<double>  buf;      /*! Frames at this rate */
+        uint32_t n;                    /*! Frames in buf */
+        uint32_t phase;                /*! Next sample kept if 0 */
+    } Stage;
+
+    /*! Butterworth band pass, -3 dB at Lower and Upper. */
+    static void BandPass(uint32_t Order, double Lower, double Upper,
+                         double Rate, std::vector<Section> &s);
+    /*! Butterworth low pass, even Order. */
+    static void LowPass(uint32_t Order, double Corner, double Rate,
+                        std::vector<Section> &s);
+    /*! Run one channel of buf through s in place. */
+    static void Run(std::vector<Section> &s, double *z1, double *z2,
+                    double *buf, uint32_t n, uint32_t stride);
+
+    /*! End of an interval, publish and start again. */
+    void Finish(void);
+    /*! Zero state too small to matter. */
+    void Settle(void);
+
+    uint32_t           fNChannels;
+    double             fSampleRate;
+    uint32_t           fFraction;
+    uint32_t           fOrder;
+    uint64_t           fInterval;
+    uint64_t           fN;          /*! Frames into this interval */
+    uint64_t           fFirst;      /*! Frame this interval began at */
+    uint64_t           fLast;       /*! Same for the published one */
+    uint64_t           fCount;
+    std::vector<Band>  fBands;
+    std::vector<Stage> fLevels;
+    std::vector<double> fLeq;
+};
+#endif
@@ -0,0 +1,300 @@
+/********************************************************************
+ *
+ * Module Name : PortAudioSource.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Live PortAudio input stream as an AudioSource.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References : paex_record.c
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+
+// Local Includes.
+#include "PortAudioSource.hh"
+#include "CLogger.hh"
+#include "debug.h"
+
+/* Same as PA_SAMPLE_TYPE in MainModule.hh */
+static const PaSampleFormat kFormat = paInt16;
+
+/**
+ ******************************************************************
+ *
+ * Function Name : PortAudioSource constructor
+ *
+ * Description : Look the device up for its channel count, rate
+ *               and latency. No stream yet.
+ *
+ * Inputs : Device - PortAudio device index
+ *
+ * Returns : none
+ *
+ * Error Conditions : ENO_DEVICE if there is no such device
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+PortAudioSource::PortAudioSource(int32_t Device) : AudioSource()
+{
+    SET_DEBUG_STACK;
+    SetName("PortAudioSource");
+    SetError(); // No error.
+
+    fDevice  = Device;
+    fLatency = 0.0;
+    fStream  = NULL;
+
+    const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo( fDevice );
+    if (deviceInfo == NULL)
+    {
+        SetError(ENO_DEVICE, __LINE__);
+        SET_DEBUG_STACK;
+        return;
+    }
+    fNChannels  = deviceInfo->maxInputChannels;
+    fSampleRate = deviceInfo->defaultSampleRate;
+    fLatency    = deviceInfo->defaultLowInputLatency;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : PortAudioSource destructor
+ *
+ * Description : Close any open stream.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+PortAudioSource::~PortAudioSource(void)
+{
+    SET_DEBUG_STACK;
+    Close();
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Open an input only stream on the device.
+ *
+ * Inputs : SampleRate      - frames per second
+ *          FramesPerBuffer - frames per callback
+ *          Callback        - called from the PortAudio thread
+ *          UserData        - handed to Callback
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_STREAM, PortAudio's reason is logged
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool PortAudioSource::Open(double SampleRate, uint32_t FramesPerBuffer,
+                           PaStreamCallback *Callback, void *UserData)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    PaStreamParameters  inputParameters;
+    PaError             err;
+
+    Close();
+    inputParameters.device = fDevice;
+    inputParameters.channelCount = fNChannels;
+    inputParameters.sampleFormat = kFormat;
+    inputParameters.suggestedLatency = fLatency;
+    inputParameters.hostApiSpecificStreamInfo = NULL;
+
+    err = Pa_OpenStream(
+              &fStream,
+              &inputParameters,
+              NULL,                  /* &outputParameters, */
+              SampleRate,
+              FramesPerBuffer,
+              paClipOff,      /* we won't output out of range samples so don't bother clipping them */
+              Callback,
+              UserData );
+    if( err != paNoError )
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', Pa_GetErrorText(err));
+        SetError(ENO_STREAM, __LINE__);
+        fStream = NULL;
+        SET_DEBUG_STACK;
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Start
+ *
+ * Description : Pa_StartStream
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_START
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool PortAudioSource::Start(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    PaError  err;
+
+    if (fStream == NULL)
+    {
+        SetError(ENO_STREAM, __LINE__);
+        return false;
+    }
+    err = Pa_StartStream( fStream );
+    if( err != paNoError )
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', Pa_GetErrorText(err));
+        SetError(ENO_START, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Stop
+ *
+ * Description : Pa_StopStream, waits for the buffers in flight.
+ *               Also needed after the callback returned paComplete.
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_STREAM
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool PortAudioSource::Stop(void)
+{
+    SET_DEBUG_STACK;
+    if (fStream == NULL) return true;
+    // A stream that finished with paComplete is inactive but still
+    // has to be stopped before it can be started again.
+    if (Pa_IsStreamStopped( fStream ) == 1) return true;
+    if (Pa_StopStream( fStream ) != paNoError)
+    {
+        SetError(ENO_STREAM, __LINE__);
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Pa_CloseStream, which aborts a running stream.
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_STREAM, PortAudio's reason is logged
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool PortAudioSource::Close(void)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    PaError  err;
+
+    if (fStream == NULL) return true;
+    err = Pa_CloseStream( fStream );
+    fStream = NULL;
+    if( err != paNoError )
+    {
+        pLogger->LogError(__FILE__, __LINE__, 'F', Pa_GetErrorText(err));
+        SetError(ENO_STREAM, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : IsActive
+ *
+ * Description : Pa_IsStreamActive
+ *
+ * Inputs : none
+ *
+ * Returns : 1 running, 0 not, negative PaError
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int PortAudioSource::IsActive(void)
+{
+    if (fStream == NULL) return 0;
+    return Pa_IsStreamActive( fStream );
+}
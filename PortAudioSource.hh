@@ -0,0 +1,47 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : PortAudioSource.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : AudioSource on a PortAudio input device, what
+ *               Record and Acquire used to do inline.
+ *
+ * Restrictions/Limitations :
+ *   Pa_Initialize must have been called.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __PORTAUDIOSOURCE_hh_
+#define __PORTAUDIOSOURCE_hh_
+#  include "AudioSource.hh"
+
+class PortAudioSource : public AudioSource
+{
+public:
+    /*! All the input channels of Device. */
+    PortAudioSource(int32_t Device);
+    ~PortAudioSource(void);
+
+    bool Open(double SampleRate, uint32_t FramesPerBuffer,
+              PaStreamCallback *Callback, void *UserData);
+    bool Start(void);
+    bool Stop(void);
+    bool Close(void);
+    int  IsActive(void);
+    inline bool Live(void) const {return true;};
+    inline const char* Name(void) const {return "portaudio";};
+
+private:
+    int32_t     fDevice;
+    PaTime      fLatency;   /*! Default low input latency */
+    PaStream   *fStream;
+};
+#endif
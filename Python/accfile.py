@@ -0,0 +1,229 @@
+#
+# Modified    By    Reason
+# --------    --    ------
+# 17-Oct-26   CBL   Original
+# 17-Oct-26   CBL   Compressed files, decoded as AccCodec does
+# 17-Oct-26   CBL   No good block is an error, as AccFile
+#
+# Read .acc recordings without copying, the Python side of AccFile.
+# The header is 256 bytes of "Key: value" lines, zero padded, then
+# interleaved little endian int16 frames.
+#
+#   hdr, x = ReadAccFile('2025Accelerometer072_00.acc')
+#   x[:, 0]                  channel 0, a strided view, nothing read yet
+#   Time(hdr, x)             UTC seconds of every frame
+#
+# With "Compression: rice" in the header the samples are AccCodec
+# blocks instead, see AccCodec.hh. They are decoded into memory, each
+# at the frame its header gives, so x looks the same either way.
+# Blocks that do not decode are left as zeros and hdr['BadBlocks']
+# says how many, a file without a single good block is an error. The Rice codes of a partition are found all at once:
+# from every bit position the end of the code starting there is known,
+# and repeated doubling of that jump gives where each code starts.
+#
+# ------------------------------------------------------------------
+import os
+import numpy as np
+
+HeaderBytes = 256
+
+# AccCodec block layout.
+Sync        = b'ACB\x01'
+BlockHeader = np.dtype([('sync', '<u4'), ('bytes', '<u4'), ('first', '<u8'),
+                        ('frames', '<u2'), ('channels', '<u2'),
+                        ('check', '<u4'), ('guard', '<u4')])
+Partition   = 256
+Escape      = 24
+Raw         = 20
+MaxK        = 19
+Verbatim    = 7
+
+def ReadAccHeader(Filename):
+    hdr = {}
+    with open(Filename, 'rb') as f:
+        raw = f.read(HeaderBytes)
+    for line in raw.split(b'\0')[0].decode('ascii').splitlines():
+        key, _, value = line.partition(':')
+        hdr[key.strip()] = value.strip()
+    for key in ('NChannels', 'FramesPerBuffer', 'FirstSample'):
+        hdr[key] = int(hdr.get(key, 0))
+    for key in ('SampleRate', 'FirstTime'):
+        hdr[key] = float(hdr.get(key, 0.0))
+    hdr.setdefault('Compression', 'none')
+    return hdr
+
+def ReadAccFile(Filename):
+    hdr    = ReadAccHeader(Filename)
+    nch    = hdr['NChannels']
+    if hdr['Compression'] == 'rice':
+        data = np.memmap(Filename, dtype=np.uint8, mode='r', offset=HeaderBytes)
+        x, hdr['BadBlocks'], good = Decode(data, nch)
+        if good == 0:
+            raise ValueError('%s: no good compressed block' % Filename)
+        return hdr, x
+    if hdr['Compression'] != 'none':
+        raise ValueError('%s: unknown Compression %s' % (Filename, hdr['Compression']))
+    frames = (os.path.getsize(Filename) - HeaderBytes) // (2 * nch)
+    x = np.memmap(Filename, dtype='<i2', mode='r', offset=HeaderBytes,
+                  shape=(frames, nch))
+    return hdr, x
+
+def Time(hdr, x):
+    return hdr['FirstTime'] + np.arange(x.shape[0]) / hdr['SampleRate']
+
+# ------------------------------------------------------------------
+# AccCodec decoder.
+
+def _Header(data, off):
+    """ Block header at off if it checks out, else None. """
+    if off + BlockHeader.itemsize > len(data) or bytes(data[off:off+4]) != Sync:
+        return None
+    h = np.frombuffer(data, BlockHeader, 1, off)[0]
+    first = int(h['first'])
+    guard = (int(h['sync']) ^ int(h['bytes']) ^ (first & 0xFFFFFFFF) ^
+             (first >> 32) ^ (int(h['frames']) | (int(h['channels']) << 16)) ^
+             int(h['check']) ^ 0x5A5A5A5A)
+    frames, channels, nbytes = int(h['frames']), int(h['channels']), int(h['bytes'])
+    if (guard != int(h['guard']) or frames == 0 or frames > 16384 or
+            channels == 0 or nbytes <= BlockHeader.itemsize or
+            nbytes > BlockHeader.itemsize + channels * (2 * frames + 1) + 8):
+        return None
+    return first, frames, channels, nbytes, int(h['check'])
+
+def _Check(x):
+    """ Fletcher style check of the interleaved samples, as AccCodec. """
+    w = x.reshape(-1).view(np.uint16).astype(np.uint64)
+    a = np.cumsum(w)
+    b = int(a.sum()) & 0xFFFFFFFF
+    return ((b << 16) ^ int(a[-1])) & 0xFFFFFFFF
+
+class _Bits:
+    """ Most significant first bit reader over one block. """
+    def __init__(self, payload):
+        self.bits = np.unpackbits(payload)
+        self.pos  = 0
+
+    def Get(self, n):
+        if self.pos + n > len(self.bits):
+            raise EOFError
+        v = 0
+        for b in self.bits[self.pos:self.pos + n]:
+            v = (v << 1) | int(b)
+        self.pos += n
+        return v
+
+    def Array(self, n, width):
+        """ n values of width bits. """
+        if self.pos + n * width > len(self.bits):
+            raise EOFError
+        b = self.bits[self.pos:self.pos + n * width].reshape(n, width)
+        self.pos += n * width
+        return b.astype(np.int64) @ (1 << np.arange(width - 1, -1, -1, dtype=np.int64))
+
+    def Rice(self, m, k):
+        """ m zig zag residuals with Rice parameter k. """
+        # Window for about k+2 bits a code, wider if that is short.
+        L = m * (k + 2) + 64
+        while True:
+            L = min(L, len(self.bits) - self.pos)
+            u, end = self._Rice(self.bits[self.pos:self.pos + L], m, k)
+            if end <= L:
+                self.pos += end
+                return u
+            if L == len(self.bits) - self.pos:
+                raise EOFError
+            L *= 2
+
+    @staticmethod
+    def _Rice(w, m, k):
+        L    = len(w)
+        i    = np.arange(L + 1)
+        # First zero at or after each position, L if none.
+        zero = np.where(np.append(w, 0) == 0, i, L)
+        zero = np.minimum.accumulate(zero[::-1])[::-1]
+        escape = (zero - i) >= Escape
+        jump = np.minimum(np.where(escape, i + Escape + Raw, zero + 1 + k), L)
+        # Start of code j is jump applied j times to 0, by doubling.
+        start = np.zeros(m, dtype=np.int64)
+        j     = np.arange(m)
+        t     = 0
+        while (1 << t) < m:
+            sel = ((j >> t) & 1).astype(bool)
+            start[sel] = jump[start[sel]]
+            jump = jump[jump]
+            t += 1
+        last = start[-1]
+        end  = last + Escape + Raw if escape[last] else zero[last] + 1 + k
+        if end > L:
+            return None, end
+        # The low bits, or the raw value after an escape.
+        win = np.lib.stride_tricks.sliding_window_view(
+            np.append(w, np.zeros(Raw, dtype=w.dtype)).astype(np.int64), Raw)
+        esc = escape[start]
+        u   = (zero[start] - start) << k
+        if k > 0:
+            u |= win[zero[start] + 1, :k] @ (1 << np.arange(k - 1, -1, -1))
+        if esc.any():
+            u[esc] = win[start[esc] + Escape] @ (1 << np.arange(Raw - 1, -1, -1))
+        return u, end
+
+def _Channel(bits, n):
+    order = bits.Get(3)
+    if order == Verbatim:
+        return bits.Array(n, 16).astype(np.uint16).view(np.int16).astype(np.int64)
+    if order > 3 or order > n:
+        raise ValueError
+    x = np.empty(n, dtype=np.int64)
+    x[:order] = bits.Array(order, 16).astype(np.uint16).view(np.int16)
+    for p in range(0, n, Partition):
+        lo = max(p, order)
+        hi = min(p + Partition, n)
+        k  = bits.Get(5)
+        if k > MaxK:
+            raise ValueError
+        if hi > lo:
+            u = bits.Rice(hi - lo, k)
+            x[lo:hi] = (u >> 1) ^ -(u & 1)
+    # Undo the predictor, one running sum per order.
+    carry = [np.diff(x[:order], j)[-1] for j in range(order)]
+    for j in reversed(range(order)):
+        x[order:] = np.cumsum(x[order:]) + carry[j]
+    return x
+
+def _Block(data, off, nch):
+    first, frames, channels, nbytes, check = _Header(data, off)
+    bits = _Bits(np.asarray(data[off + BlockHeader.itemsize:off + nbytes]))
+    x = np.empty((frames, nch), dtype=np.int16)
+    for c in range(nch):
+        x[:, c] = _Channel(bits, frames)
+    if _Check(x) != check:
+        raise ValueError
+    return x
+
+def _Blocks(data, nch):
+    """ (offset, first, frames) of every good header, in file order. """
+    off, n, blocks = 0, len(data), []
+    raw = data.tobytes() if isinstance(data, np.ndarray) else bytes(data)
+    while off < n:
+        h = _Header(data, off)
+        if h is not None and h[3] <= n - off and h[2] == nch and h[0] < 8 * n:
+            blocks.append((off, h[0], h[1]))
+            off += h[3]
+            continue
+        nxt = raw.find(Sync, off + 1)
+        off = n if nxt < 0 else nxt
+    return blocks
+
+def Decode(data, nch):
+    """ Frames x channels int16 from the AccCodec blocks in data, with
+        the bad and good block counts. """
+    blocks = _Blocks(data, nch)
+    frames = max([first + m for _, first, m in blocks], default=0)
+    x   = np.zeros((frames, nch), dtype=np.int16)
+    bad = 0
+    for off, first, m in blocks:
+        try:
+            x[first:first + m] = _Block(data, off, nch)
+        except (ValueError, EOFError, IndexError):
+            bad += 1
+    return x, bad, len(blocks) - bad
@@ -0,0 +1,75 @@
+#
+# Modified    By    Reason
+# --------    --    ------
+# 17-Oct-26   CBL   Original
+#
+# Read the tiled .stft spectrogram files written by SpectrogramFile.
+# The header is "Key: value" lines padded to HeaderBytes, followed by
+# whole tiles of TileColumns columns, so the file maps straight into
+# numpy and a time range only touches the tiles that cover it.
+#
+#   hdr, tiles = ReadSpectrogramFile('2025Accelerometer072_00.stft')
+#   t, S = ReadRange('2025Accelerometer072_00.stft', t0, t0 + 60.0)
+#   S[:, 0, :]               channel 0, one row per column, float32
+#   Frequency(hdr)           frequency axis
+#
+# ------------------------------------------------------------------
+import numpy as np
+
+def ReadSpectrogramHeader(Filename):
+    hdr = {}
+    with open(Filename, 'rb') as f:
+        raw = f.read(1024)
+    for line in raw.split(b'\0')[0].decode('ascii').splitlines():
+        key, _, value = line.partition(':')
+        hdr[key.strip()] = value.strip()
+    for key in ('NChannels', 'NBins', 'FFTLength', 'Hop', 'TileColumns',
+                'HeaderBytes', 'TileBytes'):
+        hdr[key] = int(hdr[key])
+    for key in ('SampleRate', 'BinWidth', 'ColumnSeconds', 'Min', 'Max'):
+        hdr[key] = float(hdr[key])
+    return hdr
+
+def TileType(hdr):
+    return np.dtype({'names':   ['Time', 'Frame', 'Columns', 'Data'],
+                     'formats': ['<f8', '<u8', '<u4',
+                                 ('<' + hdr['Format'],
+                                  (hdr['TileColumns'], hdr['NChannels'],
+                                   hdr['NBins']))],
+                     'offsets': [0, 8, 16, 24],
+                     'itemsize': hdr['TileBytes']})
+
+def ReadSpectrogramFile(Filename):
+    hdr = ReadSpectrogramHeader(Filename)
+    tiles = np.memmap(Filename, dtype=TileType(hdr), mode='r',
+                      offset=hdr['HeaderBytes'])
+    return hdr, tiles
+
+def Values(hdr, data):
+    # Stored values back to float32, undoing the u1 scaling.
+    if hdr['Format'] == 'u1':
+        step = (hdr['Max'] - hdr['Min']) / 255.0
+        return (hdr['Min'] + step * data.astype(np.float32)).astype(np.float32)
+    return data.astype(np.float32)
+
+def ReadRange(Filename, Start, Stop):
+    # Columns whose first sample is in [Start, Stop), UTC seconds.
+    hdr, tiles = ReadSpectrogramFile(Filename)
+    step = hdr['ColumnSeconds']
+    t0 = np.asarray(tiles['Time'])
+    first = max(np.searchsorted(t0, Start, side='right') - 1, 0)
+    last = np.searchsorted(t0, Stop, side='left')
+    times, data = [], []
+    for k in range(first, last):
+        n = int(tiles['Columns'][k])
+        t = t0[k] + step * np.arange(n)
+        keep = (t >= Start) & (t < Stop)
+        times.append(t[keep])
+        data.append(Values(hdr, tiles['Data'][k, :n][keep]))
+    if not times:
+        return (np.zeros(0),
+                np.zeros((0, hdr['NChannels'], hdr['NBins']), np.float32))
+    return np.concatenate(times), np.concatenate(data)
+
+def Frequency(hdr):
+    return np.arange(hdr['NBins']) * hdr['BinWidth']
@@ -0,0 +1,52 @@
+#
+# Modified    By    Reason
+# --------    --    ------
+# 17-Oct-26   CBL   Original
+# 17-Oct-26   CBL   .oct band levels, Frequencies from the header
+#
+# Read the .psd/.spc/.oct spectral product files written by SpectrumFile.
+# The header is "Key: value" lines padded to HeaderBytes, followed by
+# fixed size records, so the whole file maps straight into numpy.
+#
+#   hdr, rec = ReadSpectrumFile('2025Accelerometer072_00.psd')
+#   rec['Time']              UTC seconds, one per record
+#   rec['Data'][:, 0, :]     channel 0, NBins per record
+#   Frequency(hdr)           frequency axis, band centres for .oct
+#
+# ------------------------------------------------------------------
+import numpy as np
+
+def ReadSpectrumHeader(Filename):
+    hdr = {}
+    with open(Filename, 'rb') as f:
+        raw = f.read(1024)
+    for line in raw.split(b'\0')[0].decode('ascii').splitlines():
+        key, _, value = line.partition(':')
+        hdr[key.strip()] = value.strip()
+    for key in ('NChannels', 'NBins', 'FFTLength', 'Averages', 'Overlap',
+                'HeaderBytes', 'RecordBytes'):
+        hdr[key] = int(hdr[key])
+    for key in ('SampleRate', 'BinWidth'):
+        hdr[key] = float(hdr[key])
+    if 'Frequencies' in hdr:
+        hdr['Frequencies'] = np.array([float(v) for v in
+                                       hdr['Frequencies'].split()])
+    return hdr
+
+def RecordType(hdr):
+    return np.dtype({'names':   ['Time', 'Frame', 'Data'],
+                     'formats': ['<f8', '<u8',
+                                 ('<f4', (hdr['NChannels'], hdr['NBins']))],
+                     'offsets': [0, 8, 16],
+                     'itemsize': hdr['RecordBytes']})
+
+def ReadSpectrumFile(Filename):
+    hdr = ReadSpectrumHeader(Filename)
+    rec = np.memmap(Filename, dtype=RecordType(hdr), mode='r',
+                    offset=hdr['HeaderBytes'])
+    return hdr, rec
+
+def Frequency(hdr):
+    if 'Frequencies' in hdr:
+        return hdr['Frequencies']
+    return np.arange(hdr['NBins']) * hdr['BinWidth']
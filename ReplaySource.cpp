@@ -0,0 +1,890 @@
+/********************************************************************
+ *
+ * Module Name : ReplaySource.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : File and synthetic virtual input device.
+ *
+ * Restrictions/Limitations :
+ *   WAV is read as little endian, as are the .acc files.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Compressed .acc files through AccCodec.
+ *
+ * Classification : Unclassified
+ *
+ * References : WAVE PCM soundfile format, RIFF chunks "fmt " and "data"
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+// Local Includes.
+#include "ReplaySource.hh"
+#include "AccCodec.hh"
+#include "CLogger.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : ReplaySource constructor
+ *
+ * Description : Open a .acc or WAV file and read its header for
+ *               the channel count and sample rate.
+ *
+ * Inputs : Kind - kAcc or kWav
+ *          File - path to the file
+ *
+ * Returns : none
+ *
+ * Error Conditions : ENO_FILE, EFORMAT
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+ReplaySource::ReplaySource(int Kind, const char *File) : AudioSource()
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+    SetName("ReplaySource");
+    SetError(); // No error.
+
+    fKind            = Kind;
+    fFile            = File ? File : "";
+    fFD              = -1;
+    fDataStart       = 0;
+    fDataEnd         = 0;
+    fPosition        = 0;
+    fCodec           = NULL;
+    fDecodedFrames   = 0;
+    fDecodedNext     = 0;
+    fTone            = 0.0;
+    fLevel           = 0.0;
+    fNoise           = 0.0;
+    fPhase           = NULL;
+    fSeed            = 0x9E3779B97F4A7C15ULL;
+    fSpeed           = 1.0;
+    fLoop            = false;
+    fMaxFrames       = 0;
+    fReady           = NULL;
+    fReadyArg        = NULL;
+    fRate            = 0.0;
+    fFramesPerBuffer = 0;
+    fCallback        = NULL;
+    fUserData        = NULL;
+    fBuffer          = NULL;
+    fThread          = NULL;
+    fRun.store(false);
+    fActive.store(false);
+    fFrames.store(0);
+
+    fFD = open(fFile.c_str(), O_RDONLY);
+    if (fFD < 0)
+    {
+        pLogger->Log("# Replay can not open %s\n", fFile.c_str());
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return;
+    }
+    if (!((fKind == kWav) ? ReadWavHeader() : ReadAccHeader()))
+    {
+        pLogger->Log("# Replay %s is not a 16 bit %s file\n", fFile.c_str(),
+                     Name());
+        SetError(EFORMAT, __LINE__);
+        SET_DEBUG_STACK;
+        return;
+    }
+    fPosition = fDataStart;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReplaySource constructor
+ *
+ * Description : Synthetic source, no file.
+ *
+ * Inputs : NChan      - channels
+ *          SampleRate - Hz
+ *          Tone       - Hz of channel 0, channel c is (c+1)*Tone
+ *          Level      - sine peak, fraction of full scale
+ *          Noise      - noise peak, fraction of full scale
+ *
+ * Returns : none
+ *
+ * Error Conditions : EFORMAT if there are no channels
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+ReplaySource::ReplaySource(uint32_t NChan, double SampleRate, double Tone,
+                           double Level, double Noise) : AudioSource()
+{
+    SET_DEBUG_STACK;
+    SetName("ReplaySource");
+    SetError(); // No error.
+
+    fKind            = kSynthetic;
+    fFD              = -1;
+    fDataStart       = 0;
+    fDataEnd         = 0;
+    fPosition        = 0;
+    fCodec           = NULL;
+    fDecodedFrames   = 0;
+    fDecodedNext     = 0;
+    fTone            = Tone;
+    fLevel           = Level;
+    fNoise           = Noise;
+    fSeed            = 0x9E3779B97F4A7C15ULL;
+    fSpeed           = 1.0;
+    fLoop            = false;
+    fMaxFrames       = 0;
+    fReady           = NULL;
+    fReadyArg        = NULL;
+    fRate            = 0.0;
+    fFramesPerBuffer = 0;
+    fCallback        = NULL;
+    fUserData        = NULL;
+    fBuffer          = NULL;
+    fThread          = NULL;
+    fRun.store(false);
+    fActive.store(false);
+    fFrames.store(0);
+
+    fNChannels  = NChan;
+    fSampleRate = SampleRate;
+    fPhase      = new double[(NChan > 0) ? NChan : 1];
+    memset(fPhase, 0, ((NChan > 0) ? NChan : 1) * sizeof(double));
+    if (NChan == 0)
+    {
+        SetError(EFORMAT, __LINE__);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReplaySource destructor
+ *
+ * Description : Stop the thread and close the file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+ReplaySource::~ReplaySource(void)
+{
+    SET_DEBUG_STACK;
+    Close();
+    if (fFD >= 0) close(fFD);
+    delete[] fPhase;
+    delete fCodec;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Kind
+ *
+ * Description : Map a configuration Source name to a kind.
+ *
+ * Inputs : Name - "acc", "wav" or "synthetic", any case
+ *
+ * Returns : kAcc, kWav, kSynthetic or -1
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int ReplaySource::Kind(const char *Name)
+{
+    if (Name == NULL)                      return -1;
+    if (strcasecmp(Name, "acc") == 0)       return kAcc;
+    if (strcasecmp(Name, "wav") == 0)       return kWav;
+    if (strcasecmp(Name, "synthetic") == 0) return kSynthetic;
+    return -1;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Name
+ *
+ * Description : Kind as a string, for the log.
+ *
+ * Inputs : none
+ *
+ * Returns : name
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+const char* ReplaySource::Name(void) const
+{
+    switch (fKind)
+    {
+    case kWav:
+        return "wav";
+    case kSynthetic:
+        return "synthetic";
+    default:
+        return "acc";
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReadAccHeader
+ *
+ * Description : Pull NChannels and SampleRate out of the
+ *               kAccHeaderSize bytes of "Key: value" lines.
+ *
+ * Inputs : none
+ *
+ * Returns : true if both were found
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::ReadAccHeader(void)
+{
+    SET_DEBUG_STACK;
+    char        header[kAccHeaderSize+1];
+    const char *p;
+
+    if (pread(fFD, header, kAccHeaderSize, 0) != (ssize_t) kAccHeaderSize)
+    {
+        return false;
+    }
+    header[kAccHeaderSize] = 0;
+    if ((p = strstr(header, "NChannels: ")) != NULL)
+    {
+        fNChannels = strtoul(p + strlen("NChannels: "), NULL, 10);
+    }
+    if ((p = strstr(header, "SampleRate: ")) != NULL)
+    {
+        fSampleRate = strtod(p + strlen("SampleRate: "), NULL);
+    }
+    if ((p = strstr(header, "Compression: ")) != NULL)
+    {
+        p += strlen("Compression: ");
+        if (strncmp(p, AccCodec::kName, strlen(AccCodec::kName)) == 0)
+        {
+            fCodec = new AccCodec(fNChannels);
+        }
+        else if (strncmp(p, "none", 4) != 0)
+        {
+            return false;
+        }
+    }
+    fDataStart = kAccHeaderSize;
+    fDataEnd   = 0;
+    SET_DEBUG_STACK;
+    return ((fNChannels > 0) && (fSampleRate > 0.0));
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReadWavHeader
+ *
+ * Description : Walk the RIFF chunks for "fmt " and "data".
+ *               PCM or WAVE_FORMAT_EXTENSIBLE, 16 bits only.
+ *
+ * Inputs : none
+ *
+ * Returns : true for a usable file
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::ReadWavHeader(void)
+{
+    SET_DEBUG_STACK;
+    unsigned char riff[12];
+    unsigned char chunk[8];
+    unsigned char fmt[16];
+    uint32_t      size;
+    uint16_t      tag  = 0;
+    uint16_t      bits = 0;
+    uint16_t      chan = 0;
+    uint32_t      rate = 0;
+    off_t         pos  = sizeof(riff);
+
+    if ((pread(fFD, riff, sizeof(riff), 0) != (ssize_t) sizeof(riff)) ||
+        (memcmp(riff, "RIFF", 4) != 0) || (memcmp(&riff[8], "WAVE", 4) != 0))
+    {
+        return false;
+    }
+    while (pread(fFD, chunk, sizeof(chunk), pos) == (ssize_t) sizeof(chunk))
+    {
+        memcpy(&size, &chunk[4], sizeof(size));
+        pos += sizeof(chunk);
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            if ((size < sizeof(fmt)) ||
+                (pread(fFD, fmt, sizeof(fmt), pos) != (ssize_t) sizeof(fmt)))
+            {
+                return false;
+            }
+            memcpy(&tag,  &fmt[0],  sizeof(tag));
+            memcpy(&chan, &fmt[2],  sizeof(chan));
+            memcpy(&rate, &fmt[4],  sizeof(rate));
+            memcpy(&bits, &fmt[14], sizeof(bits));
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            fDataStart = pos;
+            // Streamed files leave the size at 0 or all ones.
+            fDataEnd   = ((size == 0) || (size == 0xFFFFFFFF)) ? 0 : pos + size;
+            break;
+        }
+        // Chunks are word aligned.
+        pos += size + (size & 1);
+    }
+    fNChannels  = chan;
+    fSampleRate = rate;
+    SET_DEBUG_STACK;
+    return ((fDataStart > 0) && ((tag == 1) || (tag == 0xFFFE)) &&
+            (bits == 16) && (chan > 0) && (rate > 0));
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Size the callback buffer and remember the callback.
+ *               The file stays where the last stream left it.
+ *
+ * Inputs : SampleRate      - rate to run the stream at
+ *          FramesPerBuffer - frames per callback
+ *          Callback        - stream callback
+ *          UserData        - handed to Callback
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_STREAM if the source is not usable
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::Open(double SampleRate, uint32_t FramesPerBuffer,
+                        PaStreamCallback *Callback, void *UserData)
+{
+    SET_DEBUG_STACK;
+    Close();
+    if ((fNChannels == 0) || (FramesPerBuffer == 0) || (Callback == NULL) ||
+        (SampleRate <= 0.0) || ((fKind != kSynthetic) && (fFD < 0)))
+    {
+        SetError(ENO_STREAM, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    fRate            = SampleRate;
+    fFramesPerBuffer = FramesPerBuffer;
+    fCallback        = Callback;
+    fUserData        = UserData;
+    fBuffer          = new int16_t[FramesPerBuffer * fNChannels];
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Start
+ *
+ * Description : Start the thread that plays the device.
+ *
+ * Inputs : none
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_STREAM if not open
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::Start(void)
+{
+    SET_DEBUG_STACK;
+    if (fBuffer == NULL)
+    {
+        SetError(ENO_STREAM, __LINE__);
+        return false;
+    }
+    Stop();
+    fRun.store(true);
+    fActive.store(true);
+    fThread = new std::thread(&ReplaySource::Run, this);
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Stop
+ *
+ * Description : Ask the thread to finish and wait for it. A
+ *               callback in progress completes.
+ *
+ * Inputs : none
+ *
+ * Returns : true
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::Stop(void)
+{
+    SET_DEBUG_STACK;
+    fRun.store(false);
+    if (fThread)
+    {
+        fThread->join();
+        delete fThread;
+        fThread = NULL;
+    }
+    fActive.store(false);
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Stop and drop the callback buffer. The file stays
+ *               open for the next stream.
+ *
+ * Inputs : none
+ *
+ * Returns : true
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::Close(void)
+{
+    SET_DEBUG_STACK;
+    Stop();
+    delete[] fBuffer;
+    fBuffer   = NULL;
+    fCallback = NULL;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : IsActive
+ *
+ * Description : Still calling back?
+ *
+ * Inputs : none
+ *
+ * Returns : 1 running, 0 finished or stopped
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int ReplaySource::IsActive(void)
+{
+    return fActive.load() ? 1 : 0;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Rewind
+ *
+ * Description : Back to the first sample, for looping.
+ *
+ * Inputs : none
+ *
+ * Returns : true if there is a file to rewind
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::Rewind(void)
+{
+    if (fFD < 0) return false;
+    fPosition      = fDataStart;
+    fDecodedFrames = 0;
+    fDecodedNext   = 0;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Fill
+ *
+ * Description : Read up to n whole frames into fBuffer, going
+ *               round again at the end if looping. A trailing
+ *               partial frame is never delivered.
+ *
+ * Inputs : n - frames wanted, at most FramesPerBuffer
+ *
+ * Returns : frames read, 0 at the end
+ *
+ * Error Conditions : none, a read error ends the stream
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t ReplaySource::Fill(uint32_t n)
+{
+    const size_t frameBytes = fNChannels * sizeof(int16_t);
+    char        *dst        = (char *) fBuffer;
+    uint32_t     got        = 0;
+    bool         rewound    = false;
+    size_t       want;
+    ssize_t      rc;
+
+    if (fCodec) return FillCoded(n);
+    while (got < n)
+    {
+        want = (n - got) * frameBytes;
+        if ((fDataEnd > 0) && (fPosition + (off_t) want > fDataEnd))
+        {
+            want = ((fDataEnd - fPosition) / frameBytes) * frameBytes;
+        }
+        rc = (want > 0) ? pread(fFD, dst + got*frameBytes, want, fPosition) : 0;
+        if ((rc < 0) && (errno == EINTR)) continue;
+        if (rc < 0) break;
+        rc -= rc % frameBytes;
+        if (rc == 0)
+        {
+            // Once round per empty read, so an empty file ends.
+            if (fLoop && !rewound && Rewind())
+            {
+                rewound = true;
+                continue;
+            }
+            break;
+        }
+        fPosition += rc;
+        got       += rc / frameBytes;
+        rewound    = false;
+    }
+    return got;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FillCoded
+ *
+ * Description : Fill for a compressed file. Frames come out of the
+ *               decoded block, the next block is read and decoded
+ *               when it runs out.
+ *
+ * Inputs : n - frames wanted, at most FramesPerBuffer
+ *
+ * Returns : frames decoded, 0 at the end
+ *
+ * Error Conditions : none, blocks that do not decode are skipped
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t ReplaySource::FillCoded(uint32_t n)
+{
+    uint32_t got     = 0;
+    uint32_t m;
+    bool     rewound = false;
+
+    while (got < n)
+    {
+        if (fDecodedNext == fDecodedFrames)
+        {
+            if (!ReadBlock())
+            {
+                if (fLoop && !rewound && Rewind())
+                {
+                    rewound = true;
+                    continue;
+                }
+                break;
+            }
+            rewound = false;
+        }
+        m = fDecodedFrames - fDecodedNext;
+        if (m > n - got) m = n - got;
+        memcpy( fBuffer + (size_t) got * fNChannels,
+                &fDecoded[(size_t) fDecodedNext * fNChannels],
+                (size_t) m * fNChannels * sizeof(int16_t));
+        fDecodedNext += m;
+        got          += m;
+    }
+    return got;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ReadBlock
+ *
+ * Description : Read the block header at fPosition and then the
+ *               block, and decode it. If there is no good block there
+ *               scan forward a window at a time for the next header.
+ *
+ * Inputs : none
+ *
+ * Returns : true with a block in fDecoded, false at the end of the file
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool ReplaySource::ReadBlock(void)
+{
+    const size_t    kWindow = 65536;
+    uint8_t         header[AccCodec::kHeaderBytes];
+    AccCodec::Block b;
+    size_t          s;
+    ssize_t         rc;
+
+    while (true)
+    {
+        rc = pread(fFD, header, sizeof(header), fPosition);
+        if ((rc < 0) && (errno == EINTR)) continue;
+        if (rc < (ssize_t) sizeof(header)) return false;
+        if (AccCodec::Peek(header, sizeof(header), b) &&
+            (b.channels == fNChannels))
+        {
+            fCoded.resize(b.bytes);
+            fDecoded.resize((size_t) b.frames * fNChannels);
+            if ((pread(fFD, fCoded.data(), b.bytes, fPosition) == (ssize_t) b.bytes) &&
+                fCodec->Decode(fCoded.data(), b.bytes, fDecoded.data()))
+            {
+                fPosition     += b.bytes;
+                fDecodedFrames = b.frames;
+                fDecodedNext   = 0;
+                return true;
+            }
+        }
+        // Not a good block, find the next header.
+        fCoded.resize(kWindow);
+        rc = pread(fFD, fCoded.data(), kWindow, fPosition + 1);
+        if (rc < (ssize_t) sizeof(header)) return false;
+        s = AccCodec::Sync(fCoded.data(), rc);
+        fPosition += 1 + ((s < (size_t) rc) ? s : rc - sizeof(header) + 1);
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Synthesize
+ *
+ * Description : n frames of tones plus noise into fBuffer. The
+ *               noise is a xorshift generator, cheap and the same
+ *               every run.
+ *
+ * Inputs : n - frames
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void ReplaySource::Synthesize(uint32_t n)
+{
+    int16_t *dst = fBuffer;
+    double   v, u;
+    long     s;
+
+    for (uint32_t i=0; i<n; i++)
+    {
+        for (uint32_t c=0; c<fNChannels; c++)
+        {
+            fSeed ^= fSeed << 13;
+            fSeed ^= fSeed >> 7;
+            fSeed ^= fSeed << 17;
+            u  = 2.0 * (double) (fSeed >> 11) * (1.0 / 9007199254740992.0) - 1.0;
+            v  = fLevel * sin(fPhase[c]) + fNoise * u;
+            s  = lrint(32767.0 * v);
+            *dst++ = (int16_t) ((s > 32767) ? 32767 : ((s < -32768) ? -32768 : s));
+
+            fPhase[c] += 2.0 * M_PI * (double) (c+1) * fTone / fRate;
+            if (fPhase[c] >= 2.0 * M_PI) fPhase[c] -= 2.0 * M_PI;
+        }
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Run
+ *
+ * Description : The device. Each pass gets a buffer of frames,
+ *               waits until it is due, or until the consumer has
+ *               room when running flat out, and calls back. Due
+ *               times are from the start of the stream so sleep
+ *               error does not accumulate.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void ReplaySource::Run(void)
+{
+    SET_DEBUG_STACK;
+    PaStreamCallbackTimeInfo timeInfo;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    uint64_t sent = 0;   // This stream
+    uint64_t frames;     // Since construction, the stream clock
+    uint32_t n;
+    int      rc = paContinue;
+
+    while (fRun.load(std::memory_order_relaxed) && (rc == paContinue))
+    {
+        frames = fFrames.load(std::memory_order_relaxed);
+        n      = fFramesPerBuffer;
+        if (fMaxFrames > 0)
+        {
+            if (frames >= fMaxFrames) break;
+            if (fMaxFrames - frames < n) n = fMaxFrames - frames;
+        }
+        if (fKind == kSynthetic)
+        {
+            Synthesize(n);
+        }
+        else
+        {
+            n = Fill(n);
+        }
+        if (n == 0) break;
+
+        if (fSpeed > 0.0)
+        {
+            std::this_thread::sleep_until(t0 +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>((double) (sent + n) /
+                                                  (fRate * fSpeed))));
+        }
+        else if (fReady)
+        {
+            while (fRun.load(std::memory_order_relaxed) && !fReady(fReadyArg, n))
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            if (!fRun.load(std::memory_order_relaxed)) break;
+        }
+
+        timeInfo.inputBufferAdcTime  = (double) frames / fRate;
+        timeInfo.currentTime         = (double) (frames + n) / fRate;
+        timeInfo.outputBufferDacTime = 0.0;
+        rc = fCallback(fBuffer, NULL, n, &timeInfo, 0, fUserData);
+        sent += n;
+        fFrames.store(frames + n, std::memory_order_relaxed);
+    }
+    fActive.store(false);
+    SET_DEBUG_STACK;
+}
@@ -0,0 +1,143 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : ReplaySource.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Virtual input device. A thread reads a .acc file,
+ *               a 16 bit PCM WAV file or generates tones and noise,
+ *               and calls the stream callback with FramesPerBuffer
+ *               frames at a time, just as PortAudio would. The
+ *               stream clock in the time info counts frames from 0.
+ *
+ *               Speed 1 paces the callbacks at the sample rate, 2
+ *               twice as fast and so on. Speed 0 goes as fast as the
+ *               consumer can take the data, asking the ReadyFunc
+ *               before each callback so nothing is dropped. That
+ *               makes the whole capture, write and analysis path a
+ *               benchmark that runs on any machine.
+ *
+ *               Compressed .acc files are decoded a block at a time
+ *               as they are read, a block that does not decode is
+ *               skipped to the next good header.
+ *
+ * Restrictions/Limitations :
+ *   Only 16 bit integer samples. The file position carries over from
+ *   one Open to the next, so back to back Records read on through the
+ *   file.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL AccCodec compressed .acc files.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __REPLAYSOURCE_hh_
+#define __REPLAYSOURCE_hh_
+#  include <atomic>
+#  include <sys/types.h>
+#  include <thread>
+#  include <string>
+#  include <vector>
+#  include "AudioSource.hh"
+
+class AccCodec;
+
+class ReplaySource : public AudioSource
+{
+public:
+    enum {kAcc=0, kWav, kSynthetic};
+
+    /*!
+     * .acc or WAV file, channels and rate come from its header.
+     */
+    ReplaySource(int Kind, const char *File);
+    /*!
+     * Synthetic, channel c is a sine at (c+1)*Tone Hz with peak
+     * Level plus uniform noise of peak Noise, both fractions of
+     * full scale.
+     */
+    ReplaySource(uint32_t NChan, double SampleRate, double Tone,
+                 double Level, double Noise);
+    ~ReplaySource(void);
+
+    /*! kAcc, kWav, kSynthetic from a config name, -1 if none match. */
+    static int Kind(const char *Name);
+
+    /*! Times real time, 0 for as fast as possible. */
+    inline void SetSpeed(double v)     {fSpeed = (v > 0.0) ? v : 0.0;};
+    /*! Go back to the start at the end of the file. */
+    inline void SetLoop(bool v)        {fLoop = v;};
+    /*! Stop after this many frames, 0 for no limit. */
+    inline void SetMaxFrames(uint64_t v) {fMaxFrames = v;};
+
+    bool Open(double SampleRate, uint32_t FramesPerBuffer,
+              PaStreamCallback *Callback, void *UserData);
+    bool Start(void);
+    bool Stop(void);
+    bool Close(void);
+    int  IsActive(void);
+    inline bool Live(void) const {return false;};
+    const char* Name(void) const;
+    inline void SetReady(ReadyFunc Ready, void *Arg) {fReady = Ready; fReadyArg = Arg;};
+
+    /*! Frames handed to the callback since construction. */
+    inline uint64_t Frames(void) const {return fFrames.load(std::memory_order_relaxed);};
+
+    /*! Size of the ASCII header at the top of a .acc file. */
+    static const uint32_t kAccHeaderSize = 256;
+
+private:
+    bool     ReadAccHeader(void);
+    bool     ReadWavHeader(void);
+    bool     Rewind(void);
+    /*! Up to n frames into fBuffer, fewer only at the end. */
+    uint32_t Fill(uint32_t n);
+    /*! Same for a compressed file. */
+    uint32_t FillCoded(uint32_t n);
+    /*! Decode the next good block at or after fPosition. */
+    bool     ReadBlock(void);
+    void     Synthesize(uint32_t n);
+    void     Run(void);
+
+    int                 fKind;
+    std::string         fFile;
+    int                 fFD;
+    off_t               fDataStart;    /*! First sample in the file */
+    off_t               fDataEnd;      /*! One past the last, 0 to EOF */
+    off_t               fPosition;
+
+    AccCodec           *fCodec;        /*! NULL unless compressed */
+    std::vector<uint8_t> fCoded;       /*! One block as read */
+    std::vector<int16_t> fDecoded;     /*! The same decoded */
+    uint32_t            fDecodedFrames;
+    uint32_t            fDecodedNext;  /*! Next frame to hand out */
+
+    double              fTone;
+    double              fLevel;
+    double              fNoise;
+    double             *fPhase;        /*! Radians, per channel */
+    uint64_t            fSeed;         /*! xorshift state */
+
+    double              fSpeed;
+    bool                fLoop;
+    uint64_t            fMaxFrames;
+    ReadyFunc           fReady;
+    void               *fReadyArg;
+
+    double              fRate;         /*! Rate the stream runs at */
+    uint32_t            fFramesPerBuffer;
+    PaStreamCallback   *fCallback;
+    void               *fUserData;
+    int16_t            *fBuffer;       /*! One callback of frames */
+
+    std::thread        *fThread;
+    std::atomic<bool>   fRun;
+    std::atomic<bool>   fActive;
+    std::atomic<uint64_t> fFrames;
+};
+#endif
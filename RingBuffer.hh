@@ -0,0 +1,185 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : RingBuffer.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Fixed size, wait free, single producer/single consumer
+ *               ring buffer. The producer is the PortAudio callback,
+ *               the consumer is a processing thread. Neither side
+ *               ever blocks or allocates once the ring is built.
+ *
+ * Restrictions/Limitations :
+ *   Exactly one thread may call Push* and exactly one thread may
+ *   call Pop/Peek/Consume. Capacity is rounded up to a power of 2.
+ *   T must be trivially copyable.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   https://www.1024cores.net/home/lock-free-algorithms/queues
+ *
+ *******************************************************************
+ */
+#ifndef __RINGBUFFER_hh_
+#define __RINGBUFFER_hh_
+#  include <atomic>
+#  include <cstdint>
+#  include <cstdlib>
+#  include <cstring>
+
+#  define RING_CACHE_LINE 64
+
+template <class T> class SPSCRing
+{
+public:
+    /*!
+     * Constructor, Capacity is in elements of T and is rounded up
+     * to the next power of 2.
+     */
+    SPSCRing(size_t Capacity)
+    {
+        size_t n = 1;
+        while (n < Capacity) n <<= 1;
+        fMask     = n - 1;
+        fBuffer   = NULL;
+        if (posix_memalign((void **)&fBuffer, RING_CACHE_LINE, n*sizeof(T)))
+        {
+            fBuffer = NULL;
+            fMask   = 0;
+        }
+        else
+        {
+            memset(fBuffer, 0, n*sizeof(T));
+        }
+        fHead.store(0, std::memory_order_relaxed);
+        fTail.store(0, std::memory_order_relaxed);
+        fDropped.store(0, std::memory_order_relaxed);
+        fTailCache = 0;
+        fHeadCache = 0;
+    };
+    ~SPSCRing() {free(fBuffer);};
+
+    /*! Did the allocation succeed? */
+    inline bool   Valid(void)    const {return (fBuffer != NULL);};
+    /*! Total number of elements the ring can hold. */
+    inline size_t Capacity(void) const {return fBuffer ? fMask + 1 : 0;};
+    /*! Number of elements that have been discarded because the ring was full */
+    inline uint64_t Dropped(void) const
+	{return fDropped.load(std::memory_order_relaxed);};
+
+    /*! Consumer side, number of elements ready to be read. */
+    inline size_t Available(void) const
+    {
+        return fHead.load(std::memory_order_acquire) -
+            fTail.load(std::memory_order_relaxed);
+    };
+    /*! Producer side, number of elements that can be written. */
+    inline size_t Space(void) const
+    {
+        return Capacity() - (fHead.load(std::memory_order_relaxed) -
+                             fTail.load(std::memory_order_acquire));
+    };
+
+    /*!
+     * Producer: copy n elements in. This is all or nothing so that
+     * frames are never split. On overflow the elements are counted
+     * as dropped and 0 is returned.
+     */
+    inline size_t Push(const T *src, size_t n)
+    {
+        T *dst;
+        size_t head = fHead.load(std::memory_order_relaxed);
+        if (!Reserve(head, n)) return 0;
+        size_t first = Contiguous(head, n);
+        dst = &fBuffer[head & fMask];
+        memcpy( dst, src, first*sizeof(T));
+        memcpy( fBuffer, src+first, (n-first)*sizeof(T));
+        fHead.store(head + n, std::memory_order_release);
+        return n;
+    };
+    /*!
+     * Producer: same as Push but fill with zeros. Used when the
+     * driver hands us a NULL input buffer.
+     */
+    inline size_t PushZeros(size_t n)
+    {
+        size_t head = fHead.load(std::memory_order_relaxed);
+        if (!Reserve(head, n)) return 0;
+        size_t first = Contiguous(head, n);
+        memset( &fBuffer[head & fMask], 0, first*sizeof(T));
+        memset( fBuffer, 0, (n-first)*sizeof(T));
+        fHead.store(head + n, std::memory_order_release);
+        return n;
+    };
+
+    /*!
+     * Consumer: copy out at most n elements. Returns the number
+     * of elements actually copied.
+     */
+    inline size_t Pop(T *dst, size_t n)
+    {
+        size_t tail  = fTail.load(std::memory_order_relaxed);
+        size_t avail = fHeadCache - tail;
+        if (avail < n)
+        {
+            fHeadCache = fHead.load(std::memory_order_acquire);
+            avail      = fHeadCache - tail;
+        }
+        if (n > avail) n = avail;
+        if (n == 0) return 0;
+        size_t first = Contiguous(tail, n);
+        memcpy( dst, &fBuffer[tail & fMask], first*sizeof(T));
+        memcpy( dst+first, fBuffer, (n-first)*sizeof(T));
+        fTail.store(tail + n, std::memory_order_release);
+        return n;
+    };
+
+private:
+    /*!
+     * Check that n elements fit, refreshing the cached copy of the
+     * consumer index only when needed.
+     */
+    inline bool Reserve(size_t head, size_t n)
+    {
+        size_t cap = fMask + 1;
+        if ((fBuffer == NULL) || (n > cap))
+        {
+            fDropped.fetch_add(n, std::memory_order_relaxed);
+            return false;
+        }
+        if (head + n - fTailCache > cap)
+        {
+            fTailCache = fTail.load(std::memory_order_acquire);
+            if (head + n - fTailCache > cap)
+            {
+                fDropped.fetch_add(n, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        return true;
+    };
+    /*! Elements that can be moved before wrapping. */
+    inline size_t Contiguous(size_t index, size_t n) const
+    {
+        size_t end = (fMask + 1) - (index & fMask);
+        return (n < end) ? n : end;
+    };
+
+    /*
+     * Producer and consumer indices live on separate cache lines
+     * so the two threads do not false share. Indices increase
+     * monotonically and are masked on access.
+     */
+    alignas(RING_CACHE_LINE) std::atomic<size_t> fHead;  /*! Producer */
+    size_t                  fTailCache;   /*! Producer copy of fTail */
+    alignas(RING_CACHE_LINE) std::atomic<size_t> fTail;  /*! Consumer */
+    size_t                  fHeadCache;   /*! Consumer copy of fHead */
+    alignas(RING_CACHE_LINE) std::atomic<uint64_t> fDropped;
+    T                      *fBuffer;
+    size_t                  fMask;
+};
+#endif
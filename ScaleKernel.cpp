@@ -0,0 +1,650 @@
+/********************************************************************
+ *
+ * Module Name : ScaleKernel.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Vectorised de-interleave/convert/scale/window,
+ *               and the block moments behind StreamStats.
+ *
+ * Restrictions/Limitations :
+ *   Each vector version is compiled with a target attribute so the
+ *   rest of the program does not need -mavx2, the CPU is checked
+ *   before one is used.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Float versions of each kernel.
+ * 17-Oct-26 CBL MomentFrames kernels.
+ * 17-Oct-26 CBL Automatic selection happens once, thread safe, the
+ *               batch workers all come in here together.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   Intel Intrinsics Guide
+ *
+ ********************************************************************/
+// System includes.
+#include <cstdint>
+#include <cstddef>
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#  define SCALE_X86 1
+#endif
+
+// Local Includes.
+#include "ScaleKernel.hh"
+
+typedef void (*ScaleFn)(const int16_t *, uint32_t, uint32_t, double,
+                        const double *, double *, uint32_t);
+typedef void (*ScaleFnF)(const int16_t *, uint32_t, uint32_t, float,
+                         const float *, float *, uint32_t);
+typedef void (*MomentFn)(const int16_t *, uint32_t, uint32_t, int32_t,
+                         FrameMoments *);
+
+/*
+ * Vector iterations between spills of the narrow lane sums. 32768
+ * summed 16384 times still fits an int32, and the int16 clip count
+ * can not wrap.
+ */
+static const uint32_t kMomentSpill = 16384;
+
+/*
+ * Portable version, also does the tails of the vector versions.
+ */
+static void ScaleScalar(const int16_t *frames, uint32_t nChan,
+                        uint32_t nFrames, double scale,
+                        const double *window, double *dst,
+                        uint32_t dstStride)
+{
+    for (uint32_t c=0; c<nChan; c++)
+    {
+        double        *out = &dst[c*dstStride];
+        const int16_t *in  = &frames[c];
+        if (window)
+        {
+            for (uint32_t i=0; i<nFrames; i++)
+            {
+                out[i] = scale * (double) in[i*nChan] * window[i];
+            }
+        }
+        else
+        {
+            for (uint32_t i=0; i<nFrames; i++)
+            {
+                out[i] = scale * (double) in[i*nChan];
+            }
+        }
+    }
+}
+
+/*
+ * Portable float version.
+ */
+static void ScaleScalarF(const int16_t *frames, uint32_t nChan,
+                         uint32_t nFrames, float scale,
+                         const float *window, float *dst,
+                         uint32_t dstStride)
+{
+    for (uint32_t c=0; c<nChan; c++)
+    {
+        float         *out = &dst[c*dstStride];
+        const int16_t *in  = &frames[c];
+        if (window)
+        {
+            for (uint32_t i=0; i<nFrames; i++)
+            {
+                out[i] = scale * (float) in[i*nChan] * window[i];
+            }
+        }
+        else
+        {
+            for (uint32_t i=0; i<nFrames; i++)
+            {
+                out[i] = scale * (float) in[i*nChan];
+            }
+        }
+    }
+}
+
+/*
+ * Portable moments, adds to out so it also does the vector tails.
+ */
+static void MomentScalar(const int16_t *frames, uint32_t nChan,
+                         uint32_t nFrames, int32_t clip, FrameMoments *out)
+{
+    for (uint32_t c=0; c<nChan; c++)
+    {
+        const int16_t *in = &frames[c];
+        FrameMoments  &m  = out[c];
+        int64_t  sum = 0;
+        uint64_t sumAbs = 0, sumSq = 0, clips = 0;
+        for (uint32_t i=0; i<nFrames; i++)
+        {
+            int32_t x = in[i*nChan];
+            if (x < m.min) m.min = x;
+            if (x > m.max) m.max = x;
+            sum    += x;
+            sumAbs += (x < 0) ? -x : x;
+            sumSq  += (uint64_t) (x * x);
+            clips  += (x >= clip) || (x <= -clip);
+        }
+        m.sum    += sum;
+        m.sumAbs += sumAbs;
+        m.sumSq  += sumSq;
+        m.clips  += clips;
+    }
+}
+
+/*
+ * Fold per int16 lane results into channels. With nChan dividing
+ * the lane count every load starts on a frame, so lane j is always
+ * channel j % nChan.
+ */
+static void MomentLanes(uint32_t nLanes, uint32_t nChan,
+                        const int16_t *mn, const int16_t *mx,
+                        const int64_t *sum, const uint64_t *sumAbs,
+                        const uint64_t *sumSq, const uint64_t *clips,
+                        FrameMoments *out)
+{
+    for (uint32_t j=0; j<nLanes; j++)
+    {
+        FrameMoments &m = out[j % nChan];
+        if (mn[j] < m.min) m.min = mn[j];
+        if (mx[j] > m.max) m.max = mx[j];
+        m.sum    += sum[j];
+        m.sumAbs += sumAbs[j];
+        m.sumSq  += sumSq[j];
+        m.clips  += clips[j];
+    }
+}
+
+#ifdef SCALE_X86
+/*
+ * SSE4.1, 8 samples per pass. Min, max and clips work on the int16
+ * lanes directly. For the sums the even and odd lanes are sign
+ * extended to int32 (a and b), squares go to int64 through
+ * _mm_mul_epi32 on the even then odd int32 lanes of each.
+ */
+__attribute__((target("sse4.1")))
+static void MomentSSE41(const int16_t *frames, uint32_t nChan,
+                        uint32_t nFrames, int32_t clip, FrameMoments *out)
+{
+    const uint32_t per = 8 / nChan;
+    uint32_t i = 0;
+
+    if ((nChan <= 8) && (8 % nChan == 0))
+    {
+        const __m128i hi = _mm_set1_epi16((int16_t) (clip - 1));
+        const __m128i lo = _mm_set1_epi16((int16_t) (1 - clip));
+        __m128i vmin = _mm_set1_epi16(32767);
+        __m128i vmax = _mm_set1_epi16(-32768);
+        __m128i sq[4];
+        alignas(16) int32_t  s32[8];
+        alignas(16) int16_t  c16[8];
+        alignas(16) int16_t  mn[8], mx[8];
+        alignas(16) int64_t  q64[8];
+        int64_t  sum[8]    = {0};
+        uint64_t sumAbs[8] = {0}, sumSq[8] = {0}, clips[8] = {0};
+
+        for (uint32_t k=0; k<4; k++) sq[k] = _mm_setzero_si128();
+        while (i+per <= nFrames)
+        {
+            __m128i sa = _mm_setzero_si128(), sb = sa;
+            __m128i aa = sa, ab = sa, cl = sa;
+            for (uint32_t n=0; (n<kMomentSpill) && (i+per<=nFrames); n++, i+=per)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i *) &frames[i*nChan]);
+                __m128i a = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+                __m128i b = _mm_srai_epi32(v, 16);
+                vmin = _mm_min_epi16(vmin, v);
+                vmax = _mm_max_epi16(vmax, v);
+                cl   = _mm_sub_epi16(cl, _mm_or_si128(_mm_cmpgt_epi16(v, hi),
+                                                      _mm_cmpgt_epi16(lo, v)));
+                sa   = _mm_add_epi32(sa, a);
+                sb   = _mm_add_epi32(sb, b);
+                aa   = _mm_add_epi32(aa, _mm_abs_epi32(a));
+                ab   = _mm_add_epi32(ab, _mm_abs_epi32(b));
+                sq[0] = _mm_add_epi64(sq[0], _mm_mul_epi32(a, a));
+                a     = _mm_srli_epi64(a, 32);
+                sq[1] = _mm_add_epi64(sq[1], _mm_mul_epi32(a, a));
+                sq[2] = _mm_add_epi64(sq[2], _mm_mul_epi32(b, b));
+                b     = _mm_srli_epi64(b, 32);
+                sq[3] = _mm_add_epi64(sq[3], _mm_mul_epi32(b, b));
+            }
+            // int32 lane k of a is int16 lane 2k, of b 2k+1.
+            _mm_store_si128((__m128i *) s32, sa);
+            _mm_store_si128((__m128i *) &s32[4], sb);
+            for (uint32_t k=0; k<4; k++)
+            {
+                sum[2*k]   += s32[k];
+                sum[2*k+1] += s32[4+k];
+            }
+            _mm_store_si128((__m128i *) s32, aa);
+            _mm_store_si128((__m128i *) &s32[4], ab);
+            for (uint32_t k=0; k<4; k++)
+            {
+                sumAbs[2*k]   += (uint32_t) s32[k];
+                sumAbs[2*k+1] += (uint32_t) s32[4+k];
+            }
+            _mm_store_si128((__m128i *) c16, cl);
+            for (uint32_t j=0; j<8; j++) clips[j] += (uint16_t) c16[j];
+        }
+        // int64 lane m of sq[0] is int16 lane 4m, sq[1] 4m+2,
+        // sq[2] 4m+1 and sq[3] 4m+3.
+        for (uint32_t k=0; k<4; k++)
+        {
+            _mm_store_si128((__m128i *) &q64[2*k], sq[k]);
+        }
+        for (uint32_t m=0; m<2; m++)
+        {
+            sumSq[4*m]   = q64[m];
+            sumSq[4*m+2] = q64[2+m];
+            sumSq[4*m+1] = q64[4+m];
+            sumSq[4*m+3] = q64[6+m];
+        }
+        _mm_store_si128((__m128i *) mn, vmin);
+        _mm_store_si128((__m128i *) mx, vmax);
+        MomentLanes(8, nChan, mn, mx, sum, sumAbs, sumSq, clips, out);
+    }
+    if (i < nFrames)
+    {
+        MomentScalar(&frames[i*nChan], nChan, nFrames-i, clip, out);
+    }
+}
+
+/*
+ * AVX2, 16 samples per pass, as the SSE4.1 version.
+ */
+__attribute__((target("avx2")))
+static void MomentAVX2(const int16_t *frames, uint32_t nChan,
+                       uint32_t nFrames, int32_t clip, FrameMoments *out)
+{
+    const uint32_t per = 16 / nChan;
+    uint32_t i = 0;
+
+    if ((nChan <= 16) && (16 % nChan == 0))
+    {
+        const __m256i hi = _mm256_set1_epi16((int16_t) (clip - 1));
+        const __m256i lo = _mm256_set1_epi16((int16_t) (1 - clip));
+        __m256i vmin = _mm256_set1_epi16(32767);
+        __m256i vmax = _mm256_set1_epi16(-32768);
+        __m256i sq[4];
+        alignas(32) int32_t  s32[16];
+        alignas(32) int16_t  c16[16];
+        alignas(32) int16_t  mn[16], mx[16];
+        alignas(32) int64_t  q64[16];
+        int64_t  sum[16]    = {0};
+        uint64_t sumAbs[16] = {0}, sumSq[16] = {0}, clips[16] = {0};
+
+        for (uint32_t k=0; k<4; k++) sq[k] = _mm256_setzero_si256();
+        while (i+per <= nFrames)
+        {
+            __m256i sa = _mm256_setzero_si256(), sb = sa;
+            __m256i aa = sa, ab = sa, cl = sa;
+            for (uint32_t n=0; (n<kMomentSpill) && (i+per<=nFrames); n++, i+=per)
+            {
+                __m256i v = _mm256_loadu_si256((const __m256i *) &frames[i*nChan]);
+                __m256i a = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+                __m256i b = _mm256_srai_epi32(v, 16);
+                vmin = _mm256_min_epi16(vmin, v);
+                vmax = _mm256_max_epi16(vmax, v);
+                cl   = _mm256_sub_epi16(cl, _mm256_or_si256(
+                            _mm256_cmpgt_epi16(v, hi), _mm256_cmpgt_epi16(lo, v)));
+                sa   = _mm256_add_epi32(sa, a);
+                sb   = _mm256_add_epi32(sb, b);
+                aa   = _mm256_add_epi32(aa, _mm256_abs_epi32(a));
+                ab   = _mm256_add_epi32(ab, _mm256_abs_epi32(b));
+                sq[0] = _mm256_add_epi64(sq[0], _mm256_mul_epi32(a, a));
+                a     = _mm256_srli_epi64(a, 32);
+                sq[1] = _mm256_add_epi64(sq[1], _mm256_mul_epi32(a, a));
+                sq[2] = _mm256_add_epi64(sq[2], _mm256_mul_epi32(b, b));
+                b     = _mm256_srli_epi64(b, 32);
+                sq[3] = _mm256_add_epi64(sq[3], _mm256_mul_epi32(b, b));
+            }
+            _mm256_store_si256((__m256i *) s32, sa);
+            _mm256_store_si256((__m256i *) &s32[8], sb);
+            for (uint32_t k=0; k<8; k++)
+            {
+                sum[2*k]   += s32[k];
+                sum[2*k+1] += s32[8+k];
+            }
+            _mm256_store_si256((__m256i *) s32, aa);
+            _mm256_store_si256((__m256i *) &s32[8], ab);
+            for (uint32_t k=0; k<8; k++)
+            {
+                sumAbs[2*k]   += (uint32_t) s32[k];
+                sumAbs[2*k+1] += (uint32_t) s32[8+k];
+            }
+            _mm256_store_si256((__m256i *) c16, cl);
+            for (uint32_t j=0; j<16; j++) clips[j] += (uint16_t) c16[j];
+        }
+        for (uint32_t k=0; k<4; k++)
+        {
+            _mm256_store_si256((__m256i *) &q64[4*k], sq[k]);
+        }
+        for (uint32_t m=0; m<4; m++)
+        {
+            sumSq[4*m]   = q64[m];
+            sumSq[4*m+2] = q64[4+m];
+            sumSq[4*m+1] = q64[8+m];
+            sumSq[4*m+3] = q64[12+m];
+        }
+        _mm256_store_si256((__m256i *) mn, vmin);
+        _mm256_store_si256((__m256i *) mx, vmax);
+        MomentLanes(16, nChan, mn, mx, sum, sumAbs, sumSq, clips, out);
+    }
+    if (i < nFrames)
+    {
+        MomentScalar(&frames[i*nChan], nChan, nFrames-i, clip, out);
+    }
+}
+
+/*
+ * SSE4.1, 4 frames per pass. For stereo one 128 bit load holds
+ * 4 frames, the low half of each 32 bit lane is TIP and the high
+ * half RING, shifts pull them apart with sign extension.
+ */
+__attribute__((target("sse4.1")))
+static void ScaleSSE41(const int16_t *frames, uint32_t nChan,
+                       uint32_t nFrames, double scale,
+                       const double *window, double *dst,
+                       uint32_t dstStride)
+{
+    const __m128d s = _mm_set1_pd(scale);
+    __m128i  v, a, b;
+    __m128d  lo, hi;
+    uint32_t i = 0;
+
+    if (nChan == 1)
+    {
+        for (; i+4<=nFrames; i+=4)
+        {
+            v  = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *) &frames[i]));
+            lo = _mm_mul_pd(_mm_cvtepi32_pd(v), s);
+            hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), s);
+            if (window)
+            {
+                lo = _mm_mul_pd(lo, _mm_loadu_pd(&window[i]));
+                hi = _mm_mul_pd(hi, _mm_loadu_pd(&window[i+2]));
+            }
+            _mm_storeu_pd(&dst[i],   lo);
+            _mm_storeu_pd(&dst[i+2], hi);
+        }
+    }
+    else if (nChan == 2)
+    {
+        double *d0 = dst;
+        double *d1 = &dst[dstStride];
+        __m128d w0 = _mm_set1_pd(1.0), w1 = w0;
+        for (; i+4<=nFrames; i+=4)
+        {
+            v = _mm_loadu_si128((const __m128i *) &frames[2*i]);
+            a = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+            b = _mm_srai_epi32(v, 16);
+            if (window)
+            {
+                w0 = _mm_loadu_pd(&window[i]);
+                w1 = _mm_loadu_pd(&window[i+2]);
+            }
+            _mm_storeu_pd(&d0[i],   _mm_mul_pd(_mm_mul_pd(_mm_cvtepi32_pd(a), s), w0));
+            _mm_storeu_pd(&d0[i+2], _mm_mul_pd(_mm_mul_pd(
+                          _mm_cvtepi32_pd(_mm_srli_si128(a, 8)), s), w1));
+            _mm_storeu_pd(&d1[i],   _mm_mul_pd(_mm_mul_pd(_mm_cvtepi32_pd(b), s), w0));
+            _mm_storeu_pd(&d1[i+2], _mm_mul_pd(_mm_mul_pd(
+                          _mm_cvtepi32_pd(_mm_srli_si128(b, 8)), s), w1));
+        }
+    }
+    if (i < nFrames)
+    {
+        ScaleScalar(&frames[i*nChan], nChan, nFrames-i, scale,
+                    window ? &window[i] : NULL, &dst[i], dstStride);
+    }
+}
+
+/*
+ * AVX2, 8 frames per pass.
+ */
+__attribute__((target("avx2")))
+static void ScaleAVX2(const int16_t *frames, uint32_t nChan,
+                      uint32_t nFrames, double scale,
+                      const double *window, double *dst,
+                      uint32_t dstStride)
+{
+    const __m256d s = _mm256_set1_pd(scale);
+    __m256i  v, a, b;
+    __m256d  w0 = _mm256_set1_pd(1.0), w1 = w0;
+    uint32_t i = 0;
+
+    if (nChan == 1)
+    {
+        for (; i+8<=nFrames; i+=8)
+        {
+            v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &frames[i]));
+            if (window)
+            {
+                w0 = _mm256_loadu_pd(&window[i]);
+                w1 = _mm256_loadu_pd(&window[i+4]);
+            }
+            _mm256_storeu_pd(&dst[i], _mm256_mul_pd(_mm256_mul_pd(
+                   _mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), s), w0));
+            _mm256_storeu_pd(&dst[i+4], _mm256_mul_pd(_mm256_mul_pd(
+                   _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), s), w1));
+        }
+    }
+    else if (nChan == 2)
+    {
+        double *d0 = dst;
+        double *d1 = &dst[dstStride];
+        for (; i+8<=nFrames; i+=8)
+        {
+            v = _mm256_loadu_si256((const __m256i *) &frames[2*i]);
+            a = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+            b = _mm256_srai_epi32(v, 16);
+            if (window)
+            {
+                w0 = _mm256_loadu_pd(&window[i]);
+                w1 = _mm256_loadu_pd(&window[i+4]);
+            }
+            _mm256_storeu_pd(&d0[i], _mm256_mul_pd(_mm256_mul_pd(
+                   _mm256_cvtepi32_pd(_mm256_castsi256_si128(a)), s), w0));
+            _mm256_storeu_pd(&d0[i+4], _mm256_mul_pd(_mm256_mul_pd(
+                   _mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1)), s), w1));
+            _mm256_storeu_pd(&d1[i], _mm256_mul_pd(_mm256_mul_pd(
+                   _mm256_cvtepi32_pd(_mm256_castsi256_si128(b)), s), w0));
+            _mm256_storeu_pd(&d1[i+4], _mm256_mul_pd(_mm256_mul_pd(
+                   _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1)), s), w1));
+        }
+    }
+    if (i < nFrames)
+    {
+        ScaleScalar(&frames[i*nChan], nChan, nFrames-i, scale,
+                    window ? &window[i] : NULL, &dst[i], dstStride);
+    }
+}
+
+/*
+ * SSE4.1 float, 4 frames per pass, one register per channel.
+ */
+__attribute__((target("sse4.1")))
+static void ScaleSSE41F(const int16_t *frames, uint32_t nChan,
+                        uint32_t nFrames, float scale,
+                        const float *window, float *dst,
+                        uint32_t dstStride)
+{
+    const __m128 s = _mm_set1_ps(scale);
+    __m128   w = _mm_set1_ps(1.0f);
+    __m128i  v;
+    uint32_t i = 0;
+
+    if (nChan == 1)
+    {
+        for (; i+4<=nFrames; i+=4)
+        {
+            v = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i *) &frames[i]));
+            if (window) w = _mm_loadu_ps(&window[i]);
+            _mm_storeu_ps(&dst[i], _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(v), s), w));
+        }
+    }
+    else if (nChan == 2)
+    {
+        float *d0 = dst;
+        float *d1 = &dst[dstStride];
+        for (; i+4<=nFrames; i+=4)
+        {
+            v = _mm_loadu_si128((const __m128i *) &frames[2*i]);
+            if (window) w = _mm_loadu_ps(&window[i]);
+            _mm_storeu_ps(&d0[i], _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(
+                          _mm_srai_epi32(_mm_slli_epi32(v, 16), 16)), s), w));
+            _mm_storeu_ps(&d1[i], _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(
+                          _mm_srai_epi32(v, 16)), s), w));
+        }
+    }
+    if (i < nFrames)
+    {
+        ScaleScalarF(&frames[i*nChan], nChan, nFrames-i, scale,
+                     window ? &window[i] : NULL, &dst[i], dstStride);
+    }
+}
+
+/*
+ * AVX2 float, 8 frames per pass, one register per channel.
+ */
+__attribute__((target("avx2")))
+static void ScaleAVX2F(const int16_t *frames, uint32_t nChan,
+                       uint32_t nFrames, float scale,
+                       const float *window, float *dst,
+                       uint32_t dstStride)
+{
+    const __m256 s = _mm256_set1_ps(scale);
+    __m256   w = _mm256_set1_ps(1.0f);
+    __m256i  v;
+    uint32_t i = 0;
+
+    if (nChan == 1)
+    {
+        for (; i+8<=nFrames; i+=8)
+        {
+            v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) &frames[i]));
+            if (window) w = _mm256_loadu_ps(&window[i]);
+            _mm256_storeu_ps(&dst[i], _mm256_mul_ps(_mm256_mul_ps(
+                             _mm256_cvtepi32_ps(v), s), w));
+        }
+    }
+    else if (nChan == 2)
+    {
+        float *d0 = dst;
+        float *d1 = &dst[dstStride];
+        for (; i+8<=nFrames; i+=8)
+        {
+            v = _mm256_loadu_si256((const __m256i *) &frames[2*i]);
+            if (window) w = _mm256_loadu_ps(&window[i]);
+            _mm256_storeu_ps(&d0[i], _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(
+                   _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16)), s), w));
+            _mm256_storeu_ps(&d1[i], _mm256_mul_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(
+                   _mm256_srai_epi32(v, 16)), s), w));
+        }
+    }
+    if (i < nFrames)
+    {
+        ScaleScalarF(&frames[i*nChan], nChan, nFrames-i, scale,
+                     window ? &window[i] : NULL, &dst[i], dstStride);
+    }
+}
+#endif
+
+static const char *KernelNames[] = {"scalar", "sse4.1", "avx2"};
+static int     Selected = kScaleAuto;
+static ScaleFn Kernel   = NULL;
+static ScaleFnF KernelF = NULL;
+static MomentFn KernelM = NULL;
+
+/*
+ * Pick a kernel, falling back when the CPU can not run the one asked for.
+ */
+int SetScaleKernel(int isa)
+{
+    int best = kScaleScalar;
+#ifdef SCALE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) best = kScaleSSE41;
+    if (__builtin_cpu_supports("avx2"))   best = kScaleAVX2;
+#endif
+    if ((isa < kScaleScalar) || (isa > best))
+    {
+        isa = best;
+    }
+    switch (isa)
+    {
+#ifdef SCALE_X86
+    case kScaleAVX2:
+        Kernel  = ScaleAVX2;
+        KernelF = ScaleAVX2F;
+        KernelM = MomentAVX2;
+        break;
+    case kScaleSSE41:
+        Kernel  = ScaleSSE41;
+        KernelF = ScaleSSE41F;
+        KernelM = MomentSSE41;
+        break;
+#endif
+    default:
+        isa     = kScaleScalar;
+        Kernel  = ScaleScalar;
+        KernelF = ScaleScalarF;
+        KernelM = MomentScalar;
+        break;
+    }
+    Selected = isa;
+    return Selected;
+}
+
+/*
+ * First use picks the best kernel unless one was forced already. A
+ * function local static, so threads arriving together wait for the
+ * one doing it and then see the same pointers.
+ */
+static inline void Resolve(void)
+{
+    static const int once = (Kernel == NULL) ?
+        SetScaleKernel(kScaleAuto) : Selected;
+    (void) once;
+}
+
+const char* ScaleKernelName(void)
+{
+    Resolve();
+    return KernelNames[Selected];
+}
+
+void ScaleFrames(const int16_t *frames, uint32_t nChan, uint32_t nFrames,
+                 double scale, const double *window,
+                 double *dst, uint32_t dstStride)
+{
+    Resolve();
+    Kernel(frames, nChan, nFrames, scale, window, dst, dstStride);
+}
+
+void ScaleFramesF(const int16_t *frames, uint32_t nChan, uint32_t nFrames,
+                  float scale, const float *window,
+                  float *dst, uint32_t dstStride)
+{
+    Resolve();
+    KernelF(frames, nChan, nFrames, scale, window, dst, dstStride);
+}
+
+void MomentFrames(const int16_t *frames, uint32_t nChan, uint32_t nFrames,
+                  int32_t clip, FrameMoments *out)
+{
+    Resolve();
+    for (uint32_t c=0; c<nChan; c++)
+    {
+        out[c].min    = 32767;
+        out[c].max    = -32768;
+        out[c].sum    = 0;
+        out[c].sumAbs = 0;
+        out[c].sumSq  = 0;
+        out[c].clips  = 0;
+    }
+    KernelM(frames, nChan, nFrames, clip, out);
+}
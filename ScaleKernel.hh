@@ -0,0 +1,84 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : ScaleKernel.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Fused de-interleave, int16 to floating point,
+ *               scale and window. One pass over the interleaved
+ *               input writes every channel to its own planar row.
+ *               SSE4.1 and AVX2 versions are picked at run time,
+ *               with a scalar fallback for everything else.
+ *
+ * Restrictions/Limitations :
+ *   Mono and stereo are vectorised, more channels use the scalar
+ *   loop. x86 only for the vector paths.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Single precision output, twice the lanes per vector.
+ * 17-Oct-26 CBL MomentFrames, per channel block sums for StreamStats
+ *               on the same dispatch. 1, 2, 4 and 8 channels are
+ *               vectorised.
+ * 17-Oct-26 CBL First use selects the kernel once, thread safe.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __SCALEKERNEL_hh_
+#define __SCALEKERNEL_hh_
+#  include <cstdint>
+
+/*! Instruction sets the kernel can use. */
+enum {kScaleAuto=-1, kScaleScalar=0, kScaleSSE41, kScaleAVX2};
+
+/*!
+ * For every channel c and frame i < nFrames
+ *   dst[c*dstStride + i] = scale * frames[i*nChan + c] * window[i]
+ * window may be NULL.
+ */
+void ScaleFrames(const int16_t *frames, uint32_t nChan, uint32_t nFrames,
+                 double scale, const double *window,
+                 double *dst, uint32_t dstStride);
+
+/*!
+ * Same again with float output for the single precision path.
+ */
+void ScaleFramesF(const int16_t *frames, uint32_t nChan, uint32_t nFrames,
+                  float scale, const float *window,
+                  float *dst, uint32_t dstStride);
+
+/*!
+ * Exact per channel sums over one block. Integer throughout, so
+ * -32768 is no different to any other value.
+ */
+typedef struct
+{
+    int32_t  min;
+    int32_t  max;
+    int64_t  sum;       /*! x */
+    uint64_t sumAbs;    /*! |x| */
+    uint64_t sumSq;     /*! x^2 */
+    uint64_t clips;     /*! x >= clip or x <= -clip */
+} FrameMoments;
+
+/*!
+ * out[c] for every channel c < nChan over nFrames interleaved
+ * frames. clip is 1 to 32768.
+ */
+void MomentFrames(const int16_t *frames, uint32_t nChan, uint32_t nFrames,
+                  int32_t clip, FrameMoments *out);
+
+/*!
+ * Force a particular instruction set, kScaleAuto picks the best
+ * the CPU supports. Returns the one actually selected. Not thread
+ * safe, only call it while nothing else is using the kernels.
+ * Without it the best is picked on first use, safely.
+ */
+int         SetScaleKernel(int isa);
+/*! Name of the selected instruction set. */
+const char* ScaleKernelName(void);
+#endif
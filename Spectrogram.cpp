@@ -0,0 +1,278 @@
+/********************************************************************
+ *
+ * Module Name : Spectrogram.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Rolling STFT.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+// Local Includes.
+#include "Spectrogram.hh"
+#include "Wisdom.hh"
+#include "ScaleKernel.hh"
+#include "debug.h"
+
+const float Spectrogram::kFloor = 1.0e-10f;
+
+/**
+ ******************************************************************
+ *
+ * Function Name : Spectrogram constructor
+ *
+ * Description : Allocate everything the transforms need and make
+ *               the one plan they all use.
+ *
+ * Inputs : Segment    - FFT length
+ *          Hop        - frames between columns, clipped to 1..Segment
+ *          NChan      - interleaved channels
+ *          Window     - Welch window enum
+ *          SampleRate - Hz
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+Spectrogram::Spectrogram(uint32_t Segment, uint32_t Hop, uint32_t NChan,
+                         int Window, double SampleRate)
+{
+    SET_DEBUG_STACK;
+    double *w;
+    double  s1 = 0.0;
+
+    fSegment    = (Segment < 2) ? 2 : Segment;
+    fHop        = (Hop < 1) ? 1 : ((Hop > fSegment) ? fSegment : Hop);
+    fNChannels  = (NChan < 1) ? 1 : NChan;
+    fSampleRate = SampleRate;
+    fScale      = 1.0;
+    fDecibels   = false;
+    fFill       = 0;
+    fFrame      = 0;
+    fCount      = 0;
+
+    w           = new double[fSegment];
+    fWindowType = Welch::MakeWindow(Window, fSegment, w);
+    fWindow     = (float *) fftwf_malloc(fSegment * sizeof(float));
+    for (uint32_t i=0; i<fSegment; i++)
+    {
+        fWindow[i] = (float) w[i];
+        s1 += w[i];
+    }
+    delete[] w;
+    fNorm = (float) (2.0 / s1);
+
+    fHistory = (float *) fftwf_malloc(fNChannels * fSegment * sizeof(float));
+    fIN      = (float *) fftwf_malloc(fNChannels * fSegment * sizeof(float));
+    fOUT     = (fftwf_complex *) fftwf_malloc(fNChannels * NBins() *
+                                              sizeof(fftwf_complex));
+    fFFT     = Wisdom::PlanR2C(fSegment, fNChannels, fIN, fOUT);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Spectrogram destructor
+ *
+ * Description : Free everything.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+Spectrogram::~Spectrogram(void)
+{
+    SET_DEBUG_STACK;
+    Wisdom::Destroy(fFFT);
+    fftwf_free(fIN);
+    fftwf_free(fOUT);
+    fftwf_free(fWindow);
+    fftwf_free(fHistory);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AddBlock
+ *
+ * Description : De-interleave into the per channel history. Each
+ *               time it fills a column is made and the history slides
+ *               forward by Hop. The column store only grows when a
+ *               block is longer than any before it.
+ *
+ * Inputs : samples - interleaved int16 frames
+ *          nFrames - number of frames
+ *
+ * Returns : number of columns made from this block
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t Spectrogram::AddBlock(const int16_t *samples, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    uint32_t done = 0;
+    uint32_t i    = 0;
+    uint32_t keep = fSegment - fHop;
+    uint32_t most = (fFill + nFrames) / fHop + 1;
+    uint32_t m, c;
+    float   *h;
+
+    if (fColumnFrame.size() < most)
+    {
+        fColumnFrame.resize(most);
+        fColumns.resize((size_t) most * fNChannels * NBins());
+    }
+
+    while (i < nFrames)
+    {
+        m = nFrames - i;
+        if (m > fSegment - fFill) m = fSegment - fFill;
+        ScaleFramesF(&samples[i*fNChannels], fNChannels, m, 1.0f, NULL,
+                     &fHistory[fFill], fSegment);
+        fFill  += m;
+        fFrame += m;
+        i      += m;
+
+        if (fFill == fSegment)
+        {
+            fColumnFrame[done] = fFrame - fSegment;
+            Transform(done);
+            done++;
+            for (c=0; c<fNChannels; c++)
+            {
+                h = &fHistory[c*fSegment];
+                memmove(h, &h[fHop], keep * sizeof(float));
+            }
+            fFill = keep;
+        }
+    }
+    fCount += done;
+    SET_DEBUG_STACK;
+    return done;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Transform
+ *
+ * Description : Remove the segment mean, window, transform every
+ *               channel at once and turn the result into magnitudes.
+ *               In dB the power is logged directly, which saves the
+ *               square root.
+ *
+ * Inputs : n - column to fill
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void Spectrogram::Transform(uint32_t n)
+{
+    SET_DEBUG_STACK;
+    const float         *h;
+    const fftwf_complex *out;
+    float               *in, *col;
+    double               sum;
+    float                mean, p;
+    uint32_t             c, i;
+    uint32_t             nb   = NBins();
+    float                norm = fNorm * (float) fScale;
+    float                db   = 20.0f * log10f(norm);
+    float                lo   = 20.0f * log10f(kFloor);
+    float                half = 20.0f * log10f(2.0f);
+
+    for (c=0; c<fNChannels; c++)
+    {
+        h   = &fHistory[c*fSegment];
+        in  = &fIN[c*fSegment];
+        sum = 0.0;
+        for (i=0; i<fSegment; i++)
+        {
+            sum += h[i];
+        }
+        mean = (float) (sum / (double) fSegment);
+        for (i=0; i<fSegment; i++)
+        {
+            in[i] = (h[i] - mean) * fWindow[i];
+        }
+    }
+    fftwf_execute(fFFT);
+
+    col = &fColumns[(size_t) n * fNChannels * nb];
+    for (c=0; c<fNChannels; c++)
+    {
+        out = &fOUT[c*nb];
+        if (fDecibels)
+        {
+            for (i=0; i<nb; i++)
+            {
+                p = out[i][0]*out[i][0] + out[i][1]*out[i][1];
+                p = (p > 0.0f) ? 10.0f * log10f(p) + db : lo;
+                col[i] = (p > lo) ? p : lo;
+            }
+            // DC, and Nyquist for even lengths, are not folded.
+            col[0] = (col[0] - half > lo) ? col[0] - half : lo;
+            if ((fSegment % 2) == 0)
+            {
+                col[nb-1] = (col[nb-1] - half > lo) ? col[nb-1] - half : lo;
+            }
+        }
+        else
+        {
+            for (i=0; i<nb; i++)
+            {
+                col[i] = norm * sqrtf(out[i][0]*out[i][0] +
+                                      out[i][1]*out[i][1]);
+            }
+            col[0] *= 0.5f;
+            if ((fSegment % 2) == 0) col[nb-1] *= 0.5f;
+        }
+        col += nb;
+    }
+    SET_DEBUG_STACK;
+}
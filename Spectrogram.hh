@@ -0,0 +1,114 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : Spectrogram.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Rolling short time Fourier transform. Blocks of
+ *               interleaved samples go in as they arrive, and every
+ *               Hop frames the last Segment frames of each channel are
+ *               mean removed, windowed and transformed. Each transform
+ *               gives one column, the one sided magnitude of every
+ *               channel, in counts (times Scale) or in dB.
+ *
+ *               The magnitude is scaled by 2/sum(window) so a sine of
+ *               amplitude A reads A in its bin whatever the window.
+ *
+ *               One single precision plan does all the channels, and
+ *               the history, FFT buffers and the columns of the
+ *               current block are allocated once, so steady state
+ *               costs no allocation at all.
+ *
+ * Restrictions/Limitations :
+ *   Hop is 1 to Segment. One thread.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __SPECTROGRAM_hh_
+#define __SPECTROGRAM_hh_
+#  include <cstdint>
+#  include <vector>
+#  include "fftw3.h"
+#  include "Welch.hh"
+
+class Spectrogram
+{
+public:
+    /*!
+     * Segment    - FFT length, samples per channel
+     * Hop        - frames between columns
+     * NChan      - channels in the interleaved input
+     * Window     - Welch window enum
+     * SampleRate - Hz
+     */
+    Spectrogram(uint32_t Segment, uint32_t Hop, uint32_t NChan=1,
+                int Window=Welch::kHann, double SampleRate=1.0);
+    ~Spectrogram(void);
+
+    /*!
+     * Consume nFrames interleaved frames. Returns the number of
+     * columns completed during this block, read them with Column
+     * and ColumnFrame before the next call.
+     */
+    uint32_t AddBlock(const int16_t *samples, uint32_t nFrames);
+
+    /*! Column i of the last block, NChannels x NBins, channel major. */
+    inline const float* Column(uint32_t i) const
+	{return &fColumns[i*fNChannels*NBins()];};
+    /*! Frame index (from the first AddBlock) of its first sample. */
+    inline uint64_t ColumnFrame(uint32_t i) const {return fColumnFrame[i];};
+    /*! Columns made since construction. */
+    inline uint64_t Count(void)     const {return fCount;};
+
+    inline uint32_t NBins(void)     const {return fSegment/2 + 1;};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    inline uint32_t Segment(void)   const {return fSegment;};
+    inline uint32_t Hop(void)       const {return fHop;};
+    inline int      Window(void)    const {return fWindowType;};
+    inline double   SampleRate(void) const {return fSampleRate;};
+    inline double   BinWidth(void)  const {return fSampleRate/(double)fSegment;};
+
+    /*! counts -> physical units */
+    inline void   SetScale(double v) {fScale = v;};
+    inline double GetScale(void) const {return fScale;};
+    /*! 20 log10 of the magnitude rather than the magnitude. */
+    inline void SetDecibels(bool v) {fDecibels = v;};
+    inline bool Decibels(void) const {return fDecibels;};
+
+    /*! Smallest magnitude before the log, -200 dB. */
+    static const float kFloor;
+
+private:
+    /*! Window and transform the full history into column n. */
+    void Transform(uint32_t n);
+
+    uint32_t  fSegment;
+    uint32_t  fHop;
+    uint32_t  fNChannels;
+    int       fWindowType;
+    double    fSampleRate;
+    double    fScale;
+    bool      fDecibels;
+
+    float    *fWindow;       /*! Segment long */
+    float    *fHistory;      /*! NChan x Segment, incoming samples */
+    uint32_t  fFill;         /*! Samples in fHistory per channel */
+    uint64_t  fFrame;        /*! Frames consumed */
+    uint64_t  fCount;
+    float     fNorm;         /*! 2/sum(window) */
+
+    std::vector<float>    fColumns;     /*! Columns of this block */
+    std::vector<uint64_t> fColumnFrame;
+
+    fftwf_plan     fFFT;
+    float         *fIN;      /*! NChan x Segment, planar */
+    fftwf_complex *fOUT;     /*! NChan x NBins */
+};
+#endif
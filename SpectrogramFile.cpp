@@ -0,0 +1,568 @@
+/********************************************************************
+ *
+ * Module Name : SpectrogramFile.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Tiled, memmap friendly spectrogram file.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   IEEE 754-2008 binary16 for the f2 format.
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Local Includes.
+#include "SpectrogramFile.hh"
+#include "debug.h"
+
+static const char *FormatNames[] = {"f4", "f2", "u1"};
+
+/**
+ ******************************************************************
+ *
+ * Function Name : SpectrogramFile constructor
+ *
+ * Description : Size the tiles and the tile buffer.
+ *
+ * Inputs : NChan       - channels per column
+ *          NBins       - bins per channel
+ *          TileColumns - columns per tile
+ *          Format      - kFloat32, kFloat16 or kUInt8
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+SpectrogramFile::SpectrogramFile(uint32_t NChan, uint32_t NBins,
+                                 uint32_t TileColumns, int Format) : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("SpectrogramFile");
+    SetError(); // No error.
+
+    fFD          = -1;
+    fNChannels   = NChan;
+    fNBins       = NBins;
+    fTileColumns = (TileColumns > 0) ? TileColumns : 1;
+    fFormat      = ((Format < kFloat32) || (Format > kUInt8)) ? kFloat16 : Format;
+    switch (fFormat)
+    {
+    case kFloat32:
+        fValueBytes = sizeof(float);
+        break;
+    case kUInt8:
+        fValueBytes = sizeof(uint8_t);
+        break;
+    default:
+        fValueBytes = sizeof(uint16_t);
+        break;
+    }
+    // Rounded up so every tile's Time stays aligned.
+    fTileBytes   = kTileHeader + fTileColumns * NChan * NBins * fValueBytes;
+    fTileBytes   = (fTileBytes + 7) & ~((size_t) 7);
+    fTile        = new char[fTileBytes];
+    fFilled      = 0;
+    fColumns     = 0;
+
+    fSampleRate  = 0.0;
+    fFFTLength   = 2*(NBins-1);
+    fHop         = fFFTLength;
+    fDecibels    = false;
+    fMin         = 0.0;
+    fMax         = 1.0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SpectrogramFile destructor
+ *
+ * Description : Write the last tile and close.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+SpectrogramFile::~SpectrogramFile(void)
+{
+    SET_DEBUG_STACK;
+    Close();
+    delete[] fTile;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FormatType
+ *
+ * Description : Config string to format enum.
+ *
+ * Inputs : Name - f4, f2 or u1, float32, float16 and uint8 also do
+ *
+ * Returns : format enum, kFloat16 if not recognised
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int SpectrogramFile::FormatType(const char *Name)
+{
+    if (Name == NULL) return kFloat16;
+    for (int i=kFloat32; i<=kUInt8; i++)
+    {
+        if (strcasecmp(Name, FormatNames[i]) == 0) return i;
+    }
+    if (strcasecmp(Name, "float32") == 0) return kFloat32;
+    if (strcasecmp(Name, "uint8") == 0)   return kUInt8;
+    return kFloat16;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FormatName
+ *
+ * Description : Format enum to header string, the numpy type code.
+ *
+ * Inputs : Format - enum
+ *
+ * Returns : name
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+const char* SpectrogramFile::FormatName(int Format)
+{
+    if ((Format < kFloat32) || (Format > kUInt8))
+    {
+        Format = kFloat16;
+    }
+    return FormatNames[Format];
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Half
+ *
+ * Description : float to IEEE binary16 bits. Rounds to nearest
+ *               even, too large goes to infinity, too small through
+ *               the subnormals to zero.
+ *
+ * Inputs : v - value
+ *
+ * Returns : binary16 bit pattern
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint16_t SpectrogramFile::Half(float v)
+{
+    uint32_t x, m, q, rem, mid, shift;
+    int32_t  e;
+    uint16_t sign;
+
+    memcpy(&x, &v, sizeof(x));
+    sign = (x >> 16) & 0x8000;
+    m    = x & 0x007FFFFF;
+    if (((x >> 23) & 0xFF) == 0xFF)
+    {
+        // Inf stays inf, NaN stays a quiet NaN.
+        return sign | 0x7C00 | (m ? 0x0200 : 0);
+    }
+    e = (int32_t) ((x >> 23) & 0xFF) - 127 + 15;
+    if (e >= 31) return sign | 0x7C00;
+    if (e <= 0)
+    {
+        if (e < -10) return sign;
+        m    |= 0x00800000;
+        shift = 14 - e;
+        q     = m >> shift;
+        rem   = m & ((1u << shift) - 1);
+        mid   = 1u << (shift - 1);
+    }
+    else
+    {
+        q     = ((uint32_t) e << 10) | (m >> 13);
+        rem   = m & 0x1FFF;
+        mid   = 0x1000;
+    }
+    // A carry out of the mantissa is the right answer, even into inf.
+    if ((rem > mid) || ((rem == mid) && (q & 1))) q++;
+    return sign | (uint16_t) q;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : FormatHeader
+ *
+ * Description : Everything a reader needs to build the tile dtype,
+ *               the time and frequency axes and undo the u1 scaling.
+ *
+ * Inputs : header - kHeaderBytes to fill, zero padded
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void SpectrogramFile::FormatHeader(char *header)
+{
+    SET_DEBUG_STACK;
+    ostringstream oss;
+    char    msg[64];
+    char    width[32];
+    char    column[32];
+    time_t  now;
+
+    time(&now);
+    strftime (msg, sizeof(msg), "%F %T", gmtime(&now));
+    snprintf(width, sizeof(width), "%.6f",
+             (fFFTLength > 0) ? fSampleRate/(double) fFFTLength : 0.0);
+    snprintf(column, sizeof(column), "%.9f",
+             (fSampleRate > 0.0) ? (double) fHop/fSampleRate : 0.0);
+    oss << "SpectrogramFile: 1" << endl
+        << "Created: " << msg << endl
+        << "Units: " << (fDecibels ? "dB" : "magnitude") << endl
+        << "NChannels: " << fNChannels << endl
+        << "NBins: " << fNBins << endl
+        << "FFTLength: " << fFFTLength << endl
+        << "Hop: " << fHop << endl
+        << "SampleRate: " << fSampleRate << endl
+        << "BinWidth: " << width << endl
+        << "ColumnSeconds: " << column << endl
+        << "Window: " << fWindow << endl
+        << "Format: " << FormatName(fFormat) << endl
+        << "Min: " << fMin << endl
+        << "Max: " << fMax << endl
+        << "TileColumns: " << fTileColumns << endl
+        << "HeaderBytes: " << kHeaderBytes << endl
+        << "TileBytes: " << fTileBytes << endl
+        << "Tile: <f8 Time, <u8 Frame, <u4 Columns, <u4 pad, <"
+        << FormatName(fFormat) << " Data[TileColumns][NChannels][NBins]"
+        << endl
+        << "Note: " << fNote.substr(0, 64) << endl;
+
+    size_t n = oss.str().size();
+    if (n > kHeaderBytes) n = kHeaderBytes;
+    memset(header, 0, kHeaderBytes);
+    memcpy(header, oss.str().data(), n);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Start a file. To append, the existing header must
+ *               describe the same tiles, and a tile cut short by a
+ *               crash is dropped so the file is whole tiles again.
+ *
+ * Inputs : Name   - file to create or add to
+ *          Append - add to Name if it is already there
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_FILE, EWRITE, EHEADER if the file to append
+ *                    to has a different layout
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool SpectrogramFile::Open(const char *Name, bool Append)
+{
+    SET_DEBUG_STACK;
+    char    header[kHeaderBytes];
+    char    old[kHeaderBytes+1];
+    off_t   size;
+    const char *keys[] = {"Units:", "NChannels:", "NBins:", "FFTLength:",
+                          "Hop:", "SampleRate:", "Format:", "Min:", "Max:",
+                          "TileColumns:", "TileBytes:"};
+
+    Close();
+    fColumns = 0;
+    fFilled  = 0;
+    FormatHeader(header);
+
+    if (Append)
+    {
+        fFD = open(Name, O_RDWR);
+        if ((fFD >= 0) && ((size = lseek(fFD, 0, SEEK_END)) > 0))
+        {
+            memset(old, 0, sizeof(old));
+            if (pread(fFD, old, kHeaderBytes, 0) != (ssize_t) kHeaderBytes)
+            {
+                size = 0;
+            }
+            // Every line that fixes the tile layout must match.
+            for (size_t k=0; (size > 0) && (k<sizeof(keys)/sizeof(keys[0])); k++)
+            {
+                const char *a = strstr(header, keys[k]);
+                const char *b = strstr(old, keys[k]);
+                if ((b == NULL) ||
+                    (strncmp(a, b, strcspn(a, "\n") + 1) != 0))
+                {
+                    SetError(EHEADER, __LINE__);
+                    close(fFD);
+                    fFD = -1;
+                    SET_DEBUG_STACK;
+                    return false;
+                }
+            }
+        }
+        if ((fFD >= 0) && (size >= (off_t) kHeaderBytes))
+        {
+            size = kHeaderBytes +
+                ((size - kHeaderBytes) / fTileBytes) * fTileBytes;
+            if ((ftruncate(fFD, size) != 0) ||
+                (lseek(fFD, size, SEEK_SET) != size))
+            {
+                SetError(EWRITE, __LINE__);
+                close(fFD);
+                fFD = -1;
+                SET_DEBUG_STACK;
+                return false;
+            }
+            SET_DEBUG_STACK;
+            return true;
+        }
+        if (fFD >= 0)
+        {
+            close(fFD);
+            fFD = -1;
+        }
+    }
+
+    fFD = open(Name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fFD < 0)
+    {
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    if (write(fFD, header, kHeaderBytes) != (ssize_t) kHeaderBytes)
+    {
+        SetError(EWRITE, __LINE__);
+        close(fFD);
+        fFD = -1;
+        SET_DEBUG_STACK;
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Write the partly filled tile and close the file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void SpectrogramFile::Close(void)
+{
+    SET_DEBUG_STACK;
+    if (fFD < 0) return;
+    if (fFilled > 0) WriteTile();
+    close(fFD);
+    fFD = -1;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Append
+ *
+ * Description : Convert a column into the tile. The first column
+ *               of a tile stamps it, the unused part of the last tile
+ *               is zeroed when it is written.
+ *
+ * Inputs : Time   - UTC of the first sample in the column
+ *          Frame  - stream index of that sample
+ *          column - NChannels*NBins values, channel major
+ *
+ * Returns : false if not open or the tile could not be written
+ *
+ * Error Conditions : EWRITE
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool SpectrogramFile::Append(double Time, uint64_t Frame, const float *column)
+{
+    SET_DEBUG_STACK;
+    size_t   n = (size_t) fNChannels * fNBins;
+    char    *dst;
+    uint16_t *h;
+    uint8_t  *u;
+    float    q, scale;
+
+    if (fFD < 0) return false;
+    if (fFilled == 0)
+    {
+        memcpy(fTile, &Time, sizeof(double));
+        memcpy(fTile + sizeof(double), &Frame, sizeof(uint64_t));
+    }
+    dst = fTile + kTileHeader + fFilled * n * fValueBytes;
+    switch (fFormat)
+    {
+    case kFloat32:
+        memcpy(dst, column, n * sizeof(float));
+        break;
+    case kUInt8:
+        u     = (uint8_t *) dst;
+        scale = (fMax > fMin) ? (float) (255.0 / (fMax - fMin)) : 0.0f;
+        for (size_t i=0; i<n; i++)
+        {
+            q = (column[i] - (float) fMin) * scale;
+            u[i] = (q <= 0.0f) ? 0 : ((q >= 255.0f) ? 255 :
+                                      (uint8_t) lrintf(q));
+        }
+        break;
+    default:
+        h = (uint16_t *) dst;
+        for (size_t i=0; i<n; i++)
+        {
+            h[i] = Half(column[i]);
+        }
+        break;
+    }
+    fFilled++;
+    fColumns++;
+    if (fFilled == fTileColumns)
+    {
+        SET_DEBUG_STACK;
+        return WriteTile();
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WriteTile
+ *
+ * Description : One write(2) for the tile, with its column count
+ *               and the unused columns zeroed so the file is
+ *               reproducible.
+ *
+ * Inputs : none
+ *
+ * Returns : true if the tile reached the file
+ *
+ * Error Conditions : EWRITE, the tile is dropped
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool SpectrogramFile::WriteTile(void)
+{
+    SET_DEBUG_STACK;
+    size_t      used = kTileHeader +
+        (size_t) fFilled * fNChannels * fNBins * fValueBytes;
+    size_t      n    = fTileBytes;
+    const char *p    = fTile;
+    uint32_t    pad  = 0;
+    ssize_t     rc;
+    bool        ok   = true;
+
+    memcpy(fTile + 2*sizeof(uint64_t), &fFilled, sizeof(uint32_t));
+    memcpy(fTile + 2*sizeof(uint64_t) + sizeof(uint32_t), &pad,
+           sizeof(uint32_t));
+    memset(fTile + used, 0, fTileBytes - used);
+    while ((fFD >= 0) && (n > 0))
+    {
+        rc = write(fFD, p, n);
+        if (rc <= 0)
+        {
+            SetError(EWRITE, __LINE__);
+            ok = false;
+            break;
+        }
+        p += rc;
+        n -= rc;
+    }
+    fFilled = 0;
+    SET_DEBUG_STACK;
+    return ok;
+}
@@ -0,0 +1,135 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : SpectrogramFile.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Appendable tiled file of spectrogram columns. The
+ *               file starts with a fixed size ASCII header of
+ *               "Key: value" lines, as SpectrumFile, followed by fixed
+ *               size tiles of TileColumns consecutive columns:
+ *
+ *                 f8  Time     UTC seconds of the first column
+ *                 u8  Frame    stream index of its first sample
+ *                 u4  Columns  columns used, TileColumns but the last
+ *                 u4  pad
+ *                 Data[TileColumns][NChannels][NBins]
+ *
+ *               padded to a multiple of 8 bytes (TileBytes). Column j
+ *               of a tile is Hop frames after column j-1. Data is
+ *               stored as f4, f2 (IEEE half) or u1, where
+ *
+ *                 value = Min + u1 * (Max - Min) / 255
+ *
+ *               Tiles are whole, so tile k is at HeaderBytes +
+ *               k*TileBytes and a viewer finds a time range from the
+ *               tile Times alone, then maps just those tiles.
+ *
+ * Restrictions/Limitations :
+ *   One thread per file. Metadata is fixed once the file is open.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __SPECTROGRAMFILE_hh_
+#define __SPECTROGRAMFILE_hh_
+#  include <cstdint>
+#  include <string>
+#  include "CObject.hh"
+
+class SpectrogramFile : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_FILE=1, EWRITE, EHEADER};
+    /*! How each value is stored. */
+    enum {kFloat32=0, kFloat16, kUInt8};
+
+    /*!
+     * NChan x NBins values per column, TileColumns columns per tile,
+     * stored as Format.
+     */
+    SpectrogramFile(uint32_t NChan, uint32_t NBins, uint32_t TileColumns=64,
+                    int Format=kFloat16);
+    /*! Write the last tile and close. */
+    ~SpectrogramFile(void);
+
+    /* Metadata for the header, set before Open. */
+    inline void SetSampleRate(double v)     {fSampleRate = v;};
+    inline void SetFFTLength(uint32_t v)    {fFFTLength = v;};
+    inline void SetHop(uint32_t v)          {fHop = v;};
+    inline void SetWindow(const char *v)    {fWindow = v ? v : "";};
+    inline void SetDecibels(bool v)         {fDecibels = v;};
+    /*! u1 range, values outside are clipped. */
+    inline void SetRange(double Min, double Max) {fMin = Min; fMax = Max;};
+    inline void SetNote(const char *v)      {fNote = v ? v : "";};
+
+    /*!
+     * Create Name and write the header, closing any open file. With
+     * Append an existing file with the same layout is added to
+     * instead, anything after its last whole tile is dropped.
+     */
+    bool Open(const char *Name, bool Append=false);
+    /*! Write the partly filled tile and close. */
+    void Close(void);
+    inline bool IsOpen(void) const {return (fFD >= 0);};
+
+    /*!
+     * Add a column, NChannels*NBins floats channel major. The tile
+     * is written once it is full.
+     */
+    bool Append(double Time, uint64_t Frame, const float *column);
+
+    inline uint32_t NChannels(void)   const {return fNChannels;};
+    inline uint32_t NBins(void)       const {return fNBins;};
+    inline uint32_t TileColumns(void) const {return fTileColumns;};
+    inline size_t   TileBytes(void)   const {return fTileBytes;};
+    inline int      Format(void)      const {return fFormat;};
+    /*! Columns added since Open. */
+    inline uint64_t Columns(void)     const {return fColumns;};
+
+    /*! Size of the ASCII header. */
+    static const size_t kHeaderBytes = 1024;
+    /*! Bytes ahead of the data in each tile. */
+    static const size_t kTileHeader  = 24;
+    /*! Config string to format enum and back, f4, f2 or u1. */
+    static int          FormatType(const char *Name);
+    static const char*  FormatName(int Format);
+    /*! IEEE binary16, round to nearest even. */
+    static uint16_t     Half(float v);
+
+private:
+    /*! Header text for the current settings. */
+    void FormatHeader(char *header);
+    /*! Write the tile, however full. */
+    bool WriteTile(void);
+
+    int          fFD;
+    uint32_t     fNChannels;
+    uint32_t     fNBins;
+    uint32_t     fTileColumns;
+    int          fFormat;
+    size_t       fValueBytes;
+    size_t       fTileBytes;
+    char        *fTile;         /*! TileBytes being filled */
+    uint32_t     fFilled;       /*! Columns in fTile */
+    uint64_t     fColumns;
+
+    double       fSampleRate;
+    uint32_t     fFFTLength;
+    uint32_t     fHop;
+    std::string  fWindow;
+    bool         fDecibels;
+    double       fMin;
+    double       fMax;
+    std::string  fNote;
+};
+#endif
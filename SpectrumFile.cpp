@@ -0,0 +1,378 @@
+/********************************************************************
+ *
+ * Module Name : SpectrumFile.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Batched, memmap friendly spectral product file.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Leq kind, Frequencies header line.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Local Includes.
+#include "SpectrumFile.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : SpectrumFile constructor
+ *
+ * Description : Size the records and the batch buffer.
+ *
+ * Inputs : NChan        - channels per record
+ *          NBins        - bins per channel
+ *          BatchRecords - records per write
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+SpectrumFile::SpectrumFile(uint32_t NChan, uint32_t NBins,
+                           uint32_t BatchRecords) : CObject()
+{
+    SET_DEBUG_STACK;
+    SetName("SpectrumFile");
+    SetError(); // No error.
+
+    fFD           = -1;
+    fNChannels    = NChan;
+    fNBins        = NBins;
+    // Time and frame, then the data, rounded up to keep Time aligned.
+    fRecordBytes  = 2*sizeof(uint64_t) + NChan * NBins * sizeof(float);
+    fRecordBytes  = (fRecordBytes + 7) & ~((size_t) 7);
+    fBatchRecords = (BatchRecords > 0) ? BatchRecords : 1;
+    fBatch        = new char[fBatchRecords * fRecordBytes];
+    fBatched      = 0;
+    fRecords      = 0;
+
+    fKind         = kPower;
+    fSampleRate   = 0.0;
+    fFFTLength    = 2*(NBins-1);
+    fAverages     = 1;
+    fOverlap      = 0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SpectrumFile destructor
+ *
+ * Description : Flush and close.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+SpectrumFile::~SpectrumFile(void)
+{
+    SET_DEBUG_STACK;
+    Close();
+    delete[] fBatch;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : KindName
+ *
+ * Description : Header string for a Kind enum.
+ *
+ * Inputs : Kind - kPower, kMagnitude, kPSD or kLeq
+ *
+ * Returns : name
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+const char* SpectrumFile::KindName(int Kind)
+{
+    switch (Kind)
+    {
+    case kMagnitude:
+        return "magnitude";
+    case kPSD:
+        return "psd";
+    case kLeq:
+        return "leq";
+    default:
+        return "power";
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Open
+ *
+ * Description : Create the file and write the header. Everything
+ *               a reader needs to build the record dtype and the
+ *               frequency axis is in the header.
+ *
+ * Inputs : Name - file to create
+ *
+ * Returns : true on success
+ *
+ * Error Conditions : ENO_FILE
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool SpectrumFile::Open(const char *Name)
+{
+    SET_DEBUG_STACK;
+    ostringstream oss;
+    char    header[kHeaderBytes];
+    char    msg[64];
+    char    width[32];
+    time_t  now;
+
+    Close();
+    fFD = open(Name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fFD < 0)
+    {
+        SetError(ENO_FILE, __LINE__);
+        SET_DEBUG_STACK;
+        return false;
+    }
+    fRecords = 0;
+    fBatched = 0;
+
+    time(&now);
+    strftime (msg, sizeof(msg), "%F %T", gmtime(&now));
+    snprintf(width, sizeof(width), "%.6f",
+             (fFFTLength > 0) ? fSampleRate/(double) fFFTLength : 0.0);
+    oss << "SpectrumFile: 1" << endl
+        << "Created: " << msg << endl
+        << "Kind: " << KindName(fKind) << endl
+        << "NChannels: " << fNChannels << endl
+        << "NBins: " << fNBins << endl
+        << "FFTLength: " << fFFTLength << endl
+        << "SampleRate: " << fSampleRate << endl
+        << "BinWidth: " << width << endl
+        << "Window: " << fWindow << endl
+        << "Averages: " << fAverages << endl
+        << "Overlap: " << fOverlap << endl
+        << "HeaderBytes: " << kHeaderBytes << endl
+        << "RecordBytes: " << fRecordBytes << endl
+        << "Record: <f8 Time, <u8 Frame, <f4 Data[NChannels][NBins]" << endl
+        << "Note: " << fNote.substr(0, 64) << endl;
+    if (!fFrequencies.empty())
+    {
+        oss << "Frequencies:";
+        for (size_t i=0; i<fFrequencies.size(); i++)
+        {
+            snprintf(width, sizeof(width), " %.6g", fFrequencies[i]);
+            oss << width;
+        }
+        oss << endl;
+    }
+
+    // Pad out with zeros.
+    size_t n = oss.str().size();
+    if (n > kHeaderBytes) n = kHeaderBytes;
+    memset(header, 0, kHeaderBytes);
+    memcpy(header, oss.str().data(), n);
+    if (write(fFD, header, kHeaderBytes) != (ssize_t) kHeaderBytes)
+    {
+        SetError(EWRITE, __LINE__);
+        close(fFD);
+        fFD = -1;
+        SET_DEBUG_STACK;
+        return false;
+    }
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Close
+ *
+ * Description : Write the partial batch and close the file.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void SpectrumFile::Close(void)
+{
+    SET_DEBUG_STACK;
+    if (fFD < 0) return;
+    Flush();
+    close(fFD);
+    fFD = -1;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Reserve
+ *
+ * Description : Stamp the next record in the batch and hand back
+ *               its data area. A full batch is written first.
+ *
+ * Inputs : Time  - UTC of the first sample in the spectrum
+ *          Frame - stream index of that sample
+ *
+ * Returns : NChannels*NBins floats to fill, NULL if not open
+ *
+ * Error Conditions : EWRITE if the batch could not be written
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+float* SpectrumFile::Reserve(double Time, uint64_t Frame)
+{
+    SET_DEBUG_STACK;
+    char *rec;
+    if (fFD < 0) return NULL;
+    if (fBatched == fBatchRecords) Flush();
+
+    rec = &fBatch[fBatched * fRecordBytes];
+    memcpy(rec, &Time, sizeof(double));
+    memcpy(rec + sizeof(double), &Frame, sizeof(uint64_t));
+    // Zero the padding so the file is reproducible.
+    memset(rec + 2*sizeof(uint64_t), 0, fRecordBytes - 2*sizeof(uint64_t));
+    fBatched++;
+    fRecords++;
+    SET_DEBUG_STACK;
+    return (float *) (rec + 2*sizeof(uint64_t));
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Append
+ *
+ * Description : Add a whole record.
+ *
+ * Inputs : Time  - UTC of the first sample
+ *          Frame - stream index of that sample
+ *          data  - NChannels*NBins values, channel major
+ *
+ * Returns : false if not open
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool SpectrumFile::Append(double Time, uint64_t Frame, const float *data)
+{
+    float *dst = Reserve(Time, Frame);
+    if (dst == NULL) return false;
+    memcpy(dst, data, fNChannels * fNBins * sizeof(float));
+    return true;
+}
+bool SpectrumFile::Append(double Time, uint64_t Frame, const double *data)
+{
+    float *dst = Reserve(Time, Frame);
+    if (dst == NULL) return false;
+    for (uint32_t i=0; i<fNChannels*fNBins; i++) dst[i] = (float) data[i];
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Flush
+ *
+ * Description : One write(2) for every record in the batch.
+ *
+ * Inputs : none
+ *
+ * Returns : true if the batch reached the file
+ *
+ * Error Conditions : EWRITE, the batch is dropped
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool SpectrumFile::Flush(void)
+{
+    SET_DEBUG_STACK;
+    size_t      n  = fBatched * fRecordBytes;
+    const char *p  = fBatch;
+    ssize_t     rc;
+    bool        ok = true;
+
+    while ((fFD >= 0) && (n > 0))
+    {
+        rc = write(fFD, p, n);
+        if (rc <= 0)
+        {
+            SetError(EWRITE, __LINE__);
+            ok = false;
+            break;
+        }
+        p += rc;
+        n -= rc;
+    }
+    fBatched = 0;
+    SET_DEBUG_STACK;
+    return ok;
+}
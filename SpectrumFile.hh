@@ -0,0 +1,118 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : SpectrumFile.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Appendable file of spectral products, one record per
+ *               spectrum or PSD. The file starts with a fixed size
+ *               ASCII header of "Key: value" lines, the same idea as
+ *               the .acc header, followed by fixed size records:
+ *
+ *                 f8  Time   UTC seconds of the first sample used
+ *                 u8  Frame  index of that sample in the stream
+ *                 f4  Data[NChannels][NBins]
+ *
+ *               padded to a multiple of 8 bytes (RecordBytes in the
+ *               header). A numpy memmap with offset HeaderBytes and
+ *               that record dtype reads it with no copying.
+ *               Records are collected and written a batch at a time.
+ *               Band levels, where the bins are not evenly spaced,
+ *               list their centre frequencies in the header.
+ *
+ * Restrictions/Limitations :
+ *   One thread per file. Metadata is fixed once the file is open.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Leq band levels with a Frequencies line.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ *******************************************************************
+ */
+#ifndef __SPECTRUMFILE_hh_
+#define __SPECTRUMFILE_hh_
+#  include <cstdint>
+#  include <string>
+#  include <vector>
+#  include "CObject.hh"
+
+class SpectrumFile : public CObject
+{
+public:
+    /**
+     * Build on CObject error codes.
+     */
+    enum {ENO_FILE=1, EWRITE};
+    /*! What the values are. */
+    enum {kPower=0, kMagnitude, kPSD, kLeq};
+
+    /*!
+     * NChan x NBins floats per record, BatchRecords records are
+     * held before each write.
+     */
+    SpectrumFile(uint32_t NChan, uint32_t NBins, uint32_t BatchRecords=8);
+    /*! Flush and close. */
+    ~SpectrumFile(void);
+
+    /* Metadata for the header, set before Open. */
+    inline void SetKind(int v)              {fKind = v;};
+    inline void SetSampleRate(double v)     {fSampleRate = v;};
+    inline void SetFFTLength(uint32_t v)    {fFFTLength = v;};
+    inline void SetAverages(uint32_t v)     {fAverages = v;};
+    inline void SetOverlap(uint32_t v)      {fOverlap = v;};
+    inline void SetWindow(const char *v)    {fWindow = v ? v : "";};
+    inline void SetNote(const char *v)      {fNote = v ? v : "";};
+    /*! Centre of each bin when they are not BinWidth apart. */
+    inline void SetFrequencies(const std::vector<double> &v) {fFrequencies = v;};
+
+    /*! Create Name and write the header, closing any open file. */
+    bool Open(const char *Name);
+    /*! Write anything batched and close. */
+    void Close(void);
+    inline bool IsOpen(void) const {return (fFD >= 0);};
+
+    /*!
+     * Slot for the next record, NChannels*NBins floats, channel
+     * major. Fill it before the next call. NULL if not open.
+     */
+    float* Reserve(double Time, uint64_t Frame);
+    /*! Copy a record in, converting from double if need be. */
+    bool   Append(double Time, uint64_t Frame, const float *data);
+    bool   Append(double Time, uint64_t Frame, const double *data);
+    /*! Write the batch now. */
+    bool   Flush(void);
+
+    inline uint32_t NChannels(void)   const {return fNChannels;};
+    inline uint32_t NBins(void)       const {return fNBins;};
+    inline size_t   RecordBytes(void) const {return fRecordBytes;};
+    /*! Records written or batched in this file. */
+    inline uint64_t Records(void)     const {return fRecords;};
+
+    /*! Size of the ASCII header. */
+    static const size_t kHeaderBytes = 1024;
+    static const char*  KindName(int Kind);
+
+private:
+    int          fFD;
+    uint32_t     fNChannels;
+    uint32_t     fNBins;
+    size_t       fRecordBytes;
+    uint32_t     fBatchRecords;
+    char        *fBatch;        /*! BatchRecords x RecordBytes */
+    uint32_t     fBatched;      /*! Records in fBatch */
+    uint64_t     fRecords;
+
+    int          fKind;
+    double       fSampleRate;
+    uint32_t     fFFTLength;
+    uint32_t     fAverages;
+    uint32_t     fOverlap;
+    std::string  fWindow;
+    std::string  fNote;
+    std::vector<double> fFrequencies;
+};
+#endif
@@ -0,0 +1,217 @@
+/********************************************************************
+ *
+ * Module Name : StaLta.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Recursive STA/LTA detector.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cfloat>
+
+// Local Includes.
+#include "StaLta.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : StaLta constructor
+ *
+ * Description : Coefficients from the window lengths, all channels
+ *               quiet.
+ *
+ * Inputs : NChan      - channels per frame
+ *          SampleRate - Hz
+ *          Sta, Lta   - seconds
+ *          On, Off    - trigger and reset ratios
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+StaLta::StaLta(uint32_t NChan, double SampleRate, double Sta, double Lta,
+               double On, double Off)
+{
+    SET_DEBUG_STACK;
+    double nSta = Sta * SampleRate;
+    double nLta = Lta * SampleRate;
+
+    if (nSta < 1.0)  nSta = 1.0;
+    if (nLta < nSta) nLta = nSta;
+    fNChannels = (NChan > 0) ? NChan : 1;
+    fSta       = 1.0 / nSta;
+    fLta       = 1.0 / nLta;
+    fOn        = On;
+    fOff       = (Off < On) ? Off : On;
+    fWarmup    = (uint64_t) nLta;
+    fFrames    = 0;
+    fActive    = 0;
+    fChannel   = 0;
+    fPeak      = 0.0;
+    fDC        = new double[fNChannels];
+    fShort     = new double[fNChannels];
+    fLong      = new double[fNChannels];
+    fOnNow     = new bool[fNChannels];
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        fDC[c]    = 0.0;
+        fShort[c] = 0.0;
+        fLong[c]  = 0.0;
+        fOnNow[c] = false;
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : StaLta destructor
+ *
+ * Description : Free the per channel state.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+StaLta::~StaLta(void)
+{
+    SET_DEBUG_STACK;
+    delete[] fDC;
+    delete[] fShort;
+    delete[] fLong;
+    delete[] fOnNow;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Ratio
+ *
+ * Description : sta/lta of one channel.
+ *
+ * Inputs : c - channel
+ *
+ * Returns : ratio, 0 before there is any long term average
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double StaLta::Ratio(uint32_t c) const
+{
+    return (fLong[c] > DBL_MIN) ? fShort[c] / fLong[c] : 0.0;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Process
+ *
+ * Description : Update every channel frame by frame. The state is
+ *               copied to locals per channel so the inner loop is
+ *               registers only. The very first sample seeds the DC
+ *               estimate so a large offset does not look like an
+ *               event while the average settles.
+ *
+ * Inputs : frames  - interleaved samples
+ *          nFrames - frames in the block
+ *
+ * Returns : frame of the first quiet to triggered change, -1 if none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int64_t StaLta::Process(const int16_t *frames, uint32_t nFrames)
+{
+    int64_t first = -1;
+    uint64_t start = fFrames;
+
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        const int16_t *in = &frames[c];
+        double dc  = fDC[c];
+        double sta = fShort[c];
+        double lta = fLong[c];
+        bool   on  = fOnNow[c];
+        double peak = fPeak;
+
+        if (start == 0 && nFrames > 0) dc = in[0];
+        for (uint32_t i=0; i<nFrames; i++)
+        {
+            double x = (double) in[i*fNChannels];
+            double d = x - dc;
+            double e = d * d;
+            dc  += (x - dc) * fLta;
+            sta += (e - sta) * fSta;
+            if (!on) lta += (e - lta) * fLta;
+            if (start + i < fWarmup) continue;
+
+            double r = (lta > DBL_MIN) ? sta / lta : 0.0;
+            if (on)
+            {
+                if (r > peak) peak = r;
+                if (r < fOff)
+                {
+                    on = false;
+                    fActive--;
+                }
+            }
+            else if (r >= fOn)
+            {
+                on = true;
+                fActive++;
+                if (r > peak) peak = r;
+                if ((first < 0) || ((int64_t) i < first))
+                {
+                    first    = i;
+                    fChannel = c;
+                }
+            }
+        }
+        fDC[c]    = dc;
+        fShort[c] = sta;
+        fLong[c]  = lta;
+        fOnNow[c] = on;
+        fPeak     = peak;
+    }
+    fFrames += nFrames;
+    return first;
+}
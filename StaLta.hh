@@ -0,0 +1,88 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : StaLta.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Short term over long term average event detector,
+ *               one per channel, recursive so each sample costs a
+ *               handful of multiply adds whatever the windows are.
+ *               The DC offset of the accelerometer is taken out with
+ *               an average over the long window first, the averages
+ *               are of the square of what is left.
+ *
+ *                 d   = x - dc,  dc  += (x - dc)/Nlta
+ *                 sta += (d^2 - sta)/Nsta
+ *                 lta += (d^2 - lta)/Nlta
+ *
+ *               A channel triggers when sta/lta reaches On and stays
+ *               triggered until it falls below Off. The long term
+ *               average is held while triggered so the event does not
+ *               raise its own threshold. Nothing triggers until one
+ *               long window has gone by.
+ *
+ * Restrictions/Limitations :
+ *   One thread.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   Withers et al., "A comparison of select trigger algorithms for
+ *   automated global seismic phase and event detection", BSSA 1998.
+ *
+ *******************************************************************
+ */
+#ifndef __STALTA_hh_
+#define __STALTA_hh_
+#  include <cstdint>
+
+class StaLta
+{
+public:
+    /*!
+     * NChan      - interleaved channels
+     * SampleRate - Hz
+     * Sta, Lta   - window lengths, seconds
+     * On, Off    - ratio to trigger and to reset
+     */
+    StaLta(uint32_t NChan, double SampleRate, double Sta, double Lta,
+           double On, double Off);
+    ~StaLta(void);
+
+    /*!
+     * Run nFrames interleaved frames through every channel. Returns
+     * the frame within the block at which the first channel went
+     * from quiet to triggered, or -1 if none did.
+     */
+    int64_t Process(const int16_t *frames, uint32_t nFrames);
+
+    /*! Any channel triggered at the end of the last block. */
+    inline bool     Active(void)  const {return fActive > 0;};
+    /*! Channel that triggered at the frame Process returned. */
+    inline uint32_t Channel(void) const {return fChannel;};
+    /*! Largest ratio since ResetPeak. */
+    inline double   Peak(void)    const {return fPeak;};
+    inline void     ResetPeak(void) {fPeak = 0.0;};
+    /*! Current ratio of a channel. */
+    double   Ratio(uint32_t c) const;
+
+private:
+    uint32_t fNChannels;
+    double   fSta;          /*! 1/Nsta */
+    double   fLta;          /*! 1/Nlta */
+    double   fOn;
+    double   fOff;
+    uint64_t fWarmup;       /*! Frames before anything can trigger */
+    uint64_t fFrames;
+    double  *fDC;           /*! Per channel state */
+    double  *fShort;
+    double  *fLong;
+    bool    *fOnNow;
+    uint32_t fActive;       /*! Channels triggered */
+    uint32_t fChannel;
+    double   fPeak;
+};
+#endif
@@ -0,0 +1,295 @@
+/********************************************************************
+ *
+ * Module Name : StreamStats.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Streaming per channel amplitude statistics.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstdio>
+
+// Local Includes.
+#include "StreamStats.hh"
+#include "CLogger.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : StreamStats constructor
+ *
+ * Description : Both sets empty.
+ *
+ * Inputs : Name      - label for the log
+ *          NChan     - channels per frame
+ *          ClipLevel - clip threshold, |x|
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+StreamStats::StreamStats(const char *Name, uint32_t NChan, int32_t ClipLevel)
+{
+    SET_DEBUG_STACK;
+    fName      = Name;
+    fNChannels = (NChan > 0) ? NChan : 1;
+    fClip      = ClipLevel;
+    if (fClip < 1)     fClip = 1;
+    if (fClip > 32768) fClip = 32768;
+    fBlock     = new FrameMoments[fNChannels];
+    for (uint32_t w=0; w<kPeriods; w++)
+    {
+        fAcc[w] = new Moments[fNChannels];
+        Reset(w);
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : StreamStats destructor
+ *
+ * Description : Free the per channel state.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+StreamStats::~StreamStats(void)
+{
+    SET_DEBUG_STACK;
+    delete[] fBlock;
+    for (uint32_t w=0; w<kPeriods; w++) delete[] fAcc[w];
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Reset
+ *
+ * Description : Empty one set.
+ *
+ * Inputs : Which - kInterval or kFile
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void StreamStats::Reset(int Which)
+{
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        Moments &m = fAcc[Which][c];
+        m.n      = 0;
+        m.min    = 32767;
+        m.max    = -32768;
+        m.mean   = 0.0;
+        m.m2     = 0.0;
+        m.sumAbs = 0;
+        m.clips  = 0;
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Merge
+ *
+ * Description : Combine a block with the running state. The block
+ *               sums are exact, so its mean and M2 are formed in
+ *               128 bit integers and only then rounded, then the
+ *               two are joined with
+ *                 d    = mean_b - mean_a
+ *                 mean = mean_a + d n_b / n
+ *                 M2   = M2_a + M2_b + d^2 n_a n_b / n
+ *
+ * Inputs : m - running state, updated
+ *          b - block sums
+ *          n - frames in the block
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void StreamStats::Merge(Moments &m, const FrameMoments &b, uint64_t n)
+{
+    if (n == 0) return;
+
+    __int128 s   = b.sum;
+    double   mb  = (double) b.sum / (double) n;
+    double   m2b = (double) ((__int128) n * b.sumSq - s * s) / (double) n;
+    uint64_t na  = m.n;
+    uint64_t nt  = na + n;
+    double   d   = mb - m.mean;
+
+    m.mean  += d * (double) n / (double) nt;
+    m.m2    += m2b + d * d * ((double) na * (double) n / (double) nt);
+    m.n      = nt;
+    if (b.min < m.min) m.min = b.min;
+    if (b.max > m.max) m.max = b.max;
+    m.sumAbs += b.sumAbs;
+    m.clips  += b.clips;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Add
+ *
+ * Description : One pass over the block with the vector kernel,
+ *               then fold the sums into both sets.
+ *
+ * Inputs : frames  - interleaved samples
+ *          nFrames - frames in the block
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void StreamStats::Add(const int16_t *frames, uint32_t nFrames)
+{
+    if (nFrames == 0) return;
+    MomentFrames(frames, fNChannels, nFrames, fClip, fBlock);
+    for (uint32_t w=0; w<kPeriods; w++)
+    {
+        for (uint32_t c=0; c<fNChannels; c++)
+        {
+            Merge(fAcc[w][c], fBlock[c], nFrames);
+        }
+    }
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : MeanAbs, RMS, AC, Peak, Crest
+ *
+ * Description : Derived values, 0 while empty.
+ *
+ * Inputs : Which - kInterval or kFile
+ *          c     - channel
+ *
+ * Returns : value
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double StreamStats::MeanAbs(int Which, uint32_t c) const
+{
+    const Moments &m = fAcc[Which][c];
+    return (m.n > 0) ? (double) m.sumAbs / (double) m.n : 0.0;
+}
+double StreamStats::RMS(int Which, uint32_t c) const
+{
+    const Moments &m = fAcc[Which][c];
+    return (m.n > 0) ? sqrt(m.m2 / (double) m.n + m.mean * m.mean) : 0.0;
+}
+double StreamStats::AC(int Which, uint32_t c) const
+{
+    const Moments &m = fAcc[Which][c];
+    return (m.n > 0) ? sqrt(m.m2 / (double) m.n) : 0.0;
+}
+int32_t StreamStats::Peak(int Which, uint32_t c) const
+{
+    const Moments &m = fAcc[Which][c];
+    if (m.n == 0) return 0;
+    return (-m.min > m.max) ? -m.min : m.max;
+}
+double StreamStats::Crest(int Which, uint32_t c) const
+{
+    double rms = RMS(Which, c);
+    return (rms > 0.0) ? (double) Peak(Which, c) / rms : 0.0;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Publish
+ *
+ * Description : A log line per channel, then start the set again.
+ *
+ * Inputs : Which - kInterval or kFile
+ *          Label - what the set covers, e.g. the file name
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void StreamStats::Publish(int Which, const char *Label)
+{
+    SET_DEBUG_STACK;
+    CLogger *pLogger = CLogger::GetThis();
+
+    if (Frames(Which) == 0) return;
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        pLogger->Log("# Stats %s %s ch%u: n %lu, min %d, max %d, dc %.2f, mean|x| %.2f, rms %.2f, ac %.2f, crest %.2f, clips %lu\n",
+                     fName, Label ? Label : "", c,
+                     (unsigned long) fAcc[Which][c].n,
+                     Min(Which, c), Max(Which, c), DC(Which, c),
+                     MeanAbs(Which, c), RMS(Which, c), AC(Which, c),
+                     Crest(Which, c), (unsigned long) Clips(Which, c));
+    }
+    Reset(Which);
+    SET_DEBUG_STACK;
+}
@@ -0,0 +1,103 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : StreamStats.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Per channel amplitude statistics kept as the data
+ *               goes by, no second pass. Each block is reduced to
+ *               exact integer sums by the MomentFrames kernel and
+ *               folded into running count, mean and M2 with the
+ *               pairwise (Chan/Welford) update, so the variance stays
+ *               good over a day of data with a large DC offset. Two
+ *               sets are kept, one for the reporting interval and
+ *               one for the current file.
+ *
+ *               min, max, dc (signed mean), mean |x|, rms, ac rms
+ *               (dc removed), crest (peak/rms) and clips.
+ *
+ * Restrictions/Limitations :
+ *   One thread, Add and Publish from the same one.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   Chan, Golub and LeVeque, "Updating Formulae and a Pairwise
+ *   Algorithm for Computing Sample Variances", 1979.
+ *
+ *******************************************************************
+ */
+#ifndef __STREAMSTATS_hh_
+#define __STREAMSTATS_hh_
+#  include <cstdint>
+#  include "ScaleKernel.hh"
+
+class StreamStats
+{
+public:
+    /*! Which set of statistics. */
+    enum {kInterval=0, kFile, kPeriods};
+
+    /*!
+     * Name      - used in the log
+     * NChan     - interleaved channels
+     * ClipLevel - |x| at or above this counts as a clip, 1 to 32768
+     */
+    StreamStats(const char *Name, uint32_t NChan, int32_t ClipLevel=32767);
+    ~StreamStats(void);
+
+    /*! Fold nFrames interleaved frames into both sets. */
+    void Add(const int16_t *frames, uint32_t nFrames);
+
+    /*!
+     * One log line per channel for Which, labelled with Label,
+     * then start that set again. Nothing if it is empty.
+     */
+    void Publish(int Which, const char *Label);
+    /*! Start Which again. */
+    void Reset(int Which);
+
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    inline uint64_t Frames(int Which) const {return fAcc[Which][0].n;};
+
+    inline int32_t  Min(int Which, uint32_t c)   const {return fAcc[Which][c].min;};
+    inline int32_t  Max(int Which, uint32_t c)   const {return fAcc[Which][c].max;};
+    inline uint64_t Clips(int Which, uint32_t c) const {return fAcc[Which][c].clips;};
+    /*! Signed mean. */
+    inline double   DC(int Which, uint32_t c)    const {return fAcc[Which][c].mean;};
+    double   MeanAbs(int Which, uint32_t c) const;
+    double   RMS(int Which, uint32_t c)     const;
+    /*! RMS about the mean. */
+    double   AC(int Which, uint32_t c)      const;
+    /*! Largest |x|, 32768 for -32768. */
+    int32_t  Peak(int Which, uint32_t c)    const;
+    /*! Peak/RMS, 0 for silence. */
+    double   Crest(int Which, uint32_t c)   const;
+
+private:
+    /*! Running state of one channel. */
+    typedef struct
+    {
+        uint64_t n;
+        int32_t  min;
+        int32_t  max;
+        double   mean;
+        double   m2;       /*! Sum of squares about the mean */
+        uint64_t sumAbs;
+        uint64_t clips;
+    }
+    Moments;
+
+    /*! Pairwise update of m with n frames summarised in b. */
+    static void Merge(Moments &m, const FrameMoments &b, uint64_t n);
+
+    const char   *fName;
+    uint32_t      fNChannels;
+    int32_t       fClip;
+    FrameMoments *fBlock;             /*! Kernel output, per channel */
+    Moments      *fAcc[kPeriods];
+};
+#endif
@@ -0,0 +1,294 @@
+/********************************************************************
+ *
+ * Module Name : ToneBank.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Goertzel tone trackers.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstdint>
+
+// Local Includes.
+#include "ToneBank.hh"
+#include "debug.h"
+
+/**
+ ******************************************************************
+ *
+ * Function Name : ToneBank constructor
+ *
+ * Description : An empty bank, tones come from AddTone.
+ *
+ * Inputs : NChan      - channels per frame
+ *          SampleRate - Hz
+ *          Seconds    - target window length
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+ToneBank::ToneBank(uint32_t NChan, double SampleRate, double Seconds)
+{
+    SET_DEBUG_STACK;
+    fNChannels  = (NChan > 0) ? NChan : 1;
+    fSampleRate = SampleRate;
+    fSeconds    = (Seconds > 0.0) ? Seconds : 1.0;
+    fScale      = 1.0;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ToneBank destructor
+ *
+ * Description : Nothing to do, the vectors look after themselves.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+ToneBank::~ToneBank(void)
+{
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AddTone
+ *
+ * Description : Work out the coefficients and a window of a whole
+ *               number of cycles, so the tone itself does not leak
+ *               across the window edges, then clear the state.
+ *
+ * Inputs : Frequency - Hz
+ *
+ * Returns : index of the tone, -1 if it is not between 0 and Nyquist
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int32_t ToneBank::AddTone(double Frequency)
+{
+    SET_DEBUG_STACK;
+    Tone   t;
+    double cycles, w, re, im, d, a, b;
+    double hann[kTerms] = {-0.25, 0.5, -0.25};
+
+    if ((Frequency <= 0.0) || (Frequency >= 0.5 * fSampleRate))
+    {
+        return -1;
+    }
+    cycles   = floor(fSeconds * Frequency + 0.5);
+    if (cycles < 2.0) cycles = 2.0;
+    t.freq   = Frequency;
+    t.length = (uint32_t) floor(cycles * fSampleRate / Frequency + 0.5);
+    t.w      = 2.0 * M_PI * Frequency / fSampleRate;
+    t.dcRe   = 0.0;
+    t.dcIm   = 0.0;
+    for (uint32_t j=0; j<kTerms; j++)
+    {
+        w          = t.w + (double) ((int) j - 1) * 2.0 * M_PI / t.length;
+        t.cosw[j]  = cos(w);
+        t.sinw[j]  = sin(w);
+        t.coeff[j] = 2.0 * t.cosw[j];
+        t.rotRe[j] = cos(w * (t.length - 1));
+        t.rotIm[j] = -sin(w * (t.length - 1));
+
+        // sum e^-jwn, n < N = (1 - e^-jwN)/(1 - e^-jw)
+        re = 1.0 - cos(w * t.length);
+        im = sin(w * t.length);
+        a  = 1.0 - t.cosw[j];
+        b  = t.sinw[j];
+        d  = a*a + b*b;
+        t.dcRe += hann[j] * (re*a + im*b) / d;
+        t.dcIm += hann[j] * (im*a - re*b) / d;
+    }
+
+    t.n     = 0;
+    t.first = 0;
+    t.last  = 0;
+    t.count = 0;
+    t.s1.assign(fNChannels * kTerms, 0.0);
+    t.s2.assign(fNChannels * kTerms, 0.0);
+    t.sum.assign(fNChannels, 0.0);
+    t.amp.assign(fNChannels, 0.0);
+    t.phase.assign(fNChannels, 0.0);
+    fTones.push_back(t);
+    SET_DEBUG_STACK;
+    return (int32_t) fTones.size() - 1;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Add
+ *
+ * Description : Each tone walks the block in runs that stop at its
+ *               window end. Within a run a channel's three recursions
+ *               are in registers, three multiplies and seven adds a
+ *               sample with no dependence between them.
+ *
+ * Inputs : frames  - interleaved samples
+ *          nFrames - frames in the block
+ *
+ * Returns : windows completed, over all tones
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t ToneBank::Add(const int16_t *frames, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    uint32_t done = 0;
+    uint32_t i, m, c, j;
+
+    for (Tone &t : fTones)
+    {
+        i = 0;
+        while (i < nFrames)
+        {
+            m = t.length - t.n;
+            if (m > nFrames - i) m = nFrames - i;
+            for (c=0; c<fNChannels; c++)
+            {
+                const int16_t *in = &frames[i*fNChannels + c];
+                double *p1 = &t.s1[c*kTerms];
+                double *p2 = &t.s2[c*kTerms];
+                double  ca = t.coeff[0], cb = t.coeff[1], cc = t.coeff[2];
+                double  a1 = p1[0], b1 = p1[1], c1 = p1[2];
+                double  a2 = p2[0], b2 = p2[1], c2 = p2[2];
+                double  sum = t.sum[c];
+                double  a0, b0, c0, x;
+                for (j=0; j<m; j++)
+                {
+                    x    = (double) in[j*fNChannels];
+                    a0   = x + ca * a1 - a2;
+                    b0   = x + cb * b1 - b2;
+                    c0   = x + cc * c1 - c2;
+                    a2   = a1; a1 = a0;
+                    b2   = b1; b1 = b0;
+                    c2   = c1; c1 = c0;
+                    sum += x;
+                }
+                p1[0] = a1; p1[1] = b1; p1[2] = c1;
+                p2[0] = a2; p2[1] = b2; p2[2] = c2;
+                t.sum[c] = sum;
+            }
+            t.n += m;
+            i   += m;
+            if (t.n == t.length)
+            {
+                Finish(t);
+                done++;
+            }
+        }
+    }
+    SET_DEBUG_STACK;
+    return done;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Finish
+ *
+ * Description : End of a window. Complete the three DFT terms,
+ *               combine them into the Hann term, take out the mean's
+ *               share, publish and start the next window.
+ *
+ * Inputs : t - the tone
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ *
+ * Unit Tested on:
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void ToneBank::Finish(Tone &t)
+{
+    SET_DEBUG_STACK;
+    double yr, yi, xr, xi, mean, cycles, ref, ph, s1, s2;
+    double hann[kTerms] = {-0.25, 0.5, -0.25};
+
+    // Phase of the tone at the window start, from frame 0.
+    cycles = t.freq * (double) t.first / fSampleRate;
+    ref    = 2.0 * M_PI * (cycles - floor(cycles));
+
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        xr = xi = 0.0;
+        for (uint32_t j=0; j<kTerms; j++)
+        {
+            // y = s1 - e^-jw s2, X = e^-jw(N-1) y
+            s1  = t.s1[c*kTerms + j];
+            s2  = t.s2[c*kTerms + j];
+            yr  = s1 - t.cosw[j] * s2;
+            yi  = t.sinw[j] * s2;
+            xr += hann[j] * (t.rotRe[j] * yr - t.rotIm[j] * yi);
+            xi += hann[j] * (t.rotRe[j] * yi + t.rotIm[j] * yr);
+            t.s1[c*kTerms + j] = 0.0;
+            t.s2[c*kTerms + j] = 0.0;
+        }
+        mean = t.sum[c] / (double) t.length;
+        xr  -= mean * t.dcRe;
+        xi  -= mean * t.dcIm;
+
+        t.amp[c] = fScale * 4.0 * sqrt(xr*xr + xi*xi) / (double) t.length;
+        ph = atan2(xi, xr) - ref;
+        ph = fmod(ph + M_PI, 2.0 * M_PI);
+        if (ph < 0.0) ph += 2.0 * M_PI;
+        t.phase[c] = ph - M_PI;
+
+        t.sum[c] = 0.0;
+    }
+    t.last   = t.first;
+    t.first += t.length;
+    t.n      = 0;
+    t.count++;
+    SET_DEBUG_STACK;
+}
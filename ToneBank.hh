@@ -0,0 +1,128 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : ToneBank.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Amplitude and phase of a few known tones, the 100 Hz
+ *               reference, mains and its harmonics, machine lines,
+ *               without transforming the whole record. Each tone is
+ *               integrated over a window of a whole number of its own
+ *               cycles close to Seconds long with Goertzel filters,
+ *               one multiply and two adds per sample each:
+ *
+ *                 s[n] = x[n] + 2cos(w) s[n-1] - s[n-2]
+ *                 X(w) = e^-jw(N-1) (s[N-1] - e^-jw s[N-2])
+ *
+ *               A rectangular window lets a strong line leak tens of
+ *               dB into a weak one nearby, so each tone runs three,
+ *               at w and w +- 2pi/N, which combine to the Hann
+ *               windowed term
+ *
+ *                 Xh = X(w)/2 - X(w-2pi/N)/4 - X(w+2pi/N)/4
+ *
+ *               The three recursions are independent so they overlap
+ *               in the pipeline. The window mean times the DC response
+ *               is taken off so the accelerometer offset does not leak
+ *               in either. At the end of each window
+ *
+ *                 Amplitude = 4|Xh|/N  (counts, times Scale)
+ *                 Phase     = arg Xh - w n0, radians at stream frame 0
+ *
+ *               so a steady tone keeps a steady phase from window to
+ *               window, and a drift in frequency shows as a ramp.
+ *
+ * Restrictions/Limitations :
+ *   One thread. Tones are added before the first block. At least two
+ *   cycles per window.
+ *
+ * Change Descriptions :
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   G. Goertzel, "An algorithm for the evaluation of finite
+ *   trigonometric series", Amer. Math. Monthly 65, 1958.
+ *
+ *******************************************************************
+ */
+#ifndef __TONEBANK_hh_
+#define __TONEBANK_hh_
+#  include <cstdint>
+#  include <vector>
+
+class ToneBank
+{
+public:
+    /*!
+     * NChan      - interleaved channels
+     * SampleRate - Hz
+     * Seconds    - about how long each estimate integrates
+     */
+    ToneBank(uint32_t NChan, double SampleRate, double Seconds=1.0);
+    ~ToneBank(void);
+
+    /*!
+     * Track Frequency, Hz, below Nyquist. Returns its index, or -1
+     * if it can not be tracked.
+     */
+    int32_t  AddTone(double Frequency);
+
+    /*!
+     * Run nFrames interleaved frames through every filter. Returns
+     * the number of tone windows completed, each tone's latest is
+     * held.
+     */
+    uint32_t Add(const int16_t *frames, uint32_t nFrames);
+
+    inline uint32_t NTones(void)    const {return fTones.size();};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    inline double   Frequency(uint32_t k) const {return fTones[k].freq;};
+    /*! Samples per window, whole cycles. */
+    inline uint32_t Window(uint32_t k) const {return fTones[k].length;};
+    /*! Windows completed. */
+    inline uint64_t Count(uint32_t k)  const {return fTones[k].count;};
+    /*! Stream frame (from the first Add) the latest window began at. */
+    inline uint64_t FirstFrame(uint32_t k) const {return fTones[k].last;};
+    inline double   Amplitude(uint32_t k, uint32_t c) const
+	{return fTones[k].amp[c];};
+    inline double   Phase(uint32_t k, uint32_t c) const
+	{return fTones[k].phase[c];};
+
+    /*! counts -> physical units */
+    inline void   SetScale(double v) {fScale = v;};
+    inline double GetScale(void) const {return fScale;};
+
+private:
+    /*! Filters per tone, w-2pi/N, w, w+2pi/N. */
+    static const uint32_t kTerms = 3;
+
+    typedef struct
+    {
+        double   freq;
+        double   w;                   /*! rad/sample */
+        double   coeff[kTerms];       /*! 2cos(w) */
+        double   cosw[kTerms], sinw[kTerms];
+        double   rotRe[kTerms], rotIm[kTerms];  /*! e^-jw(N-1) */
+        double   dcRe, dcIm;          /*! Hann DC response */
+        uint32_t length;              /*! N */
+        uint32_t n;           /*! Samples into this window */
+        uint64_t first;       /*! Stream frame of the window start */
+        uint64_t last;        /*! Same for the published estimate */
+        uint64_t count;
+        std::vector<double> s1, s2;        /*! Channel x kTerms state */
+        std::vector<double> sum;           /*! Per channel */
+        std::vector<double> amp, phase;    /*! Latest estimate */
+    } Tone;
+
+    /*! Turn the filter state into amplitude and phase. */
+    void Finish(Tone &t);
+
+    uint32_t          fNChannels;
+    double            fSampleRate;
+    double            fSeconds;
+    double            fScale;
+    std::vector<Tone> fTones;
+};
+#endif
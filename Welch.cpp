@@ -0,0 +1,442 @@
+/********************************************************************
+ *
+ * Module Name : Welch.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Streaming Welch PSD estimate.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Plans come from the persistent wisdom store.
+ * 17-Oct-26 CBL One batched transform for all channels.
+ * 17-Oct-26 CBL De-interleave with the ScaleFrames kernel.
+ * 17-Oct-26 CBL MakeWindow split out for Spectrogram.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <strings.h>
+
+// Local Includes.
+#include "Welch.hh"
+#include "Wisdom.hh"
+#include "ScaleKernel.hh"
+#include "debug.h"
+
+static const char *WindowNames[] = {"rectangular", "hann", "hamming",
+                                    "blackman"};
+
+/**
+ ******************************************************************
+ *
+ * Function Name : Welch constructor
+ *
+ * Description : Allocate the segment sized buffers, build
+ *               the window and the FFT plan.
+ *
+ * Inputs : Segment    - samples per segment
+ *          Overlap    - samples of overlap, clipped to Segment-1
+ *          NChan      - interleaved channels
+ *          Window     - window enum
+ *          Averages   - segments per published PSD
+ *          SampleRate - Hz
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+Welch::Welch(uint32_t Segment, uint32_t Overlap, uint32_t NChan,
+             int Window, uint32_t Averages, double SampleRate)
+{
+    SET_DEBUG_STACK;
+    fSegment     = (Segment < 2) ? 2 : Segment;
+    fOverlap     = (Overlap >= fSegment) ? fSegment - 1 : Overlap;
+    fNChannels   = (NChan < 1) ? 1 : NChan;
+    fWindowType  = Window;
+    fScaling     = kDensity;
+    fAverages    = (Averages < 1) ? 1 : Averages;
+    fSampleRate  = SampleRate;
+    fScale       = 1.0;
+    fFill        = 0;
+    fFrame       = 0;
+    fSumFrame    = 0;
+    fSummed      = 0;
+    fPublished   = 0;
+    fPublishedFrame = 0;
+    fCount       = 0;
+
+    fWindow     = new double[fSegment];
+    fWindowType = MakeWindow(Window, fSegment, fWindow);
+    fS1 = fS2 = 0.0;
+    for (uint32_t i=0; i<fSegment; i++)
+    {
+        fS1 += fWindow[i];
+        fS2 += fWindow[i] * fWindow[i];
+    }
+
+    fHistory = new double[fNChannels * fSegment];
+    fSum     = new double[fNChannels * NBins()];
+    fPSD     = new double[fNChannels * NBins()];
+    memset(fSum, 0, fNChannels * NBins() * sizeof(double));
+    memset(fPSD, 0, fNChannels * NBins() * sizeof(double));
+
+    fIN  = (double *) fftw_malloc(fNChannels * fSegment * sizeof(double));
+    fOUT = (fftw_complex *) fftw_malloc(fNChannels * NBins() *
+                                        sizeof(fftw_complex));
+    fFFT = Wisdom::PlanR2C(fSegment, fNChannels, fIN, fOUT);
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Welch destructor
+ *
+ * Description : Free everything.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+Welch::~Welch(void)
+{
+    SET_DEBUG_STACK;
+    Wisdom::Destroy(fFFT);
+    fftw_free(fIN);
+    fftw_free(fOUT);
+    delete[] fWindow;
+    delete[] fHistory;
+    delete[] fSum;
+    delete[] fPSD;
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : AddBlock
+ *
+ * Description : De-interleave a block into the per channel
+ *               history. Every time a segment fills it is processed
+ *               and the history slides forward by Segment-Overlap.
+ *
+ * Inputs : samples - interleaved int16 frames
+ *          nFrames - number of frames
+ *
+ * Returns : number of PSDs published during this block
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+uint32_t Welch::AddBlock(const int16_t *samples, uint32_t nFrames)
+{
+    SET_DEBUG_STACK;
+    uint32_t done = 0;
+    uint32_t i    = 0;
+    uint32_t m, c;
+    uint32_t hop  = fSegment - fOverlap;
+    double  *h;
+
+    while (i < nFrames)
+    {
+        m = nFrames - i;
+        if (m > fSegment - fFill) m = fSegment - fFill;
+        ScaleFrames(&samples[i*fNChannels], fNChannels, m, 1.0, NULL,
+                    &fHistory[fFill], fSegment);
+        fFill  += m;
+        fFrame += m;
+        i      += m;
+
+        if (fFill == fSegment)
+        {
+            if (fSummed == 0)
+            {
+                fSumFrame = fFrame - fSegment;
+            }
+            ProcessSegment();
+            for (c=0; c<fNChannels; c++)
+            {
+                h = &fHistory[c*fSegment];
+                memmove(h, &h[hop], fOverlap * sizeof(double));
+            }
+            fFill = fOverlap;
+            fSummed++;
+            if (fSummed >= fAverages)
+            {
+                Emit();
+                done++;
+            }
+        }
+    }
+    SET_DEBUG_STACK;
+    return done;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Emit
+ *
+ * Description : Turn the running sum into a one sided PSD and
+ *               start a new sum.
+ *
+ * Inputs : none
+ *
+ * Returns : true if a PSD was published
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool Welch::Emit(void)
+{
+    SET_DEBUG_STACK;
+    uint32_t nb = NBins();
+    double   norm;
+    double  *sum, *psd;
+
+    if (fSummed == 0) return false;
+
+    if (fScaling == kSpectrum)
+    {
+        norm = fScale * fScale / (fS1 * fS1);
+    }
+    else
+    {
+        norm = fScale * fScale / (fSampleRate * fS2);
+    }
+    norm /= (double) fSummed;
+
+    for (uint32_t c=0; c<fNChannels; c++)
+    {
+        sum = &fSum[c*nb];
+        psd = &fPSD[c*nb];
+        for (uint32_t k=0; k<nb; k++)
+        {
+            psd[k] = 2.0 * norm * sum[k];
+        }
+        // DC, and Nyquist for even lengths, are not folded.
+        psd[0] *= 0.5;
+        if ((fSegment % 2) == 0)
+        {
+            psd[nb-1] *= 0.5;
+        }
+    }
+    memset(fSum, 0, fNChannels * nb * sizeof(double));
+    fPublished      = fSummed;
+    fPublishedFrame = fSumFrame;
+    fSummed         = 0;
+    fCount++;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ProcessSegment
+ *
+ * Description : Remove the segment mean, window, transform
+ *               every channel at once and add |X|^2 to the running
+ *               sums.
+ *
+ * Inputs : none
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void Welch::ProcessSegment(void)
+{
+    SET_DEBUG_STACK;
+    const double       *h;
+    const fftw_complex *out;
+    double             *in, *sum;
+    double              mean;
+    uint32_t            c, i;
+    uint32_t            nb = NBins();
+
+    for (c=0; c<fNChannels; c++)
+    {
+        h    = &fHistory[c*fSegment];
+        in   = &fIN[c*fSegment];
+        mean = 0.0;
+        for (i=0; i<fSegment; i++)
+        {
+            mean += h[i];
+        }
+        mean /= (double) fSegment;
+        for (i=0; i<fSegment; i++)
+        {
+            in[i] = (h[i] - mean) * fWindow[i];
+        }
+    }
+    fftw_execute(fFFT);
+    for (c=0; c<fNChannels; c++)
+    {
+        out = &fOUT[c*nb];
+        sum = &fSum[c*nb];
+        for (i=0; i<nb; i++)
+        {
+            sum[i] += out[i][0]*out[i][0] + out[i][1]*out[i][1];
+        }
+    }
+    SET_DEBUG_STACK;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WindowType
+ *
+ * Description : Config string to window enum.
+ *
+ * Inputs : Name - e.g. "hann"
+ *
+ * Returns : window enum, kHann if not recognised
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int Welch::WindowType(const char *Name)
+{
+    for (int i=kRectangular; i<=kBlackman; i++)
+    {
+        if (Name && (strcasecmp(Name, WindowNames[i]) == 0))
+        {
+            return i;
+        }
+    }
+    // scipy spells it hanning too.
+    if (Name && (strcasecmp(Name, "hanning") == 0)) return kHann;
+    return kHann;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : WindowName
+ *
+ * Description : Window enum to config string.
+ *
+ * Inputs : Window - enum
+ *
+ * Returns : name
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+const char* Welch::WindowName(int Window)
+{
+    if ((Window < kRectangular) || (Window > kBlackman))
+    {
+        Window = kHann;
+    }
+    return WindowNames[Window];
+}
+
+/**
+ ******************************************************************
+ *
+ * Function Name : MakeWindow
+ *
+ * Description : Periodic windows, as scipy uses for spectral
+ *               estimation.
+ *
+ * Inputs : Window - window enum
+ *          N      - length
+ *          w      - N doubles to fill
+ *
+ * Returns : window enum used, kHann if Window is not known
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int Welch::MakeWindow(int Window, uint32_t N, double *w)
+{
+    SET_DEBUG_STACK;
+    double theta;
+
+    if ((Window < kRectangular) || (Window > kBlackman))
+    {
+        Window = kHann;
+    }
+    for (uint32_t i=0; i<N; i++)
+    {
+        theta = 2.0 * M_PI * (double) i / (double) N;
+        switch (Window)
+        {
+        case kRectangular:
+            w[i] = 1.0;
+            break;
+        case kHamming:
+            w[i] = 0.54 - 0.46 * cos(theta);
+            break;
+        case kBlackman:
+            w[i] = 0.42 - 0.5 * cos(theta) + 0.08 * cos(2.0*theta);
+            break;
+        default:
+            w[i] = 0.5 - 0.5 * cos(theta);
+            break;
+        }
+    }
+    SET_DEBUG_STACK;
+    return Window;
+}
@@ -0,0 +1,139 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : Welch.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Streaming Welch power spectral density estimate.
+ *               Blocks of interleaved samples are fed in as they
+ *               arrive, each full segment is windowed, transformed
+ *               and added to a running sum of power spectra. After
+ *               a set number of segments the average is published
+ *               and the sum starts again. Memory and CPU depend only
+ *               on the segment length, not on how long we run.
+ *
+ * Restrictions/Limitations :
+ *   Overlap must be less than Segment.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL All channels transformed in one batched plan.
+ * 17-Oct-26 CBL Window generation shared with Spectrogram.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   P. Welch, "The use of fast Fourier transform for the estimation
+ *   of power spectra", IEEE Trans. Audio Electroacoust. AU-15, 1967
+ *   scipy.signal.welch, which the notebooks used until now.
+ *
+ *******************************************************************
+ */
+#ifndef __WELCH_hh_
+#define __WELCH_hh_
+#  include <cstdint>
+#  include "fftw3.h"
+
+class Welch
+{
+public:
+    /*! Window functions applied to each segment. */
+    enum {kRectangular=0, kHann, kHamming, kBlackman};
+    /*! PSD (units^2/Hz) or power spectrum (units^2) */
+    enum {kDensity=0, kSpectrum};
+
+    /*!
+     * Segment  - samples per segment, per channel
+     * Overlap  - samples shared by consecutive segments
+     * NChan    - channels in the interleaved input
+     * Window   - one of the window enums above
+     * Averages - segments averaged into each published PSD
+     * SampleRate - Hz, used for the frequency axis and scaling
+     */
+    Welch(uint32_t Segment, uint32_t Overlap, uint32_t NChan=1,
+          int Window=kHann, uint32_t Averages=1, double SampleRate=1.0);
+    ~Welch(void);
+
+    /*!
+     * Consume nFrames interleaved frames. Returns the number of
+     * averaged PSDs completed during this block, if more than one
+     * only the last is held.
+     */
+    uint32_t AddBlock(const int16_t *samples, uint32_t nFrames);
+    /*!
+     * Publish whatever has been summed so far even if fewer than
+     * the requested number of segments. Returns false if there is
+     * nothing to publish.
+     */
+    bool     Emit(void);
+
+    /*! Averaged one sided PSD for channel, NBins() long. */
+    inline const double* PSD(uint32_t chan) const
+	{return &fPSD[chan*NBins()];};
+    /*! Number of segments in the published PSD */
+    inline uint32_t Segments(void)  const {return fPublished;};
+    /*! Total PSDs published. */
+    inline uint64_t Count(void)     const {return fCount;};
+    /*! Frame index (from the first AddBlock) of the first sample
+     *  in the published PSD. */
+    inline uint64_t FirstFrame(void) const {return fPublishedFrame;};
+
+    inline uint32_t NBins(void)     const {return fSegment/2 + 1;};
+    inline uint32_t NChannels(void) const {return fNChannels;};
+    inline uint32_t Segment(void)   const {return fSegment;};
+    inline uint32_t Overlap(void)   const {return fOverlap;};
+    inline uint32_t Averages(void)  const {return fAverages;};
+    inline int      Window(void)    const {return fWindowType;};
+    inline double   SampleRate(void) const {return fSampleRate;};
+    inline double   BinWidth(void)  const {return fSampleRate/(double)fSegment;};
+
+    /*! counts -> physical units, applied before squaring */
+    inline void   SetScale(double v) {fScale = v;};
+    inline double GetScale(void) const {return fScale;};
+    /*! kDensity or kSpectrum */
+    inline void SetScaling(int Scaling) {fScaling = Scaling;};
+    inline int  GetScaling(void) const {return fScaling;};
+
+    /*! Map a config string to a window enum, Hann if unknown. */
+    static int         WindowType(const char *Name);
+    /*! and back again */
+    static const char* WindowName(int Window);
+    /*!
+     * Fill w[0..N-1] with the periodic window, returns the window
+     * actually used (Hann if Window is not known).
+     */
+    static int         MakeWindow(int Window, uint32_t N, double *w);
+
+private:
+    /*! Window, transform and sum the full segment, all channels. */
+    void ProcessSegment(void);
+
+    uint32_t  fSegment;      /*! FFT length */
+    uint32_t  fOverlap;      /*! Retained samples between segments */
+    uint32_t  fNChannels;
+    int       fWindowType;
+    int       fScaling;
+    uint32_t  fAverages;     /*! Segments per published PSD */
+    double    fSampleRate;
+    double    fScale;
+    double    fS1;           /*! Sum of window */
+    double    fS2;           /*! Sum of window squared */
+
+    double   *fWindow;       /*! Segment long */
+    double   *fHistory;      /*! NChan x Segment, incoming samples */
+    uint32_t  fFill;         /*! Samples in fHistory per channel */
+    uint64_t  fFrame;        /*! Frames consumed */
+    uint64_t  fSumFrame;     /*! First frame in the running sum */
+
+    double   *fSum;          /*! NChan x NBins running sum */
+    uint32_t  fSummed;       /*! Segments in fSum */
+    double   *fPSD;          /*! NChan x NBins published average */
+    uint32_t  fPublished;
+    uint64_t  fPublishedFrame;
+    uint64_t  fCount;
+
+    fftw_plan     fFFT;
+    double       *fIN;       /*! NChan x Segment, planar */
+    fftw_complex *fOUT;      /*! NChan x NBins */
+};
+#endif
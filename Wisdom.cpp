@@ -0,0 +1,457 @@
+/********************************************************************
+ *
+ * Module Name : Wisdom.cpp
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Persistent FFTW wisdom and serialised planning.
+ *
+ * Restrictions/Limitations :
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Batched (plan_many) real to complex plans.
+ * 17-Oct-26 CBL fftwf plans for the single precision analysis.
+ * 17-Oct-26 CBL fftw3_threads, plans carry a thread count.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *
+ ********************************************************************/
+// System includes.
+
+#include <iostream>
+using namespace std;
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <strings.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Local Includes.
+#include "Wisdom.hh"
+#include "debug.h"
+
+std::mutex  Wisdom::fLock;
+std::string Wisdom::fDirectory;
+unsigned    Wisdom::fFlags        = FFTW_MEASURE;
+int         Wisdom::fThreadInit   = 0;
+
+static const struct
+{
+    const char *name;
+    unsigned    flags;
+} Efforts[] = {{"estimate",   FFTW_ESTIMATE},
+               {"measure",    FFTW_MEASURE},
+               {"patient",    FFTW_PATIENT},
+               {"exhaustive", FFTW_EXHAUSTIVE}};
+static const int NEfforts = sizeof(Efforts)/sizeof(Efforts[0]);
+
+/**
+ ******************************************************************
+ *
+ * Function Name : SetDirectory
+ *
+ * Description : Set, and create if need be, the directory
+ *               that holds the wisdom files.
+ *
+ * Inputs : Dir - directory, NULL or empty to disable
+ *
+ * Returns : true if the directory is usable
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool Wisdom::SetDirectory(const char *Dir)
+{
+    SET_DEBUG_STACK;
+    struct stat st;
+    std::lock_guard<std::mutex> lock(fLock);
+
+    fDirectory.clear();
+    if ((Dir == NULL) || (*Dir == 0)) return false;
+
+    if ((stat(Dir, &st) != 0) && (mkdir(Dir, 0755) != 0))
+    {
+        return false;
+    }
+    fDirectory = Dir;
+    SET_DEBUG_STACK;
+    return true;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : SetEffort
+ *
+ * Description : Select the planner effort by name.
+ *
+ * Inputs : Effort - estimate, measure, patient, exhaustive
+ *
+ * Returns : true if recognised
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool Wisdom::SetEffort(const char *Effort)
+{
+    SET_DEBUG_STACK;
+    for (int i=0; i<NEfforts; i++)
+    {
+        if (Effort && (strcasecmp(Effort, Efforts[i].name) == 0))
+        {
+            fFlags = Efforts[i].flags;
+            return true;
+        }
+    }
+    return false;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Effort
+ *
+ * Description : Name of the current planner effort.
+ *
+ * Inputs : none
+ *
+ * Returns : name
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+const char* Wisdom::Effort(void)
+{
+    for (int i=0; i<NEfforts; i++)
+    {
+        if (fFlags == Efforts[i].flags) return Efforts[i].name;
+    }
+    return "unknown";
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Filename
+ *
+ * Description : Wisdom file name for a transform. The key is
+ *               the kind, size, batch, precision and thread count so
+ *               that a change in any of them gets planned afresh.
+ *
+ * Inputs : Kind      - transform type, r2c
+ *          N         - length
+ *          HowMany   - number of transforms in the batch
+ *          Precision - d or f
+ *          Threads   - threads the plan was made for
+ *
+ * Returns : full path, empty if disabled
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+std::string Wisdom::Filename(const char *Kind, int N, int HowMany,
+                             char Precision, int Threads)
+{
+    char name[128];
+    if (fDirectory.empty()) return std::string();
+    snprintf(name, sizeof(name), "/%s_%c_%dx%d_t%d.wisdom", Kind, Precision,
+             N, HowMany, Threads);
+    return fDirectory + name;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : InitThreads
+ *
+ * Description : Start FFTW's thread support for both precisions, once.
+ *
+ * Inputs : none
+ *
+ * Returns : true if threaded plans are available
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+bool Wisdom::InitThreads(void)
+{
+    SET_DEBUG_STACK;
+    if (fThreadInit == 0)
+    {
+        fThreadInit = (fftw_init_threads() && fftwf_init_threads()) ? 1 : -1;
+    }
+    return (fThreadInit > 0);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : ThreadCount
+ *
+ * Description : Resolve a configured thread count. 0 or less is
+ *               one thread per core. Anything above 1 needs FFTW's
+ *               thread support.
+ *
+ * Inputs : Threads - requested
+ *
+ * Returns : threads to plan with
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+int Wisdom::ThreadCount(int Threads)
+{
+    SET_DEBUG_STACK;
+    std::lock_guard<std::mutex> lock(fLock);
+    if (Threads <= 0)
+    {
+        Threads = (int) std::thread::hardware_concurrency();
+    }
+    if (Threads <= 1) return 1;
+    return InitThreads() ? Threads : 1;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : PlanR2C
+ *
+ * Description : Make a batched real to complex plan over planar
+ *               data, one planner call for every channel. Import the wisdom
+ *               for this key if there is any and try for a plan from
+ *               wisdom alone. If that fails plan the hard way and
+ *               save the result for next time.
+ *
+ * Inputs : N        - transform length
+ *          HowMany  - number of transforms
+ *          in       - HowMany*N doubles
+ *          out      - HowMany*(N/2+1) complex
+ *          Threads  - threads to execute with, see ThreadCount
+ *          PlanTime - if not NULL, seconds spent planning
+ *
+ * Returns : plan, NULL on failure
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+fftw_plan Wisdom::PlanR2C(int N, int HowMany, double *in,
+                          fftw_complex *out, int Threads, double *PlanTime)
+{
+    SET_DEBUG_STACK;
+    fftw_plan   plan = NULL;
+    std::string file;
+    std::lock_guard<std::mutex> lock(fLock);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    int         nb = N/2 + 1;
+    if ((Threads > 1) && !InitThreads()) Threads = 1;
+    if (Threads < 1) Threads = 1;
+    // Global planner state, hence under the lock.
+    if (fThreadInit > 0) fftw_plan_with_nthreads(Threads);
+    file = Filename("r2c", N, HowMany, 'd', Threads);
+    if (PlanTime) *PlanTime = 0.0;
+    if (!file.empty() && fftw_import_wisdom_from_filename(file.c_str()))
+    {
+        plan = fftw_plan_many_dft_r2c(1, &N, HowMany, in, NULL, 1, N,
+                                      out, NULL, 1, nb,
+                                      fFlags | FFTW_WISDOM_ONLY);
+    }
+    if (plan == NULL)
+    {
+        plan = fftw_plan_many_dft_r2c(1, &N, HowMany, in, NULL, 1, N,
+                                      out, NULL, 1, nb, fFlags);
+        std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+        if (PlanTime) *PlanTime = dt.count();
+        if (plan && !file.empty() && (fFlags != FFTW_ESTIMATE))
+        {
+            fftw_export_wisdom_to_filename(file.c_str());
+        }
+    }
+    SET_DEBUG_STACK;
+    return plan;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : PlanR2C
+ *
+ * Description : Single precision version of the above. fftwf keeps
+ *               its own wisdom so it has its own file.
+ *
+ * Inputs : N        - transform length
+ *          HowMany  - number of transforms
+ *          in       - HowMany*N floats
+ *          out      - HowMany*(N/2+1) complex
+ *          Threads  - threads to execute with, see ThreadCount
+ *          PlanTime - if not NULL, seconds spent planning
+ *
+ * Returns : plan, NULL on failure
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+fftwf_plan Wisdom::PlanR2C(int N, int HowMany, float *in,
+                           fftwf_complex *out, int Threads, double *PlanTime)
+{
+    SET_DEBUG_STACK;
+    fftwf_plan  plan = NULL;
+    std::string file;
+    std::lock_guard<std::mutex> lock(fLock);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    int         nb = N/2 + 1;
+    if ((Threads > 1) && !InitThreads()) Threads = 1;
+    if (Threads < 1) Threads = 1;
+    if (fThreadInit > 0) fftwf_plan_with_nthreads(Threads);
+    file = Filename("r2c", N, HowMany, 'f', Threads);
+    if (PlanTime) *PlanTime = 0.0;
+    if (!file.empty() && fftwf_import_wisdom_from_filename(file.c_str()))
+    {
+        plan = fftwf_plan_many_dft_r2c(1, &N, HowMany, in, NULL, 1, N,
+                                       out, NULL, 1, nb,
+                                       fFlags | FFTW_WISDOM_ONLY);
+    }
+    if (plan == NULL)
+    {
+        plan = fftwf_plan_many_dft_r2c(1, &N, HowMany, in, NULL, 1, N,
+                                       out, NULL, 1, nb, fFlags);
+        std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+        if (PlanTime) *PlanTime = dt.count();
+        if (plan && !file.empty() && (fFlags != FFTW_ESTIMATE))
+        {
+            fftwf_export_wisdom_to_filename(file.c_str());
+        }
+    }
+    SET_DEBUG_STACK;
+    return plan;
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Destroy
+ *
+ * Description : Destroy a plan with the planner lock held.
+ *
+ * Inputs : p - plan
+ *
+ * Returns : none
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+void Wisdom::Destroy(fftw_plan p)
+{
+    std::lock_guard<std::mutex> lock(fLock);
+    if (p) fftw_destroy_plan(p);
+}
+void Wisdom::Destroy(fftwf_plan p)
+{
+    std::lock_guard<std::mutex> lock(fLock);
+    if (p) fftwf_destroy_plan(p);
+}
+/**
+ ******************************************************************
+ *
+ * Function Name : Warm
+ *
+ * Description : Plan a batch of length N transforms on scratch
+ *               arrays so the wisdom is on disk before the real run.
+ *
+ * Inputs : N       - transform length
+ *          HowMany - number of transforms
+ *          Single  - fftwf rather than fftw
+ *          Threads - threads the plan will run on
+ *
+ * Returns : seconds spent planning, 0 if from wisdom, <0 on failure
+ *
+ * Error Conditions : none
+ * 
+ * Unit Tested on: 
+ *
+ * Unit Tested by: CBL
+ *
+ *
+ *******************************************************************
+ */
+double Wisdom::Warm(int N, int HowMany, bool Single, int Threads)
+{
+    SET_DEBUG_STACK;
+    double        rc;
+    if (Single)
+    {
+        float         *fin  = (float *) fftwf_malloc(HowMany * N * sizeof(float));
+        fftwf_complex *fout = (fftwf_complex *)
+            fftwf_malloc(HowMany * (N/2+1) * sizeof(fftwf_complex));
+        fftwf_plan     fp   = PlanR2C(N, HowMany, fin, fout, Threads, &rc);
+
+        if (fp == NULL) rc = -1.0;
+        Destroy(fp);
+        fftwf_free(fin);
+        fftwf_free(fout);
+        return rc;
+    }
+    double       *in  = (double *) fftw_malloc(HowMany * N * sizeof(double));
+    fftw_complex *out = (fftw_complex *)
+        fftw_malloc(HowMany * (N/2+1) * sizeof(fftw_complex));
+    fftw_plan     p   = PlanR2C(N, HowMany, in, out, Threads, &rc);
+
+    if (p == NULL) rc = -1.0;
+    Destroy(p);
+    fftw_free(in);
+    fftw_free(out);
+    SET_DEBUG_STACK;
+    return rc;
+}
@@ -0,0 +1,102 @@
+/**
+ ******************************************************************
+ *
+ * Module Name : Wisdom.hh
+ *
+ * Author/Date : C.B. Lirakis / 17-Oct-26
+ *
+ * Description : Persistent FFTW wisdom. Every plan the program makes
+ *               goes through here. Wisdom is kept in one file per
+ *               transform size, precision and thread count in a
+ *               directory next to the configuration file. The first
+ *               time a size is seen it is planned with the configured
+ *               effort (FFTW_MEASURE by default) and the wisdom saved,
+ *               after that the plan comes straight from the file.
+ *
+ * Restrictions/Limitations :
+ *   The FFTW planner is not thread safe, all plan creation and
+ *   destruction is serialised here. fftw_execute is safe.
+ *
+ * Change Descriptions :
+ * 17-Oct-26 CBL Batched plans, the key includes the batch count.
+ * 17-Oct-26 CBL Single precision (fftwf) plans, separate wisdom files.
+ * 17-Oct-26 CBL Multi threaded plans, the thread count is part of the
+ *               wisdom key.
+ *
+ * Classification : Unclassified
+ *
+ * References :
+ *   http://www.fftw.org/fftw3_doc/Words-of-Wisdom_002dSaving-Plans.html
+ *
+ *******************************************************************
+ */
+#ifndef __WISDOM_hh_
+#define __WISDOM_hh_
+#  include <cstdint>
+#  include <string>
+#  include <mutex>
+#  include "fftw3.h"
+
+class Wisdom
+{
+public:
+    /*!
+     * Where the wisdom files live, created if it does not exist.
+     * Empty means do not save wisdom at all.
+     */
+    static bool SetDirectory(const char *Dir);
+    static inline const char* Directory(void) {return fDirectory.c_str();};
+
+    /*!
+     * Planner effort: estimate, measure, patient or exhaustive.
+     * Returns false and leaves the effort alone if not recognised.
+     */
+    static bool SetEffort(const char *Effort);
+    static const char* Effort(void);
+
+    /*!
+     * HowMany 1D real to complex transforms of length N in one plan,
+     * from wisdom if we have it, otherwise planned with the
+     * configured effort and saved. Data is planar, transform i
+     * reads in[i*N] and writes out[i*(N/2+1)]. in/out may be
+     * overwritten during planning. If PlanTime is given it is set
+     * to the seconds spent planning, 0 if the plan came from wisdom.
+     * Threads is the number of threads the plan may use at execute.
+     */
+    static fftw_plan PlanR2C(int N, int HowMany, double *in,
+                             fftw_complex *out, int Threads=1,
+                             double *PlanTime=NULL);
+    /*! Same, single precision. */
+    static fftwf_plan PlanR2C(int N, int HowMany, float *in,
+                              fftwf_complex *out, int Threads=1,
+                              double *PlanTime=NULL);
+    /*! Destroy a plan made here. */
+    static void      Destroy(fftw_plan p);
+    static void      Destroy(fftwf_plan p);
+
+    /*!
+     * Make sure there is wisdom for HowMany length N transforms.
+     * Returns the seconds spent planning, 0 if it came from the file.
+     */
+    static double    Warm(int N, int HowMany=1, bool Single=false,
+                          int Threads=1);
+
+    /*!
+     * Threads actually used for a request of Threads, 0 means one
+     * per core. Falls back to 1 if FFTW threads can not be started.
+     */
+    static int       ThreadCount(int Threads);
+
+private:
+    /*! Wisdom file for this transform. */
+    static std::string Filename(const char *Kind, int N, int HowMany,
+                                char Precision, int Threads);
+    /*! fftw(f)_init_threads once, planner lock held. */
+    static bool        InitThreads(void);
+
+    static std::mutex  fLock;       /*! Guards the FFTW planner. */
+    static std::string fDirectory;
+    static unsigned    fFlags;      /*! FFTW planner flags */
+    static int         fThreadInit; /*! 0 not tried, 1 ok, -1 failed */
+};
+#endif
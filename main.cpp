@@ -10,6 +10,8 @@
  * Restrictions/Limitations :
  *
  * Change Descriptions :
+ * 17-Oct-26 CBL -f analyses .acc files in a batch.
+ * 17-Oct-26 CBL -w warms the wisdom offline.
  *
  * Classification : Unclassified
  *
@@ -34,6 +36,8 @@ static unsigned int VerboseLevel = 0;
 /** Pointer to the logger structure. */
 static CLogger   *logger;
 static bool ScanForDevices = false;
+static bool WarmWisdom     = false;
+static char *BatchFiles    = NULL;
 static char *Note = NULL;
 
 /**
@@ -61,6 +65,8 @@ static void Help(void)
     cout << "*   -h help                                *" << endl;
     cout << "*   -n 'some note for the logfile'         *" << endl;
     cout << "*   -s Scan for devices                    *" << endl;
+    cout << "*   -w Pre-plan FFTs and save wisdom       *" << endl;
+    cout << "*   -f 'dir or glob' analyse .acc files    *" << endl;
     cout << "*                                          *" << endl;
     cout << "********************************************" << endl;
 }
@@ -92,10 +98,11 @@ ProcessCommandLineArgs(int argc, char **argv)
     SET_DEBUG_STACK;
     do
     {
-        option = getopt( argc, argv, "f:hHN:n:sSv");
+        option = getopt( argc, argv, "f:hHN:n:sSvw");
         switch(option)
         {
         case 'f':
+            BatchFiles = strdup(optarg);
             break;
         case 'h':
         case 'H':
@@ -110,6 +117,9 @@ ProcessCommandLineArgs(int argc, char **argv)
 	case 'S':
 	  ScanForDevices = true;
 	  break;
+	case 'w':
+	    WarmWisdom = true;
+	    break;
 	case 'v':
 	    VerboseLevel = atoi(optarg);
             break;
@@ -185,7 +195,9 @@ int main(int argc, char **argv)
     ProcessCommandLineArgs(argc, argv);
     if (Initialize())
     {
-        MainModule *pModule = new MainModule("Accelerometer.cfg", Note);
+        // Batch runs and wisdom warming need no audio device or files.
+        MainModule *pModule = new MainModule("Accelerometer.cfg", Note,
+                                             (BatchFiles != NULL) || WarmWisdom);
 
 	if (pModule->Error() == 0)
 	{
@@ -194,6 +206,14 @@ int main(int argc, char **argv)
 	    {
 	        pModule->EnumerateAvailable();
 	    }
+	    else if (BatchFiles)
+	    {
+	        pModule->Batch(BatchFiles);
+	    }
+	    else if (WarmWisdom)
+	    {
+	        pModule->WarmWisdom();
+	    }
 	    else
 	    {
 	        pModule->Do();